@@ -43,6 +43,9 @@ private:
 class MessageBuilder : public capnp::MallocMessageBuilder {
 public:
   MessageBuilder() = default;
+  // build into a caller owned, zeroed first segment to avoid allocating per message.
+  // the segment is zeroed again when the builder is destroyed, so it can be reused.
+  explicit MessageBuilder(kj::ArrayPtr<capnp::word> firstSegment) : capnp::MallocMessageBuilder(firstSegment) {}
 
   cereal::Event::Builder initEvent(bool valid = true) {
     cereal::Event::Builder event = initRoot<cereal::Event>();
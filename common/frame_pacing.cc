@@ -0,0 +1,82 @@
+#include "common/frame_pacing.h"
+
+#include <algorithm>
+#include <cinttypes>
+
+#include "common/swaglog.h"
+
+FramePacingMonitor::FramePacingMonitor(const std::string &name, uint64_t budget_ns, double log_interval_s)
+    : name(name), budget_ns(budget_ns), log_interval_ns(log_interval_s * 1e9) {}
+
+void FramePacingMonitor::received(uint32_t frame_id, uint64_t timestamp_eof, uint64_t now_ns) {
+  bool log = false;
+  {
+    std::lock_guard lk(lock);
+    if (window_start_ns == 0) window_start_ns = now_ns;
+
+    if (has_frame) {
+      if (frame_id > last_frame_id + 1) {
+        uint32_t gap = frame_id - last_frame_id - 1;
+        window.dropped += gap;
+        window.gaps++;
+        window.max_gap = std::max(window.max_gap, gap);
+      } else if (frame_id <= last_frame_id) {
+        window.resets++;
+      }
+    }
+    has_frame = true;
+    last_frame_id = frame_id;
+    last_received_ns = now_ns;
+    window.frames++;
+    // a publisher on another clock can't be ahead of us
+    latency.record(now_ns > timestamp_eof ? now_ns - timestamp_eof : 0);
+
+    log = log_interval_ns > 0 && now_ns - window_start_ns >= log_interval_ns;
+  }
+  if (log) logSummary(now_ns);
+}
+
+bool FramePacingMonitor::processed(uint64_t now_ns) {
+  std::lock_guard lk(lock);
+  uint64_t dt = now_ns - last_received_ns;
+  processing.record(dt);
+  bool in_budget = budget_ns == 0 || dt <= budget_ns;
+  window.over_budget += !in_budget;
+  return in_budget;
+}
+
+FramePacingMonitor::Summary FramePacingMonitor::summaryLocked() const {
+  Summary s = window;
+  s.latency_p50 = latency.percentile(50);
+  s.latency_p99 = latency.percentile(99);
+  s.latency_max = latency.max();
+  s.processing_p50 = processing.percentile(50);
+  s.processing_p99 = processing.percentile(99);
+  s.processing_max = processing.max();
+  return s;
+}
+
+FramePacingMonitor::Summary FramePacingMonitor::summary() const {
+  std::lock_guard lk(lock);
+  return summaryLocked();
+}
+
+void FramePacingMonitor::logSummary(uint64_t now_ns) {
+  Summary s;
+  {
+    std::lock_guard lk(lock);
+    s = summaryLocked();
+    window = {};
+    latency.reset();
+    processing.reset();
+    window_start_ns = now_ns;
+  }
+
+  // dropping frames is worth a warning, the rest is only for debugging
+  const int level = s.dropped > 0 || s.over_budget > 0 ? CLOUDLOG_WARNING : CLOUDLOG_DEBUG;
+  cloudlog(level, "%s pacing: %" PRIu64 " frames, %" PRIu64 " dropped in %" PRIu64 " gaps (max %u), %" PRIu64 " resets; "
+           "latency p50 %.1f ms, p99 %.1f ms, max %.1f ms; processing p50 %.1f ms, p99 %.1f ms, max %.1f ms, %" PRIu64 " over budget",
+           name.c_str(), s.frames, s.dropped, s.gaps, s.max_gap, s.resets,
+           s.latency_p50 / 1e6, s.latency_p99 / 1e6, s.latency_max / 1e6,
+           s.processing_p50 / 1e6, s.processing_p99 / 1e6, s.processing_max / 1e6, s.over_budget);
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+#include "common/ratekeeper.h"
+#include "common/timing.h"
+
+// Frame accounting for a VisionIpc consumer: frame id gaps, latency from the end of
+// exposure to the receive, and the time spent on each frame against a budget. Call
+// received() after VisionIpcClient::recv and processed() when done with the frame,
+// a summary of the last window is logged every log_interval_s.
+class FramePacingMonitor {
+public:
+  struct Summary {
+    uint64_t frames = 0;
+    uint64_t dropped = 0;       // frame ids that were never received
+    uint64_t gaps = 0;          // receives that skipped at least one frame id
+    uint32_t max_gap = 0;
+    uint64_t resets = 0;        // frame id went backwards, e.g. the camera restarted
+    uint64_t over_budget = 0;   // frames processed slower than the budget
+    uint64_t latency_p50 = 0, latency_p99 = 0, latency_max = 0;
+    uint64_t processing_p50 = 0, processing_p99 = 0, processing_max = 0;
+  };
+
+  FramePacingMonitor(const std::string &name, uint64_t budget_ns, double log_interval_s = 10.0);
+
+  void received(uint32_t frame_id, uint64_t timestamp_eof, uint64_t now_ns = nanos_since_boot());
+  // time since the last received(), returns false if it was over budget
+  bool processed(uint64_t now_ns = nanos_since_boot());
+
+  // the current window, thread safe
+  Summary summary() const;
+  // logs the current window and starts the next
+  void logSummary(uint64_t now_ns = nanos_since_boot());
+
+private:
+  Summary summaryLocked() const;
+
+  const std::string name;
+  const uint64_t budget_ns;
+  const uint64_t log_interval_ns;
+
+  mutable std::mutex lock;
+  bool has_frame = false;
+  uint32_t last_frame_id = 0;
+  uint64_t last_received_ns = 0;
+  uint64_t window_start_ns = 0;
+  Summary window;
+  TimingHistogram latency, processing;
+};
@@ -1,11 +1,63 @@
 #include "common/ratekeeper.h"
 
 #include <algorithm>
+#include <cerrno>
+#include <cinttypes>
+#include <cmath>
+#include <ctime>
 
 #include "common/swaglog.h"
 #include "common/timing.h"
 #include "common/util.h"
 
+// single writer, so plain loads and stores are enough to keep the histogram lock-free
+static inline void add(std::atomic<uint64_t> &v, uint64_t n) {
+  v.store(v.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+
+void TimingHistogram::record(uint64_t ns) {
+  uint64_t us = ns / 1000;
+  int bucket = us == 0 ? 0 : std::min(NUM_BUCKETS - 1, 64 - __builtin_clzll(us));
+  add(buckets_[bucket], 1);
+  add(count_, 1);
+  add(sum_, ns);
+  if (ns > max_.load(std::memory_order_relaxed)) {
+    max_.store(ns, std::memory_order_relaxed);
+  }
+}
+
+void TimingHistogram::reset() {
+  for (auto &b : buckets_) b.store(0, std::memory_order_relaxed);
+  count_.store(0, std::memory_order_relaxed);
+  sum_.store(0, std::memory_order_relaxed);
+  max_.store(0, std::memory_order_relaxed);
+}
+
+double TimingHistogram::mean() const {
+  uint64_t n = count();
+  return n > 0 ? (double)sum_.load(std::memory_order_relaxed) / n : 0;
+}
+
+uint64_t TimingHistogram::percentile(double p) const {
+  uint64_t counts[NUM_BUCKETS];
+  uint64_t total = 0;
+  for (int i = 0; i < NUM_BUCKETS; i++) {
+    counts[i] = buckets_[i].load(std::memory_order_relaxed);
+    total += counts[i];
+  }
+  if (total == 0) return 0;
+
+  uint64_t target = std::max<uint64_t>(1, std::ceil(total * std::clamp(p, 0.0, 100.0) / 100.0));
+  uint64_t cumulative = 0;
+  for (int i = 0; i < NUM_BUCKETS; i++) {
+    cumulative += counts[i];
+    if (cumulative >= target) {
+      return (1ULL << i) * 1000;
+    }
+  }
+  return (1ULL << (NUM_BUCKETS - 1)) * 1000;
+}
+
 RateKeeper::RateKeeper(const std::string &name, float rate, float print_delay_threshold)
     : name(name),
       print_delay_threshold(std::max(0.f, print_delay_threshold)) {
@@ -14,7 +66,19 @@ RateKeeper::RateKeeper(const std::string &name, float rate, float print_delay_th
   next_frame_time = last_monitor_time + interval;
 }
 
+void RateKeeper::useAbsoluteDeadlines(uint32_t spin_us) {
+  absolute = true;
+  interval_ns = std::llround(interval * 1e9);
+  spin_ns = std::min<uint64_t>(spin_us * 1000ULL, interval_ns);
+  last_wakeup_ns = nanos_monotonic();
+  next_deadline_ns = last_wakeup_ns + interval_ns;
+}
+
 bool RateKeeper::keepTime() {
+  if (absolute) {
+    return keepDeadline();
+  }
+
   bool lagged = monitorTime();
   if (remaining_ > 0) {
     util::sleep_for(remaining_ * 1000);
@@ -38,3 +102,51 @@ bool RateKeeper::monitorTime() {
   }
   return lagged;
 }
+
+static void sleep_until(uint64_t deadline_ns) {
+#ifdef __APPLE__
+  uint64_t now = nanos_monotonic();
+  if (deadline_ns > now) {
+    struct timespec ts = {(time_t)((deadline_ns - now) / 1000000000ULL), (long)((deadline_ns - now) % 1000000000ULL)};
+    nanosleep(&ts, nullptr);
+  }
+#else
+  struct timespec ts = {(time_t)(deadline_ns / 1000000000ULL), (long)(deadline_ns % 1000000000ULL)};
+  while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr) == EINTR) {}
+#endif
+}
+
+bool RateKeeper::keepDeadline() {
+  ++frame_;
+  uint64_t now = nanos_monotonic();
+  loop_duration.record(now - last_wakeup_ns);
+  int64_t remaining = (int64_t)(next_deadline_ns - now);
+  remaining_ = remaining * 1e-9;
+
+  if (remaining < 0) {
+    lagged_frames++;
+    if (print_delay_threshold > 0 && remaining_ < -print_delay_threshold) {
+      LOGW("%s lagging by %.2f ms", name.c_str(), -remaining_ * 1000);
+    }
+    // skip the missed deadlines instead of catching up
+    next_deadline_ns = now + interval_ns;
+    last_wakeup_ns = now;
+    return true;
+  }
+
+  if (remaining > (int64_t)spin_ns) {
+    sleep_until(next_deadline_ns - spin_ns);
+  }
+  while ((now = nanos_monotonic()) < next_deadline_ns) {}
+
+  wakeup_error.record(now - next_deadline_ns);
+  last_wakeup_ns = now;
+  next_deadline_ns += interval_ns;
+  return false;
+}
+
+void RateKeeper::logStats() {
+  LOG("%s timing: wakeup error p50 %.1f us, p99 %.1f us, max %.1f us; loop p99 %.1f us, max %.1f us; lagged %" PRIu64 "/%" PRIu64,
+      name.c_str(), wakeup_error.percentile(50) / 1e3, wakeup_error.percentile(99) / 1e3, wakeup_error.max() / 1e3,
+      loop_duration.percentile(99) / 1e3, loop_duration.max() / 1e3, lagged_frames, frame_);
+}
@@ -1,18 +1,52 @@
 #pragma once
 
+#include <atomic>
 #include <cstdint>
 #include <string>
 
+// Log2 histogram of durations with 1us resolution, safe to read from other
+// threads while the owning loop records into it.
+class TimingHistogram {
+public:
+  static constexpr int NUM_BUCKETS = 32;
+
+  void record(uint64_t ns);
+  void reset();
+  inline uint64_t count() const { return count_.load(std::memory_order_relaxed); }
+  inline uint64_t max() const { return max_.load(std::memory_order_relaxed); }
+  double mean() const;
+  // upper bound in ns of the bucket containing the p-th percentile (0-100)
+  uint64_t percentile(double p) const;
+
+private:
+  // bucket i holds [2^(i-1), 2^i) us, bucket 0 below 1us
+  std::atomic<uint64_t> buckets_[NUM_BUCKETS] = {};
+  std::atomic<uint64_t> count_ = 0;
+  std::atomic<uint64_t> sum_ = 0;
+  std::atomic<uint64_t> max_ = 0;
+};
+
 class RateKeeper {
 public:
   RateKeeper(const std::string &name, float rate, float print_delay_threshold = 0);
   ~RateKeeper() {}
+  // Sleep until absolute integer deadlines on CLOCK_MONOTONIC instead of for the remaining
+  // interval, busy waiting for the last spin_us. Wake-up errors and loop durations are recorded.
+  void useAbsoluteDeadlines(uint32_t spin_us = 0);
   bool keepTime();
   bool monitorTime();
+  // logs the timing histograms at info level, call it at a low rate, e.g. once a minute
+  void logStats();
   inline uint64_t frame() const { return frame_; }
   inline double remaining() const { return remaining_; }
+  // wake-up time past the deadline
+  inline const TimingHistogram &wakeupError() const { return wakeup_error; }
+  // time from wake-up to the next keepTime, the loop body
+  inline const TimingHistogram &loopDuration() const { return loop_duration; }
 
 private:
+  bool keepDeadline();
+
   double interval;
   double next_frame_time;
   double last_monitor_time;
@@ -20,4 +54,13 @@ private:
   float print_delay_threshold = 0;
   uint64_t frame_ = 0;
   std::string name;
+
+  bool absolute = false;
+  uint64_t interval_ns = 0;
+  uint64_t spin_ns = 0;
+  uint64_t next_deadline_ns = 0;
+  uint64_t last_wakeup_ns = 0;
+  uint64_t lagged_frames = 0;
+  TimingHistogram wakeup_error;
+  TimingHistogram loop_duration;
 };
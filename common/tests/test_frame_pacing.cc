@@ -0,0 +1,102 @@
+#include <random>
+#include <set>
+
+#include "catch2/catch.hpp"
+#include "common/frame_pacing.h"
+
+const uint64_t FRAME_NS = 50000000ULL;  // 20Hz
+const uint64_t MS = 1000000ULL;
+
+TEST_CASE("FramePacingMonitor steady stream") {
+  FramePacingMonitor monitor("test", 30 * MS, 0);
+  uint64_t t = 1000 * FRAME_NS;
+  for (uint32_t id = 0; id < 100; id++, t += FRAME_NS) {
+    // received 8ms after the end of exposure, processed in 12ms
+    monitor.received(id, t, t + 8 * MS);
+    REQUIRE(monitor.processed(t + 20 * MS));
+  }
+
+  auto s = monitor.summary();
+  REQUIRE(s.frames == 100);
+  REQUIRE(s.dropped == 0);
+  REQUIRE(s.gaps == 0);
+  REQUIRE(s.resets == 0);
+  REQUIRE(s.over_budget == 0);
+  // log2 buckets, in ns
+  REQUIRE(s.latency_max == 8 * MS);
+  REQUIRE(s.latency_p50 == 8192000);
+  REQUIRE(s.processing_max == 12 * MS);
+  REQUIRE(s.processing_p99 == 16384000);
+}
+
+TEST_CASE("FramePacingMonitor counts dropped frames") {
+  FramePacingMonitor monitor("test", 30 * MS, 0);
+
+  // a synthetic stream losing 10% of the frames, in bursts of up to 3
+  std::mt19937 gen(0);
+  std::set<uint32_t> lost;
+  while (lost.size() < 100) {
+    uint32_t start = 1 + gen() % 998;
+    for (uint32_t i = 0; i < 1 + gen() % 3 && lost.size() < 100; i++) lost.insert(start + i);
+  }
+
+  uint64_t expected_gaps = 0;
+  uint32_t expected_max_gap = 0, run = 0;
+  for (uint32_t id = 0; id < 1000; id++) {
+    uint64_t t = (id + 1) * FRAME_NS;
+    if (lost.count(id)) {
+      run++;
+      continue;
+    }
+    if (run > 0) {
+      expected_gaps++;
+      expected_max_gap = std::max(expected_max_gap, run);
+      run = 0;
+    }
+    monitor.received(id, t, t + MS);
+    // every 10th frame takes too long
+    monitor.processed(t + MS + (id % 10 == 0 ? 40 : 10) * MS);
+  }
+
+  auto s = monitor.summary();
+  REQUIRE(s.frames == 1000 - lost.size() - run);
+  REQUIRE(s.dropped == lost.size() - run);
+  REQUIRE(s.gaps == expected_gaps);
+  REQUIRE(s.max_gap == expected_max_gap);
+  REQUIRE(s.over_budget > 0);
+  REQUIRE(s.over_budget <= 100);
+}
+
+TEST_CASE("FramePacingMonitor camera restart") {
+  FramePacingMonitor monitor("test", 0, 0);
+  for (uint32_t id = 100; id < 110; id++) monitor.received(id, id * FRAME_NS, id * FRAME_NS);
+  for (uint32_t id = 0; id < 10; id++) monitor.received(id, (200 + id) * FRAME_NS, (200 + id) * FRAME_NS);
+
+  auto s = monitor.summary();
+  REQUIRE(s.frames == 20);
+  REQUIRE(s.resets == 1);
+  REQUIRE(s.dropped == 0);
+  // no budget
+  REQUIRE(monitor.processed(1000 * FRAME_NS));
+}
+
+TEST_CASE("FramePacingMonitor windows") {
+  FramePacingMonitor monitor("test", 30 * MS, 1.0);
+  uint64_t t = FRAME_NS;
+  for (uint32_t id = 0; id < 20; id++, t += FRAME_NS) {
+    monitor.received(id * 2, t, t + MS);
+  }
+  REQUIRE(monitor.summary().frames == 20);
+  REQUIRE(monitor.summary().dropped == 19);
+
+  // a second after the first frame the window is logged and the next one starts
+  monitor.received(40, t, t + MS);
+  REQUIRE(monitor.summary().frames == 0);
+
+  t += FRAME_NS;
+  monitor.received(41, t, t + 2 * MS);
+  auto s = monitor.summary();
+  REQUIRE(s.frames == 1);
+  REQUIRE(s.dropped == 0);
+  REQUIRE(s.latency_max == 2 * MS);
+}
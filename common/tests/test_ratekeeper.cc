@@ -0,0 +1,75 @@
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "catch2/catch.hpp"
+#include "common/ratekeeper.h"
+#include "common/timing.h"
+
+TEST_CASE("TimingHistogram") {
+  TimingHistogram hist;
+  REQUIRE(hist.count() == 0);
+  REQUIRE(hist.percentile(50) == 0);
+
+  for (int i = 0; i < 98; i++) hist.record(500);  // < 1us
+  hist.record(3000);  // [2, 4) us
+  hist.record(1500000);  // [1024, 2048) us
+
+  REQUIRE(hist.count() == 100);
+  REQUIRE(hist.max() == 1500000);
+  REQUIRE(hist.mean() == Approx((98 * 500 + 3000 + 1500000) / 100.0));
+  REQUIRE(hist.percentile(50) == 1000);
+  REQUIRE(hist.percentile(99) == 4000);
+  REQUIRE(hist.percentile(100) == 2048000);
+
+  hist.reset();
+  REQUIRE(hist.count() == 0);
+  REQUIRE(hist.max() == 0);
+}
+
+TEST_CASE("RateKeeper absolute deadlines under CPU load") {
+  const int rate = 200;
+  const int frames = 200;
+  const uint64_t interval_ns = 1000000000ULL / rate;
+  auto spin_us = GENERATE(0, 200);
+
+  // synthetic load on every core
+  std::atomic<bool> done = false;
+  std::vector<std::thread> load;
+  for (int i = 0; i < std::max(1, (int)std::thread::hardware_concurrency()); i++) {
+    load.emplace_back([&]() {
+      volatile uint64_t x = 0;
+      while (!done) x = x + 1;
+    });
+  }
+
+  uint64_t start = nanos_monotonic();
+  RateKeeper rk("test", rate);
+  rk.useAbsoluteDeadlines(spin_us);
+
+  int lagged = 0;
+  for (int i = 0; i < frames; i++) {
+    // loop body of ~1ms
+    uint64_t body_end = nanos_monotonic() + 1000000;
+    while (nanos_monotonic() < body_end) {}
+    lagged += rk.keepTime();
+  }
+  uint64_t elapsed = nanos_monotonic() - start;
+
+  done = true;
+  for (auto &t : load) t.join();
+
+  INFO("spin " << spin_us << " us, wakeup error p50 " << rk.wakeupError().percentile(50) << " ns, p99 "
+       << rk.wakeupError().percentile(99) << " ns, max " << rk.wakeupError().max() << " ns, lagged " << lagged);
+  REQUIRE(rk.frame() == frames);
+  REQUIRE(rk.loopDuration().count() == frames);
+  REQUIRE(rk.wakeupError().count() == (uint64_t)(frames - lagged));
+  REQUIRE(rk.loopDuration().percentile(50) >= 1000000);
+
+  // deadlines don't drift, only a lagged frame pushes the schedule back
+  REQUIRE(elapsed >= frames * interval_ns);
+  if (lagged == 0) {
+    REQUIRE(elapsed < frames * interval_ns + interval_ns);
+  }
+}
@@ -0,0 +1,119 @@
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "catch2/catch.hpp"
+#include "common/watchdog.h"
+
+// pids above PID_MAX_LIMIT never exist, so simulated processes always look exited
+const int FAKE_PID = 1 << 23;
+
+struct WatchdogFixture {
+  WatchdogFixture() {
+    int fd = mkstemp(path);
+    close(fd);
+  }
+  ~WatchdogFixture() {
+    unlink(path);
+  }
+  char path[32] = "/tmp/test_watchdog_XXXXXX";
+};
+
+TEST_CASE_METHOD(WatchdogFixture, "Watchdog: simulated processes kicking") {
+  const int num_procs = 48;
+  const uint64_t num_kicks = 20000;
+
+  std::atomic<bool> done = false;
+  std::atomic<int> errors = 0;
+  std::thread reader([&]() {
+    Watchdog watchdog(path);
+    std::vector<Watchdog::State> states;
+    std::map<int, Watchdog::State> last;
+    while (!done) {
+      watchdog.scan(states);
+      for (auto &s : states) {
+        // kicks are ordered within a generation
+        auto it = last.find(s.pid);
+        if (it != last.end() && it->second.generation == s.generation && s.last_kick < it->second.last_kick) {
+          errors++;
+        }
+        last[s.pid] = s;
+      }
+    }
+  });
+
+  std::vector<std::thread> procs;
+  for (int i = 0; i < num_procs; i++) {
+    procs.emplace_back([&, i]() {
+      Watchdog watchdog(path);
+      for (uint64_t ts = 1; ts <= num_kicks; ts++) {
+        if (!watchdog.kick(FAKE_PID + i, ts)) errors++;
+      }
+    });
+  }
+  for (auto &t : procs) t.join();
+  done = true;
+  reader.join();
+  REQUIRE(errors == 0);
+
+  Watchdog watchdog(path);
+  std::vector<Watchdog::State> states;
+  watchdog.scan(states);
+  REQUIRE(states.size() == num_procs);
+  for (auto &s : states) {
+    REQUIRE(s.pid >= FAKE_PID);
+    REQUIRE(s.pid < FAKE_PID + num_procs);
+    REQUIRE(s.generation == 1);
+    REQUIRE(s.last_kick == num_kicks);
+  }
+}
+
+TEST_CASE_METHOD(WatchdogFixture, "Watchdog: slots") {
+  Watchdog reader(path);
+  std::vector<Watchdog::State> states;
+
+  SECTION("pid reuse") {
+    {
+      Watchdog watchdog(path);
+      REQUIRE(watchdog.kick(FAKE_PID, 100));
+    }
+    reader.scan(states);
+    REQUIRE(states.size() == 1);
+    REQUIRE(states[0].generation == 1);
+    REQUIRE(states[0].last_kick == 100);
+
+    // a new process with the same pid claims the slot again
+    Watchdog watchdog(path);
+    REQUIRE(watchdog.kick(FAKE_PID, 5));
+    reader.scan(states);
+    REQUIRE(states.size() == 1);
+    REQUIRE(states[0].generation == 2);
+    REQUIRE(states[0].last_kick == 5);
+  }
+
+  SECTION("full table") {
+    // the test process is alive, the simulated processes look exited
+    Watchdog live(path);
+    REQUIRE(live.kick(getpid(), 42));
+    std::vector<std::unique_ptr<Watchdog>> procs;
+    for (int i = 0; i < WATCHDOG_MAX_SLOTS - 1; i++) {
+      procs.push_back(std::make_unique<Watchdog>(path));
+      REQUIRE(procs.back()->kick(FAKE_PID + i, i));
+    }
+    reader.scan(states);
+    REQUIRE(states.size() == WATCHDOG_MAX_SLOTS);
+
+    // slots of exited processes are taken over, live ones are kept
+    Watchdog watchdog(path);
+    REQUIRE(watchdog.kick(FAKE_PID + WATCHDOG_MAX_SLOTS, 1));
+    reader.scan(states);
+    REQUIRE(states.size() == WATCHDOG_MAX_SLOTS);
+    REQUIRE(std::count_if(states.begin(), states.end(), [](auto &s) { return s.pid == getpid() && s.last_kick == 42; }) == 1);
+    REQUIRE(std::count_if(states.begin(), states.end(), [](auto &s) { return s.pid == FAKE_PID + WATCHDOG_MAX_SLOTS; }) == 1);
+  }
+}
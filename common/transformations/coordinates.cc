@@ -1,6 +1,7 @@
 #define _USE_MATH_DEFINES
 
 #include "common/transformations/coordinates.hpp"
+#include "common/transformations/vec_math.hpp"
 
 #include <iostream>
 #include <cmath>
@@ -61,6 +62,67 @@ Geodetic ecef2geodetic(const ECEF &e) {
   return to_degrees({lat, lon, h});
 }
 
+// Per point kernels of the batch conversions, the same math as above with branch-free
+// sin/cos/atan2/cbrt. Always inlined, so the loops over them vectorize.
+__attribute__((always_inline)) static inline void geodetic2ecef_kernel(const double (&g)[3], double (&e)[3]) {
+  double slat, clat, slon, clon;
+  vec_math::sincos(DEG2RAD(g[0]), slat, clat);
+  vec_math::sincos(DEG2RAD(g[1]), slon, clon);
+  double n = a / sqrt(1.0 - esq * slat * slat);
+  e[0] = (n + g[2]) * clat * clon;
+  e[1] = (n + g[2]) * clat * slon;
+  e[2] = (n * (1.0 - esq) + g[2]) * slat;
+}
+
+__attribute__((always_inline)) static inline void ecef2geodetic_kernel(const double (&e)[3], double (&g)[3]) {
+  double x = e[0], y = e[1], z = e[2];
+  double r = sqrt(x * x + y * y);
+  double Esq = a * a - b * b;
+  double F = 54 * b * b * z * z;
+  double G = r * r + (1 - esq) * z * z - esq * Esq;
+  double C = (esq * esq * F * r * r) / (G * G * G);
+  double S = vec_math::cbrt(1 + C + sqrt(C * C + 2 * C));
+  double SS = S + 1 / S + 1;
+  double P = F / (3 * SS * SS * G * G);
+  double Q = sqrt(1 + 2 * esq * esq * P);
+  double r_0 = -(P * esq * r) / (1 + Q) + sqrt(0.5 * a * a*(1 + 1.0 / Q) - P * (1 - esq) * z * z / (Q * (1 + Q)) - 0.5 * P * r * r);
+  double dr = r - esq * r_0;
+  double U = sqrt(dr * dr + z * z);
+  double V = sqrt(dr * dr + (1 - esq) * z * z);
+  double Z_0 = b * b * z / (a * V);
+
+  g[0] = RAD2DEG(vec_math::atan2(z + e1sq * Z_0, r));
+  g[1] = RAD2DEG(vec_math::atan2(y, x));
+  g[2] = U * (1 - b * b / (a * V));
+}
+
+// m is the row-major rotation, o the origin
+__attribute__((always_inline)) static inline void ned2ecef_kernel(const double (&m)[9], const double (&o)[3], const double (&n)[3], double (&e)[3]) {
+  e[0] = m[0] * n[0] + m[1] * n[1] + m[2] * n[2] + o[0];
+  e[1] = m[3] * n[0] + m[4] * n[1] + m[5] * n[2] + o[1];
+  e[2] = m[6] * n[0] + m[7] * n[1] + m[8] * n[2] + o[2];
+}
+
+__attribute__((always_inline)) static inline void ecef2ned_kernel(const double (&m)[9], const double (&o)[3], const double (&e)[3], double (&n)[3]) {
+  double x = e[0] - o[0], y = e[1] - o[1], z = e[2] - o[2];
+  n[0] = m[0] * x + m[1] * y + m[2] * z;
+  n[1] = m[3] * x + m[4] * y + m[5] * z;
+  n[2] = m[6] * x + m[7] * y + m[8] * z;
+}
+
+static void to_arrays(const Eigen::Matrix3d &mat, const Eigen::Vector3d &vec, double (&m)[9], double (&o)[3]) {
+  for (int i = 0; i < 9; i++) m[i] = mat(i / 3, i % 3);
+  for (int i = 0; i < 3; i++) o[i] = vec(i);
+}
+
+void geodetic2ecef(const double *const geodetic[3], double *const ecef[3], size_t count) {
+  vec_math::soa_batch<3, 3>(geodetic, ecef, count, [](auto &in, auto &out) { geodetic2ecef_kernel(in, out); });
+}
+
+void ecef2geodetic(const double *const ecef[3], double *const geodetic[3], size_t count) {
+  vec_math::soa_batch<3, 3>(ecef, geodetic, count, [](auto &in, auto &out) { ecef2geodetic_kernel(in, out); });
+}
+
 LocalCoord::LocalCoord(const Geodetic &geodetic, const ECEF &e) {
   init_ecef <<  e.x, e.y, e.z;
 
@@ -98,3 +160,39 @@ Geodetic LocalCoord::ned2geodetic(const NED &n) {
   ECEF e = ned2ecef(n);
   return ::ecef2geodetic(e);
 }
+
+void LocalCoord::ecef2ned(const double *const ecef[3], double *const ned[3], size_t count) const {
+  double m[9], o[3];
+  to_arrays(ecef2ned_matrix, init_ecef, m, o);
+  vec_math::soa_batch<3, 3>(ecef, ned, count, [&](const double (&e)[3], double (&n)[3]) {
+    ecef2ned_kernel(m, o, e, n);
+  });
+}
+
+void LocalCoord::ned2ecef(const double *const ned[3], double *const ecef[3], size_t count) const {
+  double m[9], o[3];
+  to_arrays(ned2ecef_matrix, init_ecef, m, o);
+  vec_math::soa_batch<3, 3>(ned, ecef, count, [&](const double (&n)[3], double (&e)[3]) {
+    ned2ecef_kernel(m, o, n, e);
+  });
+}
+
+void LocalCoord::geodetic2ned(const double *const geodetic[3], double *const ned[3], size_t count) const {
+  double m[9], o[3];
+  to_arrays(ecef2ned_matrix, init_ecef, m, o);
+  vec_math::soa_batch<3, 3>(geodetic, ned, count, [&](const double (&g)[3], double (&n)[3]) {
+    double e[3];
+    geodetic2ecef_kernel(g, e);
+    ecef2ned_kernel(m, o, e, n);
+  });
+}
+
+void LocalCoord::ned2geodetic(const double *const ned[3], double *const geodetic[3], size_t count) const {
+  double m[9], o[3];
+  to_arrays(ned2ecef_matrix, init_ecef, m, o);
+  vec_math::soa_batch<3, 3>(ned, geodetic, count, [&](const double (&n)[3], double (&g)[3]) {
+    double e[3];
+    ned2ecef_kernel(m, o, n, e);
+    ecef2geodetic_kernel(e, g);
+  });
+}
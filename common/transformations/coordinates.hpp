@@ -27,6 +27,11 @@ struct Geodetic {
 ECEF geodetic2ecef(const Geodetic &g);
 Geodetic ecef2geodetic(const ECEF &e);
 
+// Batch conversions of count points in structure-of-arrays layout: {lat, lon, alt} in degrees,
+// {x, y, z} and {n, e, d} arrays. Outputs must not overlap the inputs.
+void geodetic2ecef(const double *const geodetic[3], double *const ecef[3], size_t count);
+void ecef2geodetic(const double *const ecef[3], double *const geodetic[3], size_t count);
+
 class LocalCoord {
 public:
   Eigen::Matrix3d ned2ecef_matrix;
@@ -40,4 +45,9 @@ public:
   ECEF ned2ecef(const NED &n);
   NED geodetic2ned(const Geodetic &g);
   Geodetic ned2geodetic(const NED &n);
+
+  void ecef2ned(const double *const ecef[3], double *const ned[3], size_t count) const;
+  void ned2ecef(const double *const ned[3], double *const ecef[3], size_t count) const;
+  void geodetic2ned(const double *const geodetic[3], double *const ned[3], size_t count) const;
+  void ned2geodetic(const double *const ned[3], double *const geodetic[3], size_t count) const;
 };
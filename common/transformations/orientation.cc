@@ -6,6 +6,7 @@
 
 #include "common/transformations/orientation.hpp"
 #include "common/transformations/coordinates.hpp"
+#include "common/transformations/vec_math.hpp"
 
 Eigen::Quaterniond ensure_unique(const Eigen::Quaterniond &quat) {
   if (quat.w() > 0){
@@ -142,3 +143,96 @@ Eigen::Vector3d ned_euler_from_ecef(const ECEF &ecef_init, const Eigen::Vector3d
   return {phi, theta, psi};
 }
 
+
+// Per rotation kernels of the batch conversions. They follow the Eigen formulas used above,
+// with the branches of ensure_unique and the matrix to quaternion case selection as selects.
+__attribute__((always_inline)) static inline void euler2quat_kernel(const double (&e)[3], double (&q)[4]) {
+  double sr, cr, sp, cp, sy, cy;
+  vec_math::sincos(0.5 * e[0], sr, cr);
+  vec_math::sincos(0.5 * e[1], sp, cp);
+  vec_math::sincos(0.5 * e[2], sy, cy);
+
+  double w = cy * cp * cr + sy * sp * sr;
+  double sign = w > 0 ? 1.0 : -1.0;
+  q[0] = sign * w;
+  q[1] = sign * (cy * cp * sr - sy * sp * cr);
+  q[2] = sign * (cy * sp * cr + sy * cp * sr);
+  q[3] = sign * (sy * cp * cr - cy * sp * sr);
+}
+
+__attribute__((always_inline)) static inline void quat2euler_kernel(const double (&q)[4], double (&e)[3]) {
+  double w = q[0], x = q[1], y = q[2], z = q[3];
+  e[0] = vec_math::atan2(2 * (w * x + y * z), 1 - 2 * (x * x + y * y));
+  double s = 2 * (w * y - z * x);
+  e[1] = vec_math::asin(s < -1.0 ? -1.0 : (s > 1.0 ? 1.0 : s));
+  e[2] = vec_math::atan2(2 * (w * z + x * y), 1 - 2 * (y * y + z * z));
+}
+
+__attribute__((always_inline)) static inline void quat2rot_kernel(const double (&q)[4], double (&m)[9]) {
+  double tx = 2 * q[1], ty = 2 * q[2], tz = 2 * q[3];
+  double twx = tx * q[0], twy = ty * q[0], twz = tz * q[0];
+  double txx = tx * q[1], txy = ty * q[1], txz = tz * q[1];
+  double tyy = ty * q[2], tyz = tz * q[2], tzz = tz * q[3];
+
+  m[0] = 1 - (tyy + tzz); m[1] = txy - twz;       m[2] = txz + twy;
+  m[3] = txy + twz;       m[4] = 1 - (txx + tzz); m[5] = tyz - twx;
+  m[6] = txz - twy;       m[7] = tyz + twx;       m[8] = 1 - (txx + tyy);
+}
+
+__attribute__((always_inline)) static inline void rot2quat_kernel(const double (&m)[9], double (&q)[4]) {
+  // the largest of w, x, y, z is computed from the diagonal, the others from the off-diagonal sums
+  double trace = m[0] + m[4] + m[8];
+  bool cw = trace > 0;
+  bool cz = !cw && m[8] > (m[4] > m[0] ? m[4] : m[0]);
+  bool cy = !cw && !cz && m[4] > m[0];
+  bool cx = !cw && !cz && !cy;
+
+  double t = sqrt((cw ? trace : (cx ? m[0] - m[4] - m[8] : (cy ? m[4] - m[8] - m[0] : m[8] - m[0] - m[4]))) + 1);
+  double big = 0.5 * t;
+  double f = 0.5 / t;
+
+  double A = m[7] - m[5], B = m[2] - m[6], C = m[3] - m[1];
+  double D = m[3] + m[1], E = m[6] + m[2], F = m[7] + m[5];
+  double w = cw ? big : (cx ? A : (cy ? B : C)) * f;
+  double x = cx ? big : (cw ? A : (cy ? D : E)) * f;
+  double y = cy ? big : (cw ? B : (cx ? D : F)) * f;
+  double z = cz ? big : (cw ? C : (cx ? E : F)) * f;
+
+  double sign = w > 0 ? 1.0 : -1.0;
+  q[0] = sign * w;
+  q[1] = sign * x;
+  q[2] = sign * y;
+  q[3] = sign * z;
+}
+
+void euler2quat(const double *const euler[3], double *const quat[4], size_t count) {
+  vec_math::soa_batch<3, 4>(euler, quat, count, [](auto &in, auto &out) { euler2quat_kernel(in, out); });
+}
+
+void quat2euler(const double *const quat[4], double *const euler[3], size_t count) {
+  vec_math::soa_batch<4, 3>(quat, euler, count, [](auto &in, auto &out) { quat2euler_kernel(in, out); });
+}
+
+void quat2rot(const double *const quat[4], double *const rot[9], size_t count) {
+  vec_math::soa_batch<4, 9>(quat, rot, count, [](auto &in, auto &out) { quat2rot_kernel(in, out); });
+}
+
+void rot2quat(const double *const rot[9], double *const quat[4], size_t count) {
+  vec_math::soa_batch<9, 4>(rot, quat, count, [](auto &in, auto &out) { rot2quat_kernel(in, out); });
+}
+
+void euler2rot(const double *const euler[3], double *const rot[9], size_t count) {
+  vec_math::soa_batch<3, 9>(euler, rot, count, [](const double (&e)[3], double (&m)[9]) {
+    double q[4];
+    euler2quat_kernel(e, q);
+    quat2rot_kernel(q, m);
+  });
+}
+
+void rot2euler(const double *const rot[9], double *const euler[3], size_t count) {
+  vec_math::soa_batch<9, 3>(rot, euler, count, [](const double (&m)[9], double (&e)[3]) {
+    double q[4];
+    rot2quat_kernel(m, q);
+    quat2euler_kernel(q, e);
+  });
+}
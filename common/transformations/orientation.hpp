@@ -15,3 +15,13 @@ Eigen::Matrix3d rot_matrix(double roll, double pitch, double yaw);
 Eigen::Matrix3d rot(const Eigen::Vector3d &axis, double angle);
 Eigen::Vector3d ecef_euler_from_ned(const ECEF &ecef_init, const Eigen::Vector3d &ned_pose);
 Eigen::Vector3d ned_euler_from_ecef(const ECEF &ecef_init, const Eigen::Vector3d &ecef_pose);
+
+// Batch conversions of count rotations in structure-of-arrays layout: euler {roll, pitch, yaw},
+// quaternion {w, x, y, z} and the 9 rotation matrix elements in row-major order.
+// Outputs must not overlap the inputs.
+void euler2quat(const double *const euler[3], double *const quat[4], size_t count);
+void quat2euler(const double *const quat[4], double *const euler[3], size_t count);
+void quat2rot(const double *const quat[4], double *const rot[9], size_t count);
+void rot2quat(const double *const rot[9], double *const quat[4], size_t count);
+void euler2rot(const double *const euler[3], double *const rot[9], size_t count);
+void rot2euler(const double *const rot[9], double *const euler[3], size_t count);
@@ -102,3 +102,25 @@ class TestNED:
     np.testing.assert_allclose(converter.ned2ecef(ned_offsets_batch),
                                                            ecef_positions_offset_batch,
                                                            rtol=1e-9, atol=1e-7)
+
+  def test_batch_matches_single(self):
+    def assert_geodetic_close(actual, desired):
+      # 1e-9 degrees is ~0.1 mm, heights in meters
+      actual, desired = np.asarray(actual), np.asarray(desired)
+      np.testing.assert_allclose(actual[:, :2], desired[:, :2], rtol=0, atol=1e-9)
+      np.testing.assert_allclose(actual[:, 2], desired[:, 2], rtol=0, atol=1e-6)
+
+    rng = np.random.default_rng(0)
+    geodetic = np.column_stack([rng.uniform(-89.9, 89.9, 1000), rng.uniform(-180, 180, 1000), rng.uniform(-500, 20000, 1000)])
+    ecef = coord.geodetic2ecef(geodetic)
+    np.testing.assert_allclose(ecef, [coord.geodetic2ecef_single(g) for g in geodetic], rtol=0, atol=1e-6)
+    assert_geodetic_close(coord.ecef2geodetic(ecef), [coord.ecef2geodetic_single(e) for e in ecef])
+
+    converter = coord.LocalCoord.from_geodetic(geodetic_positions[0])
+    ned = converter.ecef2ned(ecef)
+    np.testing.assert_allclose(ned, [converter.ecef2ned_single(e) for e in ecef], rtol=0, atol=1e-6)
+    np.testing.assert_allclose(converter.ned2ecef(ned), [converter.ned2ecef_single(n) for n in ned], rtol=0, atol=1e-6)
+    np.testing.assert_allclose(converter.geodetic2ned(geodetic), [converter.geodetic2ned_single(g) for g in geodetic], rtol=0, atol=1e-6)
+    assert_geodetic_close(converter.ned2geodetic(ned), [converter.ned2geodetic_single(n) for n in ned])
+
+    assert coord.geodetic2ecef(np.zeros((0, 3))).shape == (0, 3)
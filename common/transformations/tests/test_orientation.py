@@ -3,6 +3,8 @@ import numpy as np
 from openpilot.common.transformations.orientation import euler2quat, quat2euler, euler2rot, rot2euler, \
                                                rot2quat, quat2rot, \
                                                ned_euler_from_ecef
+from openpilot.common.transformations.transformations import euler2quat_single, quat2euler_single, euler2rot_single, \
+                                                   rot2euler_single, rot2quat_single, quat2rot_single
 
 eulers = np.array([[ 1.46520501,  2.78688383,  2.92780854],
        [ 4.86909526,  3.60618161,  4.30648981],
@@ -59,3 +61,16 @@ class TestOrientation:
       np.testing.assert_allclose(ned_eulers[i], ned_euler_from_ecef(ecef_positions[i], eulers[i]), rtol=1e-7)
       #np.testing.assert_allclose(eulers[i], ecef_euler_from_ned(ecef_positions[i], ned_eulers[i]), rtol=1e-7)
     # np.testing.assert_allclose(ned_eulers, ned_euler_from_ecef(ecef_positions, eulers), rtol=1e-7)
+
+  def test_batch_matches_single(self):
+    rng = np.random.default_rng(0)
+    eulers_random = np.column_stack([rng.uniform(-np.pi, np.pi, 1000), rng.uniform(-1.5, 1.5, 1000), rng.uniform(-np.pi, np.pi, 1000)])
+    quats_random = euler2quat(eulers_random)
+    rots_random = euler2rot(eulers_random)
+
+    np.testing.assert_allclose(quats_random, [euler2quat_single(e) for e in eulers_random], atol=1e-12)
+    np.testing.assert_allclose(quat2euler(quats_random), [quat2euler_single(q) for q in quats_random], atol=1e-12)
+    np.testing.assert_allclose(rots_random, [euler2rot_single(e) for e in eulers_random], atol=1e-12)
+    np.testing.assert_allclose(quat2rot(quats_random), [quat2rot_single(q) for q in quats_random], atol=1e-12)
+    np.testing.assert_allclose(rot2quat(rots_random), [rot2quat_single(r) for r in rots_random], atol=1e-12)
+    np.testing.assert_allclose(rot2euler(rots_random), [rot2euler_single(r) for r in rots_random], atol=1e-12)
@@ -0,0 +1,217 @@
+#define CATCH_CONFIG_MAIN
+#define CATCH_CONFIG_ENABLE_BENCHMARKING
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "catch2/catch.hpp"
+#include "common/transformations/coordinates.hpp"
+#include "common/transformations/orientation.hpp"
+#include "common/transformations/vec_math.hpp"
+
+// N structure-of-arrays rows of random values in [lo, hi)
+struct Columns {
+  Columns(int rows, size_t count) : data(rows, std::vector<double>(count)) {
+    for (auto &c : data) {
+      in.push_back(c.data());
+      out.push_back(c.data());
+    }
+  }
+  Columns(const std::vector<std::pair<double, double>> &ranges, size_t count, uint64_t seed) : Columns(ranges.size(), count) {
+    std::mt19937_64 gen(seed);
+    for (size_t r = 0; r < ranges.size(); r++) {
+      std::uniform_real_distribution<double> dist(ranges[r].first, ranges[r].second);
+      for (auto &v : data[r]) v = dist(gen);
+    }
+  }
+  double operator()(int row, size_t i) const { return data[row][i]; }
+
+  std::vector<std::vector<double>> data;
+  std::vector<const double *> in;
+  std::vector<double *> out;
+};
+
+const size_t COUNT = 100000;
+const std::vector<std::pair<double, double>> GEODETIC_RANGES = {{-89.9, 89.9}, {-180, 180}, {-500, 20000}};
+const std::vector<std::pair<double, double>> EULER_RANGES = {{-M_PI, M_PI}, {-M_PI_2 + 0.01, M_PI_2 - 0.01}, {-M_PI, M_PI}};
+
+TEST_CASE("vec_math") {
+  std::mt19937_64 gen(0);
+  std::uniform_real_distribution<double> angle(-100, 100), unit(-1, 1), exponent(-300, 300);
+  for (int i = 0; i < 100000; i++) {
+    double x = angle(gen), y = angle(gen), u = unit(gen);
+    double s, c;
+    vec_math::sincos(x, s, c);
+    REQUIRE(s == Approx(std::sin(x)).margin(1e-15));
+    REQUIRE(c == Approx(std::cos(x)).margin(1e-15));
+    REQUIRE(vec_math::atan2(y, x) == Approx(std::atan2(y, x)).epsilon(1e-15));
+    REQUIRE(vec_math::asin(u) == Approx(std::asin(u)).margin(1e-15));
+    double w = std::copysign(std::exp(exponent(gen)), u);
+    REQUIRE(vec_math::cbrt(w) == Approx(std::cbrt(w)).epsilon(1e-15));
+  }
+  REQUIRE(vec_math::atan2(0, 0) == 0);
+  REQUIRE(vec_math::atan2(0, -1) == Approx(M_PI));
+  REQUIRE(vec_math::atan2(1, 0) == Approx(M_PI_2));
+  REQUIRE(vec_math::cbrt(0) == 0);
+}
+
+TEST_CASE("batch coordinates match the scalar versions") {
+  Columns geodetic(GEODETIC_RANGES, COUNT, 1);
+  Columns ecef(3, COUNT), geodetic_out(3, COUNT), ned(3, COUNT), ecef_out(3, COUNT), ned_out(3, COUNT);
+  LocalCoord local(Geodetic{37.7610403, -122.4778699, 115});
+
+  geodetic2ecef(geodetic.in.data(), ecef.out.data(), COUNT);
+  ecef2geodetic(ecef.in.data(), geodetic_out.out.data(), COUNT);
+  local.ecef2ned(ecef.in.data(), ned.out.data(), COUNT);
+  local.ned2ecef(ned.in.data(), ecef_out.out.data(), COUNT);
+  local.geodetic2ned(geodetic.in.data(), ned_out.out.data(), COUNT);
+
+  for (size_t i = 0; i < COUNT; i++) {
+    Geodetic g = {geodetic(0, i), geodetic(1, i), geodetic(2, i)};
+    ECEF e = geodetic2ecef(g);
+    REQUIRE(ecef(0, i) == Approx(e.x).margin(1e-6));
+    REQUIRE(ecef(1, i) == Approx(e.y).margin(1e-6));
+    REQUIRE(ecef(2, i) == Approx(e.z).margin(1e-6));
+
+    Geodetic g2 = ecef2geodetic(e);
+    REQUIRE(geodetic_out(0, i) == Approx(g2.lat).margin(1e-10));
+    REQUIRE(geodetic_out(1, i) == Approx(g2.lon).margin(1e-10));
+    REQUIRE(geodetic_out(2, i) == Approx(g2.alt).margin(1e-6));
+
+    NED n = local.ecef2ned(e);
+    REQUIRE(ned(0, i) == Approx(n.n).margin(1e-6));
+    REQUIRE(ned(1, i) == Approx(n.e).margin(1e-6));
+    REQUIRE(ned(2, i) == Approx(n.d).margin(1e-6));
+    REQUIRE(ned_out(0, i) == Approx(n.n).margin(1e-6));
+    REQUIRE(ned_out(1, i) == Approx(n.e).margin(1e-6));
+    REQUIRE(ned_out(2, i) == Approx(n.d).margin(1e-6));
+
+    ECEF e2 = local.ned2ecef({ned(0, i), ned(1, i), ned(2, i)});
+    REQUIRE(ecef_out(0, i) == Approx(e2.x).margin(1e-6));
+    REQUIRE(ecef_out(1, i) == Approx(e2.y).margin(1e-6));
+    REQUIRE(ecef_out(2, i) == Approx(e2.z).margin(1e-6));
+  }
+
+  Columns geodetic_round(3, COUNT);
+  local.ned2geodetic(ned_out.in.data(), geodetic_round.out.data(), COUNT);
+  for (size_t i = 0; i < COUNT; i++) {
+    Geodetic g = local.ned2geodetic({ned_out(0, i), ned_out(1, i), ned_out(2, i)});
+    REQUIRE(geodetic_round(0, i) == Approx(g.lat).margin(1e-10));
+    REQUIRE(geodetic_round(1, i) == Approx(g.lon).margin(1e-10));
+    REQUIRE(geodetic_round(2, i) == Approx(g.alt).margin(1e-6));
+  }
+}
+
+TEST_CASE("batch orientation matches the scalar versions") {
+  Columns euler(EULER_RANGES, COUNT, 2);
+  Columns quat(4, COUNT), euler_out(3, COUNT), rot(9, COUNT), rot_out(9, COUNT), quat_out(4, COUNT), euler_rot(3, COUNT);
+
+  euler2quat(euler.in.data(), quat.out.data(), COUNT);
+  quat2euler(quat.in.data(), euler_out.out.data(), COUNT);
+  quat2rot(quat.in.data(), rot.out.data(), COUNT);
+  euler2rot(euler.in.data(), rot_out.out.data(), COUNT);
+  rot2quat(rot.in.data(), quat_out.out.data(), COUNT);
+  rot2euler(rot.in.data(), euler_rot.out.data(), COUNT);
+
+  for (size_t i = 0; i < COUNT; i++) {
+    Eigen::Vector3d e(euler(0, i), euler(1, i), euler(2, i));
+    Eigen::Quaterniond q = euler2quat(e);
+    // both sides pick w > 0, so only a w of ~0 can flip the sign
+    double sign = quat(0, i) * q.w() + quat(1, i) * q.x() + quat(2, i) * q.y() + quat(3, i) * q.z() < 0 ? -1 : 1;
+    REQUIRE(sign * quat(0, i) == Approx(q.w()).margin(1e-12));
+    REQUIRE(sign * quat(1, i) == Approx(q.x()).margin(1e-12));
+    REQUIRE(sign * quat(2, i) == Approx(q.y()).margin(1e-12));
+    REQUIRE(sign * quat(3, i) == Approx(q.z()).margin(1e-12));
+
+    Eigen::Vector3d e2 = quat2euler(q);
+    Eigen::Matrix3d r = quat2rot(q);
+    Eigen::Matrix3d r2 = euler2rot(e);
+    for (int k = 0; k < 3; k++) {
+      REQUIRE(euler_out(k, i) == Approx(e2(k)).margin(1e-10));
+    }
+    for (int k = 0; k < 9; k++) {
+      REQUIRE(rot(k, i) == Approx(r(k / 3, k % 3)).margin(1e-12));
+      REQUIRE(rot_out(k, i) == Approx(r2(k / 3, k % 3)).margin(1e-12));
+    }
+
+    Eigen::Matrix3d m;
+    m << rot(0, i), rot(1, i), rot(2, i), rot(3, i), rot(4, i), rot(5, i), rot(6, i), rot(7, i), rot(8, i);
+    Eigen::Quaterniond q2 = rot2quat(m);
+    REQUIRE(quat_out(0, i) == Approx(q2.w()).margin(1e-12));
+    REQUIRE(quat_out(1, i) == Approx(q2.x()).margin(1e-12));
+    REQUIRE(quat_out(2, i) == Approx(q2.y()).margin(1e-12));
+    REQUIRE(quat_out(3, i) == Approx(q2.z()).margin(1e-12));
+
+    Eigen::Vector3d e3 = rot2euler(m);
+    for (int k = 0; k < 3; k++) {
+      REQUIRE(euler_rot(k, i) == Approx(e3(k)).margin(1e-10));
+    }
+  }
+}
+
+TEST_CASE("rot2quat covers all diagonal cases") {
+  // 180 degree rotations about each axis have a zero trace and a dominant diagonal element
+  std::vector<Eigen::Vector3d> axes = {Eigen::Vector3d::UnitX(), Eigen::Vector3d::UnitY(), Eigen::Vector3d::UnitZ(), Eigen::Vector3d(1, 2, 3).normalized()};
+  for (const Eigen::Vector3d &axis : axes) {
+    Eigen::Matrix3d m = rot(axis, M_PI - 0.1);
+    Eigen::Matrix3d mt = m.transpose();
+    Columns quat(4, 1);
+    const double *rows[9];
+    for (int k = 0; k < 9; k++) rows[k] = &mt.data()[k];
+    rot2quat(rows, quat.out.data(), 1);
+
+    Eigen::Quaterniond q = rot2quat(m);
+    REQUIRE(quat(0, 0) == Approx(q.w()).margin(1e-12));
+    REQUIRE(quat(1, 0) == Approx(q.x()).margin(1e-12));
+    REQUIRE(quat(2, 0) == Approx(q.y()).margin(1e-12));
+    REQUIRE(quat(3, 0) == Approx(q.z()).margin(1e-12));
+  }
+}
+
+TEST_CASE("transformations benchmark", "[.][benchmark]") {
+  Columns geodetic(GEODETIC_RANGES, COUNT, 3), euler(EULER_RANGES, COUNT, 4);
+  Columns ecef(3, COUNT), out(3, COUNT), quat(4, COUNT), rot(9, COUNT);
+  geodetic2ecef(geodetic.in.data(), ecef.out.data(), COUNT);
+  LocalCoord local(Geodetic{37.7610403, -122.4778699, 115});
+
+  BENCHMARK("geodetic2ecef scalar") {
+    for (size_t i = 0; i < COUNT; i++) {
+      ECEF e = geodetic2ecef({geodetic(0, i), geodetic(1, i), geodetic(2, i)});
+      out.data[0][i] = e.x; out.data[1][i] = e.y; out.data[2][i] = e.z;
+    }
+  };
+  BENCHMARK("geodetic2ecef batch") {
+    geodetic2ecef(geodetic.in.data(), out.out.data(), COUNT);
+  };
+  BENCHMARK("ecef2geodetic scalar") {
+    for (size_t i = 0; i < COUNT; i++) {
+      Geodetic g = ecef2geodetic({ecef(0, i), ecef(1, i), ecef(2, i)});
+      out.data[0][i] = g.lat; out.data[1][i] = g.lon; out.data[2][i] = g.alt;
+    }
+  };
+  BENCHMARK("ecef2geodetic batch") {
+    ecef2geodetic(ecef.in.data(), out.out.data(), COUNT);
+  };
+  BENCHMARK("ecef2ned scalar") {
+    for (size_t i = 0; i < COUNT; i++) {
+      NED n = local.ecef2ned({ecef(0, i), ecef(1, i), ecef(2, i)});
+      out.data[0][i] = n.n; out.data[1][i] = n.e; out.data[2][i] = n.d;
+    }
+  };
+  BENCHMARK("ecef2ned batch") {
+    local.ecef2ned(ecef.in.data(), out.out.data(), COUNT);
+  };
+  BENCHMARK("euler2rot scalar") {
+    for (size_t i = 0; i < COUNT; i++) {
+      Eigen::Matrix3d r = euler2rot(Eigen::Vector3d(euler(0, i), euler(1, i), euler(2, i)));
+      for (int k = 0; k < 9; k++) rot.data[k][i] = r(k / 3, k % 3);
+    }
+  };
+  BENCHMARK("euler2rot batch") {
+    euler2rot(euler.in.data(), rot.out.data(), COUNT);
+  };
+  BENCHMARK("rot2euler batch") {
+    rot2euler(rot.in.data(), out.out.data(), COUNT);
+  };
+}
@@ -34,6 +34,13 @@ cdef extern from "orientation.hpp":
   Vector3 ecef_euler_from_ned(const ECEF &, const Vector3 &)
   Vector3 ned_euler_from_ecef(const ECEF &, const Vector3 &)
 
+  void euler2quat(const double **, double **, size_t)
+  void quat2euler(const double **, double **, size_t)
+  void quat2rot(const double **, double **, size_t)
+  void rot2quat(const double **, double **, size_t)
+  void euler2rot(const double **, double **, size_t)
+  void rot2euler(const double **, double **, size_t)
+
 
 cdef extern from "coordinates.cc":
   cdef struct ECEF:
@@ -54,6 +61,8 @@ cdef extern from "coordinates.cc":
 
   ECEF geodetic2ecef(const Geodetic &)
   Geodetic ecef2geodetic(const ECEF &)
+  void geodetic2ecef(const double **, double **, size_t)
+  void ecef2geodetic(const double **, double **, size_t)
 
   cdef cppclass LocalCoord_c "LocalCoord":
     Matrix3 ned2ecef_matrix
@@ -68,5 +77,10 @@ cdef extern from "coordinates.cc":
     NED geodetic2ned(const Geodetic &)
     Geodetic ned2geodetic(const NED &)
 
+    void ecef2ned(const double **, double **, size_t)
+    void ned2ecef(const double **, double **, size_t)
+    void geodetic2ned(const double **, double **, size_t)
+    void ned2geodetic(const double **, double **, size_t)
+
 cdef extern from "coordinates.hpp":
   pass
@@ -32,6 +32,19 @@ cdef Matrix3 numpy2matrix(np.ndarray[double, ndim=2, mode="fortran"] m):
     assert m.shape[1] == 3
     return Matrix3(<double*>m.data)
 
+cdef np.ndarray to_soa(a, int width):
+    # rows of width values to a contiguous (width, N) array, one row per component
+    return np.ascontiguousarray(np.asarray(a, dtype=np.double).reshape(-1, width).T)
+
+cdef np.ndarray from_soa(np.ndarray a, shape):
+    return np.ascontiguousarray(a.T).reshape((-1,) + shape)
+
+cdef void row_pointers(np.ndarray a, double **rows):
+    cdef double *data = <double*>a.data
+    cdef Py_ssize_t k
+    for k in range(a.shape[0]):
+        rows[k] = data + k * a.shape[1]
+
 cdef ECEF list2ecef(ecef):
     cdef ECEF e
     e.x = ecef[0]
@@ -83,6 +96,66 @@ def rot2euler_single(rot):
     cdef Vector3 e = rot2euler_c(r)
     return [e(0), e(1), e(2)]
 
+def euler2quat_batch(euler):
+    cdef np.ndarray inp = to_soa(euler, 3)
+    cdef np.ndarray out = np.empty((4, inp.shape[1]))
+    cdef double *i[3]
+    cdef double *o[4]
+    row_pointers(inp, i)
+    row_pointers(out, o)
+    euler2quat_c(<const double **>i, o, inp.shape[1])
+    return from_soa(out, (4,))
+
+def quat2euler_batch(quat):
+    cdef np.ndarray inp = to_soa(quat, 4)
+    cdef np.ndarray out = np.empty((3, inp.shape[1]))
+    cdef double *i[4]
+    cdef double *o[3]
+    row_pointers(inp, i)
+    row_pointers(out, o)
+    quat2euler_c(<const double **>i, o, inp.shape[1])
+    return from_soa(out, (3,))
+
+def quat2rot_batch(quat):
+    cdef np.ndarray inp = to_soa(quat, 4)
+    cdef np.ndarray out = np.empty((9, inp.shape[1]))
+    cdef double *i[4]
+    cdef double *o[9]
+    row_pointers(inp, i)
+    row_pointers(out, o)
+    quat2rot_c(<const double **>i, o, inp.shape[1])
+    return from_soa(out, (3, 3))
+
+def rot2quat_batch(rot):
+    cdef np.ndarray inp = to_soa(rot, 9)
+    cdef np.ndarray out = np.empty((4, inp.shape[1]))
+    cdef double *i[9]
+    cdef double *o[4]
+    row_pointers(inp, i)
+    row_pointers(out, o)
+    rot2quat_c(<const double **>i, o, inp.shape[1])
+    return from_soa(out, (4,))
+
+def euler2rot_batch(euler):
+    cdef np.ndarray inp = to_soa(euler, 3)
+    cdef np.ndarray out = np.empty((9, inp.shape[1]))
+    cdef double *i[3]
+    cdef double *o[9]
+    row_pointers(inp, i)
+    row_pointers(out, o)
+    euler2rot_c(<const double **>i, o, inp.shape[1])
+    return from_soa(out, (3, 3))
+
+def rot2euler_batch(rot):
+    cdef np.ndarray inp = to_soa(rot, 9)
+    cdef np.ndarray out = np.empty((3, inp.shape[1]))
+    cdef double *i[9]
+    cdef double *o[3]
+    row_pointers(inp, i)
+    row_pointers(out, o)
+    rot2euler_c(<const double **>i, o, inp.shape[1])
+    return from_soa(out, (3,))
+
 def rot_matrix(roll, pitch, yaw):
     return matrix2numpy(rot_matrix_c(roll, pitch, yaw))
 
@@ -110,6 +183,26 @@ def ecef2geodetic_single(ecef):
     cdef Geodetic g = ecef2geodetic_c(e)
     return [g.lat, g.lon, g.alt]
 
+def geodetic2ecef_batch(geodetic):
+    cdef np.ndarray inp = to_soa(geodetic, 3)
+    cdef np.ndarray out = np.empty((3, inp.shape[1]))
+    cdef double *i[3]
+    cdef double *o[3]
+    row_pointers(inp, i)
+    row_pointers(out, o)
+    geodetic2ecef_c(<const double **>i, o, inp.shape[1])
+    return from_soa(out, (3,))
+
+def ecef2geodetic_batch(ecef):
+    cdef np.ndarray inp = to_soa(ecef, 3)
+    cdef np.ndarray out = np.empty((3, inp.shape[1]))
+    cdef double *i[3]
+    cdef double *o[3]
+    row_pointers(inp, i)
+    row_pointers(out, o)
+    ecef2geodetic_c(<const double **>i, o, inp.shape[1])
+    return from_soa(out, (3,))
+
 
 cdef class LocalCoord:
     cdef LocalCoord_c * lc
@@ -169,5 +262,49 @@ cdef class LocalCoord:
         cdef Geodetic g = self.lc.ned2geodetic(n)
         return [g.lat, g.lon, g.alt]
 
+    def ecef2ned_batch(self, ecef):
+        assert self.lc
+        cdef np.ndarray inp = to_soa(ecef, 3)
+        cdef np.ndarray out = np.empty((3, inp.shape[1]))
+        cdef double *i[3]
+        cdef double *o[3]
+        row_pointers(inp, i)
+        row_pointers(out, o)
+        self.lc.ecef2ned(<const double **>i, o, inp.shape[1])
+        return from_soa(out, (3,))
+
+    def ned2ecef_batch(self, ned):
+        assert self.lc
+        cdef np.ndarray inp = to_soa(ned, 3)
+        cdef np.ndarray out = np.empty((3, inp.shape[1]))
+        cdef double *i[3]
+        cdef double *o[3]
+        row_pointers(inp, i)
+        row_pointers(out, o)
+        self.lc.ned2ecef(<const double **>i, o, inp.shape[1])
+        return from_soa(out, (3,))
+
+    def geodetic2ned_batch(self, geodetic):
+        assert self.lc
+        cdef np.ndarray inp = to_soa(geodetic, 3)
+        cdef np.ndarray out = np.empty((3, inp.shape[1]))
+        cdef double *i[3]
+        cdef double *o[3]
+        row_pointers(inp, i)
+        row_pointers(out, o)
+        self.lc.geodetic2ned(<const double **>i, o, inp.shape[1])
+        return from_soa(out, (3,))
+
+    def ned2geodetic_batch(self, ned):
+        assert self.lc
+        cdef np.ndarray inp = to_soa(ned, 3)
+        cdef np.ndarray out = np.empty((3, inp.shape[1]))
+        cdef double *i[3]
+        cdef double *o[3]
+        row_pointers(inp, i)
+        row_pointers(out, o)
+        self.lc.ned2geodetic(<const double **>i, o, inp.shape[1])
+        return from_soa(out, (3,))
+
     def __dealloc__(self):
         del self.lc
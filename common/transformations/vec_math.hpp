@@ -0,0 +1,140 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+// Branch-free double precision math for the batch conversions. Selects instead of
+// branches and no libm calls (other than sqrt) keep the loops using these vectorizable.
+// Range reductions and polynomials are the Cephes ones, accurate to a few ulp.
+namespace vec_math {
+
+inline uint64_t bits(double x) {
+  uint64_t u;
+  memcpy(&u, &x, sizeof(u));
+  return u;
+}
+
+inline double from_bits(uint64_t u) {
+  double x;
+  memcpy(&x, &u, sizeof(x));
+  return x;
+}
+
+// valid for |x| < 2^30
+inline void sincos(double x, double &s, double &c) {
+  // nearest multiple q of pi/2, rounded by the mantissa of the shifted sum
+  const double shift = 0x1.8p52;
+  double q = (x * M_2_PI + shift) - shift;
+  // q mod 4 from the rounding remainder of q / 4: 0, 0.25, +-0.5, -0.25
+  double f = q * 0.25 - ((q * 0.25 + shift) - shift);
+
+  // pi/2 split in three parts so q * pi/2 is exact
+  double r = ((x - q * 1.57079625129699707031E0) - q * 7.54978941586159635335E-8) - q * 5.39030285815811905290E-15;
+  double zz = r * r;
+
+  double sin_r = 1.58962301576546568060E-10;
+  sin_r = sin_r * zz - 2.50507477628578072866E-8;
+  sin_r = sin_r * zz + 2.75573136213857245213E-6;
+  sin_r = sin_r * zz - 1.98412698295895385996E-4;
+  sin_r = sin_r * zz + 8.33333333332211858878E-3;
+  sin_r = sin_r * zz - 1.66666666666666307295E-1;
+  sin_r = r + r * zz * sin_r;
+
+  double cos_r = -1.13585365213876817300E-11;
+  cos_r = cos_r * zz + 2.08757008419747316778E-9;
+  cos_r = cos_r * zz - 2.75573141792967388112E-7;
+  cos_r = cos_r * zz + 2.48015872888517045348E-5;
+  cos_r = cos_r * zz - 1.38888888888730564116E-3;
+  cos_r = cos_r * zz + 4.16666666666665929218E-2;
+  cos_r = 1.0 - 0.5 * zz + zz * zz * cos_r;
+
+  bool odd = std::fabs(f) == 0.25;
+  s = odd ? cos_r : sin_r;
+  c = odd ? sin_r : cos_r;
+  s = (f == -0.25 || std::fabs(f) == 0.5) ? -s : s;
+  c = (f == 0.25 || std::fabs(f) == 0.5) ? -c : c;
+}
+
+// atan of t in [0, 1]
+inline double atan_unit(double t) {
+  bool upper = t > 0.66;
+  double x = (upper ? t - 1.0 : t) / (upper ? t + 1.0 : 1.0);
+  double z = x * x;
+
+  double p = -8.750608600031904122785E-1;
+  p = p * z - 1.615753718733365076637E1;
+  p = p * z - 7.500855792314704667340E1;
+  p = p * z - 1.228866684490136173410E2;
+  p = p * z - 6.485021904942025371773E1;
+  double q = z + 2.485846490142306297962E1;
+  q = q * z + 1.650270098316988542046E2;
+  q = q * z + 4.328810604912902668951E2;
+  q = q * z + 4.853903996359136964868E2;
+  q = q * z + 1.945506571482613964425E2;
+
+  double r = x + x * (z * p / q);
+  return upper ? M_PI_4 + (r + 3.061616997868382943065E-17) : r;
+}
+
+inline double atan2(double y, double x) {
+  double ax = std::fabs(x), ay = std::fabs(y);
+  double hi = ax > ay ? ax : ay;
+  double lo = ax > ay ? ay : ax;
+  double t = lo / (hi > 0 ? hi : 1.0);
+
+  double r = atan_unit(t);
+  r = ay > ax ? M_PI_2 - r : r;
+  r = std::copysign(1.0, x) < 0 ? M_PI - r : r;
+  return std::copysign(r, y);
+}
+
+inline double asin(double x) {
+  return vec_math::atan2(x, std::sqrt((1.0 - x) * (1.0 + x)));
+}
+
+// for normal and zero x
+inline double cbrt(double x) {
+  double ax = std::fabs(x);
+
+  // exponent divided by three for a ~5 bit estimate, then Halley iterations triple the bits
+  uint32_t hi = bits(ax) >> 32;
+  double y = from_bits((uint64_t)(hi / 3 + 715094163u) << 32);
+  double y3 = y * y * y;
+  y = y * (y3 + 2.0 * ax) / (2.0 * y3 + ax);
+  y3 = y * y * y;
+  y = y * (y3 + 2.0 * ax) / (2.0 * y3 + ax);
+  y3 = y * y * y;
+  y = y * (y3 + 2.0 * ax) / (2.0 * y3 + ax);
+  return ax > 0 ? std::copysign(y, x) : x;
+}
+
+// Applies kernel(const double (&in)[IN], double (&out)[OUT]) to count elements of IN input
+// and OUT output arrays. The arrays are copied through blocks on the stack, which the compiler
+// knows don't alias, so the loop over the kernel vectorizes.
+template <int IN, int OUT, typename Kernel>
+inline void soa_batch(const double *const in[IN], double *const out[OUT], size_t count, Kernel kernel) {
+  constexpr size_t BLOCK = 64;
+  double a[IN][BLOCK], b[OUT][BLOCK];
+  for (size_t start = 0; start < count; start += BLOCK) {
+    size_t n = std::min(BLOCK, count - start);
+    for (int k = 0; k < IN; k++) {
+      memcpy(a[k], in[k] + start, n * sizeof(double));
+    }
+    for (size_t i = 0; i < n; i++) {
+      // fully unrolled, the kernel then works on scalars
+      double x[IN], y[OUT];
+      #pragma GCC unroll 16
+      for (int k = 0; k < IN; k++) x[k] = a[k][i];
+      kernel(x, y);
+      #pragma GCC unroll 16
+      for (int k = 0; k < OUT; k++) b[k][i] = y[k];
+    }
+    for (int k = 0; k < OUT; k++) {
+      memcpy(out[k] + start, b[k], n * sizeof(double));
+    }
+  }
+}
+
+}  // namespace vec_math
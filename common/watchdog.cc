@@ -1,12 +1,107 @@
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
 #include <string>
 
 #include "common/watchdog.h"
 #include "common/util.h"
 #include "system/hardware/hw.h"
 
-const std::string watchdog_fn_prefix = Path::shm_path() + "/wd_";  // + <pid>
+std::string Watchdog::default_path() {
+  return Path::shm_path() + "/watchdog";
+}
+
+Watchdog::Watchdog(const std::string &path) {
+  fd = HANDLE_EINTR(open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0666));
+  if (fd < 0) return;
+
+  flock(fd, LOCK_EX);
+  struct stat st;
+  if (fstat(fd, &st) == 0 && ((size_t)st.st_size >= sizeof(WatchdogTable) || ftruncate(fd, sizeof(WatchdogTable)) == 0)) {
+    void *p = mmap(nullptr, sizeof(WatchdogTable), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (p != MAP_FAILED) {
+      table = (WatchdogTable *)p;
+      if (table->version == 0) {
+        table->version = WATCHDOG_VERSION;
+        table->num_slots = WATCHDOG_MAX_SLOTS;
+      } else if (table->version != WATCHDOG_VERSION || table->num_slots != WATCHDOG_MAX_SLOTS) {
+        munmap(table, sizeof(WatchdogTable));
+        table = nullptr;
+      }
+    }
+  }
+  flock(fd, LOCK_UN);
+}
+
+Watchdog::~Watchdog() {
+  if (table) munmap(table, sizeof(WatchdogTable));
+  if (fd >= 0) close(fd);
+}
+
+int Watchdog::claim(int pid) {
+  flock(fd, LOCK_EX);
+  int found = -1, free_slot = -1;
+  for (int i = 0; i < WATCHDOG_MAX_SLOTS; i++) {
+    int slot_pid = table->slots[i].pid.load(std::memory_order_relaxed);
+    if (slot_pid == pid) {
+      // left over from an exited process with the same pid
+      found = i;
+      break;
+    } else if (slot_pid == 0 && free_slot < 0) {
+      free_slot = i;
+    }
+  }
+  if (found < 0) {
+    found = free_slot;
+  }
+  for (int i = 0; found < 0 && i < WATCHDOG_MAX_SLOTS; i++) {
+    // take over the slot of an exited process
+    int slot_pid = table->slots[i].pid.load(std::memory_order_relaxed);
+    if (kill(slot_pid, 0) != 0 && errno == ESRCH) {
+      found = i;
+    }
+  }
+  if (found >= 0) {
+    WatchdogSlot &s = table->slots[found];
+    s.pid.store(pid, std::memory_order_relaxed);
+    s.last_kick.store(0, std::memory_order_relaxed);
+    s.generation.fetch_add(1, std::memory_order_release);
+  }
+  flock(fd, LOCK_UN);
+  return found;
+}
+
+bool Watchdog::kick(int pid, uint64_t ts) {
+  if (!table) return false;
+
+  if (slot < 0 || slot_pid != pid || table->slots[slot].pid.load(std::memory_order_relaxed) != pid) {
+    slot = claim(pid);
+    slot_pid = pid;
+    if (slot < 0) return false;
+  }
+  table->slots[slot].last_kick.store(ts, std::memory_order_release);
+  return true;
+}
+
+void Watchdog::scan(std::vector<State> &states) const {
+  states.clear();
+  if (!table) return;
+
+  for (const WatchdogSlot &s : table->slots) {
+    uint32_t generation = s.generation.load(std::memory_order_acquire);
+    int pid = s.pid.load(std::memory_order_relaxed);
+    if (pid != 0) {
+      states.push_back({pid, generation, s.last_kick.load(std::memory_order_acquire)});
+    }
+  }
+}
 
 bool watchdog_kick(uint64_t ts) {
-  static std::string fn = watchdog_fn_prefix + std::to_string(getpid());
-  return util::write_file(fn.c_str(), &ts, sizeof(ts), O_WRONLY | O_CREAT) > 0;
+  static Watchdog watchdog;
+  return watchdog.kick(getpid(), ts);
 }
@@ -1,5 +1,52 @@
 #pragma once
 
+#include <atomic>
 #include <cstdint>
+#include <string>
+#include <vector>
+
+// Processes kick their slot of a watchdog table in shared memory, and the manager
+// scans all slots to check liveness. A slot is claimed on the first kick under a
+// file lock, kicks after that are a single atomic store.
+const int WATCHDOG_MAX_SLOTS = 64;
+const uint32_t WATCHDOG_VERSION = 1;
+
+struct WatchdogSlot {
+  std::atomic<int32_t> pid;          // 0 if free
+  std::atomic<uint32_t> generation;  // incremented every time the slot is claimed, detects pid reuse
+  std::atomic<uint64_t> last_kick;
+};
+static_assert(sizeof(WatchdogSlot) == 16);
+
+struct WatchdogTable {
+  uint32_t version;
+  uint32_t num_slots;
+  WatchdogSlot slots[WATCHDOG_MAX_SLOTS];
+};
+
+class Watchdog {
+public:
+  struct State {
+    int pid;
+    uint32_t generation;
+    uint64_t last_kick;
+  };
+
+  Watchdog(const std::string &path = default_path());
+  ~Watchdog();
+  static std::string default_path();
+
+  bool kick(int pid, uint64_t ts);
+  // all claimed slots, without syscalls
+  void scan(std::vector<State> &states) const;
+
+private:
+  int claim(int pid);
+
+  int fd = -1;
+  WatchdogTable *table = nullptr;
+  int slot = -1;
+  int slot_pid = 0;
+};
 
 bool watchdog_kick(uint64_t ts);
@@ -1,11 +1,110 @@
+import fcntl
+import mmap
 import os
-import time
 import struct
+import time
 from openpilot.system.hardware.hw import Paths
 
-WATCHDOG_FN = f"{Paths.shm_path()}/wd_"
+# shared with common/watchdog.h
+WATCHDOG_PATH = f"{Paths.shm_path()}/watchdog"
+WATCHDOG_MAX_SLOTS = 64
+WATCHDOG_VERSION = 1
+
+_HEADER = struct.Struct('<II')  # version, num_slots
+_SLOT = struct.Struct('<iIQ')   # pid, generation, last_kick
+_SIZE = _HEADER.size + WATCHDOG_MAX_SLOTS * _SLOT.size
+
+
+class WatchdogTable:
+  def __init__(self, path: str = WATCHDOG_PATH):
+    self.owner = os.getpid()
+    self.fd = os.open(path, os.O_RDWR | os.O_CREAT | os.O_CLOEXEC, 0o666)
+    fcntl.flock(self.fd, fcntl.LOCK_EX)
+    try:
+      if os.fstat(self.fd).st_size < _SIZE:
+        os.ftruncate(self.fd, _SIZE)
+      self.buf = mmap.mmap(self.fd, _SIZE)
+      version, num_slots = _HEADER.unpack_from(self.buf, 0)
+      if version == 0:
+        _HEADER.pack_into(self.buf, 0, WATCHDOG_VERSION, WATCHDOG_MAX_SLOTS)
+      elif (version, num_slots) != (WATCHDOG_VERSION, WATCHDOG_MAX_SLOTS):
+        raise ValueError(f"unsupported watchdog table version {version}")
+    finally:
+      fcntl.flock(self.fd, fcntl.LOCK_UN)
+
+    # 8 byte words, so a kick is a single aligned store
+    self.words = memoryview(self.buf).cast('Q')
+    self.slot: int | None = None
+    self.slot_pid = 0
+
+  def _offset(self, slot: int) -> int:
+    return _HEADER.size + slot * _SLOT.size
+
+  def _claim(self, pid: int) -> int | None:
+    fcntl.flock(self.fd, fcntl.LOCK_EX)
+    try:
+      pids = [_SLOT.unpack_from(self.buf, self._offset(i))[0] for i in range(WATCHDOG_MAX_SLOTS)]
+      # left over from an exited process with the same pid, a free slot, or the slot of an exited process
+      candidates = [i for i, p in enumerate(pids) if p == pid] + [i for i, p in enumerate(pids) if p == 0]
+      if not candidates:
+        for i, p in enumerate(pids):
+          try:
+            os.kill(p, 0)
+          except ProcessLookupError:
+            candidates.append(i)
+            break
+          except OSError:
+            pass
+      if not candidates:
+        return None
+
+      slot = candidates[0]
+      _, generation, _ = _SLOT.unpack_from(self.buf, self._offset(slot))
+      _SLOT.pack_into(self.buf, self._offset(slot), pid, (generation + 1) & 0xFFFFFFFF, 0)
+      return slot
+    finally:
+      fcntl.flock(self.fd, fcntl.LOCK_UN)
+
+  def kick(self, pid: int, ts: int) -> bool:
+    if self.slot is None or self.slot_pid != pid or _SLOT.unpack_from(self.buf, self._offset(self.slot))[0] != pid:
+      self.slot = self._claim(pid)
+      self.slot_pid = pid
+      if self.slot is None:
+        return False
+    self.words[(self._offset(self.slot) + 8) // 8] = ts
+    return True
+
+  def release(self, pid: int) -> None:
+    """frees the slot of an exited process"""
+    fcntl.flock(self.fd, fcntl.LOCK_EX)
+    try:
+      for i in range(WATCHDOG_MAX_SLOTS):
+        slot_pid, generation, _ = _SLOT.unpack_from(self.buf, self._offset(i))
+        if slot_pid == pid:
+          _SLOT.pack_into(self.buf, self._offset(i), 0, (generation + 1) & 0xFFFFFFFF, 0)
+    finally:
+      fcntl.flock(self.fd, fcntl.LOCK_UN)
+
+  def scan(self) -> dict[int, tuple[int, int]]:
+    """pid -> (generation, last_kick) of all claimed slots"""
+    states = {}
+    for i in range(WATCHDOG_MAX_SLOTS):
+      pid, generation, last_kick = _SLOT.unpack_from(self.buf, self._offset(i))
+      if pid != 0:
+        states[pid] = (generation, last_kick)
+    return states
+
+
+_TABLE: WatchdogTable | None = None
 _LAST_KICK = 0.0
 
+def _table() -> WatchdogTable:
+  global _TABLE
+  # a forked child needs its own open file, flock is shared with the parent otherwise
+  if _TABLE is None or _TABLE.owner != os.getpid():
+    _TABLE = WatchdogTable()
+  return _TABLE
+
 def kick_watchdog():
   global _LAST_KICK
   current_time = time.monotonic()
@@ -14,9 +113,19 @@ def kick_watchdog():
     return
 
   try:
-    with open(f"{WATCHDOG_FN}{os.getpid()}", 'wb') as f:
-      f.write(struct.pack('<Q', int(current_time * 1e9)))
-      f.flush()
-    _LAST_KICK = current_time
-  except OSError:
+    if _table().kick(os.getpid(), int(current_time * 1e9)):
+      _LAST_KICK = current_time
+  except (OSError, ValueError):
+    pass
+
+def read_watchdog() -> dict[int, tuple[int, int]]:
+  try:
+    return _table().scan()
+  except (OSError, ValueError):
+    return {}
+
+def release_watchdog(pid: int) -> None:
+  try:
+    _table().release(pid)
+  except (OSError, ValueError):
     pass
@@ -32,6 +32,7 @@ OUTPUT_SIZE = 84 + FEATURE_LEN
 
 PROCESS_NAME = "selfdrive.modeld.dmonitoringmodeld"
 SEND_RAW_PRED = os.getenv('SEND_RAW_PRED')
+CPU_PREPROCESS = os.getenv('CPU_PREPROCESS')
 MODEL_PKL_PATH = Path(__file__).parent / 'models/dmonitoring_model_tinygrad.pkl'
 
 
@@ -85,7 +86,7 @@ class ModelState:
     t1 = time.perf_counter()
 
     input_img_cl = self.frame.prepare(buf, transform.flatten())
-    if TICI:
+    if TICI and not CPU_PREPROCESS:
       # The imgs tensors are backed by opencl memory, only need init once
       if 'input_img' not in self.tensor_inputs:
         self.tensor_inputs['input_img'] = qcom_tensor_from_opencl_address(input_img_cl.mem_address, (1, MODEL_WIDTH*MODEL_HEIGHT), dtype=dtypes.uint8)
@@ -133,7 +134,8 @@ def get_driverstate_packet(model_output: np.ndarray, frame_id: int, location_ts:
 def main():
   config_realtime_process(7, 5)
 
-  cl_context = CLContext()
+  # without a CL context the frames are warped on the CPU
+  cl_context = None if CPU_PREPROCESS else CLContext()
   model = ModelState(cl_context)
   cloudlog.warning("models loaded, dmonitoringmodeld starting")
 
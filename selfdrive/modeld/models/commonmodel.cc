@@ -10,9 +10,8 @@ DrivingModelFrame::DrivingModelFrame(cl_device_id device_id, cl_context context,
   temporal_skip = _temporal_skip;
   input_frames_cl = CL_CHECK_ERR(clCreateBuffer(context, CL_MEM_READ_WRITE, buf_size, NULL, &err));
   img_buffer_20hz_cl = CL_CHECK_ERR(clCreateBuffer(context, CL_MEM_READ_WRITE, (temporal_skip+1)*frame_size_bytes, NULL, &err));
-  region.origin = temporal_skip * frame_size_bytes;
-  region.size = frame_size_bytes;
-  last_img_cl = CL_CHECK_ERR(clCreateSubBuffer(img_buffer_20hz_cl, CL_MEM_READ_WRITE, CL_BUFFER_CREATE_TYPE_REGION, &region, &err));
+  const uint8_t zero = 0;
+  CL_CHECK(clEnqueueFillBuffer(q, img_buffer_20hz_cl, &zero, sizeof(zero), 0, (temporal_skip+1)*frame_size_bytes, 0, nullptr, nullptr));
 
   loadyuv_init(&loadyuv, context, device_id, MODEL_WIDTH, MODEL_HEIGHT);
   init_transform(device_id, context, MODEL_WIDTH, MODEL_HEIGHT);
@@ -21,25 +20,44 @@ DrivingModelFrame::DrivingModelFrame(cl_device_id device_id, cl_context context,
 cl_mem* DrivingModelFrame::prepare(cl_mem yuv_cl, int frame_width, int frame_height, int frame_stride, int frame_uv_offset, const mat3& projection) {
   run_transform(yuv_cl, MODEL_WIDTH, MODEL_HEIGHT, frame_width, frame_height, frame_stride, frame_uv_offset, projection);
 
-  for (int i = 0; i < temporal_skip; i++) {
-    CL_CHECK(clEnqueueCopyBuffer(q, img_buffer_20hz_cl, img_buffer_20hz_cl, (i+1)*frame_size_bytes, i*frame_size_bytes, frame_size_bytes, 0, nullptr, nullptr));
-  }
-  loadyuv_queue(&loadyuv, q, y_cl, u_cl, v_cl, last_img_cl);
+  head = ring_slot(1);
+  loadyuv_queue(&loadyuv, q, y_cl, u_cl, v_cl, img_buffer_20hz_cl, head*frame_size_bytes);
 
-  copy_queue(&loadyuv, q, img_buffer_20hz_cl, input_frames_cl, 0, 0, frame_size_bytes);
-  copy_queue(&loadyuv, q, last_img_cl, input_frames_cl, 0, frame_size_bytes, frame_size_bytes);
+  copy_queue(&loadyuv, q, img_buffer_20hz_cl, input_frames_cl, ring_slot(1)*frame_size_bytes, 0, frame_size_bytes);
+  copy_queue(&loadyuv, q, img_buffer_20hz_cl, input_frames_cl, head*frame_size_bytes, frame_size_bytes, frame_size_bytes);
 
   // NOTE: Since thneed is using a different command queue, this clFinish is needed to ensure the image is ready.
   clFinish(q);
   return &input_frames_cl;
 }
 
+DrivingModelFrame::DrivingModelFrame(int _temporal_skip) : ModelFrame() {
+  input_frames = std::make_unique<uint8_t[]>(buf_size);
+  temporal_skip = _temporal_skip;
+  img_buffer_20hz = std::make_unique<uint8_t[]>((temporal_skip+1)*frame_size_bytes);
+}
+
+uint8_t* DrivingModelFrame::prepare_cpu(const uint8_t *yuv, int frame_width, int frame_height, int frame_stride, int frame_uv_offset, const mat3& projection) {
+  head = ring_slot(1);
+
+  // warped straight into the layout loadyuv packs
+  uint8_t *last_img = &img_buffer_20hz[head*frame_size_bytes];
+  uint8_t *last_u = last_img + MODEL_WIDTH*MODEL_HEIGHT;
+  uint8_t *last_v = last_u + (MODEL_WIDTH/2)*(MODEL_HEIGHT/2);
+  transform_cpu->transform(yuv, frame_width, frame_height, frame_stride, frame_uv_offset,
+                           last_img, last_u, last_v, MODEL_WIDTH, MODEL_HEIGHT, projection, true);
+
+  memcpy(&input_frames[0], &img_buffer_20hz[ring_slot(1)*frame_size_bytes], frame_size_bytes);
+  memcpy(&input_frames[frame_size_bytes], last_img, frame_size_bytes);
+  return &input_frames[0];
+}
+
 DrivingModelFrame::~DrivingModelFrame() {
+  if (cpu) return;
   deinit_transform();
   loadyuv_destroy(&loadyuv);
   CL_CHECK(clReleaseMemObject(input_frames_cl));
   CL_CHECK(clReleaseMemObject(img_buffer_20hz_cl));
-  CL_CHECK(clReleaseMemObject(last_img_cl));
   CL_CHECK(clReleaseCommandQueue(q));
 }
 
@@ -57,7 +75,19 @@ cl_mem* MonitoringModelFrame::prepare(cl_mem yuv_cl, int frame_width, int frame_
   return &y_cl;
 }
 
+MonitoringModelFrame::MonitoringModelFrame() : ModelFrame() {
+  input_frames = std::make_unique<uint8_t[]>(buf_size);
+}
+
+uint8_t* MonitoringModelFrame::prepare_cpu(const uint8_t *yuv, int frame_width, int frame_height, int frame_stride, int frame_uv_offset, const mat3& projection) {
+  // the model only takes Y
+  transform_cpu->transform(yuv, frame_width, frame_height, frame_stride, frame_uv_offset,
+                           &input_frames[0], nullptr, nullptr, MODEL_WIDTH, MODEL_HEIGHT, projection);
+  return &input_frames[0];
+}
+
 MonitoringModelFrame::~MonitoringModelFrame() {
+  if (cpu) return;
   deinit_transform();
   CL_CHECK(clReleaseMemObject(input_frame_cl));
   CL_CHECK(clReleaseCommandQueue(q));
@@ -16,15 +16,20 @@
 #include "common/mat.h"
 #include "selfdrive/modeld/transforms/loadyuv.h"
 #include "selfdrive/modeld/transforms/transform.h"
+#include "selfdrive/modeld/transforms/transform_cpu.h"
 
 class ModelFrame {
 public:
   ModelFrame(cl_device_id device_id, cl_context context) {
     q = CL_CHECK_ERR(clCreateCommandQueue(context, device_id, 0, &err));
   }
+  // preprocesses on the CPU, for running without an OpenCL device
+  ModelFrame() : cpu(true), transform_cpu(std::make_unique<TransformCPU>()) {}
   virtual ~ModelFrame() {}
   virtual cl_mem* prepare(cl_mem yuv_cl, int frame_width, int frame_height, int frame_stride, int frame_uv_offset, const mat3& projection) { return NULL; }
+  virtual uint8_t* prepare_cpu(const uint8_t *yuv, int frame_width, int frame_height, int frame_stride, int frame_uv_offset, const mat3& projection) { return NULL; }
   uint8_t* buffer_from_cl(cl_mem *in_frames, int buffer_size) {
+    if (cpu) return &input_frames[0];
     CL_CHECK(clEnqueueReadBuffer(q, *in_frames, CL_TRUE, 0, buffer_size, input_frames.get(), 0, nullptr, nullptr));
     clFinish(q);
     return &input_frames[0];
@@ -34,12 +39,14 @@ public:
   int MODEL_HEIGHT;
   int MODEL_FRAME_SIZE;
   int buf_size;
+  const bool cpu = false;
 
 protected:
   cl_mem y_cl, u_cl, v_cl;
   Transform transform;
   cl_command_queue q;
   std::unique_ptr<uint8_t[]> input_frames;
+  std::unique_ptr<TransformCPU> transform_cpu;
 
   void init_transform(cl_device_id device_id, cl_context context, int model_width, int model_height) {
     y_cl = CL_CHECK_ERR(clCreateBuffer(context, CL_MEM_READ_WRITE, model_width * model_height, NULL, &err));
@@ -65,8 +72,10 @@ protected:
 class DrivingModelFrame : public ModelFrame {
 public:
   DrivingModelFrame(cl_device_id device_id, cl_context context, int _temporal_skip);
+  DrivingModelFrame(int _temporal_skip);
   ~DrivingModelFrame();
   cl_mem* prepare(cl_mem yuv_cl, int frame_width, int frame_height, int frame_stride, int frame_uv_offset, const mat3& projection);
+  uint8_t* prepare_cpu(const uint8_t *yuv, int frame_width, int frame_height, int frame_stride, int frame_uv_offset, const mat3& projection);
 
   const int MODEL_WIDTH = 512;
   const int MODEL_HEIGHT = 256;
@@ -75,17 +84,24 @@ public:
   const size_t frame_size_bytes = MODEL_FRAME_SIZE * sizeof(uint8_t);
 
 private:
+  // Ring of the last temporal_skip+1 frames. Each frame is written once into slot head, and the
+  // frame temporal_skip frames ago is in the slot after it.
+  int ring_slot(int i) const { return (head + i) % (temporal_skip + 1); }
+
   LoadYUVState loadyuv;
-  cl_mem img_buffer_20hz_cl, last_img_cl, input_frames_cl;
-  cl_buffer_region region;
+  cl_mem img_buffer_20hz_cl, input_frames_cl;
+  std::unique_ptr<uint8_t[]> img_buffer_20hz;
   int temporal_skip;
+  int head = 0;
 };
 
 class MonitoringModelFrame : public ModelFrame {
 public:
   MonitoringModelFrame(cl_device_id device_id, cl_context context);
+  MonitoringModelFrame();
   ~MonitoringModelFrame();
   cl_mem* prepare(cl_mem yuv_cl, int frame_width, int frame_height, int frame_stride, int frame_uv_offset, const mat3& projection);
+  uint8_t* prepare_cpu(const uint8_t *yuv, int frame_width, int frame_height, int frame_stride, int frame_uv_offset, const mat3& projection);
 
   const int MODEL_WIDTH = 1440;
   const int MODEL_HEIGHT = 960;
@@ -15,13 +15,17 @@ cdef extern from "common/clutil.h":
 cdef extern from "selfdrive/modeld/models/commonmodel.h":
   cppclass ModelFrame:
     int buf_size
+    bint cpu
     unsigned char * buffer_from_cl(cl_mem*, int);
     cl_mem * prepare(cl_mem, int, int, int, int, mat3)
+    unsigned char * prepare_cpu(unsigned char *, int, int, int, int, mat3)
 
   cppclass DrivingModelFrame:
     int buf_size
     DrivingModelFrame(cl_device_id, cl_context, int)
+    DrivingModelFrame(int)
 
   cppclass MonitoringModelFrame:
     int buf_size
     MonitoringModelFrame(cl_device_id, cl_context)
+    MonitoringModelFrame()
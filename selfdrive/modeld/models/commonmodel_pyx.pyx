@@ -47,12 +47,16 @@ cdef class ModelFrame:
     cdef mat3 cprojection
     memcpy(cprojection.v, &projection[0], 9*sizeof(float))
     cdef cl_mem * data
+    if self.frame.cpu:
+      # the frames stay on the host, get them with buffer_from_cl
+      self.frame.prepare_cpu(<unsigned char*>buf.buf.addr, buf.width, buf.height, buf.stride, buf.uv_offset, cprojection)
+      return None
     data = self.frame.prepare(buf.buf.buf_cl, buf.width, buf.height, buf.stride, buf.uv_offset, cprojection)
     return CLMem.create(data)
 
   def buffer_from_cl(self, CLMem in_frames):
     cdef unsigned char * data2
-    data2 = self.frame.buffer_from_cl(in_frames.mem, self.buf_size)
+    data2 = self.frame.buffer_from_cl(in_frames.mem if in_frames is not None else NULL, self.buf_size)
     return np.asarray(<cnp.uint8_t[:self.buf_size]> data2)
 
 
@@ -60,7 +64,10 @@ cdef class DrivingModelFrame(ModelFrame):
   cdef cppDrivingModelFrame * _frame
 
   def __cinit__(self, CLContext context, int temporal_skip):
-    self._frame = new cppDrivingModelFrame(context.device_id, context.context, temporal_skip)
+    if context is None:
+      self._frame = new cppDrivingModelFrame(temporal_skip)
+    else:
+      self._frame = new cppDrivingModelFrame(context.device_id, context.context, temporal_skip)
     self.frame = <cppModelFrame*>(self._frame)
     self.buf_size = self._frame.buf_size
 
@@ -68,7 +75,10 @@ cdef class MonitoringModelFrame(ModelFrame):
   cdef cppMonitoringModelFrame * _frame
 
   def __cinit__(self, CLContext context):
-    self._frame = new cppMonitoringModelFrame(context.device_id, context.context)
+    if context is None:
+      self._frame = new cppMonitoringModelFrame()
+    else:
+      self._frame = new cppMonitoringModelFrame(context.device_id, context.context)
     self.frame = <cppModelFrame*>(self._frame)
     self.buf_size = self._frame.buf_size
 
@@ -0,0 +1,305 @@
+#define CATCH_CONFIG_MAIN
+#define CATCH_CONFIG_ENABLE_BENCHMARKING
+#include "catch2/catch.hpp"
+
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "common/clutil.h"
+#include "selfdrive/modeld/models/commonmodel.h"
+#include "selfdrive/modeld/transforms/transform_cpu.h"
+
+const int FRAME_WIDTH = 1928, FRAME_HEIGHT = 1208, FRAME_STRIDE = 2048;
+const int FRAME_UV_OFFSET = FRAME_STRIDE * FRAME_HEIGHT;
+const int FRAME_SIZE = FRAME_UV_OFFSET + FRAME_STRIDE * FRAME_HEIGHT / 2;
+
+// road camera to model frame, a zoom with a little perspective like modeld uses
+const mat3 PROJECTION = {{
+  2.42f, 0.013f, 344.7f,
+  -0.008f, 2.39f, 301.2f,
+  1.1e-6f, 2.3e-5f, 0.998f,
+}};
+
+static std::vector<uint8_t> random_frame(int seed) {
+  std::mt19937 gen(seed);
+  std::uniform_int_distribution<int> dist(0, 255);
+  std::vector<uint8_t> frame(FRAME_SIZE);
+  for (auto &px : frame) px = dist(gen);
+  return frame;
+}
+
+// transform.cl warpPerspective, one work item at a time
+static void warp_reference(const uint8_t *src, int src_row_stride, int src_px_stride, int src_offset, int src_rows, int src_cols,
+                           uint8_t *dst, int dst_rows, int dst_cols, const float *M) {
+  auto sat_short_rte = [](float v) { return (int)std::fmin(std::fmax(std::nearbyint(v), -32768.0f), 32767.0f); };
+  for (int dy = 0; dy < dst_rows; dy++) {
+    for (int dx = 0; dx < dst_cols; dx++) {
+      float X0 = M[0] * dx + M[1] * dy + M[2];
+      float Y0 = M[3] * dx + M[4] * dy + M[5];
+      float W = M[6] * dx + M[7] * dy + M[8];
+      W = W != 0.0f ? 32 / W : 0.0f;
+      int X = std::rint(X0 * W), Y = std::rint(Y0 * W);
+
+      int sx = std::clamp(X >> 5, -32768, 32767);
+      int sy = std::clamp(Y >> 5, -32768, 32767);
+      int sx_clamp = std::clamp(sx, 0, src_cols - 1);
+      int sx_p1_clamp = std::clamp(sx + 1, 0, src_cols - 1);
+      int sy_clamp = std::clamp(sy, 0, src_rows - 1);
+      int sy_p1_clamp = std::clamp(sy + 1, 0, src_rows - 1);
+      int v0 = src[sy_clamp * src_row_stride + src_offset + sx_clamp * src_px_stride];
+      int v1 = src[sy_clamp * src_row_stride + src_offset + sx_p1_clamp * src_px_stride];
+      int v2 = src[sy_p1_clamp * src_row_stride + src_offset + sx_clamp * src_px_stride];
+      int v3 = src[sy_p1_clamp * src_row_stride + src_offset + sx_p1_clamp * src_px_stride];
+
+      float taby = 1.f / 32 * (Y & 31);
+      float tabx = 1.f / 32 * (X & 31);
+      int itab0 = sat_short_rte((1.0f - taby) * (1.0f - tabx) * 32768);
+      int itab1 = sat_short_rte((1.0f - taby) * tabx * 32768);
+      int itab2 = sat_short_rte(taby * (1.0f - tabx) * 32768);
+      int itab3 = sat_short_rte(taby * tabx * 32768);
+
+      int val = v0 * itab0 + v1 * itab1 + v2 * itab2 + v3 * itab3;
+      dst[dy * dst_cols + dx] = std::clamp((val + (1 << 14)) >> 15, 0, 255);
+    }
+  }
+}
+
+struct Planes {
+  std::vector<uint8_t> y, u, v;
+  Planes(int width, int height) : y(width * height), u(width * height / 4), v(width * height / 4) {}
+};
+
+// transform_queue on the reference kernel
+static Planes transform_reference(const uint8_t *frame, int out_width, int out_height, const mat3 &projection) {
+  Planes out(out_width, out_height);
+  const mat3 projection_uv = transform_scale_buffer(projection, 0.5);
+  warp_reference(frame, FRAME_STRIDE, 1, 0, FRAME_HEIGHT, FRAME_WIDTH, out.y.data(), out_height, out_width, projection.v);
+  warp_reference(frame, FRAME_STRIDE, 2, FRAME_UV_OFFSET, FRAME_HEIGHT / 2, FRAME_WIDTH / 2, out.u.data(), out_height / 2, out_width / 2, projection_uv.v);
+  warp_reference(frame, FRAME_STRIDE, 2, FRAME_UV_OFFSET + 1, FRAME_HEIGHT / 2, FRAME_WIDTH / 2, out.v.data(), out_height / 2, out_width / 2, projection_uv.v);
+  return out;
+}
+
+// loadys and loaduv
+static std::vector<uint8_t> pack_reference(const Planes &p, int width, int height) {
+  const int uv_size = (width / 2) * (height / 2);
+  std::vector<uint8_t> out(width * height * 3 / 2);
+  for (int y = 0; y < height; y++) {
+    for (int x = 0; x < width; x++) {
+      int plane = (y & 1) + (x & 1) * 2;
+      out[plane * uv_size + (y / 2) * (width / 2) + x / 2] = p.y[y * width + x];
+    }
+  }
+  memcpy(&out[width * height], p.u.data(), uv_size);
+  memcpy(&out[width * height + uv_size], p.v.data(), uv_size);
+  return out;
+}
+
+static int max_diff(const std::vector<uint8_t> &a, const uint8_t *b) {
+  int diff = 0;
+  for (size_t i = 0; i < a.size(); i++) diff = std::max(diff, std::abs(a[i] - b[i]));
+  return diff;
+}
+
+TEST_CASE("TransformCPU matches the kernel") {
+  auto frame = random_frame(0);
+  const int threads = GENERATE(1, 3);
+  TransformCPU transform(threads);
+
+  SECTION("perspective") {
+    Planes expected = transform_reference(frame.data(), 512, 256, PROJECTION);
+    Planes out(512, 256);
+    transform.transform(frame.data(), FRAME_WIDTH, FRAME_HEIGHT, FRAME_STRIDE, FRAME_UV_OFFSET,
+                        out.y.data(), out.u.data(), out.v.data(), 512, 256, PROJECTION);
+    REQUIRE(max_diff(expected.y, out.y.data()) <= 1);
+    REQUIRE(max_diff(expected.u, out.u.data()) <= 1);
+    REQUIRE(max_diff(expected.v, out.v.data()) <= 1);
+  }
+
+  SECTION("mostly outside the frame") {
+    const mat3 projection = {{3.0f, 0.0f, -900.0f, 0.0f, 3.0f, 1000.0f, 0.0f, 0.0f, 1.0f}};
+    Planes expected = transform_reference(frame.data(), 512, 256, projection);
+    Planes out(512, 256);
+    transform.transform(frame.data(), FRAME_WIDTH, FRAME_HEIGHT, FRAME_STRIDE, FRAME_UV_OFFSET,
+                        out.y.data(), out.u.data(), out.v.data(), 512, 256, projection);
+    REQUIRE(max_diff(expected.y, out.y.data()) <= 1);
+    REQUIRE(max_diff(expected.u, out.u.data()) <= 1);
+  }
+
+  SECTION("packed for the driving model") {
+    std::vector<uint8_t> expected = pack_reference(transform_reference(frame.data(), 512, 256, PROJECTION), 512, 256);
+    std::vector<uint8_t> out(expected.size());
+    uint8_t *u = &out[512 * 256], *v = u + 256 * 128;
+    transform.transform(frame.data(), FRAME_WIDTH, FRAME_HEIGHT, FRAME_STRIDE, FRAME_UV_OFFSET,
+                        out.data(), u, v, 512, 256, PROJECTION, true);
+    REQUIRE(max_diff(expected, out.data()) <= 1);
+  }
+}
+
+TEST_CASE("TransformCPU golden warps") {
+  auto frame = random_frame(1);
+  TransformCPU transform;
+  Planes out(512, 256);
+
+  // integer shifts land on source pixels exactly
+  const int sx = 100, sy = 60;
+  const mat3 shift = {{1.0f, 0.0f, (float)sx, 0.0f, 1.0f, (float)sy, 0.0f, 0.0f, 1.0f}};
+  transform.transform(frame.data(), FRAME_WIDTH, FRAME_HEIGHT, FRAME_STRIDE, FRAME_UV_OFFSET,
+                      out.y.data(), out.u.data(), out.v.data(), 512, 256, shift);
+  for (int y = 0; y < 256; y++) {
+    for (int x = 0; x < 512; x++) {
+      REQUIRE(out.y[y * 512 + x] == frame[(y + sy) * FRAME_STRIDE + x + sx]);
+    }
+  }
+  for (int y = 0; y < 128; y++) {
+    for (int x = 0; x < 256; x++) {
+      const uint8_t *uv = &frame[FRAME_UV_OFFSET + (y + sy / 2) * FRAME_STRIDE + (x + sx / 2) * 2];
+      REQUIRE(out.u[y * 256 + x] == uv[0]);
+      REQUIRE(out.v[y * 256 + x] == uv[1]);
+    }
+  }
+
+  // half a pixel over is the rounded average of the neighbours
+  const mat3 half = {{1.0f, 0.0f, 0.5f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f}};
+  transform.transform(frame.data(), FRAME_WIDTH, FRAME_HEIGHT, FRAME_STRIDE, FRAME_UV_OFFSET,
+                      out.y.data(), nullptr, nullptr, 512, 256, half);
+  for (int x = 0; x < 512; x++) {
+    REQUIRE(out.y[x] == (frame[x] + frame[x + 1] + 1) / 2);
+  }
+}
+
+// the temporal history as DrivingModelFrame used to keep it, shifted down a frame every frame
+class ShiftedHistory {
+public:
+  ShiftedHistory(int temporal_skip, size_t frame_size)
+      : temporal_skip(temporal_skip), frame_size(frame_size), buf((temporal_skip + 1) * frame_size), input(2 * frame_size) {}
+  const uint8_t *push(const uint8_t *frame) {
+    memmove(&buf[0], &buf[frame_size], temporal_skip * frame_size);
+    memcpy(&buf[temporal_skip * frame_size], frame, frame_size);
+    memcpy(&input[0], &buf[0], frame_size);
+    memcpy(&input[frame_size], &buf[temporal_skip * frame_size], frame_size);
+    return input.data();
+  }
+
+private:
+  int temporal_skip;
+  size_t frame_size;
+  std::vector<uint8_t> buf, input;
+};
+
+// a different warp of one of a few frames each step
+static mat3 step_projection(int i) {
+  mat3 projection = PROJECTION;
+  projection.v[2] += (i * 7) % 23;
+  projection.v[5] += (i * 3) % 17;
+  return projection;
+}
+
+TEST_CASE("DrivingModelFrame temporal history matches shifting the buffer") {
+  const int temporal_skip = GENERATE(0, 1, 2, 4, 7);
+  std::vector<std::vector<uint8_t>> frames;
+  for (int i = 0; i < 3; i++) frames.push_back(random_frame(10 + i));
+
+  DrivingModelFrame model_frame(temporal_skip);
+  const int frame_size = model_frame.MODEL_FRAME_SIZE;
+  ShiftedHistory history(temporal_skip, frame_size);
+  TransformCPU transform;
+  std::vector<uint8_t> packed(frame_size);
+
+  for (int i = 0; i < 40; i++) {
+    const uint8_t *frame = frames[i % frames.size()].data();
+    const mat3 projection = step_projection(i);
+    uint8_t *input = model_frame.prepare_cpu(frame, FRAME_WIDTH, FRAME_HEIGHT, FRAME_STRIDE, FRAME_UV_OFFSET, projection);
+    REQUIRE(input == model_frame.buffer_from_cl(nullptr, model_frame.buf_size));
+
+    transform.transform(frame, FRAME_WIDTH, FRAME_HEIGHT, FRAME_STRIDE, FRAME_UV_OFFSET,
+                        &packed[0], &packed[512 * 256], &packed[512 * 256 + 256 * 128], 512, 256, projection, true);
+    INFO("temporal_skip " << temporal_skip << " frame " << i);
+    REQUIRE(memcmp(input, history.push(packed.data()), model_frame.buf_size) == 0);
+  }
+}
+
+TEST_CASE("CPU preprocessing is within a level of OpenCL") {
+  cl_uint num_platforms = 0;
+  if (clGetPlatformIDs(0, NULL, &num_platforms) != CL_SUCCESS || num_platforms == 0) {
+    WARN("no OpenCL platform, skipping");
+    return;
+  }
+  cl_device_id device_id = cl_get_device_id(CL_DEVICE_TYPE_DEFAULT);
+  cl_context context = cl_create_context(device_id);
+
+  for (int i = 0; i < 3; i++) {
+    auto frame = random_frame(20 + i);
+    cl_mem yuv_cl = CL_CHECK_ERR(clCreateBuffer(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, frame.size(), frame.data(), &err));
+
+    {
+      DrivingModelFrame cl_frame(device_id, context, 4), cpu_frame(4);
+      for (int j = 0; j < 20; j++) {
+        const mat3 projection = step_projection(j);
+        cl_mem *out_cl = cl_frame.prepare(yuv_cl, FRAME_WIDTH, FRAME_HEIGHT, FRAME_STRIDE, FRAME_UV_OFFSET, projection);
+        uint8_t *expected = cl_frame.buffer_from_cl(out_cl, cl_frame.buf_size);
+        uint8_t *out = cpu_frame.prepare_cpu(frame.data(), FRAME_WIDTH, FRAME_HEIGHT, FRAME_STRIDE, FRAME_UV_OFFSET, projection);
+        REQUIRE(max_diff(std::vector<uint8_t>(expected, expected + cl_frame.buf_size), out) <= 1);
+      }
+    }
+    {
+      MonitoringModelFrame cl_frame(device_id, context), cpu_frame;
+      cl_mem *out_cl = cl_frame.prepare(yuv_cl, FRAME_WIDTH, FRAME_HEIGHT, FRAME_STRIDE, FRAME_UV_OFFSET, PROJECTION);
+      uint8_t *expected = cl_frame.buffer_from_cl(out_cl, cl_frame.buf_size);
+      uint8_t *out = cpu_frame.prepare_cpu(frame.data(), FRAME_WIDTH, FRAME_HEIGHT, FRAME_STRIDE, FRAME_UV_OFFSET, PROJECTION);
+      REQUIRE(max_diff(std::vector<uint8_t>(expected, expected + cl_frame.buf_size), out) <= 1);
+    }
+    CL_CHECK(clReleaseMemObject(yuv_cl));
+  }
+
+  cl_release_context(context);
+}
+
+TEST_CASE("TransformCPU benchmark", "[.][benchmark]") {
+  auto frame = random_frame(2);
+  Planes out(512, 256);
+  std::vector<uint8_t> dm(1440 * 960);
+
+  TransformCPU single(1), pool;
+  BENCHMARK("reference kernel 512x256") {
+    return transform_reference(frame.data(), 512, 256, PROJECTION).y[0];
+  };
+  BENCHMARK("TransformCPU 512x256, 1 thread") {
+    single.transform(frame.data(), FRAME_WIDTH, FRAME_HEIGHT, FRAME_STRIDE, FRAME_UV_OFFSET,
+                     out.y.data(), out.u.data(), out.v.data(), 512, 256, PROJECTION, true);
+    return out.y[0];
+  };
+  BENCHMARK("TransformCPU 512x256") {
+    pool.transform(frame.data(), FRAME_WIDTH, FRAME_HEIGHT, FRAME_STRIDE, FRAME_UV_OFFSET,
+                   out.y.data(), out.u.data(), out.v.data(), 512, 256, PROJECTION, true);
+    return out.y[0];
+  };
+  BENCHMARK("TransformCPU 1440x960 Y") {
+    pool.transform(frame.data(), FRAME_WIDTH, FRAME_HEIGHT, FRAME_STRIDE, FRAME_UV_OFFSET,
+                   dm.data(), nullptr, nullptr, 1440, 960, PROJECTION);
+    return dm[0];
+  };
+}
+
+TEST_CASE("DrivingModelFrame temporal history benchmark", "[.][benchmark]") {
+  const int temporal_skip = 4;
+  const int frame_size = 512 * 256 * 3 / 2;
+  std::vector<uint8_t> packed(frame_size, 128);
+  ShiftedHistory history(temporal_skip, frame_size);
+
+  // bytes copied per frame besides writing the new frame
+  WARN("shifted history: " << (temporal_skip + 2) * frame_size << " bytes/frame, ring: " << 2 * frame_size << " bytes/frame");
+  BENCHMARK("shifted history") {
+    return history.push(packed.data())[0];
+  };
+  std::vector<uint8_t> ring((temporal_skip + 1) * frame_size), input(2 * frame_size);
+  int head = 0;
+  BENCHMARK("ring") {
+    head = (head + 1) % (temporal_skip + 1);
+    memcpy(&ring[head * frame_size], packed.data(), frame_size);
+    memcpy(&input[0], &ring[((head + 1) % (temporal_skip + 1)) * frame_size], frame_size);
+    memcpy(&input[frame_size], &ring[head * frame_size], frame_size);
+    return input[0];
+  };
+}
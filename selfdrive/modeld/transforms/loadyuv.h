@@ -13,7 +13,7 @@ void loadyuv_destroy(LoadYUVState* s);
 
 void loadyuv_queue(LoadYUVState* s, cl_command_queue q,
                    cl_mem y_cl, cl_mem u_cl, cl_mem v_cl,
-                   cl_mem out_cl);
+                   cl_mem out_cl, int out_offset = 0);
 
 
 void copy_queue(LoadYUVState* s, cl_command_queue q, cl_mem src, cl_mem dst,
@@ -0,0 +1,188 @@
+#include "selfdrive/modeld/transforms/transform_cpu.h"
+
+#include <algorithm>
+#include <cmath>
+
+// rows handed out at a time, small enough to balance the driver and wide camera warps
+const int CHUNK_ROWS = 8;
+
+RowPool::RowPool(int num_threads) {
+  // the calling thread works too
+  for (int i = 1; i < num_threads; i++) {
+    threads.emplace_back(&RowPool::worker, this);
+  }
+}
+
+RowPool::~RowPool() {
+  {
+    std::lock_guard lk(lock);
+    exit = true;
+  }
+  cv.notify_all();
+  for (auto &t : threads) t.join();
+}
+
+void RowPool::run(int rows, const std::function<void(int, int)> &f) {
+  if (threads.empty()) {
+    f(0, rows);
+    return;
+  }
+
+  {
+    std::lock_guard lk(lock);
+    job = &f;
+    job_rows = rows;
+    next_row = 0;
+    pending = threads.size();
+    generation++;
+  }
+  cv.notify_all();
+  process();
+
+  std::unique_lock lk(lock);
+  done_cv.wait(lk, [this]() { return pending == 0; });
+  job = nullptr;
+}
+
+void RowPool::process() {
+  int start;
+  while ((start = next_row.fetch_add(CHUNK_ROWS)) < job_rows) {
+    (*job)(start, std::min(start + CHUNK_ROWS, job_rows));
+  }
+}
+
+void RowPool::worker() {
+  uint64_t seen = 0;
+  while (true) {
+    {
+      std::unique_lock lk(lock);
+      cv.wait(lk, [&]() { return exit || generation != seen; });
+      if (exit) return;
+      seen = generation;
+    }
+    process();
+    {
+      std::lock_guard lk(lock);
+      pending--;
+    }
+    done_cv.notify_one();
+  }
+}
+
+
+#define INTER_BITS 5
+#define INTER_TAB_SIZE (1 << INTER_BITS)
+#define INTER_REMAP_COEF_BITS 15
+#define INTER_REMAP_COEF_SCALE (1 << INTER_REMAP_COEF_BITS)
+
+namespace {
+
+// Source position of every pixel of an output row in 1/32 pixels, the float math of the kernel.
+// No gathers here so this vectorizes, rint is done by adding 1.5 * 2^23 which is exact below 2^22.
+void map_row(const float *M, int dy, int cols, int32_t *__restrict xs, int32_t *__restrict ys) {
+  const float lim = 1 << 21;
+  const float round = 0x1.8p23f;
+  const float fy = dy;
+  for (int dx = 0; dx < cols; dx++) {
+    const float fx = dx;
+    const float X0 = M[0] * fx + M[1] * fy + M[2];
+    const float Y0 = M[3] * fx + M[4] * fy + M[5];
+    float W = M[6] * fx + M[7] * fy + M[8];
+    W = W != 0.0f ? INTER_TAB_SIZE / W : 0.0f;
+    // far outside the source, sampling clamps to the border anyway
+    float x = X0 * W, y = Y0 * W;
+    x = x < -lim ? -lim : (x > lim ? lim : x);
+    y = y < -lim ? -lim : (y > lim ? lim : y);
+    xs[dx] = (int32_t)((x + round) - round);
+    ys[dx] = (int32_t)((y + round) - round);
+  }
+}
+
+struct SourcePlane {
+  const uint8_t *data;
+  int row_stride, px_stride, rows, cols;
+};
+
+// bilinear sample like the kernel, edge pixels repeat
+inline uint8_t sample(const SourcePlane &p, const int16_t (*itab)[4], int X, int Y) {
+  const int sx = X >> INTER_BITS, sy = Y >> INTER_BITS;
+  const int x0 = std::clamp(sx, 0, p.cols - 1) * p.px_stride;
+  const int x1 = std::clamp(sx + 1, 0, p.cols - 1) * p.px_stride;
+  const uint8_t *r0 = p.data + std::clamp(sy, 0, p.rows - 1) * p.row_stride;
+  const uint8_t *r1 = p.data + std::clamp(sy + 1, 0, p.rows - 1) * p.row_stride;
+
+  const int16_t *w = itab[(Y & (INTER_TAB_SIZE - 1)) * INTER_TAB_SIZE + (X & (INTER_TAB_SIZE - 1))];
+  int val = r0[x0] * w[0] + r0[x1] * w[1] + r1[x0] * w[2] + r1[x1] * w[3];
+  val = (val + (1 << (INTER_REMAP_COEF_BITS - 1))) >> INTER_REMAP_COEF_BITS;
+  return val < 0 ? 0 : (val > 255 ? 255 : val);
+}
+
+inline int16_t coef(float v) {
+  return std::clamp(std::nearbyint(v * INTER_REMAP_COEF_SCALE), -32768.0f, 32767.0f);
+}
+
+}  // namespace
+
+TransformCPU::TransformCPU(int num_threads)
+    : pool(num_threads > 0 ? num_threads : std::clamp((int)std::thread::hardware_concurrency(), 1, 4)) {
+  for (int ay = 0; ay < INTER_TAB_SIZE; ay++) {
+    for (int ax = 0; ax < INTER_TAB_SIZE; ax++) {
+      const float taby = 1.f / INTER_TAB_SIZE * ay;
+      const float tabx = 1.f / INTER_TAB_SIZE * ax;
+      int16_t *w = itab[ay * INTER_TAB_SIZE + ax];
+      w[0] = coef((1.0f - taby) * (1.0f - tabx));
+      w[1] = coef((1.0f - taby) * tabx);
+      w[2] = coef(taby * (1.0f - tabx));
+      w[3] = coef(taby * tabx);
+    }
+  }
+}
+
+void TransformCPU::transform(const uint8_t *in_yuv, int in_width, int in_height, int in_stride, int in_uv_offset,
+                             uint8_t *out_y, uint8_t *out_u, uint8_t *out_v, int out_width, int out_height,
+                             const mat3 &projection, bool packed_y) {
+  // in and out uv is half the size of y.
+  const mat3 projection_uv = transform_scale_buffer(projection, 0.5);
+  const SourcePlane src_y = {in_yuv, in_stride, 1, in_height, in_width};
+  const SourcePlane src_u = {in_yuv + in_uv_offset, in_stride, 2, in_height / 2, in_width / 2};
+  const SourcePlane src_v = {in_yuv + in_uv_offset + 1, in_stride, 2, in_height / 2, in_width / 2};
+
+  const int uv_width = out_width / 2;
+  const int uv_height = out_height / 2;
+  const int uv_size = uv_width * uv_height;
+  const bool chroma = out_u && out_v;
+
+  // Y rows first, then the U and V rows which share their source positions
+  pool.run(out_height + (chroma ? uv_height : 0), [&](int start, int end) {
+    std::vector<int32_t> xs(out_width), ys(out_width);
+    std::vector<uint8_t> row(out_width);
+    for (int r = start; r < end; r++) {
+      if (r < out_height) {
+        map_row(projection.v, r, out_width, xs.data(), ys.data());
+        uint8_t *dst = packed_y ? row.data() : out_y + r * out_width;
+        for (int dx = 0; dx < out_width; dx++) {
+          dst[dx] = sample(src_y, itab, xs[dx], ys[dx]);
+        }
+
+        if (packed_y) {
+          // like loadys: even rows go to planes 0 and 2, odd rows to 1 and 3, even columns to the first of them
+          uint8_t *even = out_y + (r & 1) * uv_size + (r / 2) * uv_width;
+          uint8_t *odd = even + 2 * uv_size;
+          for (int i = 0; i < uv_width; i++) {
+            even[i] = row[2 * i];
+            odd[i] = row[2 * i + 1];
+          }
+        }
+      } else {
+        const int dy = r - out_height;
+        map_row(projection_uv.v, dy, uv_width, xs.data(), ys.data());
+        uint8_t *dst_u = out_u + dy * uv_width;
+        uint8_t *dst_v = out_v + dy * uv_width;
+        for (int dx = 0; dx < uv_width; dx++) {
+          dst_u[dx] = sample(src_u, itab, xs[dx], ys[dx]);
+          dst_v[dx] = sample(src_v, itab, xs[dx], ys[dx]);
+        }
+      }
+    }
+  });
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "common/mat.h"
+
+// Persistent worker threads that split a range of rows between them.
+class RowPool {
+public:
+  RowPool(int num_threads);
+  ~RowPool();
+  // runs f(row_start, row_end) over [0, rows) on all threads and waits for it to finish
+  void run(int rows, const std::function<void(int, int)> &f);
+
+private:
+  void worker();
+  void process();
+
+  std::vector<std::thread> threads;
+  std::mutex lock;
+  std::condition_variable cv, done_cv;
+  const std::function<void(int, int)> *job = nullptr;
+  int job_rows = 0;
+  std::atomic<int> next_row = 0;
+  uint64_t generation = 0;
+  int pending = 0;
+  bool exit = false;
+};
+
+// Native version of transform_queue and loadys, for running without an OpenCL device.
+// Matches the warpPerspective kernel in transform.cl up to float rounding.
+class TransformCPU {
+public:
+  TransformCPU(int num_threads = 0);
+
+  // Warps the NV12 frame into the out_y, out_u and out_v planes like transform_queue. Without
+  // chroma outputs only Y is warped. With packed_y, out_y is laid out as loadys packs it
+  // for the driving model: the 2x2 pixel blocks of the image split over four planes.
+  void transform(const uint8_t *in_yuv, int in_width, int in_height, int in_stride, int in_uv_offset,
+                 uint8_t *out_y, uint8_t *out_u, uint8_t *out_v, int out_width, int out_height,
+                 const mat3 &projection, bool packed_y = false);
+
+private:
+  RowPool pool;
+  // bilinear weights of the kernel for every fractional position
+  int16_t itab[32 * 32][4];
+};
@@ -426,6 +426,7 @@ void pandad_run(std::vector<Panda *> &pandas) {
 
   Params params;
   RateKeeper rk("pandad", 100);
+  rk.useAbsoluteDeadlines();
   SubMaster sm({"selfdriveState"});
   PubMaster pm({"can", "pandaStates", "peripheralState"});
   PandaSafety panda_safety(pandas);
@@ -469,6 +470,11 @@ void pandad_run(std::vector<Panda *> &pandas) {
       }
     }
 
+    // Log loop timing once a minute
+    if (rk.frame() > 0 && rk.frame() % 6000 == 0) {
+      rk.logStats();
+    }
+
     rk.keepTime();
   }
 
@@ -78,7 +78,7 @@ BodyWindow::BodyWindow(QWidget *parent) : fuel_filter(1.0, 5., 1. / UI_FREQ), QW
   });
   w->raise();
 
-  QObject::connect(uiState(), &UIState::uiUpdate, this, &BodyWindow::updateState);
+  uiState()->subscribe(this, {"carState", "managerState"}, [this](const UIState &s) { updateState(s); });
 }
 
 void BodyWindow::paintEvent(QPaintEvent *event) {
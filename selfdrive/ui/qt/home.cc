@@ -39,7 +39,8 @@ HomeWindow::HomeWindow(QWidget* parent) : QWidget(parent) {
   });
   slayout->addWidget(driver_view);
   setAttribute(Qt::WA_NoSystemBackground);
-  QObject::connect(uiState(), &UIState::uiUpdate, this, &HomeWindow::updateState);
+  // deviceState to catch the switch to onroad when carParams came earlier
+  uiState()->subscribe(this, {"carParams", "deviceState"}, [this](const UIState &s) { updateState(s); });
   QObject::connect(uiState(), &UIState::offroadTransition, this, &HomeWindow::offroadTransition);
   QObject::connect(uiState(), &UIState::offroadTransition, sidebar, &Sidebar::offroadTransition);
 }
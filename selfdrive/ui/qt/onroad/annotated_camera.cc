@@ -19,11 +19,13 @@ AnnotatedCameraWidget::AnnotatedCameraWidget(VisionStreamType type, QWidget *par
 
   experimental_btn = new ExperimentalButton(this);
   main_layout->addWidget(experimental_btn, 0, Qt::AlignTop | Qt::AlignRight);
+
+  uiState()->subscribe(this, {"driverStateV2", "driverMonitoringState", "selfdriveState"}, [this](const UIState &s) {
+    if (s.scene.started) updateState(s);
+  });
 }
 
 void AnnotatedCameraWidget::updateState(const UIState &s) {
-  // update engageability/experimental mode button
-  experimental_btn->updateState(s);
   dmon.updateState(s);
 }
 
@@ -22,6 +22,7 @@ ExperimentalButton::ExperimentalButton(QWidget *parent) : experimental_mode(fals
   engage_img = loadPixmap("../assets/icons/chffr_wheel.png", {img_size, img_size});
   experimental_img = loadPixmap("../assets/icons/experimental.svg", {img_size, img_size});
   QObject::connect(this, &QPushButton::clicked, this, &ExperimentalButton::changeMode);
+  uiState()->subscribe(this, {"selfdriveState"}, [this](const UIState &s) { updateState(s); });
 }
 
 void ExperimentalButton::changeMode() {
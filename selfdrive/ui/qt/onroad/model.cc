@@ -22,22 +22,36 @@ void ModelRenderer::draw(QPainter &painter, const QRect &surface_rect) {
     return;
   }
 
-  clip_region = surface_rect.adjusted(-CLIP_MARGIN, -CLIP_MARGIN, CLIP_MARGIN, CLIP_MARGIN);
   experimental_mode = sm["selfdriveState"].getSelfdriveState().getExperimentalMode();
   longitudinal_control = sm["carParams"].getCarParams().getOpenpilotLongitudinalControl();
   path_offset_z = sm["liveCalibration"].getLiveCalibration().getHeight()[0];
+  allow_throttle = sm["longitudinalPlan"].getLongitudinalPlan().getAllowThrottle() || !longitudinal_control;
+
+  draw(painter, surface_rect, sm["modelV2"].getModelV2(), sm["radarState"].getRadarState(), sm.alive("radarState"));
+}
+
+void ModelRenderer::draw(QPainter &painter, const QRect &surface_rect, const cereal::ModelDataV2::Reader &model,
+                         const cereal::RadarState::Reader &radar_state, bool radar_alive) {
+  clip_region = surface_rect.adjusted(-CLIP_MARGIN, -CLIP_MARGIN, CLIP_MARGIN, CLIP_MARGIN);
 
   painter.save();
 
-  const auto &model = sm["modelV2"].getModelV2();
-  const auto &radar_state = sm["radarState"].getRadarState();
   const auto &lead_one = radar_state.getLeadOne();
 
-  update_model(model, lead_one);
+  // the UI paints faster than the model runs, only project the lines again for a new model frame or view
+  GeometryKey key = {model.getFrameId(), model.getTimestampEof(), car_space_transform, clip_region, path_offset_z,
+                     lead_one.getStatus() ? lead_one.getDRel() : -1.0f};
+  if (!geometry_valid || !(key == geometry_key)) {
+    update_model(model, lead_one);
+    geometry_key = key;
+    geometry_valid = true;
+    // the experimental mode gradient follows the path
+    gradient_key = GradientKey();
+  }
   drawLaneLines(painter);
   drawPath(painter, model, surface_rect.height());
 
-  if (longitudinal_control && sm.alive("radarState")) {
+  if (longitudinal_control && radar_alive) {
     update_leads(radar_state, model.getPosition());
     const auto &lead_two = radar_state.getLeadTwo();
     if (lead_one.getStatus()) {
@@ -106,42 +120,67 @@ void ModelRenderer::drawLaneLines(QPainter &painter) {
 }
 
 void ModelRenderer::drawPath(QPainter &painter, const cereal::ModelDataV2::Reader &model, int height) {
-  QLinearGradient bg(0, height, 0, 0);
-  if (experimental_mode) {
-    // The first half of track_vertices are the points for the right side of the path
-    const auto &acceleration = model.getAcceleration().getX();
-    const int max_len = std::min<int>(track_vertices.length() / 2, acceleration.size());
-
-    for (int i = 0; i < max_len; ++i) {
-      // Some points are out of frame
-      int track_idx = max_len - i - 1;  // flip idx to start from bottom right
-      if (track_vertices[track_idx].y() < 0 || track_vertices[track_idx].y() > height) continue;
-
-      // Flip so 0 is bottom of frame
-      float lin_grad_point = (height - track_vertices[track_idx].y()) / height;
-
-      // speed up: 120, slow down: 0
-      float path_hue = fmax(fmin(60 + acceleration[i] * 35, 120), 0);
-      // FIXME: painter.drawPolygon can be slow if hue is not rounded
-      path_hue = int(path_hue * 100 + 0.5) / 100;
-
-      float saturation = fmin(fabs(acceleration[i] * 1.5), 1);
-      float lightness = util::map_val(saturation, 0.0f, 1.0f, 0.95f, 0.62f);        // lighter when grey
-      float alpha = util::map_val(lin_grad_point, 0.75f / 2.f, 0.75f, 0.4f, 0.0f);  // matches previous alpha fade
-      bg.setColorAt(lin_grad_point, QColor::fromHslF(path_hue / 360., saturation, lightness, alpha));
-
-      // Skip a point, unless next is last
-      i += (i + 2) < max_len ? 1 : 0;
-    }
+  if (!experimental_mode) {
+    updateThrottleBlend();
+  }
+
+  // the gradient is only built again when its inputs change
+  GradientKey key = {height, experimental_mode, allow_throttle, blend_factor};
+  if (!(key == gradient_key)) {
+    gradient_key = key;
+    path_gradient = QLinearGradient(0, height, 0, 0);
+    if (experimental_mode) {
+      // The first half of track_vertices are the points for the right side of the path
+      const auto &acceleration = model.getAcceleration().getX();
+      const int max_len = std::min<int>(track_vertices.length() / 2, acceleration.size());
+
+      for (int i = 0; i < max_len; ++i) {
+        // Some points are out of frame
+        int track_idx = max_len - i - 1;  // flip idx to start from bottom right
+        if (track_vertices[track_idx].y() < 0 || track_vertices[track_idx].y() > height) continue;
+
+        // Flip so 0 is bottom of frame
+        float lin_grad_point = (height - track_vertices[track_idx].y()) / height;
+
+        // speed up: 120, slow down: 0
+        float path_hue = fmax(fmin(60 + acceleration[i] * 35, 120), 0);
+        // FIXME: painter.drawPolygon can be slow if hue is not rounded
+        path_hue = int(path_hue * 100 + 0.5) / 100;
+
+        float saturation = fmin(fabs(acceleration[i] * 1.5), 1);
+        float lightness = util::map_val(saturation, 0.0f, 1.0f, 0.95f, 0.62f);        // lighter when grey
+        float alpha = util::map_val(lin_grad_point, 0.75f / 2.f, 0.75f, 0.4f, 0.0f);  // matches previous alpha fade
+        path_gradient.setColorAt(lin_grad_point, QColor::fromHslF(path_hue / 360., saturation, lightness, alpha));
+
+        // Skip a point, unless next is last
+        i += (i + 2) < max_len ? 1 : 0;
+      }
 
-  } else {
-    updatePathGradient(bg);
+    } else {
+      updatePathGradient(path_gradient);
+    }
   }
 
-  painter.setBrush(bg);
+  painter.setBrush(path_gradient);
   painter.drawPolygon(track_vertices);
 }
 
+void ModelRenderer::updateThrottleBlend() {
+  // Transition speed; 0.1 corresponds to 0.5 seconds at UI_FREQ
+  constexpr float transition_speed = 0.1f;
+
+  // Start transition if throttle state changes
+  if (allow_throttle != prev_allow_throttle) {
+    prev_allow_throttle = allow_throttle;
+    // Invert blend factor for a smooth transition when the state changes mid-animation
+    blend_factor = std::max(1.0f - blend_factor, 0.0f);
+  }
+
+  if (blend_factor < 1.0f) {
+    blend_factor = std::min(blend_factor + transition_speed, 1.0f);
+  }
+}
+
 void ModelRenderer::updatePathGradient(QLinearGradient &bg) {
   static const QColor throttle_colors[] = {
       QColor::fromHslF(148. / 360., 0.94, 0.51, 0.4),
@@ -154,22 +193,8 @@ void ModelRenderer::updatePathGradient(QLinearGradient &bg) {
       QColor::fromHslF(112. / 360., 0.0, 0.95, 0.0),
   };
 
-  // Transition speed; 0.1 corresponds to 0.5 seconds at UI_FREQ
-  constexpr float transition_speed = 0.1f;
-
-  // Start transition if throttle state changes
-  bool allow_throttle = (*uiState()->sm)["longitudinalPlan"].getLongitudinalPlan().getAllowThrottle() || !longitudinal_control;
-  if (allow_throttle != prev_allow_throttle) {
-    prev_allow_throttle = allow_throttle;
-    // Invert blend factor for a smooth transition when the state changes mid-animation
-    blend_factor = std::max(1.0f - blend_factor, 0.0f);
-  }
-
   const QColor *begin_colors = allow_throttle ? no_throttle_colors : throttle_colors;
   const QColor *end_colors = allow_throttle ? throttle_colors : no_throttle_colors;
-  if (blend_factor < 1.0f) {
-    blend_factor = std::min(blend_factor + transition_speed, 1.0f);
-  }
 
   // Set gradient colors by blending the start and end colors
   bg.setColorAt(0.0f, blendColors(begin_colors[0], end_colors[0], blend_factor));
@@ -230,21 +255,39 @@ bool ModelRenderer::mapToScreen(float in_x, float in_y, float in_z, QPointF *out
 void ModelRenderer::mapLineToPolygon(const cereal::XYZTData::Reader &line, float y_off, float z_off,
                                      QPolygonF *pvd, int max_idx, bool allow_invert) {
   const auto line_x = line.getX(), line_y = line.getY(), line_z = line.getZ();
-  QPointF left, right;
-  pvd->clear();
-  for (int i = 0; i <= max_idx; i++) {
+  const int n = max_idx + 1;
+
+  // project the left and right side of every point with a single matrix product
+  line_points.resize(3, 2 * n);
+  for (int i = 0; i < n; i++) {
+    line_points.col(2 * i) << line_x[i], line_y[i] - y_off, line_z[i] + z_off;
+    line_points.col(2 * i + 1) << line_x[i], line_y[i] + y_off, line_z[i] + z_off;
+  }
+  screen_points.noalias() = car_space_transform * line_points;
+  screen_points.row(0).array() /= screen_points.row(2).array();
+  screen_points.row(1).array() /= screen_points.row(2).array();
+
+  left_side.clear();
+  right_side.clear();
+  for (int i = 0; i < n; i++) {
     // highly negative x positions  are drawn above the frame and cause flickering, clip to zy plane of camera
     if (line_x[i] < 0) continue;
 
-    bool l = mapToScreen(line_x[i], line_y[i] - y_off, line_z[i] + z_off, &left);
-    bool r = mapToScreen(line_x[i], line_y[i] + y_off, line_z[i] + z_off, &right);
-    if (l && r) {
+    QPointF left(screen_points(0, 2 * i), screen_points(1, 2 * i));
+    QPointF right(screen_points(0, 2 * i + 1), screen_points(1, 2 * i + 1));
+    if (clip_region.contains(left) && clip_region.contains(right)) {
       // For wider lines the drawn polygon will "invert" when going over a hill and cause artifacts
-      if (!allow_invert && pvd->size() && left.y() > pvd->back().y()) {
+      if (!allow_invert && left_side.size() && left.y() > left_side.back().y()) {
         continue;
       }
-      pvd->push_back(left);
-      pvd->push_front(right);
+      left_side.push_back(left);
+      right_side.push_back(right);
     }
   }
+
+  // the right side goes back down the line, closing the polygon
+  pvd->clear();
+  pvd->reserve(left_side.size() + right_side.size());
+  for (auto it = right_side.rbegin(); it != right_side.rend(); ++it) pvd->push_back(*it);
+  for (const QPointF &pt : left_side) pvd->push_back(pt);
 }
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <vector>
+
 #include <QPainter>
 #include <QPolygonF>
 
@@ -10,8 +12,39 @@ public:
   ModelRenderer() {}
   void setTransform(const Eigen::Matrix3f &transform) { car_space_transform = transform; }
   void draw(QPainter &painter, const QRect &surface_rect);
+  // draws the given messages, draw() calls this with the latest ones
+  void draw(QPainter &painter, const QRect &surface_rect, const cereal::ModelDataV2::Reader &model,
+            const cereal::RadarState::Reader &radar_state, bool radar_alive);
+  // screen space geometry of the last draw
+  const QPolygonF &trackVertices() const { return track_vertices; }
+  const QPolygonF &laneLineVertices(int i) const { return lane_line_vertices[i]; }
+  const QPolygonF &roadEdgeVertices(int i) const { return road_edge_vertices[i]; }
 
 private:
+  // everything the screen space geometry depends on, it's only recomputed when this changes
+  struct GeometryKey {
+    uint32_t frame_id = 0;
+    uint64_t timestamp_eof = 0;
+    Eigen::Matrix3f transform = Eigen::Matrix3f::Zero();
+    QRectF clip_region;
+    float path_offset_z = 0;
+    float lead_d_rel = -1;
+    bool operator==(const GeometryKey &other) const {
+      return frame_id == other.frame_id && timestamp_eof == other.timestamp_eof && transform == other.transform &&
+             clip_region == other.clip_region && path_offset_z == other.path_offset_z && lead_d_rel == other.lead_d_rel;
+    }
+  };
+  struct GradientKey {
+    int height = -1;
+    bool experimental_mode = false;
+    bool allow_throttle = false;
+    float blend_factor = -1;
+    bool operator==(const GradientKey &other) const {
+      return height == other.height && experimental_mode == other.experimental_mode &&
+             allow_throttle == other.allow_throttle && blend_factor == other.blend_factor;
+    }
+  };
+
   bool mapToScreen(float in_x, float in_y, float in_z, QPointF *out);
   void mapLineToPolygon(const cereal::XYZTData::Reader &line, float y_off, float z_off,
                         QPolygonF *pvd, int max_idx, bool allow_invert = true);
@@ -21,11 +54,13 @@ private:
   void drawLaneLines(QPainter &painter);
   void drawPath(QPainter &painter, const cereal::ModelDataV2::Reader &model, int height);
   void updatePathGradient(QLinearGradient &bg);
+  void updateThrottleBlend();
   QColor blendColors(const QColor &start, const QColor &end, float t);
 
   bool longitudinal_control = false;
   bool experimental_mode = false;
   float blend_factor = 1.0f;
+  bool allow_throttle = true;
   bool prev_allow_throttle = true;
   float lane_line_probs[4] = {};
   float road_edge_stds[2] = {};
@@ -36,4 +71,13 @@ private:
   QPointF lead_vertices[2] = {};
   Eigen::Matrix3f car_space_transform = Eigen::Matrix3f::Zero();
   QRectF clip_region;
+
+  GeometryKey geometry_key;
+  bool geometry_valid = false;
+  GradientKey gradient_key;
+  QLinearGradient path_gradient;
+
+  // scratch space for projecting a line
+  Eigen::Matrix<float, 3, Eigen::Dynamic> line_points, screen_points;
+  std::vector<QPointF> left_side, right_side;
 };
@@ -35,7 +35,11 @@ OnroadWindow::OnroadWindow(QWidget *parent) : QWidget(parent) {
   alerts->raise();
 
   setAttribute(Qt::WA_OpaquePaintEvent);
-  QObject::connect(uiState(), &UIState::uiUpdate, this, &OnroadWindow::updateState);
+  // the alert timeouts need a clock, the border only changes with selfdriveState
+  QObject::connect(uiState(), &UIState::uiUpdate, alerts, [this](const UIState &s) {
+    if (s.scene.started) alerts->updateState(s);
+  });
+  uiState()->subscribe(this, {"selfdriveState"}, [this](const UIState &s) { updateState(s); });
   QObject::connect(uiState(), &UIState::offroadTransition, this, &OnroadWindow::offroadTransition);
 }
 
@@ -44,9 +48,6 @@ void OnroadWindow::updateState(const UIState &s) {
     return;
   }
 
-  alerts->updateState(s);
-  nvg->updateState(s);
-
   QColor bgColor = bg_colors[s.status];
   if (bg != bgColor) {
     // repaint border
@@ -57,6 +58,8 @@ void OnroadWindow::updateState(const UIState &s) {
 
 void OnroadWindow::offroadTransition(bool offroad) {
   alerts->clear();
+  // the status is reset when going onroad
+  updateState(*uiState());
 }
 
 void OnroadWindow::paintEvent(QPaintEvent *event) {
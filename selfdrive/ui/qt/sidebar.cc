@@ -36,7 +36,8 @@ Sidebar::Sidebar(QWidget *parent) : QFrame(parent), onroad(false), flag_pressed(
   setSizePolicy(QSizePolicy::Fixed, QSizePolicy::Expanding);
   setFixedWidth(300);
 
-  QObject::connect(uiState(), &UIState::uiUpdate, this, &Sidebar::updateState);
+  // everything shown comes from deviceState and pandaStates, both at 2Hz
+  uiState()->subscribe(this, {"deviceState", "pandaStates"}, [this](const UIState &s) { updateState(s); });
 
   pm = std::make_unique<PubMaster>(std::vector<const char*>{"userFlag"});
 }
@@ -9,6 +9,8 @@
 #include <cmath>
 #include <QApplication>
 
+#include "common/frame_pacing.h"
+
 namespace {
 
 const char frame_vertex_shader[] =
@@ -80,6 +82,7 @@ CameraWidget::~CameraWidget() {
     glDeleteBuffers(1, &frame_vbo);
     glDeleteBuffers(1, &frame_ibo);
 #ifndef QCOM2
+    uploader.destroy();
     glDeleteTextures(2, textures);
 #endif
   }
@@ -232,18 +235,12 @@ void CameraWidget::paintGL() {
   glEGLImageTargetTexture2DOES(GL_TEXTURE_EXTERNAL_OES, egl_images[frame->idx]);
   assert(glGetError() == GL_NO_ERROR);
 #else
-  // fallback to copy
-  glPixelStorei(GL_UNPACK_ROW_LENGTH, stream_stride);
+  // fallback to copy, done into a pixel buffer by the vipc thread. this only starts the transfer to the textures
+  uploader.upload();
   glActiveTexture(GL_TEXTURE0);
   glBindTexture(GL_TEXTURE_2D, textures[0]);
-  glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, stream_width, stream_height, GL_RED, GL_UNSIGNED_BYTE, frame->y);
-  assert(glGetError() == GL_NO_ERROR);
-
-  glPixelStorei(GL_UNPACK_ROW_LENGTH, stream_stride/2);
   glActiveTexture(GL_TEXTURE0 + 1);
   glBindTexture(GL_TEXTURE_2D, textures[1]);
-  glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, stream_width/2, stream_height/2, GL_RG, GL_UNSIGNED_BYTE, frame->uv);
-  assert(glGetError() == GL_NO_ERROR);
 #endif
 
   glUniformMatrix4fv(program->uniformLocation("uTransform"), 1, GL_TRUE, frame_mat.v);
@@ -304,6 +301,8 @@ void CameraWidget::vipcConnected(VisionIpcClient *vipc_client) {
   glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
   glTexImage2D(GL_TEXTURE_2D, 0, GL_RG8, stream_width/2, stream_height/2, 0, GL_RG, GL_UNSIGNED_BYTE, nullptr);
   assert(glGetError() == GL_NO_ERROR);
+
+  uploader.init(stream_width, stream_height, stream_stride, textures[0], textures[1]);
 #endif
 }
 
@@ -315,6 +314,8 @@ void CameraWidget::vipcThread() {
   VisionStreamType cur_stream = requested_stream_type;
   std::unique_ptr<VisionIpcClient> vipc_client;
   VisionIpcBufExtra meta_main = {0};
+  // the cameras run at 20Hz
+  FramePacingMonitor pacing("ui " + stream_name, 1e9 / 20, 30);
 
   while (!QThread::currentThread()->isInterruptionRequested()) {
     if (!vipc_client || cur_stream != requested_stream_type) {
@@ -342,6 +343,10 @@ void CameraWidget::vipcThread() {
     }
 
     if (VisionBuf *buf = vipc_client->recv(&meta_main, 1000)) {
+      pacing.received(meta_main.frame_id, meta_main.timestamp_eof);
+#ifndef QCOM2
+      uploader.write(meta_main.frame_id, buf->y, buf->uv);
+#endif
       {
         std::lock_guard lk(frame_lock);
         frames.push_back(std::make_pair(meta_main.frame_id, buf));
@@ -350,6 +355,7 @@ void CameraWidget::vipcThread() {
         }
       }
       emit vipcThreadFrameReceived();
+      pacing.processed();
     } else {
       if (!isVisible()) {
         vipc_client->connected = false;
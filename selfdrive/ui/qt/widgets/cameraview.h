@@ -23,6 +23,7 @@
 #endif
 
 #include "msgq/visionipc/visionipc_client.h"
+#include "selfdrive/ui/qt/widgets/frame_uploader.h"
 #include "selfdrive/ui/ui.h"
 
 const int FRAME_BUFFER_SIZE = 5;
@@ -39,6 +40,9 @@ public:
   void setStreamType(VisionStreamType type) { requested_stream_type = type; }
   VisionStreamType getStreamType() { return active_stream_type; }
   void stopVipcThread();
+#ifndef QCOM2
+  FrameUploader::Stats uploadStats() { return uploader.stats(); }
+#endif
 
 signals:
   void clicked();
@@ -65,6 +69,8 @@ protected:
 
 #ifdef QCOM2
   std::map<int, EGLImageKHR> egl_images;
+#else
+  FrameUploader uploader;
 #endif
 
   std::string stream_name;
@@ -0,0 +1,148 @@
+#include "selfdrive/ui/qt/widgets/frame_uploader.h"
+
+#include <cstring>
+
+#include "common/timing.h"
+
+void FrameUploader::init(int _width, int _height, int _stride, GLuint _tex_y, GLuint _tex_uv) {
+  destroy();
+
+  std::lock_guard lk(lock);
+  width = _width;
+  height = _height;
+  stride = _stride;
+  tex_y = _tex_y;
+  tex_uv = _tex_uv;
+  y_size = (size_t)stride * height;
+  buffer_size = y_size + (size_t)stride * (height / 2);
+
+  for (auto &b : buffers) {
+    glGenBuffers(1, &b.pbo);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, b.pbo);
+    glBufferData(GL_PIXEL_UNPACK_BUFFER, buffer_size, nullptr, GL_STREAM_DRAW);
+  }
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+  initialized = true;
+  recycle();
+}
+
+void FrameUploader::destroy() {
+  std::lock_guard lk(lock);
+  if (!initialized) return;
+
+  for (auto &b : buffers) {
+    if (b.state == State::Mapped || b.state == State::Written) {
+      glBindBuffer(GL_PIXEL_UNPACK_BUFFER, b.pbo);
+      glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+    }
+    assert(b.state != State::Writing);
+    if (b.fence) glDeleteSync(b.fence);
+    glDeleteBuffers(1, &b.pbo);
+    b = Buffer();
+  }
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+  initialized = false;
+}
+
+void FrameUploader::recycle() {
+  for (auto &b : buffers) {
+    if (b.state == State::Reading) {
+      GLenum ret = glClientWaitSync(b.fence, 0, 0);
+      if (ret != GL_ALREADY_SIGNALED && ret != GL_CONDITION_SATISFIED) continue;
+      glDeleteSync(b.fence);
+      b.fence = nullptr;
+      b.state = State::Unmapped;
+    }
+    if (b.state == State::Unmapped) {
+      glBindBuffer(GL_PIXEL_UNPACK_BUFFER, b.pbo);
+      b.ptr = (uint8_t *)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, buffer_size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+      if (b.ptr) b.state = State::Mapped;
+    }
+  }
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+bool FrameUploader::upload(uint32_t *frame_id) {
+  const double start_t = millis_since_boot();
+  std::lock_guard lk(lock);
+  if (!initialized) return false;
+
+  // only the newest frame is shown, older ones still waiting are dropped
+  Buffer *newest = nullptr;
+  for (auto &b : buffers) {
+    if (b.state == State::Written && (!newest || b.seq > newest->seq)) newest = &b;
+  }
+  for (auto &b : buffers) {
+    if (b.state == State::Written && &b != newest) {
+      glBindBuffer(GL_PIXEL_UNPACK_BUFFER, b.pbo);
+      glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+      b.state = State::Unmapped;
+      stats_.dropped++;
+    }
+  }
+
+  if (newest) {
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, newest->pbo);
+    glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+    newest->ptr = nullptr;
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, stride);
+    glBindTexture(GL_TEXTURE_2D, tex_y);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, GL_RED, GL_UNSIGNED_BYTE, (const void *)0);
+
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, stride/2);
+    glBindTexture(GL_TEXTURE_2D, tex_uv);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width/2, height/2, GL_RG, GL_UNSIGNED_BYTE, (const void *)y_size);
+    assert(glGetError() == GL_NO_ERROR);
+
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+
+    // the buffer is mapped again once the transfer is done
+    newest->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    newest->state = State::Reading;
+    if (frame_id) *frame_id = newest->frame_id;
+    stats_.uploaded++;
+  }
+
+  recycle();
+  stats_.upload_ms += millis_since_boot() - start_t;
+  return newest != nullptr;
+}
+
+bool FrameUploader::write(uint32_t frame_id, const uint8_t *y, const uint8_t *uv) {
+  const double start_t = millis_since_boot();
+  Buffer *buf = nullptr;
+  {
+    std::lock_guard lk(lock);
+    for (auto &b : buffers) {
+      if (b.state == State::Mapped) {
+        buf = &b;
+        break;
+      }
+    }
+    if (!buf) {
+      stats_.dropped++;
+      return false;
+    }
+    buf->state = State::Writing;
+  }
+
+  memcpy(buf->ptr, y, y_size);
+  memcpy(buf->ptr + y_size, uv, buffer_size - y_size);
+
+  std::lock_guard lk(lock);
+  buf->state = State::Written;
+  buf->frame_id = frame_id;
+  buf->seq = ++write_seq;
+  stats_.written++;
+  stats_.copy_ms += millis_since_boot() - start_t;
+  return true;
+}
+
+FrameUploader::Stats FrameUploader::stats() {
+  std::lock_guard lk(lock);
+  return stats_;
+}
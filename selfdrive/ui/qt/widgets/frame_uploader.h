@@ -0,0 +1,66 @@
+#pragma once
+
+#ifdef __APPLE__
+#include <OpenGL/gl3.h>
+#else
+#include <GLES3/gl3.h>
+#endif
+
+#include <cassert>
+#include <cstdint>
+#include <mutex>
+
+// buffers in the ring: one being read into the textures, one being written and a spare
+const int UPLOAD_BUFFER_COUNT = 3;
+
+// Streams NV12 frames into a Y (R8) and a UV (RG8) texture through a ring of pixel unpack
+// buffers. The receiving thread copies each frame into a mapped buffer with write(), and
+// upload() on the GL thread only starts the transfer from that buffer into the textures.
+// A buffer is mapped again after the fence of its last transfer has signaled.
+class FrameUploader {
+public:
+  struct Stats {
+    uint64_t written = 0;
+    uint64_t uploaded = 0;
+    uint64_t dropped = 0;      // frames that never made it to the textures
+    double upload_ms = 0;      // GL thread time in upload()
+    double copy_ms = 0;        // receiving thread time in write()
+  };
+
+  ~FrameUploader() { assert(!initialized); }
+
+  // GL thread, with the context current. The receiving thread must not be in write() while
+  // the buffers are created or destroyed.
+  void init(int width, int height, int stride, GLuint tex_y, GLuint tex_uv);
+  void destroy();
+  // uploads the newest written frame, false if there was none
+  bool upload(uint32_t *frame_id = nullptr);
+
+  // receiving thread, false if no buffer was free and the frame was dropped
+  bool write(uint32_t frame_id, const uint8_t *y, const uint8_t *uv);
+
+  Stats stats();
+
+private:
+  enum class State { Unmapped, Mapped, Writing, Written, Reading };
+  struct Buffer {
+    GLuint pbo = 0;
+    State state = State::Unmapped;
+    uint8_t *ptr = nullptr;
+    GLsync fence = nullptr;
+    uint32_t frame_id = 0;
+    uint64_t seq = 0;
+  };
+
+  // maps the buffers whose transfer finished, called with the lock held
+  void recycle();
+
+  std::mutex lock;
+  Buffer buffers[UPLOAD_BUFFER_COUNT];
+  bool initialized = false;
+  int width = 0, height = 0, stride = 0;
+  size_t y_size = 0, buffer_size = 0;
+  GLuint tex_y = 0, tex_uv = 0;
+  uint64_t write_seq = 0;
+  Stats stats_;
+};
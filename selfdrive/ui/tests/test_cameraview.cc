@@ -0,0 +1,130 @@
+#include "catch2/catch.hpp"
+
+#include <random>
+#include <vector>
+
+#include <QOffscreenSurface>
+#include <QOpenGLContext>
+
+#include "selfdrive/ui/qt/widgets/frame_uploader.h"
+
+const int WIDTH = 1928, HEIGHT = 1208, STRIDE = 2048;
+
+struct Frame {
+  uint32_t id;
+  std::vector<uint8_t> yuv;
+  const uint8_t *y() const { return yuv.data(); }
+  const uint8_t *uv() const { return yuv.data() + STRIDE * HEIGHT; }
+};
+
+static Frame random_frame(uint32_t id) {
+  std::mt19937 gen(id);
+  Frame frame = {id, std::vector<uint8_t>(STRIDE * HEIGHT * 3 / 2)};
+  for (auto &px : frame.yuv) px = gen();
+  return frame;
+}
+
+static GLuint create_texture(GLint format, int width, int height, GLenum pixel_format) {
+  GLuint tex;
+  glGenTextures(1, &tex);
+  glBindTexture(GL_TEXTURE_2D, tex);
+  glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, pixel_format, GL_UNSIGNED_BYTE, nullptr);
+  glBindTexture(GL_TEXTURE_2D, 0);
+  return tex;
+}
+
+// channels of the texture, read back through a framebuffer
+static std::vector<uint8_t> read_texture(GLuint tex, int width, int height, int channels) {
+  GLuint fbo;
+  glGenFramebuffers(1, &fbo);
+  glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+  glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, tex, 0);
+  std::vector<uint8_t> rgba(width * height * 4);
+  glPixelStorei(GL_PACK_ALIGNMENT, 1);
+  glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, rgba.data());
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  glDeleteFramebuffers(1, &fbo);
+
+  std::vector<uint8_t> out;
+  for (size_t i = 0; i < rgba.size(); i += 4) out.insert(out.end(), &rgba[i], &rgba[i + channels]);
+  return out;
+}
+
+static bool textures_match(GLuint tex_y, GLuint tex_uv, const Frame &frame) {
+  auto y = read_texture(tex_y, WIDTH, HEIGHT, 1);
+  auto uv = read_texture(tex_uv, WIDTH / 2, HEIGHT / 2, 2);
+  for (int row = 0; row < HEIGHT; row++) {
+    if (memcmp(&y[row * WIDTH], frame.y() + row * STRIDE, WIDTH) != 0) return false;
+  }
+  for (int row = 0; row < HEIGHT / 2; row++) {
+    if (memcmp(&uv[row * WIDTH], frame.uv() + row * STRIDE, WIDTH) != 0) return false;
+  }
+  return true;
+}
+
+TEST_CASE("FrameUploader") {
+  // software rendering is enough, e.g. LIBGL_ALWAYS_SOFTWARE=1 QT_QPA_PLATFORM=offscreen
+  QSurfaceFormat fmt;
+  fmt.setRenderableType(QSurfaceFormat::OpenGLES);
+  fmt.setVersion(3, 0);
+  QOffscreenSurface surface;
+  surface.setFormat(fmt);
+  surface.create();
+  QOpenGLContext ctx;
+  ctx.setFormat(fmt);
+  if (!ctx.create() || !ctx.makeCurrent(&surface)) {
+    WARN("no OpenGL context, skipping");
+    return;
+  }
+
+  GLuint tex_y = create_texture(GL_R8, WIDTH, HEIGHT, GL_RED);
+  GLuint tex_uv = create_texture(GL_RG8, WIDTH / 2, HEIGHT / 2, GL_RG);
+  FrameUploader uploader;
+  uploader.init(WIDTH, HEIGHT, STRIDE, tex_y, tex_uv);
+  std::vector<Frame> frames;
+  for (uint32_t i = 0; i < 4; i++) frames.push_back(random_frame(i));
+
+  SECTION("uploads frames into the textures") {
+    uint32_t frame_id = 0;
+    REQUIRE_FALSE(uploader.upload(&frame_id));
+    for (int i = 0; i < 10; i++) {
+      const Frame &frame = frames[i % frames.size()];
+      REQUIRE(uploader.write(frame.id, frame.y(), frame.uv()));
+      REQUIRE(uploader.upload(&frame_id));
+      REQUIRE(frame_id == frame.id);
+      REQUIRE(textures_match(tex_y, tex_uv, frame));
+    }
+    auto stats = uploader.stats();
+    REQUIRE(stats.uploaded == 10);
+    REQUIRE(stats.dropped == 0);
+  }
+
+  SECTION("shows the newest frame and counts drops") {
+    // every buffer is written before the GL thread gets to them
+    for (int i = 0; i < UPLOAD_BUFFER_COUNT; i++) {
+      REQUIRE(uploader.write(frames[i].id, frames[i].y(), frames[i].uv()));
+    }
+    REQUIRE_FALSE(uploader.write(frames[3].id, frames[3].y(), frames[3].uv()));
+    REQUIRE(uploader.stats().dropped == 1);
+
+    uint32_t frame_id = 0;
+    REQUIRE(uploader.upload(&frame_id));
+    REQUIRE(frame_id == frames[UPLOAD_BUFFER_COUNT - 1].id);
+    REQUIRE(textures_match(tex_y, tex_uv, frames[UPLOAD_BUFFER_COUNT - 1]));
+    REQUIRE(uploader.stats().dropped == UPLOAD_BUFFER_COUNT);
+
+    // the buffer being read is reused once its fence signals
+    glFinish();
+    REQUIRE_FALSE(uploader.upload());
+    for (int i = 0; i < UPLOAD_BUFFER_COUNT; i++) {
+      REQUIRE(uploader.write(frames[i].id, frames[i].y(), frames[i].uv()));
+    }
+    REQUIRE(uploader.upload(&frame_id));
+    REQUIRE(textures_match(tex_y, tex_uv, frames[UPLOAD_BUFFER_COUNT - 1]));
+  }
+
+  uploader.destroy();
+  glDeleteTextures(1, &tex_y);
+  glDeleteTextures(1, &tex_uv);
+  ctx.doneCurrent();
+}
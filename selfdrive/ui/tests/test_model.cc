@@ -0,0 +1,208 @@
+#define CATCH_CONFIG_ENABLE_BENCHMARKING
+#include "catch2/catch.hpp"
+
+#include <algorithm>
+
+#include <QImage>
+#include <QPainter>
+
+#include "cereal/messaging/messaging.h"
+#include "selfdrive/ui/qt/onroad/model.h"
+
+const int WIDTH = 2160, HEIGHT = 1080;
+const int POINTS = 33;
+
+// a road curving away from the car, x spaced like the model's index
+static void fill_line(cereal::XYZTData::Builder line, float y_offset, float curvature) {
+  auto x = line.initX(POINTS), y = line.initY(POINTS), z = line.initZ(POINTS), t = line.initT(POINTS);
+  for (int i = 0; i < POINTS; i++) {
+    float d = 192.0f * i * i / ((POINTS - 1) * (POINTS - 1));
+    x.set(i, d);
+    y.set(i, y_offset + curvature * d * d);
+    z.set(i, 0.01f * d);
+    t.set(i, 10.0f * i * i / ((POINTS - 1) * (POINTS - 1)));
+  }
+}
+
+static void fill_model(MessageBuilder &msg, uint32_t frame_id, float curvature) {
+  auto model = msg.initEvent().initModelV2();
+  model.setFrameId(frame_id);
+  model.setTimestampEof(frame_id * 50000000ULL);
+  fill_line(model.initPosition(), 0, curvature);
+  auto accel = model.initAcceleration();
+  fill_line(accel, 0.5, 0);
+
+  auto lane_lines = model.initLaneLines(4);
+  const float lane_offsets[] = {-5.4, -1.8, 1.8, 5.4};
+  for (int i = 0; i < 4; i++) fill_line(lane_lines[i], lane_offsets[i], curvature);
+  auto probs = model.initLaneLineProbs(4);
+  for (int i = 0; i < 4; i++) probs.set(i, 0.3 + 0.15 * i);
+
+  auto road_edges = model.initRoadEdges(2);
+  fill_line(road_edges[0], -7.2, curvature);
+  fill_line(road_edges[1], 7.2, curvature);
+  auto stds = model.initRoadEdgeStds(2);
+  stds.set(0, 0.3);
+  stds.set(1, 0.5);
+}
+
+// the road camera seen from the car frame, scaled to the widget
+static Eigen::Matrix3f car_transform(float zoom) {
+  const float f = 2648.0f * zoom, cx = WIDTH / 2, cy = HEIGHT / 2;
+  return (Eigen::Matrix3f() <<
+    cx, f, 0.0f,
+    cy, 0.0f, f,
+    1.0f, 0.0f, 0.0f).finished();
+}
+
+class ModelPainter {
+public:
+  ModelPainter() : image(WIDTH, HEIGHT, QImage::Format_ARGB32_Premultiplied), radar_state(radar_msg.initEvent().initRadarState()) {}
+
+  const QImage &paint(ModelRenderer &renderer, const MessageBuilder &model_msg) {
+    image.fill(Qt::black);
+    QPainter painter(&image);
+    painter.setRenderHint(QPainter::Antialiasing);
+    painter.setPen(Qt::NoPen);
+    auto model = const_cast<MessageBuilder &>(model_msg).getRoot<cereal::Event>().getModelV2().asReader();
+    renderer.draw(painter, image.rect(), model, radar_state.asReader(), false);
+    return image;
+  }
+
+  QImage image;
+  MessageBuilder radar_msg;
+  cereal::RadarState::Builder radar_state;
+};
+
+TEST_CASE("ModelRenderer reuses geometry only while its inputs are unchanged") {
+  MessageBuilder frame1, frame2;
+  fill_model(frame1, 1, 0.0005);
+  fill_model(frame2, 2, -0.0008);
+
+  ModelPainter painter;
+  ModelRenderer renderer;
+  renderer.setTransform(car_transform(0.5));
+
+  // repeated paints of a frame match a renderer that only ever saw that frame
+  QImage first = painter.paint(renderer, frame1);
+  REQUIRE(painter.paint(renderer, frame1) == first);
+
+  SECTION("new model frame") {
+    ModelRenderer fresh;
+    fresh.setTransform(car_transform(0.5));
+    QImage expected = painter.paint(fresh, frame2);
+    REQUIRE(painter.paint(renderer, frame2) == expected);
+    REQUIRE(expected != first);
+  }
+
+  SECTION("new calibration") {
+    ModelRenderer fresh;
+    fresh.setTransform(car_transform(0.6));
+    QImage expected = painter.paint(fresh, frame1);
+    renderer.setTransform(car_transform(0.6));
+    REQUIRE(painter.paint(renderer, frame1) == expected);
+    REQUIRE(expected != first);
+  }
+}
+
+// the projection before it was batched, point by point with the polygon built by push_front
+struct ReferenceGeometry {
+  ReferenceGeometry(const cereal::ModelDataV2::Reader &model, const Eigen::Matrix3f &transform, const QRect &rect)
+      : transform(transform), clip_region(rect.adjusted(-500, -500, 500, 500)) {
+    auto path_length_idx = [](const cereal::XYZTData::Reader &line, float path_height) {
+      const auto &line_x = line.getX();
+      int max_idx = 0;
+      for (int i = 1; i < line_x.size() && line_x[i] <= path_height; ++i) {
+        max_idx = i;
+      }
+      return max_idx;
+    };
+    // no lead, so the path is as long as the lines
+    const auto &position = model.getPosition();
+    const float max_distance = std::clamp(*(position.getX().end() - 1), 10.0f, 100.0f);
+    const int max_idx = path_length_idx(model.getLaneLines()[0], max_distance);
+    for (int i = 0; i < 4; i++) {
+      lane_lines[i] = mapLineToPolygon(model.getLaneLines()[i], 0.025 * model.getLaneLineProbs()[i], 0, max_idx);
+    }
+    for (int i = 0; i < 2; i++) {
+      road_edges[i] = mapLineToPolygon(model.getRoadEdges()[i], 0.025, 0, max_idx);
+    }
+    // at the default calibration height
+    track = mapLineToPolygon(position, 0.9, 1.22, path_length_idx(position, max_distance), false);
+  }
+
+  bool mapToScreen(float in_x, float in_y, float in_z, QPointF *out) {
+    Eigen::Vector3f input(in_x, in_y, in_z);
+    auto pt = transform * input;
+    *out = QPointF(pt.x() / pt.z(), pt.y() / pt.z());
+    return clip_region.contains(*out);
+  }
+
+  QPolygonF mapLineToPolygon(const cereal::XYZTData::Reader &line, float y_off, float z_off, int max_idx, bool allow_invert = true) {
+    const auto line_x = line.getX(), line_y = line.getY(), line_z = line.getZ();
+    QPolygonF pvd;
+    QPointF left, right;
+    for (int i = 0; i <= max_idx; i++) {
+      if (line_x[i] < 0) continue;
+      bool l = mapToScreen(line_x[i], line_y[i] - y_off, line_z[i] + z_off, &left);
+      bool r = mapToScreen(line_x[i], line_y[i] + y_off, line_z[i] + z_off, &right);
+      if (l && r) {
+        if (!allow_invert && pvd.size() && left.y() > pvd.back().y()) {
+          continue;
+        }
+        pvd.push_back(left);
+        pvd.push_front(right);
+      }
+    }
+    return pvd;
+  }
+
+  Eigen::Matrix3f transform;
+  QRectF clip_region;
+  QPolygonF lane_lines[4], road_edges[2], track;
+};
+
+static void require_close(const QPolygonF &actual, const QPolygonF &expected) {
+  REQUIRE(actual.size() == expected.size());
+  for (int i = 0; i < actual.size(); i++) {
+    INFO("vertex " << i);
+    REQUIRE(actual[i].x() == Approx(expected[i].x()).margin(0.01));
+    REQUIRE(actual[i].y() == Approx(expected[i].y()).margin(0.01));
+  }
+}
+
+TEST_CASE("ModelRenderer geometry matches the per point projection") {
+  const float curvature = GENERATE(0.0f, 0.0005f, -0.002f);
+  const float zoom = GENERATE(0.5f, 1.1f);
+  MessageBuilder frame;
+  fill_model(frame, 1, curvature);
+  auto model = frame.getRoot<cereal::Event>().getModelV2().asReader();
+
+  ModelPainter painter;
+  ModelRenderer renderer;
+  renderer.setTransform(car_transform(zoom));
+  painter.paint(renderer, frame);
+
+  ReferenceGeometry expected(model, car_transform(zoom), painter.image.rect());
+  REQUIRE(expected.track.size() > 4);
+  require_close(renderer.trackVertices(), expected.track);
+  for (int i = 0; i < 4; i++) require_close(renderer.laneLineVertices(i), expected.lane_lines[i]);
+  for (int i = 0; i < 2; i++) require_close(renderer.roadEdgeVertices(i), expected.road_edges[i]);
+}
+
+TEST_CASE("ModelRenderer paint benchmark", "[.][benchmark]") {
+  std::vector<MessageBuilder> frames(20);
+  for (int i = 0; i < frames.size(); i++) fill_model(frames[i], i + 1, 0.0001 * i);
+
+  ModelPainter painter;
+  ModelRenderer renderer;
+  renderer.setTransform(car_transform(0.5));
+
+  int frame = 0;
+  BENCHMARK("new model frame every paint") {
+    return painter.paint(renderer, frames[frame++ % frames.size()]).width();
+  };
+  BENCHMARK("same model frame") {
+    return painter.paint(renderer, frames[0]).width();
+  };
+}
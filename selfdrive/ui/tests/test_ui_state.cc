@@ -0,0 +1,99 @@
+#include "catch2/catch.hpp"
+
+#include <map>
+#include <memory>
+
+#include <QObject>
+
+#include "common/timing.h"
+#include "selfdrive/ui/ui.h"
+
+// a SubMaster feed without sockets, every call is one UI tick
+class FakeFeed {
+public:
+  FakeFeed(UIState &s) : s(s) {}
+
+  void tick(const std::vector<std::string> &services = {}) {
+    std::vector<std::pair<std::string, cereal::Event::Reader>> messages;
+    for (const auto &service : services) {
+      // the SubMaster keeps a reader into the message until the next one for the service
+      auto &msg = msgs[service];
+      msg = std::make_unique<MessageBuilder>();
+      auto event = msg->initEvent();
+      if (service == "deviceState") {
+        event.initDeviceState();
+      } else if (service == "selfdriveState") {
+        event.initSelfdriveState();
+      } else if (service == "carState") {
+        event.initCarState();
+      }
+      messages.push_back({service, event.asReader()});
+    }
+    s.sm->update_msgs(nanos_since_boot(), messages);
+    s.processUpdate();
+  }
+
+  UIState &s;
+  std::map<std::string, std::unique_ptr<MessageBuilder>> msgs;
+};
+
+TEST_CASE("UIState notifies subscribers only for their services") {
+  UIState s;
+  FakeFeed feed(s);
+
+  int ticks = 0;
+  QObject::connect(&s, &UIState::uiUpdate, [&](const UIState &) { ticks++; });
+
+  QObject device, car;
+  int device_calls = 0, car_calls = 0;
+  s.subscribe(&device, {"deviceState"}, [&](const UIState &) { device_calls++; });
+  s.subscribe(&car, {"carState", "selfdriveState"}, [&](const UIState &) { car_calls++; });
+
+  feed.tick();
+  feed.tick({"deviceState"});
+  feed.tick({"carState"});
+  feed.tick({"carState", "selfdriveState"});
+  feed.tick({"modelV2"});
+  feed.tick({"deviceState", "selfdriveState"});
+
+  REQUIRE(ticks == 6);
+  REQUIRE(device_calls == 2);
+  REQUIRE(car_calls == 3);
+
+  auto stats = s.subscriberStats();
+  REQUIRE(stats.size() == 2);
+  REQUIRE(stats[0].name == "QObject");
+  REQUIRE(stats[0].calls == 2);
+  REQUIRE(stats[0].skipped == 4);
+  REQUIRE(stats[1].calls == 3);
+  REQUIRE(stats[1].skipped == 3);
+  REQUIRE(stats[1].max_ms >= 0);
+  REQUIRE(stats[1].total_ms >= stats[1].max_ms);
+}
+
+TEST_CASE("UIState drops subscriptions of destroyed receivers") {
+  UIState s;
+  FakeFeed feed(s);
+
+  int calls = 0;
+  auto receiver = std::make_unique<QObject>();
+  s.subscribe(receiver.get(), {"deviceState"}, [&](const UIState &) { calls++; });
+  feed.tick({"deviceState"});
+  REQUIRE(calls == 1);
+
+  receiver.reset();
+  REQUIRE(s.subscriberStats().empty());
+  feed.tick({"deviceState"});
+  REQUIRE(calls == 1);
+
+  SECTION("destroyed while notifying") {
+    auto first = std::make_unique<QObject>(), second = std::make_unique<QObject>();
+    int second_calls = 0;
+    s.subscribe(first.get(), {"deviceState"}, [&](const UIState &) { second.reset(); });
+    s.subscribe(second.get(), {"deviceState"}, [&](const UIState &) { second_calls++; });
+    feed.tick({"deviceState"});
+    feed.tick({"deviceState"});
+    REQUIRE(second_calls == 0);
+    REQUIRE(s.subscriberStats().size() == 1);
+  }
+}
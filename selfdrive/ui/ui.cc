@@ -1,12 +1,14 @@
 #include "selfdrive/ui/ui.h"
 
 #include <algorithm>
+#include <cinttypes>
 #include <cmath>
 
 #include <QtConcurrent>
 
 #include "common/transformations/orientation.hpp"
 #include "common/swaglog.h"
+#include "common/timing.h"
 #include "common/util.h"
 #include "common/watchdog.h"
 #include "system/hardware/hw.h"
@@ -114,13 +116,72 @@ UIState::UIState(QObject *parent) : QObject(parent) {
 
 void UIState::update() {
   update_sockets(this);
-  update_state(this);
-  updateStatus();
+  processUpdate();
 
   if (sm->frame % UI_FREQ == 0) {
     watchdog_kick(nanos_since_boot());
   }
+  if (sm->frame % (60 * UI_FREQ) == 0) {
+    for (const auto &stats : subscriberStats()) {
+      LOG("ui subscriber %s: %" PRIu64 " calls, %" PRIu64 " skipped, %.2f ms avg, %.2f ms max", qPrintable(stats.name), stats.calls,
+           stats.skipped, stats.calls ? stats.total_ms / stats.calls : 0.0, stats.max_ms);
+    }
+  }
+}
+
+void UIState::processUpdate() {
+  update_state(this);
+  updateStatus();
+
   emit uiUpdate(*this);
+  notifySubscribers();
+}
+
+void UIState::subscribe(QObject *receiver, const std::vector<const char *> &services, std::function<void(const UIState &)> f) {
+  subscribers.push_back({receiver, services, f, {receiver->metaObject()->className()}});
+  QObject::connect(receiver, &QObject::destroyed, this, [this](QObject *obj) {
+    // cleared here and removed before the next notification, this can happen during one
+    for (auto &sub : subscribers) {
+      if (sub.receiver == obj) sub.receiver = nullptr;
+    }
+  });
+}
+
+void UIState::notifySubscribers() {
+  subscribers.erase(std::remove_if(subscribers.begin(), subscribers.end(), [](auto &sub) { return !sub.receiver; }),
+                    subscribers.end());
+
+  // a subscriber may subscribe again, only the ones present before this update are notified
+  const size_t count = subscribers.size();
+  for (size_t i = 0; i < count; ++i) {
+    auto &sub = subscribers[i];
+    bool updated = std::any_of(sub.services.begin(), sub.services.end(), [this](const char *service) {
+      return sm->updated(service);
+    });
+    if (!sub.receiver || !updated) {
+      sub.stats.skipped++;
+      continue;
+    }
+
+    double start = millis_since_boot();
+    // copied, the callback may add subscribers and move the vector
+    auto f = sub.f;
+    f(*this);
+    double dt = millis_since_boot() - start;
+
+    auto &stats = subscribers[i].stats;
+    stats.calls++;
+    stats.total_ms += dt;
+    stats.max_ms = std::max(stats.max_ms, dt);
+  }
+}
+
+std::vector<UIState::SubscriberStats> UIState::subscriberStats() const {
+  std::vector<SubscriberStats> stats;
+  for (const auto &sub : subscribers) {
+    if (sub.receiver) stats.push_back(sub.stats);
+  }
+  return stats;
 }
 
 Device::Device(QObject *parent) : brightness_filter(BACKLIGHT_OFFROAD, BACKLIGHT_TS, BACKLIGHT_DT), QObject(parent) {
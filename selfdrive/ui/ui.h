@@ -1,8 +1,10 @@
 #pragma once
 
 #include <eigen3/Eigen/Dense>
+#include <functional>
 #include <memory>
 #include <string>
+#include <vector>
 
 #include <QTimer>
 #include <QColor>
@@ -68,6 +70,24 @@ class UIState : public QObject {
 public:
   UIState(QObject* parent = 0);
   void updateStatus();
+  // Updates the scene from the messages already in sm and notifies the subscribers. The timer
+  // calls this after polling the sockets, tests after feeding sm with update_msgs().
+  void processUpdate();
+
+  // Calls f from processUpdate() only when one of the services received a message, instead of
+  // every tick like uiUpdate, which is left for consumers that need a clock. The subscription is
+  // dropped when the receiver is destroyed.
+  void subscribe(QObject *receiver, const std::vector<const char *> &services, std::function<void(const UIState &)> f);
+
+  struct SubscriberStats {
+    QString name;           // class of the receiver
+    uint64_t calls = 0;
+    uint64_t skipped = 0;   // ticks without a message for it
+    double total_ms = 0;
+    double max_ms = 0;
+  };
+  std::vector<SubscriberStats> subscriberStats() const;
+
   inline bool engaged() const {
     return scene.started && (*sm)["selfdriveState"].getSelfdriveState().getEnabled();
   }
@@ -87,9 +107,18 @@ private slots:
   void update();
 
 private:
+  struct Subscriber {
+    QObject *receiver;
+    std::vector<const char *> services;
+    std::function<void(const UIState &)> f;
+    SubscriberStats stats;
+  };
+  void notifySubscribers();
+
   QTimer *timer;
   bool started_prev = false;
   bool engaged_prev = false;
+  std::vector<Subscriber> subscribers;
 };
 
 UIState *uiState();
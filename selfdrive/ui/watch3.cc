@@ -16,18 +16,35 @@ int main(int argc, char *argv[]) {
   layout->setMargin(0);
   layout->setSpacing(0);
 
+  CameraWidget *road = new CameraWidget("camerad", VISION_STREAM_ROAD);
+  CameraWidget *driver = new CameraWidget("camerad", VISION_STREAM_DRIVER);
+  CameraWidget *wide = new CameraWidget("camerad", VISION_STREAM_WIDE_ROAD);
+
   {
     QHBoxLayout *hlayout = new QHBoxLayout();
     layout->addLayout(hlayout);
-    hlayout->addWidget(new CameraWidget("camerad", VISION_STREAM_ROAD));
+    hlayout->addWidget(road);
   }
 
   {
     QHBoxLayout *hlayout = new QHBoxLayout();
     layout->addLayout(hlayout);
-    hlayout->addWidget(new CameraWidget("camerad", VISION_STREAM_DRIVER));
-    hlayout->addWidget(new CameraWidget("camerad", VISION_STREAM_WIDE_ROAD));
+    hlayout->addWidget(driver);
+    hlayout->addWidget(wide);
   }
 
+#ifndef QCOM2
+  QTimer timer;
+  QObject::connect(&timer, &QTimer::timeout, [=]() {
+    for (CameraWidget *cam : {road, driver, wide}) {
+      auto stats = cam->uploadStats();
+      qDebug().nospace() << "stream " << cam->getStreamType() << ": " << stats.uploaded << " uploaded, " << stats.dropped << " dropped, "
+                         << (stats.uploaded ? stats.upload_ms / stats.uploaded : 0) << " ms upload, "
+                         << (stats.written ? stats.copy_ms / stats.written : 0) << " ms copy";
+    }
+  });
+  timer.start(10 * 1000);
+#endif
+
   return a.exec();
 }
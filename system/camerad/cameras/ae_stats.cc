@@ -0,0 +1,144 @@
+#include "system/camerad/cameras/ae_stats.h"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+// Pixels are counted into interleaved tables that are summed at the end, so runs of
+// similar pixels don't serialize on the store-to-load dependency of a single counter.
+const int NUM_TABLES = 4;
+typedef uint32_t HistogramTables[NUM_TABLES][256];
+
+void AEStats::reset() {
+  memset(histogram, 0, sizeof(histogram));
+  count = 0;
+  sum = 0;
+}
+
+int AEStats::percentile(float p) const {
+  if (count == 0) return 0;
+
+  uint64_t target = std::max<uint64_t>(1, count * (100.0 - std::clamp(p, 0.0f, 100.0f)) / 100.0);
+  uint64_t cur = 0;
+  for (int lum = 255; lum >= 0; lum--) {
+    cur += histogram[lum];
+    if (cur >= target) return lum;
+  }
+  return 0;
+}
+
+static inline void count8(HistogramTables &h, uint64_t px, uint32_t weight) {
+  h[0][px & 0xff] += weight;
+  h[1][(px >> 8) & 0xff] += weight;
+  h[2][(px >> 16) & 0xff] += weight;
+  h[3][(px >> 24) & 0xff] += weight;
+  h[0][(px >> 32) & 0xff] += weight;
+  h[1][(px >> 40) & 0xff] += weight;
+  h[2][(px >> 48) & 0xff] += weight;
+  h[3][px >> 56] += weight;
+}
+
+// Counts w contiguous pixels and returns their sum. Vectors of identical pixels, common in
+// dark and saturated areas, are counted with a single add.
+static uint64_t count_row(HistogramTables &h, const uint8_t *p, int w, uint32_t weight) {
+  int x = 0;
+  uint64_t sum = 0;
+
+#if defined(__AVX2__)
+  __m256i acc = _mm256_setzero_si256();
+  for (; x + 32 <= w; x += 32) {
+    __m256i v = _mm256_loadu_si256((const __m256i *)(p + x));
+    acc = _mm256_add_epi64(acc, _mm256_sad_epu8(v, _mm256_setzero_si256()));
+    if (_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(p[x]))) == -1) {
+      h[0][p[x]] += 32 * weight;
+    } else {
+      count8(h, _mm256_extract_epi64(v, 0), weight);
+      count8(h, _mm256_extract_epi64(v, 1), weight);
+      count8(h, _mm256_extract_epi64(v, 2), weight);
+      count8(h, _mm256_extract_epi64(v, 3), weight);
+    }
+  }
+  sum = _mm256_extract_epi64(acc, 0) + _mm256_extract_epi64(acc, 1) + _mm256_extract_epi64(acc, 2) + _mm256_extract_epi64(acc, 3);
+#elif defined(__SSE2__)
+  __m128i acc = _mm_setzero_si128();
+  for (; x + 16 <= w; x += 16) {
+    __m128i v = _mm_loadu_si128((const __m128i *)(p + x));
+    acc = _mm_add_epi64(acc, _mm_sad_epu8(v, _mm_setzero_si128()));
+    if (_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8(p[x]))) == 0xffff) {
+      h[0][p[x]] += 16 * weight;
+    } else {
+      count8(h, _mm_cvtsi128_si64(v), weight);
+      count8(h, _mm_cvtsi128_si64(_mm_unpackhi_epi64(v, v)), weight);
+    }
+  }
+  sum = _mm_cvtsi128_si64(acc) + _mm_cvtsi128_si64(_mm_unpackhi_epi64(acc, acc));
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+  for (; x + 16 <= w; x += 16) {
+    uint8x16_t v = vld1q_u8(p + x);
+    sum += vaddlvq_u8(v);
+    if (vminvq_u8(vceqq_u8(v, vdupq_n_u8(p[x]))) == 0xff) {
+      h[0][p[x]] += 16 * weight;
+    } else {
+      uint64x2_t px = vreinterpretq_u64_u8(v);
+      count8(h, vgetq_lane_u64(px, 0), weight);
+      count8(h, vgetq_lane_u64(px, 1), weight);
+    }
+  }
+#endif
+
+  for (; x < w; x++) {
+    h[x % NUM_TABLES][p[x]] += weight;
+    sum += p[x];
+  }
+  return sum;
+}
+
+void calculate_ae_stats(const uint8_t *y, int stride, const std::vector<AERegion> &regions, int x_skip, int y_skip, AEStats *stats) {
+  HistogramTables h = {};
+  stats->reset();
+
+  for (const AERegion &r : regions) {
+    if (r.rect.w <= 0 || r.rect.h <= 0) continue;
+
+    uint64_t region_sum = 0;
+    for (int row = r.rect.y; row < r.rect.y + r.rect.h; row += y_skip) {
+      const uint8_t *p = y + (size_t)row * stride + r.rect.x;
+      if (x_skip == 1) {
+        region_sum += count_row(h, p, r.rect.w, r.weight);
+      } else {
+        for (int x = 0, i = 0; x < r.rect.w; x += x_skip, i++) {
+          h[i % NUM_TABLES][p[x]] += r.weight;
+          region_sum += p[x];
+        }
+      }
+    }
+
+    uint64_t rows = (r.rect.h + y_skip - 1) / y_skip;
+    uint64_t cols = (r.rect.w + x_skip - 1) / x_skip;
+    stats->count += rows * cols * r.weight;
+    stats->sum += region_sum * r.weight;
+  }
+
+  for (int lum = 0; lum < 256; lum++) {
+    stats->histogram[lum] = h[0][lum] + h[1][lum] + h[2][lum] + h[3][lum];
+  }
+}
+
+void calculate_ae_stats_reference(const uint8_t *y, int stride, const std::vector<AERegion> &regions, int x_skip, int y_skip, AEStats *stats) {
+  stats->reset();
+  for (const AERegion &r : regions) {
+    for (int row = r.rect.y; row < r.rect.y + r.rect.h; row += y_skip) {
+      for (int x = r.rect.x; x < r.rect.x + r.rect.w; x += x_skip) {
+        uint8_t lum = y[(size_t)row * stride + x];
+        stats->histogram[lum] += r.weight;
+        stats->count += r.weight;
+        stats->sum += (uint64_t)lum * r.weight;
+      }
+    }
+  }
+}
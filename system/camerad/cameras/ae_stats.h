@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "common/util.h"
+
+// luminance region of the Y plane, pixels count weight times
+struct AERegion {
+  Rect rect;
+  uint32_t weight = 1;
+};
+
+struct AEStats {
+  uint32_t histogram[256];
+  uint64_t count;  // weighted number of pixels
+  uint64_t sum;    // weighted sum of luminance
+
+  void reset();
+  inline float mean() const { return count > 0 ? (float)sum / count : 0; }
+  // highest luminance with at least (100 - p)% of the pixels at or above it, p=50 is the median
+  int percentile(float p) const;
+};
+
+// Luminance statistics over every x_skip-th pixel of every y_skip-th row of the regions.
+// Overlapping regions count their shared pixels once per region.
+void calculate_ae_stats(const uint8_t *y, int stride, const std::vector<AERegion> &regions, int x_skip, int y_skip, AEStats *stats);
+// scalar reference of calculate_ae_stats
+void calculate_ae_stats_reference(const uint8_t *y, int stride, const std::vector<AERegion> &regions, int x_skip, int y_skip, AEStats *stats);
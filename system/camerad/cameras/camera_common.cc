@@ -4,6 +4,7 @@
 #include <string>
 
 #include "common/swaglog.h"
+#include "system/camerad/cameras/ae_stats.h"
 #include "system/camerad/cameras/spectra.h"
 
 
@@ -74,30 +75,11 @@ kj::Array<uint8_t> get_raw_frame_image(const CameraBuf *b) {
 }
 
 float calculate_exposure_value(const CameraBuf *b, Rect ae_xywh, int x_skip, int y_skip) {
-  int lum_med;
-  uint32_t lum_binning[256] = {0};
-  const uint8_t *pix_ptr = b->cur_yuv_buf->y;
-
-  unsigned int lum_total = 0;
-  for (int y = ae_xywh.y; y < ae_xywh.y + ae_xywh.h; y += y_skip) {
-    for (int x = ae_xywh.x; x < ae_xywh.x + ae_xywh.w; x += x_skip) {
-      uint8_t lum = pix_ptr[(y * b->out_img_width) + x];
-      lum_binning[lum]++;
-      lum_total += 1;
-    }
-  }
-
-  // Find mean lumimance value
-  unsigned int lum_cur = 0;
-  for (lum_med = 255; lum_med >= 0; lum_med--) {
-    lum_cur += lum_binning[lum_med];
-
-    if (lum_cur >= lum_total / 2) {
-      break;
-    }
-  }
+  AEStats stats;
+  calculate_ae_stats(b->cur_yuv_buf->y, b->out_img_width, {{ae_xywh}}, x_skip, y_skip, &stats);
 
-  return lum_med / 256.0;
+  // median luminance
+  return stats.percentile(50) / 256.0;
 }
 
 int open_v4l_by_name_and_index(const char name[], int index, int flags) {
@@ -1,6 +1,11 @@
 #include "cdm.h"
 #include "stddef.h"
 
+#include <algorithm>
+#include <map>
+
+#include "common/util.h"
+
 int write_dmi(uint8_t *dst, uint64_t *addr, uint32_t length, uint32_t dmi_addr, uint8_t sel) {
   struct cdm_dmi_cmd *cmd = (struct cdm_dmi_cmd*)dst;
   cmd->cmd = CAM_CDM_CMD_DMI_32;
@@ -45,3 +50,152 @@ int write_random(uint8_t *dst, const std::vector<uint32_t> &vals) {
 
   return sizeof(struct cdm_regrandom_cmd) + vals.size()*sizeof(uint32_t);
 }
+
+uint8_t *CdmProgram::grow(size_t len) {
+  size_t start = buf.size();
+  buf.resize(start + len);
+  return buf.data() + start;
+}
+
+void CdmProgram::write_random(const std::vector<uint32_t> &vals) {
+  ::write_random(grow(sizeof(struct cdm_regrandom_cmd) + vals.size()*sizeof(uint32_t)), vals);
+}
+
+void CdmProgram::write_cont(uint32_t reg, const std::vector<uint32_t> &vals) {
+  ::write_cont(grow(sizeof(struct cdm_regcontinuous_cmd) + vals.size()*sizeof(uint32_t)), reg, vals);
+}
+
+void CdmProgram::write_dmi(uint32_t length, uint32_t dmi_addr, uint8_t sel) {
+  uint64_t addr;
+  ::write_dmi(grow(sizeof(struct cdm_dmi_cmd)), &addr, length, dmi_addr, sel);
+  patch_offsets.push_back(addr - (uint64_t)buf.data());
+}
+
+static const char *cdm_command_name(uint32_t cmd) {
+  switch (cmd) {
+    case CAM_CDM_CMD_DMI: return "DMI";
+    case CAM_CDM_CMD_DMI_32: return "DMI_32";
+    case CAM_CDM_CMD_DMI_64: return "DMI_64";
+    case CAM_CDM_CMD_REG_CONT: return "REG_CONT";
+    case CAM_CDM_CMD_REG_RANDOM: return "REG_RANDOM";
+    default: return "UNKNOWN";
+  }
+}
+
+bool cdm_decode(const uint8_t *data, size_t size, std::vector<CdmCommand> &cmds, std::string *error) {
+  auto fail = [&](size_t offset, const std::string &msg) {
+    if (error) *error = util::string_format("0x%04zx: %s", offset, msg.c_str());
+    return false;
+  };
+
+  cmds.clear();
+  size_t words = size / sizeof(uint32_t);
+  const uint32_t *w = (const uint32_t *)data;
+  if (size % sizeof(uint32_t) != 0) return fail(size, "stream is not a whole number of words");
+
+  for (size_t i = 0; i < words;) {
+    CdmCommand c = {.offset = (uint32_t)(i * sizeof(uint32_t)), .cmd = w[i] >> 24};
+    uint32_t count = w[i] & 0xffff;
+    uint32_t reserved = (w[i] >> 16) & 0xff;
+    if (reserved != 0) return fail(c.offset, "reserved bits set");
+
+    size_t len;
+    if (c.cmd == CAM_CDM_CMD_REG_CONT) {
+      if (i + 2 > words) return fail(c.offset, "truncated REG_CONT header");
+      if ((w[i + 1] >> 24) != 0) return fail(c.offset, "reserved bits set");
+      c.reg = w[i + 1] & 0xffffff;
+      len = 2 + count;
+      if (count == 0) return fail(c.offset, "empty REG_CONT");
+      if (i + len > words) return fail(c.offset, "truncated REG_CONT values");
+      c.vals.assign(w + i + 2, w + i + len);
+    } else if (c.cmd == CAM_CDM_CMD_REG_RANDOM) {
+      len = 1 + 2 * count;
+      if (count == 0) return fail(c.offset, "empty REG_RANDOM");
+      if (i + len > words) return fail(c.offset, "truncated REG_RANDOM values");
+      c.vals.assign(w + i + 1, w + i + len);
+      for (int j = 0; j < c.vals.size(); j += 2) {
+        if (c.vals[j] % 4 != 0 || c.vals[j] > 0xffffff) return fail(c.offset, util::string_format("bad register 0x%x", c.vals[j]));
+      }
+    } else if (c.cmd == CAM_CDM_CMD_DMI || c.cmd == CAM_CDM_CMD_DMI_32 || c.cmd == CAM_CDM_CMD_DMI_64) {
+      len = 3;
+      if (i + len > words) return fail(c.offset, "truncated DMI");
+      c.dmi_length = count + 1;
+      c.dmi_addr = w[i + 1];
+      c.reg = w[i + 2] & 0xffffff;
+      c.dmi_sel = w[i + 2] >> 24;
+    } else {
+      return fail(c.offset, util::string_format("unsupported command 0x%x", c.cmd));
+    }
+    if (c.reg % 4 != 0) return fail(c.offset, util::string_format("unaligned register 0x%x", c.reg));
+
+    cmds.push_back(c);
+    i += len;
+  }
+  return true;
+}
+
+std::string cdm_dump(const std::vector<CdmCommand> &cmds) {
+  std::string out;
+  for (const CdmCommand &c : cmds) {
+    out += util::string_format("%04x: %s", c.offset, cdm_command_name(c.cmd));
+    if (c.cmd == CAM_CDM_CMD_REG_CONT) {
+      out += util::string_format(" 0x%04x [%zu]\n", c.reg, c.vals.size());
+      for (int i = 0; i < c.vals.size(); i++) {
+        out += util::string_format("    0x%04x = 0x%08x\n", c.reg + i*4, c.vals[i]);
+      }
+    } else if (c.cmd == CAM_CDM_CMD_REG_RANDOM) {
+      out += util::string_format(" [%zu]\n", c.vals.size() / 2);
+      for (int i = 0; i < c.vals.size(); i += 2) {
+        out += util::string_format("    0x%04x = 0x%08x\n", c.vals[i], c.vals[i + 1]);
+      }
+    } else {
+      out += util::string_format(" 0x%04x sel %u, %u bytes, LUT at 0x%08x\n", c.reg, c.dmi_sel, c.dmi_length, c.dmi_addr);
+    }
+  }
+  return out;
+}
+
+// register values and DMI writes a stream leaves behind, the LUT addresses are patched by the kernel so they're ignored
+static void cdm_state(const std::vector<CdmCommand> &cmds, std::map<uint32_t, uint32_t> &regs, std::vector<std::string> &dmis) {
+  for (const CdmCommand &c : cmds) {
+    if (c.cmd == CAM_CDM_CMD_REG_CONT) {
+      for (int i = 0; i < c.vals.size(); i++) regs[c.reg + i*4] = c.vals[i];
+    } else if (c.cmd == CAM_CDM_CMD_REG_RANDOM) {
+      for (int i = 0; i < c.vals.size(); i += 2) regs[c.vals[i]] = c.vals[i + 1];
+    } else {
+      dmis.push_back(util::string_format("%s 0x%04x sel %u, %u bytes", cdm_command_name(c.cmd), c.reg, c.dmi_sel, c.dmi_length));
+    }
+  }
+}
+
+std::string cdm_diff(const std::vector<CdmCommand> &a, const std::vector<CdmCommand> &b) {
+  std::map<uint32_t, uint32_t> regs_a, regs_b;
+  std::vector<std::string> dmis_a, dmis_b;
+  cdm_state(a, regs_a, dmis_a);
+  cdm_state(b, regs_b, dmis_b);
+
+  std::string out;
+  auto ia = regs_a.begin(), ib = regs_b.begin();
+  while (ia != regs_a.end() || ib != regs_b.end()) {
+    if (ib == regs_b.end() || (ia != regs_a.end() && ia->first < ib->first)) {
+      out += util::string_format("- 0x%04x = 0x%08x\n", ia->first, ia->second);
+      ++ia;
+    } else if (ia == regs_a.end() || ib->first < ia->first) {
+      out += util::string_format("+ 0x%04x = 0x%08x\n", ib->first, ib->second);
+      ++ib;
+    } else {
+      if (ia->second != ib->second) {
+        out += util::string_format("- 0x%04x = 0x%08x\n+ 0x%04x = 0x%08x\n", ia->first, ia->second, ib->first, ib->second);
+      }
+      ++ia;
+      ++ib;
+    }
+  }
+
+  for (size_t i = 0; i < std::max(dmis_a.size(), dmis_b.size()); i++) {
+    if (i < dmis_a.size() && i < dmis_b.size() && dmis_a[i] == dmis_b[i]) continue;
+    if (i < dmis_a.size()) out += "- " + dmis_a[i] + "\n";
+    if (i < dmis_b.size()) out += "+ " + dmis_b[i] + "\n";
+  }
+  return out;
+}
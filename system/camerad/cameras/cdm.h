@@ -3,6 +3,7 @@
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
+#include <string>
 #include <vector>
 #include <memory>
 
@@ -11,6 +12,48 @@ int write_random(uint8_t *dst, const std::vector<uint32_t> &vals);
 int write_cont(uint8_t *dst, uint32_t reg, const std::vector<uint32_t> &vals);
 int write_dmi(uint8_t *dst, uint64_t *addr, uint32_t length, uint32_t dmi_addr, uint8_t sel);
 
+// A CDM command stream built in host memory. Programs are built once per configuration
+// and copied into the command buffers, the offsets of the DMI LUT addresses are
+// kept as patches for the kernel to fill in.
+class CdmProgram {
+public:
+  void write_random(const std::vector<uint32_t> &vals);
+  void write_cont(uint32_t reg, const std::vector<uint32_t> &vals);
+  void write_dmi(uint32_t length, uint32_t dmi_addr, uint8_t sel);
+
+  inline const uint8_t *data() const { return buf.data(); }
+  inline int size() const { return buf.size(); }
+  inline const std::vector<uint32_t> &patches() const { return patch_offsets; }
+  inline int copy_to(uint8_t *dst) const {
+    memcpy(dst, buf.data(), buf.size());
+    return buf.size();
+  }
+
+private:
+  uint8_t *grow(size_t len);
+
+  std::vector<uint8_t> buf;
+  std::vector<uint32_t> patch_offsets;
+};
+
+// a decoded CDM command
+struct CdmCommand {
+  uint32_t offset;  // in the stream
+  uint32_t cmd;     // cam_cdm_command
+  uint32_t reg;     // first register of REG_CONT, DMI config register of DMI
+  uint32_t dmi_sel;
+  uint32_t dmi_length;  // LUT size in bytes
+  uint32_t dmi_addr;
+  std::vector<uint32_t> vals;  // REG_CONT values, REG_RANDOM register/value pairs
+};
+
+// Decodes and validates a CDM stream. Fails on unsupported commands, set reserved bits,
+// unaligned registers and truncated commands, describing the problem in error.
+bool cdm_decode(const uint8_t *data, size_t size, std::vector<CdmCommand> &cmds, std::string *error = nullptr);
+std::string cdm_dump(const std::vector<CdmCommand> &cmds);
+// Differences in the register state and DMI writes left by two streams, empty if they program the same.
+std::string cdm_diff(const std::vector<CdmCommand> &a, const std::vector<CdmCommand> &b);
+
 // from drivers/media/platform/msm/camera/cam_cdm/cam_cdm_util.{c,h}
 
 enum cam_cdm_command {
@@ -5,9 +5,7 @@
 #include "system/camerad/cameras/hw.h"
 #include "system/camerad/sensors/sensor.h"
 
-int build_common_ife_bps(uint8_t *dst, const CameraConfig cam, const SensorInfo *s, std::vector<uint32_t> &patches, bool ife) {
-  uint8_t *start = dst;
-
+inline void build_common_ife_bps(CdmProgram &p, const CameraConfig cam, const SensorInfo *s, bool ife) {
   /*
     Common between IFE and BPS.
   */
@@ -20,7 +18,7 @@ int build_common_ife_bps(uint8_t *dst, const CameraConfig cam, const SensorInfo
   */
 
   // YUV
-  dst += write_cont(dst, ife ? 0xf30 : 0x3468, {
+  p.write_cont(ife ? 0xf30 : 0x3468, {
     0x00680208,
     0x00000108,
     0x00400000,
@@ -34,15 +32,11 @@ int build_common_ife_bps(uint8_t *dst, const CameraConfig cam, const SensorInfo
     0x02000000,
     0x03ff0000,
   });
-
-  return dst - start;
 }
 
-int build_update(uint8_t *dst, const CameraConfig cam, const SensorInfo *s, std::vector<uint32_t> &patches) {
-  uint8_t *start = dst;
-
+inline void build_update(CdmProgram &p, const CameraConfig cam, const SensorInfo *s) {
   // init sequence
-  dst += write_random(dst, {
+  p.write_random({
     0x2c, 0xffffffff,
     0x30, 0xffffffff,
     0x34, 0xffffffff,
@@ -51,7 +45,7 @@ int build_update(uint8_t *dst, const CameraConfig cam, const SensorInfo *s, std:
   });
 
   // demux cfg
-  dst += write_cont(dst, 0x560, {
+  p.write_cont(0x560, {
     0x00000001,
     0x04440444,
     0x04450445,
@@ -62,7 +56,7 @@ int build_update(uint8_t *dst, const CameraConfig cam, const SensorInfo *s, std:
   });
 
   // white balance
-  dst += write_cont(dst, 0x6fc, {
+  p.write_cont(0x6fc, {
     0x00800080,
     0x00000080,
     0x00000000,
@@ -70,120 +64,108 @@ int build_update(uint8_t *dst, const CameraConfig cam, const SensorInfo *s, std:
   });
 
   // module config/enables (e.g. enable debayer, white balance, etc.)
-  dst += write_cont(dst, 0x40, {
+  p.write_cont(0x40, {
     0x00000c06 | ((uint32_t)(cam.vignetting_correction) << 8),
   });
-  dst += write_cont(dst, 0x44, {
+  p.write_cont(0x44, {
     0x00000000,
   });
-  dst += write_cont(dst, 0x48, {
+  p.write_cont(0x48, {
     (1 << 3) | (1 << 1),
   });
-  dst += write_cont(dst, 0x4c, {
+  p.write_cont(0x4c, {
     0x00000019,
   });
-  dst += write_cont(dst, 0xf00, {
+  p.write_cont(0xf00, {
     0x00000000,
   });
 
   // cropping
-  dst += write_cont(dst, 0xe0c, {
+  p.write_cont(0xe0c, {
     0x00000e00,
   });
-  dst += write_cont(dst, 0xe2c, {
+  p.write_cont(0xe2c, {
     0x00000e00,
   });
 
   // black level scale + offset
-  dst += write_cont(dst, 0x6b0, {
+  p.write_cont(0x6b0, {
     ((uint32_t)(1 << 11) << 0xf) | (s->black_level << (14 - s->bits_per_pixel)),
     0x0,
     0x0,
   });
-
-  return dst - start;
 }
 
 
-int build_initial_config(uint8_t *dst, const CameraConfig cam, const SensorInfo *s, std::vector<uint32_t> &patches, uint32_t out_width, uint32_t out_height) {
-  uint8_t *start = dst;
-
+inline void build_initial_config(CdmProgram &p, const CameraConfig cam, const SensorInfo *s, uint32_t out_width, uint32_t out_height) {
   // start with the every frame config
-  dst += build_update(dst, cam, s, patches);
-
-  uint64_t addr;
+  build_update(p, cam, s);
 
   // setup
-  dst += write_cont(dst, 0x478, {
+  p.write_cont(0x478, {
     0x00000004,
     0x004000c0,
   });
-  dst += write_cont(dst, 0x488, {
+  p.write_cont(0x488, {
     0x00000000,
     0x00000000,
     0x00000f0f,
   });
-  dst += write_cont(dst, 0x49c, {
+  p.write_cont(0x49c, {
     0x00000001,
   });
-  dst += write_cont(dst, 0xce4, {
+  p.write_cont(0xce4, {
     0x00000000,
     0x00000000,
   });
 
   // linearization
-  dst += write_cont(dst, 0x4dc, {
+  p.write_cont(0x4dc, {
     0x00000000,
   });
-  dst += write_cont(dst, 0x4e0, s->linearization_pts);
-  dst += write_cont(dst, 0x4f0, s->linearization_pts);
-  dst += write_cont(dst, 0x500, s->linearization_pts);
-  dst += write_cont(dst, 0x510, s->linearization_pts);
+  p.write_cont(0x4e0, s->linearization_pts);
+  p.write_cont(0x4f0, s->linearization_pts);
+  p.write_cont(0x500, s->linearization_pts);
+  p.write_cont(0x510, s->linearization_pts);
   // TODO: this is DMI64 in the dump, does that matter?
-  dst += write_dmi(dst, &addr, s->linearization_lut.size()*sizeof(uint32_t), 0xc24, 9);
-  patches.push_back(addr - (uint64_t)start);
+  p.write_dmi(s->linearization_lut.size()*sizeof(uint32_t), 0xc24, 9);
 
   // vignetting correction
-  dst += write_cont(dst, 0x6bc, {
+  p.write_cont(0x6bc, {
     0x0b3c0000,
     0x00670067,
     0xd3b1300c,
     0x13b1300c,
   });
-  dst += write_cont(dst, 0x6d8, {
+  p.write_cont(0x6d8, {
     0xec4e4000,
     0x0100c003,
   });
-  dst += write_dmi(dst, &addr, s->vignetting_lut.size()*sizeof(uint32_t), 0xc24, 14); // GRR
-  patches.push_back(addr - (uint64_t)start);
-  dst += write_dmi(dst, &addr, s->vignetting_lut.size()*sizeof(uint32_t), 0xc24, 15); // GBB
-  patches.push_back(addr - (uint64_t)start);
+  p.write_dmi(s->vignetting_lut.size()*sizeof(uint32_t), 0xc24, 14); // GRR
+  p.write_dmi(s->vignetting_lut.size()*sizeof(uint32_t), 0xc24, 15); // GBB
 
   // debayer
-  dst += write_cont(dst, 0x6f8, {
+  p.write_cont(0x6f8, {
     0x00000100,
   });
-  dst += write_cont(dst, 0x71c, {
+  p.write_cont(0x71c, {
     0x00008000,
     0x08000066,
   });
 
   // color correction
-  dst += write_cont(dst, 0x760, s->color_correct_matrix);
+  p.write_cont(0x760, s->color_correct_matrix);
 
   // gamma
-  dst += write_cont(dst, 0x798, {
+  p.write_cont(0x798, {
     0x00000000,
   });
-  dst += write_dmi(dst, &addr, s->gamma_lut_rgb.size()*sizeof(uint32_t), 0xc24, 26);  // G
-  patches.push_back(addr - (uint64_t)start);
-  dst += write_dmi(dst, &addr, s->gamma_lut_rgb.size()*sizeof(uint32_t), 0xc24, 28);  // B
-  patches.push_back(addr - (uint64_t)start);
-  dst += write_dmi(dst, &addr, s->gamma_lut_rgb.size()*sizeof(uint32_t), 0xc24, 30);  // R
-  patches.push_back(addr - (uint64_t)start);
+  p.write_dmi(s->gamma_lut_rgb.size()*sizeof(uint32_t), 0xc24, 26);  // G
+  p.write_dmi(s->gamma_lut_rgb.size()*sizeof(uint32_t), 0xc24, 28);  // B
+  p.write_dmi(s->gamma_lut_rgb.size()*sizeof(uint32_t), 0xc24, 30);  // R
 
   // output size/scaling
-  dst += write_cont(dst, 0xa3c, {
+  p.write_cont(0xa3c, {
     0x00000003,
     ((out_width - 1) << 16) | (s->frame_width - 1),
     0x30036666,
@@ -196,7 +178,7 @@ int build_initial_config(uint8_t *dst, const CameraConfig cam, const SensorInfo
     0x00000000,
     s->frame_height - 1,
   });
-  dst += write_cont(dst, 0xa68, {
+  p.write_cont(0xa68, {
     0x00000003,
     ((out_width / 2 - 1) << 16) | (s->frame_width - 1),
     0x3006cccc,
@@ -211,26 +193,58 @@ int build_initial_config(uint8_t *dst, const CameraConfig cam, const SensorInfo
   });
 
   // cropping
-  dst += write_cont(dst, 0xe10, {
+  p.write_cont(0xe10, {
     out_height - 1,
     out_width - 1,
   });
-  dst += write_cont(dst, 0xe30, {
+  p.write_cont(0xe30, {
     out_height / 2 - 1,
     out_width - 1,
   });
-  dst += write_cont(dst, 0xe18, {
+  p.write_cont(0xe18, {
     0x0ff00000,
     0x00000016,
   });
-  dst += write_cont(dst, 0xe38, {
+  p.write_cont(0xe38, {
     0x0ff00000,
     0x00000017,
   });
 
-  dst += build_common_ife_bps(dst, cam, s, patches, true);
-
-  return dst - start;
+  build_common_ife_bps(p, cam, s, true);
 }
 
+inline void build_bps(CdmProgram &p, const CameraConfig cam, const SensorInfo *s) {
+  std::vector<uint32_t> lin_reg;
+  for (int i = 0; i < 4; i++) {
+    lin_reg.push_back(((s->linearization_pts[i] & 0xffff) << 0x10) | (s->linearization_pts[i] >> 0x10));
+  }
 
+  std::vector<uint32_t> ccm_reg;
+  for (int i = 0; i < 3; i++) {
+    ccm_reg.push_back(s->color_correct_matrix[i] | (s->color_correct_matrix[i+3] << 0x10));
+    ccm_reg.push_back(s->color_correct_matrix[i+6]);
+  }
+
+  // white balance
+  p.write_cont(0x2868, {
+    0x04000400,
+    0x00000400,
+    0x00000000,
+    0x00000000,
+  });
+  // debayer
+  p.write_cont(0x2878, {
+    0x00000080,
+    0x00800066,
+  });
+  // linearization, EN=0
+  p.write_cont(0x1868, lin_reg);
+  p.write_cont(0x1878, lin_reg);
+  p.write_cont(0x1888, lin_reg);
+  p.write_cont(0x1898, lin_reg);
+  // p.write_dmi(s->linearization_lut.size()*sizeof(uint32_t), 0x1808, 1);
+  // color correction
+  p.write_cont(0x2e68, ccm_reg);
+
+  build_common_ife_bps(p, cam, s, false);
+}
@@ -298,6 +298,14 @@ void SpectraCamera::camera_open(VisionIpcServer *v, cl_device_id device_id, cl_c
   assert(stride == VENUS_UV_STRIDE(COLOR_FMT_NV12, buf.out_img_width));
   assert(y_height/2 == uv_height);
 
+  if (cc.output_type == ISP_IFE_PROCESSED) {
+    build_initial_config(ife_init_cdm, cc, sensor.get(), buf.out_img_width, buf.out_img_height);
+    build_update(ife_update_cdm, cc, sensor.get());
+  }
+  if (cc.output_type == ISP_BPS_PROCESSED) {
+    build_bps(bps_cdm, cc, sensor.get());
+  }
+
   open = true;
   configISP();
   if (cc.output_type == ISP_BPS_PROCESSED) configICP();
@@ -519,7 +527,7 @@ void SpectraCamera::config_bps(int idx, int request_id) {
   } cdm_tmp;
 
   // *** cmd buf ***
-  std::vector<uint32_t> patches;
+  const std::vector<uint32_t> &patches = bps_cdm.patches();
   struct cam_cmd_buf_desc *buf_desc = (struct cam_cmd_buf_desc *)&pkt->payload;
   {
     pkt->num_cmd_buf = 2;
@@ -551,50 +559,8 @@ void SpectraCamera::config_bps(int idx, int request_id) {
     pa->unused = 0;
     pa->base = 0; // this gets patched
 
-    int cdm_len = 0;
-
-    if (bps_lin_reg.size() == 0) {
-      for (int i = 0; i < 4; i++) {
-        bps_lin_reg.push_back(((sensor->linearization_pts[i] & 0xffff) << 0x10) | (sensor->linearization_pts[i] >> 0x10));
-      }
-    }
-
-    if (bps_ccm_reg.size() == 0) {
-      for (int i = 0; i < 3; i++) {
-        bps_ccm_reg.push_back(sensor->color_correct_matrix[i] | (sensor->color_correct_matrix[i+3] << 0x10));
-        bps_ccm_reg.push_back(sensor->color_correct_matrix[i+6]);
-      }
-    }
-
-    // white balance
-    cdm_len += write_cont((unsigned char *)bps_cdm_program_array.ptr + cdm_len, 0x2868, {
-      0x04000400,
-      0x00000400,
-      0x00000000,
-      0x00000000,
-    });
-    // debayer
-    cdm_len += write_cont((unsigned char *)bps_cdm_program_array.ptr + cdm_len, 0x2878, {
-      0x00000080,
-      0x00800066,
-    });
-    // linearization, EN=0
-    cdm_len += write_cont((unsigned char *)bps_cdm_program_array.ptr + cdm_len, 0x1868, bps_lin_reg);
-    cdm_len += write_cont((unsigned char *)bps_cdm_program_array.ptr + cdm_len, 0x1878, bps_lin_reg);
-    cdm_len += write_cont((unsigned char *)bps_cdm_program_array.ptr + cdm_len, 0x1888, bps_lin_reg);
-    cdm_len += write_cont((unsigned char *)bps_cdm_program_array.ptr + cdm_len, 0x1898, bps_lin_reg);
-    /*
-    uint8_t *start = (unsigned char *)bps_cdm_program_array.ptr + cdm_len;
-    uint64_t addr;
-    cdm_len += write_dmi((unsigned char *)bps_cdm_program_array.ptr + cdm_len, &addr, sensor->linearization_lut.size()*sizeof(uint32_t), 0x1808, 1);
-    patches.push_back(addr - (uint64_t)start);
-    */
-    // color correction
-    cdm_len += write_cont((unsigned char *)bps_cdm_program_array.ptr + cdm_len, 0x2e68, bps_ccm_reg);
-
-    cdm_len += build_common_ife_bps((unsigned char *)bps_cdm_program_array.ptr + cdm_len, cc, sensor.get(), patches, false);
-
-    pa->length = cdm_len - 1;
+    // the program array is written once in configICP
+    pa->length = bps_cdm.size() - 1;
 
     // *** second command ***
     // parsed by cam_icp_packet_generic_blob_handler
@@ -723,7 +689,7 @@ void SpectraCamera::config_ife(int idx, int request_id, bool init) {
   pkt->header.size = size;
 
   // *** cmd buf ***
-  std::vector<uint32_t> patches;
+  const std::vector<uint32_t> &patches = init ? ife_init_cdm.patches() : ife_update_cdm.patches();
   {
     struct cam_cmd_buf_desc *buf_desc = (struct cam_cmd_buf_desc *)&pkt->payload;
     pkt->num_cmd_buf = 2;
@@ -739,11 +705,8 @@ void SpectraCamera::config_ife(int idx, int request_id, bool init) {
     // stream of IFE register writes
     bool is_raw = cc.output_type != ISP_IFE_PROCESSED;
     if (!is_raw) {
-      if (init) {
-        buf_desc[0].length = build_initial_config((unsigned char*)ife_cmd.ptr + buf_desc[0].offset, cc, sensor.get(), patches, buf.out_img_width, buf.out_img_height);
-      } else {
-        buf_desc[0].length = build_update((unsigned char*)ife_cmd.ptr + buf_desc[0].offset, cc, sensor.get(), patches);
-      }
+      const CdmProgram &program = init ? ife_init_cdm : ife_update_cdm;
+      buf_desc[0].length = program.copy_to((unsigned char*)ife_cmd.ptr + buf_desc[0].offset);
     }
 
     pkt->kmd_cmd_buf_offset = buf_desc[0].length;
@@ -1169,6 +1132,8 @@ void SpectraCamera::configICP() {
 
   // for cdm register writes, just make it bigger than you need
   bps_cdm_program_array.init(m, 0x1000, 0x20, true, m->icp_device_iommu);
+  assert(bps_cdm.size() <= bps_cdm_program_array.size);
+  bps_cdm.copy_to(bps_cdm_program_array.ptr);
 
   // striping lib output
   uint32_t striping_size = sizeof(bps_striping_output[0]) / sizeof(bps_striping_output[0][0]);
@@ -11,6 +11,7 @@
 
 #include "common/util.h"
 #include "common/swaglog.h"
+#include "system/camerad/cameras/cdm.h"
 #include "system/camerad/cameras/hw.h"
 #include "system/camerad/cameras/camera_common.h"
 #include "system/camerad/sensors/sensor.h"
@@ -173,8 +174,11 @@ public:
   SpectraBuf bps_iq;
   SpectraBuf bps_striping;
   SpectraBuf bps_linearization_lut;
-  std::vector<uint32_t> bps_lin_reg;
-  std::vector<uint32_t> bps_ccm_reg;
+
+  // CDM programs, static for a configuration so they're only built once
+  CdmProgram ife_init_cdm;
+  CdmProgram ife_update_cdm;
+  CdmProgram bps_cdm;
 
   int buf_handle_yuv[MAX_IFE_BUFS] = {};
   int buf_handle_raw[MAX_IFE_BUFS] = {};
@@ -0,0 +1,77 @@
+// Offline CDM programs: generate the IFE/BPS command streams for every camera and sensor,
+// and validate, dump and diff them without camera hardware.
+//
+//   cdm_tool gen <dir>        writes <camera>_<sensor>_<program>.bin
+//   cdm_tool dump <file>
+//   cdm_tool diff <a> <b>     exits with 1 if a and b program different registers
+
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "common/util.h"
+#include "system/camerad/cameras/ife.h"
+
+static bool load(const char *fn, std::vector<CdmCommand> &cmds) {
+  std::string data = util::read_file(fn);
+  std::string error;
+  if (!cdm_decode((const uint8_t *)data.data(), data.size(), cmds, &error)) {
+    fprintf(stderr, "%s: %s\n", fn, error.c_str());
+    return false;
+  }
+  return true;
+}
+
+static int gen(const std::string &dir) {
+  std::vector<std::pair<const char *, std::unique_ptr<SensorInfo>>> sensors;
+  sensors.emplace_back("ar0231", std::make_unique<AR0231>());
+  sensors.emplace_back("ox03c10", std::make_unique<OX03C10>());
+  sensors.emplace_back("os04c10", std::make_unique<OS04C10>());
+
+  for (const CameraConfig &cc : ALL_CAMERA_CONFIGS) {
+    for (const auto &[name, s] : sensors) {
+      uint32_t out_width = s->frame_width / s->out_scale;
+      uint32_t out_height = (s->hdr_offset > 0 ? (s->frame_height - s->hdr_offset) / 2 : s->frame_height) / s->out_scale;
+
+      std::vector<std::pair<std::string, CdmProgram>> programs(3);
+      programs[0].first = "ife_init";
+      build_initial_config(programs[0].second, cc, s.get(), out_width, out_height);
+      programs[1].first = "ife_update";
+      build_update(programs[1].second, cc, s.get());
+      programs[2].first = "bps";
+      build_bps(programs[2].second, cc, s.get());
+
+      for (const auto &[program_name, program] : programs) {
+        std::string fn = util::string_format("%s/%s_%s_%s.bin", dir.c_str(), cc.publish_name, name, program_name.c_str());
+        if (util::write_file(fn.c_str(), program.data(), program.size(), O_WRONLY | O_CREAT | O_TRUNC) != 0) {
+          fprintf(stderr, "failed to write %s\n", fn.c_str());
+          return 1;
+        }
+        printf("%s: %d bytes, %zu patches\n", fn.c_str(), program.size(), program.patches().size());
+      }
+    }
+  }
+  return 0;
+}
+
+int main(int argc, char *argv[]) {
+  std::string cmd = argc > 1 ? argv[1] : "";
+  if (cmd == "gen" && argc == 3) {
+    return gen(argv[2]);
+  } else if (cmd == "dump" && argc == 3) {
+    std::vector<CdmCommand> cmds;
+    if (!load(argv[2], cmds)) return 1;
+    printf("%s", cdm_dump(cmds).c_str());
+    return 0;
+  } else if (cmd == "diff" && argc == 4) {
+    std::vector<CdmCommand> a, b;
+    if (!load(argv[2], a) || !load(argv[3], b)) return 1;
+    std::string diff = cdm_diff(a, b);
+    printf("%s", diff.c_str());
+    return diff.empty() ? 0 : 1;
+  }
+
+  fprintf(stderr, "usage: %s gen <dir> | dump <file> | diff <a> <b>\n", argv[0]);
+  return 1;
+}
@@ -0,0 +1,158 @@
+#define CATCH_CONFIG_MAIN
+#define CATCH_CONFIG_ENABLE_BENCHMARKING
+#include "catch2/catch.hpp"
+
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "system/camerad/cameras/ae_stats.h"
+
+#define W 1928
+#define H 1208
+
+static void require_equal(const AEStats &a, const AEStats &b) {
+  REQUIRE(a.count == b.count);
+  REQUIRE(a.sum == b.sum);
+  REQUIRE(memcmp(a.histogram, b.histogram, sizeof(a.histogram)) == 0);
+}
+
+// the subsampled single histogram AE used before
+static int legacy_median(const uint8_t *y, int stride, Rect r, int x_skip, int y_skip) {
+  uint32_t lum_binning[256] = {0};
+  unsigned int lum_total = 0;
+  for (int row = r.y; row < r.y + r.h; row += y_skip) {
+    for (int x = r.x; x < r.x + r.w; x += x_skip) {
+      lum_binning[y[row * stride + x]]++;
+      lum_total += 1;
+    }
+  }
+  int lum_med;
+  unsigned int lum_cur = 0;
+  for (lum_med = 255; lum_med >= 0; lum_med--) {
+    lum_cur += lum_binning[lum_med];
+    if (lum_cur >= lum_total / 2) break;
+  }
+  return lum_med;
+}
+
+// noise on top of flat dark and saturated bands, like a road scene at night
+static std::vector<uint8_t> scene(std::mt19937 &rng) {
+  std::vector<uint8_t> img(W * H);
+  std::uniform_int_distribution<int> noise(0, 255);
+  for (int row = 0; row < H; row++) {
+    uint8_t *p = &img[row * W];
+    if (row < H / 4) {
+      memset(p, 255, W);
+    } else if (row > 3 * H / 4) {
+      memset(p, 16, W);
+    } else {
+      for (int x = 0; x < W; x++) p[x] = noise(rng);
+    }
+  }
+  return img;
+}
+
+TEST_CASE("calculate_ae_stats matches reference") {
+  std::mt19937 rng(1234);
+  std::vector<uint8_t> img = scene(rng);
+  auto x_skip = GENERATE(1, 2, 3, 4);
+  auto y_skip = GENERATE(1, 2, 4);
+
+  for (int i = 0; i < 20; i++) {
+    std::vector<AERegion> regions;
+    for (int j = 0; j <= i % 3; j++) {
+      int x = rng() % (W - 1), y = rng() % (H - 1);
+      int w = 1 + rng() % (W - x), h = 1 + rng() % (H - y);
+      regions.push_back({{x, y, w, h}, (uint32_t)(1 + rng() % 4)});
+    }
+
+    AEStats stats, ref;
+    calculate_ae_stats(img.data(), W, regions, x_skip, y_skip, &stats);
+    calculate_ae_stats_reference(img.data(), W, regions, x_skip, y_skip, &ref);
+    require_equal(stats, ref);
+    REQUIRE(stats.percentile(50) == ref.percentile(50));
+  }
+}
+
+TEST_CASE("calculate_ae_stats uniform and unaligned rows") {
+  std::vector<uint8_t> img(W * H, 200);
+  // break up a few vectors in the middle of the flat area
+  img[5 * W + 37] = 10;
+  img[5 * W + 38] = 11;
+
+  for (int x = 0; x < 40; x++) {
+    AEStats stats, ref;
+    std::vector<AERegion> regions = {{{x, 3, 100 + x, 5}, 3}};
+    calculate_ae_stats(img.data(), W, regions, 1, 1, &stats);
+    calculate_ae_stats_reference(img.data(), W, regions, 1, 1, &ref);
+    require_equal(stats, ref);
+  }
+}
+
+TEST_CASE("AEStats percentile and mean") {
+  std::vector<uint8_t> img(100 * 10);
+  for (int row = 0; row < 10; row++) {
+    for (int x = 0; x < 100; x++) img[row * 100 + x] = x;
+  }
+
+  AEStats stats;
+  calculate_ae_stats(img.data(), 100, {{{0, 0, 100, 10}}}, 1, 1, &stats);
+  REQUIRE(stats.count == 1000);
+  REQUIRE(stats.mean() == Approx(49.5));
+  REQUIRE(stats.percentile(50) == 50);
+  REQUIRE(stats.percentile(90) == 90);
+  REQUIRE(stats.percentile(100) == 99);
+  REQUIRE(stats.percentile(0) == 0);
+
+  // weighting the left half shifts the median down
+  calculate_ae_stats(img.data(), 100, {{{0, 0, 50, 10}, 3}, {{50, 0, 50, 10}, 1}}, 1, 1, &stats);
+  REQUIRE(stats.count == 2000);
+  REQUIRE(stats.percentile(50) == 33);
+
+  calculate_ae_stats(img.data(), 100, {}, 1, 1, &stats);
+  REQUIRE(stats.count == 0);
+  REQUIRE(stats.mean() == 0);
+  REQUIRE(stats.percentile(50) == 0);
+}
+
+TEST_CASE("calculate_ae_stats matches legacy median") {
+  std::mt19937 rng(42);
+  std::vector<uint8_t> img = scene(rng);
+  Rect r = {96, 160, 1736, 888};
+  for (int skip : {1, 2, 4}) {
+    AEStats stats;
+    calculate_ae_stats(img.data(), W, {{r}}, 2, skip, &stats);
+    REQUIRE(stats.percentile(50) == legacy_median(img.data(), W, r, 2, skip));
+  }
+}
+
+TEST_CASE("calculate_ae_stats benchmark", "[.][benchmark]") {
+  std::mt19937 rng(42);
+  std::vector<uint8_t> img = scene(rng);
+  Rect r = {96, 160, 1736, 888};
+
+  BENCHMARK("legacy 2x2") {
+    return legacy_median(img.data(), W, r, 2, 2);
+  };
+  BENCHMARK("reference 1x1") {
+    AEStats stats;
+    calculate_ae_stats_reference(img.data(), W, {{r}}, 1, 1, &stats);
+    return stats.percentile(50);
+  };
+  BENCHMARK("calculate_ae_stats 2x2") {
+    AEStats stats;
+    calculate_ae_stats(img.data(), W, {{r}}, 2, 2, &stats);
+    return stats.percentile(50);
+  };
+  BENCHMARK("calculate_ae_stats 1x2") {
+    AEStats stats;
+    calculate_ae_stats(img.data(), W, {{r}}, 1, 2, &stats);
+    return stats.percentile(50);
+  };
+  BENCHMARK("calculate_ae_stats 1x1") {
+    AEStats stats;
+    calculate_ae_stats(img.data(), W, {{r}}, 1, 1, &stats);
+    return stats.percentile(50);
+  };
+}
@@ -0,0 +1,146 @@
+#define CATCH_CONFIG_MAIN
+#include "catch2/catch.hpp"
+
+#include <memory>
+#include <vector>
+
+#include "system/camerad/cameras/ife.h"
+
+static std::vector<CdmCommand> decode(const CdmProgram &p) {
+  std::vector<CdmCommand> cmds;
+  std::string error;
+  bool ok = cdm_decode(p.data(), p.size(), cmds, &error);
+  INFO(error);
+  REQUIRE(ok);
+  return cmds;
+}
+
+TEST_CASE("CdmProgram matches the write helpers") {
+  CdmProgram p;
+  p.write_random({0x2c, 0xffffffff, 0x30, 0x1});
+  p.write_cont(0x560, {1, 2, 3});
+  p.write_dmi(144, 0xc24, 9);
+  p.write_cont(0x6b0, {4});
+
+  uint8_t expected[256] = {};
+  uint64_t addr;
+  int len = 0;
+  len += write_random(expected + len, {0x2c, 0xffffffff, 0x30, 0x1});
+  len += write_cont(expected + len, 0x560, {1, 2, 3});
+  len += write_dmi(expected + len, &addr, 144, 0xc24, 9);
+  len += write_cont(expected + len, 0x6b0, {4});
+
+  REQUIRE(p.size() == len);
+  REQUIRE(memcmp(p.data(), expected, len) == 0);
+  REQUIRE(p.patches() == std::vector<uint32_t>{(uint32_t)(addr - (uint64_t)expected)});
+
+  uint8_t copy[256] = {};
+  REQUIRE(p.copy_to(copy) == len);
+  REQUIRE(memcmp(copy, expected, len) == 0);
+}
+
+TEST_CASE("cdm_decode") {
+  CdmProgram p;
+  p.write_random({0x2c, 0xffffffff, 0x30, 0x1});
+  p.write_cont(0x560, {1, 2, 3});
+  p.write_dmi(144, 0xc24, 9);
+
+  std::vector<CdmCommand> cmds = decode(p);
+  REQUIRE(cmds.size() == 3);
+  REQUIRE(cmds[0].cmd == CAM_CDM_CMD_REG_RANDOM);
+  REQUIRE(cmds[0].vals == std::vector<uint32_t>{0x2c, 0xffffffff, 0x30, 0x1});
+  REQUIRE(cmds[1].cmd == CAM_CDM_CMD_REG_CONT);
+  REQUIRE(cmds[1].offset == 20);
+  REQUIRE(cmds[1].reg == 0x560);
+  REQUIRE(cmds[1].vals == std::vector<uint32_t>{1, 2, 3});
+  REQUIRE(cmds[2].cmd == CAM_CDM_CMD_DMI_32);
+  REQUIRE(cmds[2].reg == 0xc24);
+  REQUIRE(cmds[2].dmi_sel == 9);
+  REQUIRE(cmds[2].dmi_length == 144);
+  REQUIRE(p.patches()[0] == cmds[2].offset + offsetof(cdm_dmi_cmd, addr));
+
+  std::string dump = cdm_dump(cmds);
+  REQUIRE(dump.find("0x0568 = 0x00000003") != std::string::npos);
+  REQUIRE(dump.find("DMI_32 0x0c24 sel 9, 144 bytes") != std::string::npos);
+
+  std::string error;
+  SECTION("truncated") {
+    REQUIRE_FALSE(cdm_decode(p.data(), p.size() - 4, cmds, &error));
+    REQUIRE(error == "0x0028: truncated DMI");
+    REQUIRE_FALSE(cdm_decode(p.data(), 30, cmds, &error));
+  }
+  SECTION("bad commands") {
+    std::vector<uint8_t> data(p.data(), p.data() + p.size());
+    data[22] = 0x1;  // REG_CONT reserved bits
+    REQUIRE_FALSE(cdm_decode(data.data(), data.size(), cmds, &error));
+    REQUIRE(error == "0x0014: reserved bits set");
+    data[22] = 0;
+    data[23] = CAM_CDM_CMD_GEN_IRQ;
+    REQUIRE_FALSE(cdm_decode(data.data(), data.size(), cmds, &error));
+    REQUIRE(error == "0x0014: unsupported command 0x6");
+  }
+  SECTION("unaligned register") {
+    CdmProgram bad;
+    bad.write_cont(0x562, {1});
+    REQUIRE_FALSE(cdm_decode(bad.data(), bad.size(), cmds, &error));
+    REQUIRE(error == "0x0000: unaligned register 0x562");
+  }
+}
+
+TEST_CASE("cdm_diff") {
+  CdmProgram a, b;
+  a.write_cont(0x560, {1, 2, 3});
+  a.write_dmi(144, 0xc24, 9);
+  // same register state, written differently
+  b.write_random({0x568, 3, 0x560, 1});
+  b.write_cont(0x564, {2});
+  b.write_dmi(144, 0xc24, 9);
+  REQUIRE(cdm_diff(decode(a), decode(b)) == "");
+
+  b.write_cont(0x564, {5, 6});
+  b.write_dmi(64, 0xc24, 26);
+  REQUIRE(cdm_diff(decode(a), decode(b)) ==
+          "- 0x0564 = 0x00000002\n"
+          "+ 0x0564 = 0x00000005\n"
+          "- 0x0568 = 0x00000003\n"
+          "+ 0x0568 = 0x00000006\n"
+          "+ DMI_32 0x0c24 sel 26, 64 bytes\n");
+}
+
+TEST_CASE("ISP programs are valid") {
+  std::unique_ptr<SensorInfo> sensors[] = {std::make_unique<AR0231>(), std::make_unique<OX03C10>(), std::make_unique<OS04C10>()};
+
+  for (const CameraConfig &cc : ALL_CAMERA_CONFIGS) {
+    for (const auto &s : sensors) {
+      CdmProgram init, update, bps;
+      build_initial_config(init, cc, s.get(), s->frame_width / s->out_scale, s->frame_height / s->out_scale);
+      build_update(update, cc, s.get());
+      build_bps(bps, cc, s.get());
+
+      // the patches point at the LUT addresses of the DMI writes
+      std::vector<CdmCommand> cmds = decode(init);
+      std::vector<uint32_t> dmi_addrs;
+      for (const CdmCommand &c : cmds) {
+        if (c.cmd == CAM_CDM_CMD_DMI_32) dmi_addrs.push_back(c.offset + offsetof(cdm_dmi_cmd, addr));
+      }
+      REQUIRE(init.patches().size() == 6);
+      REQUIRE(init.patches() == dmi_addrs);
+
+      // the initial config starts with the per-frame update
+      REQUIRE(update.size() < init.size());
+      REQUIRE(memcmp(update.data(), init.data(), update.size()) == 0);
+      REQUIRE(decode(update).size() > 0);
+      REQUIRE(update.patches().empty());
+
+      REQUIRE(decode(bps).size() > 0);
+      REQUIRE(bps.patches().empty());
+      REQUIRE(bps.size() <= 0x1000);
+
+      // the cameras only differ in vignetting correction
+      CdmProgram other;
+      build_update(other, WIDE_ROAD_CAMERA_CONFIG, s.get());
+      std::string diff = cdm_diff(decode(other), decode(update));
+      REQUIRE(diff.empty() == !cc.vignetting_correction);
+    }
+  }
+}
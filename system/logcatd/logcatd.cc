@@ -0,0 +1,131 @@
+#include "system/logcatd/logcatd.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <sstream>
+
+// published in the message JSON, in the sorted order of the map it used to be
+static const std::string_view FIELDS[] = {"MESSAGE", "PRIORITY", "SYSLOG_IDENTIFIER", "_COMM", "_PID", "_SYSTEMD_UNIT"};
+enum { MESSAGE, PRIORITY, SYSLOG_IDENTIFIER, COMM, PID, SYSTEMD_UNIT, NUM_FIELDS };
+
+JournalFilter::JournalFilter(const std::string &rules_str) {
+  std::istringstream stream(rules_str);
+  std::string rule;
+  while (std::getline(stream, rule, ',')) {
+    size_t pos = rule.find('=');
+    if (pos == std::string::npos || pos == 0 || pos + 1 == rule.size()) continue;
+
+    std::string identifier = rule.substr(0, pos);
+    int priority = std::atoi(rule.c_str() + pos + 1);
+    if (identifier == "*") {
+      default_priority = priority;
+    } else {
+      rules.emplace_back(identifier, priority);
+    }
+  }
+}
+
+bool JournalFilter::keep(std::string_view identifier, int priority) const {
+  for (const auto &[rule_identifier, max_priority] : rules) {
+    if (identifier == rule_identifier) return priority <= max_priority;
+  }
+  return priority <= default_priority;
+}
+
+// same escaping as json11
+static void append_json_string(std::string &out, const std::string &s) {
+  out += '"';
+  for (size_t i = 0; i < s.size(); i++) {
+    const char ch = s[i];
+    if (ch == '\\') {
+      out += "\\\\";
+    } else if (ch == '"') {
+      out += "\\\"";
+    } else if (ch == '\b') {
+      out += "\\b";
+    } else if (ch == '\f') {
+      out += "\\f";
+    } else if (ch == '\n') {
+      out += "\\n";
+    } else if (ch == '\r') {
+      out += "\\r";
+    } else if (ch == '\t') {
+      out += "\\t";
+    } else if ((uint8_t)ch <= 0x1f) {
+      char buf[8];
+      snprintf(buf, sizeof buf, "\\u%04x", ch);
+      out += buf;
+    } else if ((uint8_t)ch == 0xe2 && i + 2 < s.size() && (uint8_t)s[i + 1] == 0x80 && (uint8_t)s[i + 2] == 0xa8) {
+      out += "\\u2028";
+      i += 2;
+    } else if ((uint8_t)ch == 0xe2 && i + 2 < s.size() && (uint8_t)s[i + 1] == 0x80 && (uint8_t)s[i + 2] == 0xa9) {
+      out += "\\u2029";
+      i += 2;
+    } else {
+      out += ch;
+    }
+  }
+  out += '"';
+}
+
+bool JournalReader::read(JournalEntry &entry) {
+  values.resize(NUM_FIELDS);
+  uint32_t present = 0;
+  source->forEachField([&](std::string_view field) {
+    for (int i = 0; i < NUM_FIELDS; i++) {
+      const std::string_view key = FIELDS[i];
+      if (field.size() > key.size() && field[key.size()] == '=' && field.compare(0, key.size(), key) == 0) {
+        values[i].assign(field.data() + key.size() + 1, field.size() - key.size() - 1);
+        present |= 1 << i;
+        return;
+      }
+    }
+  });
+
+  entry.priority = (present & (1 << PRIORITY)) ? std::atoi(values[PRIORITY].c_str()) : 0;
+  std::string_view tag = (present & (1 << SYSLOG_IDENTIFIER)) ? std::string_view(values[SYSLOG_IDENTIFIER]) : std::string_view();
+  if (!filter.keep(tag, entry.priority)) {
+    return false;
+  }
+
+  entry.ts = source->timestamp();
+  entry.pid = (present & (1 << PID)) ? std::atoi(values[PID].c_str()) : 0;
+  entry.tag = tag;
+
+  entry.message = "{";
+  for (int i = 0; i < NUM_FIELDS; i++) {
+    if (!(present & (1 << i))) continue;
+    if (entry.message.size() > 1) entry.message += ", ";
+    entry.message += '"';
+    entry.message += FIELDS[i];
+    entry.message += "\": ";
+    append_json_string(entry.message, values[i]);
+  }
+  entry.message += "}";
+  return true;
+}
+
+size_t JournalReader::readBatch(size_t max_entries, uint64_t timeout_us) {
+  if (entries.size() < max_entries) {
+    entries.resize(max_entries);
+  }
+
+  size_t n = 0;
+  bool waited = false;
+  while (n < max_entries) {
+    if (!source->next()) {
+      // publish what we have, or wait once for new entries
+      if (n > 0 || waited) break;
+      source->wait(timeout_us);
+      waited = true;
+      continue;
+    }
+
+    if (read(entries[n])) {
+      n++;
+    } else {
+      filtered_++;
+    }
+  }
+  return n;
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// the parts of the journald API logcatd uses, so the reader can run on a fake journal
+class JournalSource {
+public:
+  virtual ~JournalSource() = default;
+  // moves to the next entry, false if there isn't one yet
+  virtual bool next() = 0;
+  virtual void wait(uint64_t timeout_us) = 0;
+  virtual uint64_t timestamp() = 0;
+  // calls f with every "KEY=VALUE" field of the current entry, the view is only valid during the call
+  virtual void forEachField(const std::function<void(std::string_view)> &f) = 0;
+};
+
+struct JournalEntry {
+  uint64_t ts;
+  int pid;
+  int priority;
+  std::string tag;
+  std::string message;  // JSON object of the kept fields
+};
+
+// Drops entries by syslog identifier and priority (0 emerg - 7 debug). Rules are comma separated
+// "IDENTIFIER=PRIORITY", keeping the entries of IDENTIFIER up to PRIORITY. "*" sets the default.
+class JournalFilter {
+public:
+  JournalFilter(const std::string &rules = "");
+  bool keep(std::string_view identifier, int priority) const;
+
+private:
+  int default_priority = 7;
+  std::vector<std::pair<std::string, int>> rules;
+};
+
+// Reads the journal in batches. Only the fields logcatd publishes are copied out of an
+// entry, and the entries of a batch are reused so bursts don't allocate.
+class JournalReader {
+public:
+  JournalReader(JournalSource *source, const JournalFilter &filter) : source(source), filter(filter) {}
+  // reads up to max_entries entries, waiting up to timeout_us if none are available
+  size_t readBatch(size_t max_entries, uint64_t timeout_us);
+  inline const JournalEntry &entry(size_t i) const { return entries[i]; }
+  inline uint64_t filtered() const { return filtered_; }
+
+private:
+  bool read(JournalEntry &entry);
+
+  JournalSource *source;
+  JournalFilter filter;
+  std::vector<JournalEntry> entries;
+  std::vector<std::string> values;
+  uint64_t filtered_ = 0;
+};
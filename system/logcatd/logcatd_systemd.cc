@@ -2,74 +2,86 @@
 
 #include <cassert>
 #include <csignal>
-#include <map>
 #include <string>
 
-#include "third_party/json11/json11.hpp"
-
 #include "cereal/messaging/messaging.h"
 #include "common/timing.h"
 #include "common/util.h"
+#include "system/logcatd/logcatd.h"
 
-ExitHandler do_exit;
-int main(int argc, char *argv[]) {
+// entries published per read, bursts are drained without waiting on the journal in between
+const size_t MAX_BATCH = 64;
 
-  PubMaster pm({"androidLog"});
-
-  sd_journal *journal;
-  int err = sd_journal_open(&journal, 0);
-  assert(err >= 0);
-  err = sd_journal_get_fd(journal); // needed so sd_journal_wait() works properly if files rotate
-  assert(err >= 0);
-  err = sd_journal_seek_tail(journal);
-  assert(err >= 0);
+class SystemdJournal : public JournalSource {
+public:
+  SystemdJournal() {
+    int err = sd_journal_open(&journal, 0);
+    assert(err >= 0);
+    err = sd_journal_get_fd(journal); // needed so sd_journal_wait() works properly if files rotate
+    assert(err >= 0);
+    err = sd_journal_seek_tail(journal);
+    assert(err >= 0);
 
-  // workaround for bug https://github.com/systemd/systemd/issues/9934
-  // call sd_journal_previous_skip after sd_journal_seek_tail (like journalctl -f does) to makes things work.
-  sd_journal_previous_skip(journal, 1);
+    // workaround for bug https://github.com/systemd/systemd/issues/9934
+    // call sd_journal_previous_skip after sd_journal_seek_tail (like journalctl -f does) to makes things work.
+    sd_journal_previous_skip(journal, 1);
+  }
+  ~SystemdJournal() { sd_journal_close(journal); }
 
-  while (!do_exit) {
-    err = sd_journal_next(journal);
+  bool next() override {
+    int err = sd_journal_next(journal);
     assert(err >= 0);
+    return err > 0;
+  }
 
-    // Wait for new message if we didn't receive anything
-    if (err == 0) {
-      err = sd_journal_wait(journal, 1000 * 1000);
-      assert(err >= 0);
-      continue; // Try again
-    }
+  void wait(uint64_t timeout_us) override {
+    int err = sd_journal_wait(journal, timeout_us);
+    assert(err >= 0);
+  }
 
-    uint64_t timestamp = 0;
-    err = sd_journal_get_realtime_usec(journal, &timestamp);
+  uint64_t timestamp() override {
+    uint64_t ts = 0;
+    int err = sd_journal_get_realtime_usec(journal, &ts);
     assert(err >= 0);
+    return ts;
+  }
 
+  void forEachField(const std::function<void(std::string_view)> &f) override {
     const void *data;
     size_t length;
-    std::map<std::string, std::string> kv;
-
     SD_JOURNAL_FOREACH_DATA(journal, data, length) {
-      std::string str((char*)data, length);
-
-      // Split "KEY=VALUE"" on "=" and put in map
-      std::size_t found = str.find("=");
-      if (found != std::string::npos) {
-        kv[str.substr(0, found)] = str.substr(found + 1, std::string::npos);
-      }
+      f(std::string_view((const char *)data, length));
     }
+  }
 
-    MessageBuilder msg;
+private:
+  sd_journal *journal;
+};
 
-    // Build message
-    auto androidEntry = msg.initEvent().initAndroidLog();
-    androidEntry.setTs(timestamp);
-    androidEntry.setMessage(json11::Json(kv).dump());
-    if (kv.count("_PID")) androidEntry.setPid(std::atoi(kv["_PID"].c_str()));
-    if (kv.count("PRIORITY")) androidEntry.setPriority(std::atoi(kv["PRIORITY"].c_str()));
-    if (kv.count("SYSLOG_IDENTIFIER")) androidEntry.setTag(kv["SYSLOG_IDENTIFIER"]);
+ExitHandler do_exit;
+int main(int argc, char *argv[]) {
+
+  PubMaster pm({"androidLog"});
 
-    pm.send("androidLog", msg);
+  SystemdJournal journal;
+  JournalReader reader(&journal, JournalFilter(util::getenv("LOGCATD_FILTER", "")));
+
+  while (!do_exit) {
+    size_t n = reader.readBatch(MAX_BATCH, 1000 * 1000);
+    for (size_t i = 0; i < n; i++) {
+      const JournalEntry &entry = reader.entry(i);
+
+      MessageBuilder msg;
+      auto androidEntry = msg.initEvent().initAndroidLog();
+      androidEntry.setTs(entry.ts);
+      androidEntry.setMessage(entry.message);
+      androidEntry.setPid(entry.pid);
+      androidEntry.setPriority(entry.priority);
+      androidEntry.setTag(entry.tag);
+
+      pm.send("androidLog", msg);
+    }
   }
 
-  sd_journal_close(journal);
   return 0;
 }
@@ -0,0 +1,147 @@
+#define CATCH_CONFIG_MAIN
+#define CATCH_CONFIG_ENABLE_BENCHMARKING
+#include "catch2/catch.hpp"
+
+#include <algorithm>
+#include <map>
+
+#include "third_party/json11/json11.hpp"
+#include "system/logcatd/logcatd.h"
+
+// an in-memory journal, new entries show up when the reader waits
+class FakeJournal : public JournalSource {
+public:
+  void add(uint64_t ts, const std::vector<std::string> &fields) { entries.push_back({ts, fields}); }
+
+  bool next() override {
+    if (pos + 1 >= (int)entries.size()) return false;
+    pos++;
+    return true;
+  }
+  void wait(uint64_t timeout_us) override {
+    waits++;
+    for (auto &e : on_wait) entries.push_back(e);
+    on_wait.clear();
+  }
+  uint64_t timestamp() override { return entries[pos].first; }
+  void forEachField(const std::function<void(std::string_view)> &f) override {
+    for (const std::string &field : entries[pos].second) f(field);
+  }
+
+  std::vector<std::pair<uint64_t, std::vector<std::string>>> entries, on_wait;
+  int pos = -1;
+  int waits = 0;
+};
+
+const std::vector<std::string> SAMPLE = {
+  "_BOOT_ID=8f3e1c2a", "_TRANSPORT=journal", "PRIORITY=6", "SYSLOG_FACILITY=3", "_UID=0", "_GID=0",
+  "_COMM=NetworkManager", "_EXE=/usr/sbin/NetworkManager", "_SYSTEMD_UNIT=NetworkManager.service",
+  "SYSLOG_IDENTIFIER=NetworkManager", "_PID=812", "CODE_FILE=src/core/nm-manager.c",
+  "MESSAGE=<info>  [1700000000.1234] manager: \"wlan0\"\tstate\\change \xe2\x80\xa8 \x01",
+};
+
+// what logcatd published before, all fields as a JSON object
+static std::string legacy_message(const std::vector<std::string> &fields, bool kept_only) {
+  static const std::vector<std::string> kept = {"MESSAGE", "PRIORITY", "SYSLOG_IDENTIFIER", "_COMM", "_PID", "_SYSTEMD_UNIT"};
+  std::map<std::string, std::string> kv;
+  for (const std::string &str : fields) {
+    std::size_t found = str.find("=");
+    if (found != std::string::npos) {
+      std::string key = str.substr(0, found);
+      if (!kept_only || std::find(kept.begin(), kept.end(), key) != kept.end()) {
+        kv[key] = str.substr(found + 1, std::string::npos);
+      }
+    }
+  }
+  return json11::Json(kv).dump();
+}
+
+TEST_CASE("JournalReader extracts the published fields") {
+  FakeJournal journal;
+  journal.add(1234, SAMPLE);
+  journal.add(1235, {"MESSAGE=no metadata"});
+
+  JournalReader reader(&journal, JournalFilter());
+  REQUIRE(reader.readBatch(16, 0) == 2);
+
+  const JournalEntry &e = reader.entry(0);
+  REQUIRE(e.ts == 1234);
+  REQUIRE(e.pid == 812);
+  REQUIRE(e.priority == 6);
+  REQUIRE(e.tag == "NetworkManager");
+  REQUIRE(e.message == legacy_message(SAMPLE, true));
+
+  std::string err;
+  auto json = json11::Json::parse(e.message, err);
+  REQUIRE(err.empty());
+  REQUIRE(json["MESSAGE"].string_value() == SAMPLE.back().substr(8));
+  REQUIRE(json["_BOOT_ID"].is_null());
+
+  // fields of the previous entry don't leak
+  const JournalEntry &e2 = reader.entry(1);
+  REQUIRE(e2.pid == 0);
+  REQUIRE(e2.priority == 0);
+  REQUIRE(e2.tag == "");
+  REQUIRE(e2.message == "{\"MESSAGE\": \"no metadata\"}");
+}
+
+TEST_CASE("JournalReader batches") {
+  FakeJournal journal;
+  for (int i = 0; i < 10; i++) journal.add(i, SAMPLE);
+
+  JournalReader reader(&journal, JournalFilter());
+  REQUIRE(reader.readBatch(4, 0) == 4);
+  REQUIRE(reader.readBatch(4, 0) == 4);
+  REQUIRE(reader.readBatch(4, 0) == 2);
+  REQUIRE(reader.entry(1).ts == 9);
+  REQUIRE(journal.waits == 0);
+
+  // waits once when empty
+  REQUIRE(reader.readBatch(4, 0) == 0);
+  REQUIRE(journal.waits == 1);
+
+  journal.on_wait = {{20, SAMPLE}, {21, SAMPLE}};
+  REQUIRE(reader.readBatch(4, 0) == 2);
+  REQUIRE(journal.waits == 2);
+  REQUIRE(reader.entry(0).ts == 20);
+}
+
+TEST_CASE("JournalFilter") {
+  JournalFilter filter("NetworkManager=4,kernel=7,*=6,bad,=3");
+  REQUIRE(filter.keep("NetworkManager", 4));
+  REQUIRE_FALSE(filter.keep("NetworkManager", 5));
+  REQUIRE(filter.keep("kernel", 7));
+  REQUIRE(filter.keep("systemd", 6));
+  REQUIRE_FALSE(filter.keep("systemd", 7));
+  REQUIRE_FALSE(filter.keep("", 7));
+
+  REQUIRE(JournalFilter().keep("anything", 7));
+
+  FakeJournal journal;
+  journal.add(1, SAMPLE);
+  journal.add(2, {"SYSLOG_IDENTIFIER=NetworkManager", "PRIORITY=3", "MESSAGE=kept"});
+  JournalReader reader(&journal, filter);
+  REQUIRE(reader.readBatch(16, 0) == 1);
+  REQUIRE(reader.entry(0).ts == 2);
+  REQUIRE(reader.filtered() == 1);
+}
+
+TEST_CASE("JournalReader benchmark", "[.][benchmark]") {
+  FakeJournal journal;
+  for (int i = 0; i < 1000; i++) journal.add(i, SAMPLE);
+
+  BENCHMARK("legacy map + json11") {
+    size_t len = 0;
+    for (auto &[ts, fields] : journal.entries) len += legacy_message(fields, false).size();
+    return len;
+  };
+  JournalReader reader(&journal, JournalFilter());
+  BENCHMARK("JournalReader") {
+    journal.pos = -1;
+    size_t len = 0;
+    while (size_t n = reader.readBatch(64, 0)) {
+      for (size_t i = 0; i < n; i++) len += reader.entry(i).message.size();
+    }
+    return len;
+  };
+}
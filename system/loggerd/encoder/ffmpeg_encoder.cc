@@ -45,6 +45,13 @@ FfmpegEncoder::~FfmpegEncoder() {
   av_frame_free(&frame);
 }
 
+void FfmpegEncoder::set_preprocessor(FramePreprocessor *p) {
+  preprocessor = p;
+  preprocessor_output = preprocessor->addOutput(out_width, out_height);
+  convert_buf = {};
+  downscale_buf = {};
+}
+
 void FfmpegEncoder::encoder_open() {
   auto codec_id = encoder_info.encode_type == cereal::EncodeIndex::Type::QCAMERA_H264
                       ? AV_CODEC_ID_H264
@@ -72,10 +79,7 @@ void FfmpegEncoder::encoder_close() {
   is_open = false;
 }
 
-int FfmpegEncoder::encode_frame(VisionBuf* buf, VisionIpcBufExtra *extra) {
-  assert(buf->width == this->in_width);
-  assert(buf->height == this->in_height);
-
+void FfmpegEncoder::convert(VisionBuf *buf) {
   uint8_t *cy = convert_buf.data();
   uint8_t *cu = cy + in_width * in_height;
   uint8_t *cv = cu + (in_width / 2) * (in_height / 2);
@@ -107,6 +111,19 @@ int FfmpegEncoder::encode_frame(VisionBuf* buf, VisionIpcBufExtra *extra) {
     frame->data[1] = cu;
     frame->data[2] = cv;
   }
+}
+
+int FfmpegEncoder::encode_frame(VisionBuf* buf, VisionIpcBufExtra *extra) {
+  assert(buf->width == this->in_width);
+  assert(buf->height == this->in_height);
+
+  if (preprocessor) {
+    frame->data[0] = preprocessor->y(preprocessor_output);
+    frame->data[1] = preprocessor->u(preprocessor_output);
+    frame->data[2] = preprocessor->v(preprocessor_output);
+  } else {
+    convert(buf);
+  }
   frame->pts = counter*50*1000; // 50ms per frame
 
   int ret = counter;
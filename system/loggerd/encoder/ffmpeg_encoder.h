@@ -12,6 +12,7 @@ extern "C" {
 }
 
 #include "system/loggerd/encoder/encoder.h"
+#include "system/loggerd/encoder/frame_preprocessor.h"
 #include "system/loggerd/loggerd.h"
 
 class FfmpegEncoder : public VideoEncoder {
@@ -21,8 +22,12 @@ public:
   int encode_frame(VisionBuf* buf, VisionIpcBufExtra *extra);
   void encoder_open();
   void encoder_close();
+  // take the frames from the camera's shared preprocessor, it must have processed buf before encode_frame
+  void set_preprocessor(FramePreprocessor *p);
 
 private:
+  void convert(VisionBuf *buf);
+
   int segment_num = -1;
   int counter = 0;
   bool is_open = false;
@@ -31,4 +36,6 @@ private:
   AVFrame *frame = NULL;
   std::vector<uint8_t> convert_buf;
   std::vector<uint8_t> downscale_buf;
+  FramePreprocessor *preprocessor = nullptr;
+  int preprocessor_output = -1;
 };
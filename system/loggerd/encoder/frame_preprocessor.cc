@@ -0,0 +1,120 @@
+#include "system/loggerd/encoder/frame_preprocessor.h"
+
+#include <algorithm>
+#include <cassert>
+
+#include "third_party/libyuv/include/libyuv.h"
+
+// source rows converted at a time, the scaled outputs sample them while they are in cache
+const int BAND_ROWS = 32;
+
+namespace {
+
+// positions libyuv point samples: a 16.16 step starting half a step in, less the offset
+std::vector<int> sample_positions(int src, int dst, int offset = 0) {
+  const int step = (int)(((int64_t)src << 16) / dst);
+  std::vector<int> pos(dst);
+  for (int i = 0, p = (step >> 1) - offset; i < dst; i++, p += step) {
+    pos[i] = p >> 16;
+  }
+  return pos;
+}
+
+// the sizes libyuv::ScalePlane has its own kernels for, they don't point sample the same way
+bool has_libyuv_kernel(int src_width, int src_height, int dst_width, int dst_height) {
+  return (4 * dst_width == 3 * src_width && 4 * dst_height == 3 * src_height) ||
+         (8 * dst_width == 3 * src_width && dst_height == (src_height * 3 + 7) / 8);
+}
+
+}  // namespace
+
+FramePreprocessor::FramePreprocessor(int in_width, int in_height) : in_width(in_width), in_height(in_height) {
+  assert(in_width % 2 == 0 && in_height % 2 == 0);
+}
+
+int FramePreprocessor::addOutput(int width, int height) {
+  assert(width % 2 == 0 && height % 2 == 0);
+  assert(width <= in_width && height <= in_height);
+
+  for (int i = 0; i < outputs.size(); i++) {
+    if (outputs[i].width == width && outputs[i].height == height) return i;
+  }
+
+  // the chroma planes are checked too, 3/8 rounds their height differently
+  int scale_from = -1;
+  if (has_libyuv_kernel(in_width, in_height, width, height) ||
+      has_libyuv_kernel(in_width / 2, in_height / 2, width / 2, height / 2)) {
+    scale_from = addOutput(in_width, in_height);
+  }
+
+  Output &out = outputs.emplace_back();
+  out.width = width;
+  out.height = height;
+  out.buf.resize(width * height * 3 / 2);
+  out.scale_from = scale_from;
+  if (scale_from >= 0) return outputs.size() - 1;
+
+  out.y_cols = sample_positions(in_width, width);
+  // libyuv scales only vertically from half a row higher, the center of the rows it would filter
+  const int row_offset = width == in_width ? 1 << 15 : 0;
+  out.y_rows = sample_positions(in_height, height, row_offset);
+  out.uv_cols = sample_positions(in_width / 2, width / 2);
+  out.uv_rows = sample_positions(in_height / 2, height / 2, row_offset);
+  return outputs.size() - 1;
+}
+
+void FramePreprocessor::process(const uint8_t *y, const uint8_t *uv, int stride) {
+  for (auto &out : outputs) {
+    out.next_y_row = out.next_uv_row = 0;
+  }
+
+  for (int start = 0; start < in_height; start += BAND_ROWS) {
+    const int end = std::min(start + BAND_ROWS, in_height);
+    for (int i = 0; i < outputs.size(); i++) {
+      Output &out = outputs[i];
+      if (out.width == in_width && out.height == in_height) {
+        libyuv::CopyPlane(y + start * stride, stride, this->y(i) + start * in_width, in_width, in_width, end - start);
+        libyuv::SplitUVPlane(uv + (start / 2) * stride, stride,
+                             u(i) + (start / 2) * (in_width / 2), in_width / 2,
+                             v(i) + (start / 2) * (in_width / 2), in_width / 2,
+                             in_width / 2, (end - start) / 2);
+      } else if (out.scale_from < 0) {
+        scaleRows(out, y, uv, stride, end);
+      }
+    }
+  }
+
+  for (int i = 0; i < outputs.size(); i++) {
+    const Output &out = outputs[i];
+    if (out.scale_from < 0) continue;
+    const int src = out.scale_from;
+    libyuv::I420Scale(this->y(src), in_width, u(src), in_width / 2, v(src), in_width / 2, in_width, in_height,
+                      this->y(i), out.width, u(i), out.width / 2, v(i), out.width / 2, out.width, out.height,
+                      libyuv::kFilterNone);
+  }
+}
+
+void FramePreprocessor::scaleRows(Output &out, const uint8_t *y, const uint8_t *uv, int stride, int band_end) {
+  const int uv_width = out.width / 2;
+  uint8_t *out_y = out.buf.data();
+  uint8_t *out_u = out_y + out.width * out.height;
+  uint8_t *out_v = out_u + uv_width * (out.height / 2);
+
+  for (; out.next_y_row < out.height && out.y_rows[out.next_y_row] < band_end; out.next_y_row++) {
+    const uint8_t *src = y + out.y_rows[out.next_y_row] * stride;
+    uint8_t *dst = out_y + out.next_y_row * out.width;
+    for (int x = 0; x < out.width; x++) {
+      dst[x] = src[out.y_cols[x]];
+    }
+  }
+
+  for (; out.next_uv_row < out.height / 2 && out.uv_rows[out.next_uv_row] < band_end / 2; out.next_uv_row++) {
+    const uint8_t *src = uv + out.uv_rows[out.next_uv_row] * stride;
+    uint8_t *dst_u = out_u + out.next_uv_row * uv_width;
+    uint8_t *dst_v = out_v + out.next_uv_row * uv_width;
+    for (int x = 0; x < uv_width; x++) {
+      dst_u[x] = src[2 * out.uv_cols[x]];
+      dst_v[x] = src[2 * out.uv_cols[x] + 1];
+    }
+  }
+}
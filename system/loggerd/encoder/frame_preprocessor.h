@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// Converts the NV12 frames of a camera into the I420 frames its encoders need, at every
+// output size, in a single pass over the source. Scaled outputs are point sampled like
+// libyuv::I420Scale with kFilterNone, so they match converting the full frame and scaling
+// it per encoder, without reading the source once for every encoder. Sizes libyuv has its own
+// kernels for (3/4 and 3/8) are scaled from the full size output with libyuv after the pass.
+class FramePreprocessor {
+public:
+  FramePreprocessor(int in_width, int in_height);
+  // returns the index of the output, sizes are only converted once
+  int addOutput(int width, int height);
+  void process(const uint8_t *y, const uint8_t *uv, int stride);
+
+  // I420 planes of an output, valid until the next process()
+  inline uint8_t *y(int idx) { return outputs[idx].buf.data(); }
+  inline uint8_t *u(int idx) { return y(idx) + outputs[idx].width * outputs[idx].height; }
+  inline uint8_t *v(int idx) { return u(idx) + (outputs[idx].width / 2) * (outputs[idx].height / 2); }
+
+private:
+  struct Output {
+    int width, height;
+    std::vector<uint8_t> buf;
+    // source column of every output column, and source row of every output row, per plane
+    std::vector<int> y_cols, y_rows, uv_cols, uv_rows;
+    int next_y_row, next_uv_row;
+    int scale_from = -1;  // the full size output, when libyuv scales this one
+  };
+
+  void scaleRows(Output &out, const uint8_t *y, const uint8_t *uv, int stride, int band_end);
+
+  const int in_width, in_height;
+  std::vector<Output> outputs;
+};
@@ -1,38 +1,156 @@
 #include "system/loggerd/encoder/jpeg_encoder.h"
 
+#include <algorithm>
 #include <cassert>
+#include <cinttypes>
 #include <cstring>
 
-JpegEncoder::JpegEncoder(const std::string &pusblish_name, int width, int height)
-    : publish_name(pusblish_name), thumbnail_width(width), thumbnail_height(height) {
-  yuv_buffer.resize((thumbnail_width * ((thumbnail_height + 15) & ~15) * 3) / 2);
-  pm = std::make_unique<PubMaster>(std::vector{pusblish_name.c_str()});
+#include "common/swaglog.h"
+#include "common/util.h"
+
+namespace {
+
+// libjpeg destination writing into a vector, it keeps its capacity between thumbnails
+struct VectorDestination {
+  jpeg_destination_mgr mgr;
+  std::vector<uint8_t> *out;
+};
+
+void init_destination(j_compress_ptr cinfo) {
+  auto *dest = (VectorDestination *)cinfo->dest;
+  dest->out->resize(std::max<size_t>(dest->out->capacity(), 16384));
+  dest->mgr.next_output_byte = dest->out->data();
+  dest->mgr.free_in_buffer = dest->out->size();
+}
+
+boolean empty_output_buffer(j_compress_ptr cinfo) {
+  auto *dest = (VectorDestination *)cinfo->dest;
+  // the whole buffer is full
+  size_t used = dest->out->size();
+  dest->out->resize(used * 2);
+  dest->mgr.next_output_byte = dest->out->data() + used;
+  dest->mgr.free_in_buffer = dest->out->size() - used;
+  return TRUE;
+}
+
+void term_destination(j_compress_ptr cinfo) {
+  auto *dest = (VectorDestination *)cinfo->dest;
+  dest->out->resize(dest->out->size() - dest->mgr.free_in_buffer);
+}
+
+}  // namespace
+
+JpegEncoder::JpegEncoder(const std::string &pusblish_name, int width, int height, Publisher publisher)
+    : publish_name(pusblish_name), thumbnail_width(width), thumbnail_height(height), publisher(publisher) {
+  if (!this->publisher) {
+    pm = std::make_unique<PubMaster>(std::vector{publish_name.c_str()});
+    this->publisher = [this](uint32_t frame_id, uint64_t timestamp_eof, const std::vector<uint8_t> &jpeg) {
+      MessageBuilder msg;
+      auto thumbnaild = msg.initEvent().initThumbnail();
+      thumbnaild.setFrameId(frame_id);
+      thumbnaild.setTimestampEof(timestamp_eof);
+      thumbnaild.setThumbnail({jpeg.data(), jpeg.size()});
+      pm->send(publish_name.c_str(), msg);
+    };
+  }
+
+  for (int i = 0; i < THUMBNAIL_QUEUE_SIZE; i++) {
+    // make the buffer big enough. jpeg_write_raw_data requires 16-pixels aligned height to be used.
+    jobs[i].yuv.resize((thumbnail_width * ((thumbnail_height + 15) & ~15) * 3) / 2);
+    free_jobs.push_back(i);
+  }
+  worker_thread = std::thread(&JpegEncoder::worker, this);
 }
 
 JpegEncoder::~JpegEncoder() {
-  if (out_buffer) {
-    free(out_buffer);
+  {
+    std::lock_guard lk(lock);
+    exit = true;
+  }
+  cv.notify_one();
+  worker_thread.join();
+}
+
+bool JpegEncoder::pushThumbnail(VisionBuf *buf, const VisionIpcBufExtra &extra) {
+  return pushThumbnail(buf->y, buf->uv, buf->width, buf->height, buf->stride, extra);
+}
+
+bool JpegEncoder::pushThumbnail(const uint8_t *y, const uint8_t *uv, int width, int height, int stride, const VisionIpcBufExtra &extra) {
+  int idx;
+  {
+    std::lock_guard lk(lock);
+    if (free_jobs.empty()) {
+      dropped_++;
+      LOGW("%s: thumbnail of frame %d dropped, %" PRIu64 " so far", publish_name.c_str(), extra.frame_id, dropped_);
+      return false;
+    }
+    idx = free_jobs.front();
+    free_jobs.pop_front();
   }
+
+  // only the downscaled planes are copied here, the frame can be reused once this returns
+  Job &job = jobs[idx];
+  job.frame_id = extra.frame_id;
+  job.timestamp_eof = extra.timestamp_eof;
+  generateThumbnail(y, uv, width, height, stride, job.yuv.data());
+
+  {
+    std::lock_guard lk(lock);
+    pending.push_back(idx);
+  }
+  cv.notify_one();
+  return true;
 }
 
-void JpegEncoder::pushThumbnail(VisionBuf *buf, const VisionIpcBufExtra &extra) {
-  generateThumbnail(buf->y, buf->uv, buf->width, buf->height, buf->stride);
+void JpegEncoder::worker() {
+  util::set_thread_name("thumbnail");
+  while (true) {
+    int idx;
+    {
+      std::unique_lock lk(lock);
+      cv.wait(lk, [this]() { return exit || !pending.empty(); });
+      // queued thumbnails are still published on exit
+      if (pending.empty()) return;
+      idx = pending.front();
+      pending.pop_front();
+    }
 
-  MessageBuilder msg;
-  auto thumbnaild = msg.initEvent().initThumbnail();
-  thumbnaild.setFrameId(extra.frame_id);
-  thumbnaild.setTimestampEof(extra.timestamp_eof);
-  thumbnaild.setThumbnail({out_buffer, out_size});
+    Job &job = jobs[idx];
+    uint8_t *y_plane = job.yuv.data();
+    uint8_t *u_plane = y_plane + thumbnail_width * thumbnail_height;
+    uint8_t *v_plane = u_plane + (thumbnail_width * thumbnail_height) / 4;
+    compressToJpeg(y_plane, u_plane, v_plane);
+    publisher(job.frame_id, job.timestamp_eof, out_buffer);
+
+    {
+      std::lock_guard lk(lock);
+      free_jobs.push_back(idx);
+      published_++;
+    }
+    done_cv.notify_all();
+  }
+}
+
+void JpegEncoder::flush() {
+  std::unique_lock lk(lock);
+  done_cv.wait(lk, [this]() { return free_jobs.size() == THUMBNAIL_QUEUE_SIZE; });
+}
 
-  pm->send(publish_name.c_str(), msg);
+uint64_t JpegEncoder::published() {
+  std::lock_guard lk(lock);
+  return published_;
 }
 
-void JpegEncoder::generateThumbnail(const uint8_t *y_addr, const uint8_t *uv_addr, int width, int height, int stride) {
+uint64_t JpegEncoder::dropped() {
+  std::lock_guard lk(lock);
+  return dropped_;
+}
+
+void JpegEncoder::generateThumbnail(const uint8_t *y_addr, const uint8_t *uv_addr, int width, int height, int stride, uint8_t *yuv) {
   int downscale = width / thumbnail_width;
   assert(downscale * thumbnail_height == height);
 
-  // make the buffer big enough. jpeg_write_raw_data requires 16-pixels aligned height to be used.
-  uint8_t *y_plane = yuv_buffer.data();
+  uint8_t *y_plane = yuv;
   uint8_t *u_plane = y_plane + thumbnail_width * thumbnail_height;
   uint8_t *v_plane = u_plane + (thumbnail_width * thumbnail_height) / 4;
   {
@@ -50,8 +168,6 @@ void JpegEncoder::generateThumbnail(const uint8_t *y_addr, const uint8_t *uv_add
       }
     }
   }
-
-  compressToJpeg(y_plane, u_plane, v_plane);
 }
 
 void JpegEncoder::compressToJpeg(uint8_t *y_plane, uint8_t *u_plane, uint8_t *v_plane) {
@@ -60,12 +176,12 @@ void JpegEncoder::compressToJpeg(uint8_t *y_plane, uint8_t *u_plane, uint8_t *v_
   cinfo.err = jpeg_std_error(&jerr);
   jpeg_create_compress(&cinfo);
 
-  if (out_buffer) {
-    free(out_buffer);
-    out_buffer = nullptr;
-    out_size = 0;
-  }
-  jpeg_mem_dest(&cinfo, &out_buffer, &out_size);
+  VectorDestination dest = {};
+  dest.mgr.init_destination = init_destination;
+  dest.mgr.empty_output_buffer = empty_output_buffer;
+  dest.mgr.term_destination = term_destination;
+  dest.out = &out_buffer;
+  cinfo.dest = &dest.mgr;
 
   cinfo.image_width = thumbnail_width;
   cinfo.image_height = thumbnail_height;
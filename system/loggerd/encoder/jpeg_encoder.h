@@ -5,28 +5,62 @@
 #include <cstddef>
 #include <cstdint>
 #include <jpeglib.h>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
 #include <vector>
 #include <memory>
 #include "cereal/messaging/messaging.h"
 #include "msgq/visionipc/visionbuf.h"
 
+// thumbnails queued or being compressed, more are dropped
+const int THUMBNAIL_QUEUE_SIZE = 2;
+
+// Publishes JPEG thumbnails of camera frames. The encoder thread only copies the downscaled
+// planes, compressing and publishing happens on a worker so it doesn't stall video encoding.
 class JpegEncoder {
 public:
-  JpegEncoder(const std::string &pusblish_name, int width, int height);
+  using Publisher = std::function<void(uint32_t frame_id, uint64_t timestamp_eof, const std::vector<uint8_t> &jpeg)>;
+
+  // publishes to the publish_name service unless a publisher is given
+  JpegEncoder(const std::string &pusblish_name, int width, int height, Publisher publisher = nullptr);
   ~JpegEncoder();
-  void pushThumbnail(VisionBuf *buf, const VisionIpcBufExtra &extra);
+  // false if the queue was full and the thumbnail was dropped
+  bool pushThumbnail(VisionBuf *buf, const VisionIpcBufExtra &extra);
+  bool pushThumbnail(const uint8_t *y, const uint8_t *uv, int width, int height, int stride, const VisionIpcBufExtra &extra);
+  // waits until every queued thumbnail is published
+  void flush();
+
+  uint64_t published();
+  uint64_t dropped();
 
 private:
-  void generateThumbnail(const uint8_t *y, const uint8_t *uv, int width, int height, int stride);
+  struct Job {
+    uint32_t frame_id;
+    uint64_t timestamp_eof;
+    std::vector<uint8_t> yuv;
+  };
+
+  void generateThumbnail(const uint8_t *y, const uint8_t *uv, int width, int height, int stride, uint8_t *yuv);
   void compressToJpeg(uint8_t *y_plane, uint8_t *u_plane, uint8_t *v_plane);
+  void worker();
 
   int thumbnail_width;
   int thumbnail_height;
   std::string publish_name;
-  std::vector<uint8_t> yuv_buffer;
   std::unique_ptr<PubMaster> pm;
+  Publisher publisher;
+
+  std::mutex lock;
+  std::condition_variable cv, done_cv;
+  Job jobs[THUMBNAIL_QUEUE_SIZE];
+  std::deque<int> pending, free_jobs;
+  bool exit = false;
+  uint64_t published_ = 0, dropped_ = 0;
+  std::thread worker_thread;
 
-  // JPEG output buffer
-  unsigned char* out_buffer = nullptr;
-  unsigned long out_size = 0;
+  // JPEG output, reused by the worker
+  std::vector<uint8_t> out_buffer;
 };
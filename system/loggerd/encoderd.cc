@@ -1,5 +1,6 @@
 #include <cassert>
 
+#include "common/frame_pacing.h"
 #include "system/loggerd/loggerd.h"
 #include "system/loggerd/encoder/jpeg_encoder.h"
 
@@ -48,6 +49,10 @@ bool sync_encoders(EncoderdState *s, VisionStreamType cam_type, uint32_t frame_i
 void encoder_thread(EncoderdState *s, const LogCameraInfo &cam_info) {
   util::set_thread_name(cam_info.thread_name);
 
+#ifndef QCOM2
+  // converts every frame once for all the encoders of this camera, the V4L encoders scale in hardware
+  std::unique_ptr<FramePreprocessor> preprocessor;
+#endif
   std::vector<std::unique_ptr<Encoder>> encoders;
   VisionIpcClient vipc_client = VisionIpcClient("camerad", cam_info.stream_type, false);
 
@@ -66,8 +71,14 @@ void encoder_thread(EncoderdState *s, const LogCameraInfo &cam_info) {
       LOGW("encoder %s init %zux%zu", cam_info.thread_name, buf_info.width, buf_info.height);
       assert(buf_info.width > 0 && buf_info.height > 0);
 
+#ifndef QCOM2
+      preprocessor = std::make_unique<FramePreprocessor>(buf_info.width, buf_info.height);
+#endif
       for (const auto &encoder_info : cam_info.encoder_infos) {
         auto &e = encoders.emplace_back(new Encoder(encoder_info, buf_info.width, buf_info.height));
+#ifndef QCOM2
+        e->set_preprocessor(preprocessor.get());
+#endif
         e->encoder_open();
       }
 
@@ -78,10 +89,13 @@ void encoder_thread(EncoderdState *s, const LogCameraInfo &cam_info) {
     }
 
     bool lagging = false;
+    // every frame has to be encoded before the next one arrives
+    FramePacingMonitor pacing(cam_info.thread_name, 1e9 / MAIN_FPS);
     while (!do_exit) {
       VisionIpcBufExtra extra;
       VisionBuf* buf = vipc_client.recv(&extra);
       if (buf == nullptr) continue;
+      pacing.received(extra.frame_id, extra.timestamp_eof);
 
       // detect loop around and drop the frames
       if (buf->get_frame_id() != extra.frame_id) {
@@ -109,6 +123,9 @@ void encoder_thread(EncoderdState *s, const LogCameraInfo &cam_info) {
       }
 
       // encode a frame
+#ifndef QCOM2
+      preprocessor->process(buf->y, buf->uv, buf->stride);
+#endif
       for (int i = 0; i < encoders.size(); ++i) {
         int out_id = encoders[i]->encode_frame(buf, &extra);
 
@@ -120,6 +137,7 @@ void encoder_thread(EncoderdState *s, const LogCameraInfo &cam_info) {
       if (jpeg_encoder && (extra.frame_id % 1200 == 100)) {
         jpeg_encoder->pushThumbnail(buf, extra);
       }
+      pacing.processed();
     }
   }
 }
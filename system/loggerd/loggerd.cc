@@ -137,9 +137,12 @@ int handle_encoder_msg(LoggerdState *s, Message *msg, std::string &name, struct
       // if we aren't actually recording, don't create the writer
       if (encoder_info.record) {
         assert(encoder_info.filename != NULL);
+        bool remuxing = idx.getType() != cereal::EncodeIndex::Type::FULL_H_E_V_C;
+        // raw streams are preallocated for a segment at the target bitrate
+        size_t preallocate = remuxing ? 0 : (size_t)encoder_info.bitrate / 8 * SEGMENT_LENGTH;
         re.writer.reset(new VideoWriter(s->logger.segmentPath().c_str(),
-                                        encoder_info.filename, idx.getType() != cereal::EncodeIndex::Type::FULL_H_E_V_C,
-                                        edata.getWidth(), edata.getHeight(), encoder_info.fps, idx.getType()));
+                                        encoder_info.filename, remuxing,
+                                        edata.getWidth(), edata.getHeight(), encoder_info.fps, idx.getType(), preallocate));
         re.recording = false;
         re.audio_initialized = false;
       }
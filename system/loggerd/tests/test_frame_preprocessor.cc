@@ -0,0 +1,127 @@
+#define CATCH_CONFIG_ENABLE_BENCHMARKING
+
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "catch2/catch.hpp"
+#include "system/loggerd/encoder/frame_preprocessor.h"
+#include "third_party/libyuv/include/libyuv.h"
+
+struct NV12Frame {
+  int width, height, stride;
+  std::vector<uint8_t> buf;
+  const uint8_t *y() const { return buf.data(); }
+  const uint8_t *uv() const { return buf.data() + stride * height; }
+};
+
+static NV12Frame random_frame(int width, int height, int stride) {
+  std::mt19937 gen(width * height);
+  NV12Frame frame = {width, height, stride, std::vector<uint8_t>(stride * height * 3 / 2)};
+  for (auto &px : frame.buf) px = gen();
+  return frame;
+}
+
+// what each FfmpegEncoder did on its own: convert the full frame, then scale it
+class PerEncoderPath {
+public:
+  PerEncoderPath(int in_width, int in_height, int out_width, int out_height)
+      : in_width(in_width), in_height(in_height), out_width(out_width), out_height(out_height),
+        convert_buf(in_width * in_height * 3 / 2), out_buf(out_width * out_height * 3 / 2) {}
+
+  const uint8_t *process(const NV12Frame &frame) {
+    uint8_t *cy = convert_buf.data();
+    uint8_t *cu = cy + in_width * in_height;
+    uint8_t *cv = cu + (in_width / 2) * (in_height / 2);
+    libyuv::NV12ToI420(frame.y(), frame.stride, frame.uv(), frame.stride,
+                       cy, in_width, cu, in_width / 2, cv, in_width / 2, in_width, in_height);
+    if (out_width == in_width && out_height == in_height) return cy;
+
+    uint8_t *out_y = out_buf.data();
+    uint8_t *out_u = out_y + out_width * out_height;
+    uint8_t *out_v = out_u + (out_width / 2) * (out_height / 2);
+    libyuv::I420Scale(cy, in_width, cu, in_width / 2, cv, in_width / 2, in_width, in_height,
+                      out_y, out_width, out_u, out_width / 2, out_v, out_width / 2, out_width, out_height,
+                      libyuv::kFilterNone);
+    return out_y;
+  }
+
+private:
+  int in_width, in_height, out_width, out_height;
+  std::vector<uint8_t> convert_buf, out_buf;
+};
+
+TEST_CASE("FramePreprocessor matches converting and scaling per encoder") {
+  auto [width, height, stride] = GENERATE(std::make_tuple(1928, 1208, 2048), std::make_tuple(1344, 760, 1344));
+  std::vector<std::pair<int, int>> sizes = {
+    {width, height},
+    {526, 330},                  // qcamera
+    {width / 2, height / 2},
+    {width / 4, height / 4},
+    {width, height / 2},         // vertical only
+    {width / 2 + 2, height - 2},
+    {width * 3 / 4, height * 3 / 4},
+  };
+  // 3/8 of the chroma planes only, the luma height rounds to an odd number
+  if ((width * 3) % 16 == 0) sizes.push_back({width * 3 / 8, (height / 2 * 3 + 7) / 8 * 2});
+
+  NV12Frame frame = random_frame(width, height, stride);
+  FramePreprocessor preprocessor(width, height);
+  std::vector<int> idx;
+  for (auto [w, h] : sizes) idx.push_back(preprocessor.addOutput(w, h));
+  REQUIRE(preprocessor.addOutput(526, 330) == idx[1]);
+
+  // twice, the second pass reuses the buffers
+  for (int pass = 0; pass < 2; pass++) {
+    preprocessor.process(frame.y(), frame.uv(), frame.stride);
+    for (int i = 0; i < sizes.size(); i++) {
+      auto [w, h] = sizes[i];
+      INFO(width << "x" << height << " to " << w << "x" << h);
+      PerEncoderPath reference(width, height, w, h);
+      const uint8_t *expected = reference.process(frame);
+      REQUIRE(memcmp(preprocessor.y(idx[i]), expected, w * h * 3 / 2) == 0);
+    }
+  }
+}
+
+TEST_CASE("FramePreprocessor scales 3/4 and 3/8 with libyuv") {
+  const int width = 1344, height = 760, stride = 1344;
+  NV12Frame frame = random_frame(width, height, stride);
+
+  // without a full size output of the caller's
+  FramePreprocessor preprocessor(width, height);
+  const int three_quarters = preprocessor.addOutput(1008, 570);
+  const int three_eighths = preprocessor.addOutput(504, 286);
+  preprocessor.process(frame.y(), frame.uv(), frame.stride);
+
+  PerEncoderPath ref_three_quarters(width, height, 1008, 570), ref_three_eighths(width, height, 504, 286);
+  REQUIRE(memcmp(preprocessor.y(three_quarters), ref_three_quarters.process(frame), 1008 * 570 * 3 / 2) == 0);
+  REQUIRE(memcmp(preprocessor.y(three_eighths), ref_three_eighths.process(frame), 504 * 286 * 3 / 2) == 0);
+}
+
+TEST_CASE("FramePreprocessor bandwidth benchmark", "[.][benchmark]") {
+  const int width = 1928, height = 1208, stride = 2048;
+  NV12Frame frame = random_frame(width, height, stride);
+
+  // the road camera: main and qcamera
+  PerEncoderPath main_path(width, height, width, height), qcam_path(width, height, 526, 330);
+  FramePreprocessor preprocessor(width, height);
+  preprocessor.addOutput(width, height);
+  preprocessor.addOutput(526, 330);
+
+  // bytes moved per frame: every conversion reads and writes the full frame, scaling reads
+  // about as much as it writes
+  const size_t frame_bytes = width * height * 3 / 2;
+  const size_t qcam_bytes = 526 * 330 * 3 / 2;
+  WARN("per encoder: ~" << (4 * frame_bytes + 2 * qcam_bytes) / 1e6 << " MB/frame, "
+       << "single pass: ~" << (2 * frame_bytes + qcam_bytes) / 1e6 << " MB/frame");
+
+  BENCHMARK("per encoder convert and scale") {
+    main_path.process(frame);
+    return qcam_path.process(frame);
+  };
+  BENCHMARK("single pass") {
+    preprocessor.process(frame.y(), frame.uv(), frame.stride);
+    return preprocessor.y(1);
+  };
+}
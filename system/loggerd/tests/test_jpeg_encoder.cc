@@ -0,0 +1,121 @@
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <vector>
+
+#include "catch2/catch.hpp"
+#include "system/loggerd/encoder/jpeg_encoder.h"
+
+const int WIDTH = 1928, HEIGHT = 1208, STRIDE = 2048;
+
+struct Thumbnail {
+  uint32_t frame_id;
+  uint64_t timestamp_eof;
+  std::vector<uint8_t> jpeg;
+};
+
+// a frame whose luma is a horizontal ramp offset by the frame id, chroma is flat
+static std::vector<uint8_t> synthetic_frame(uint32_t frame_id) {
+  std::vector<uint8_t> frame(STRIDE * HEIGHT * 3 / 2, 128);
+  for (int y = 0; y < HEIGHT; y++) {
+    for (int x = 0; x < WIDTH; x++) {
+      frame[y * STRIDE + x] = (x * 200 / WIDTH + frame_id) & 0xff;
+    }
+  }
+  return frame;
+}
+
+static bool push(JpegEncoder &encoder, const std::vector<uint8_t> &frame, uint32_t frame_id) {
+  VisionIpcBufExtra extra = {};
+  extra.frame_id = frame_id;
+  extra.timestamp_eof = frame_id * 50000000ULL;
+  return encoder.pushThumbnail(frame.data(), frame.data() + STRIDE * HEIGHT, WIDTH, HEIGHT, STRIDE, extra);
+}
+
+// decodes to grayscale, returns the width and height
+static std::pair<int, int> decode(const std::vector<uint8_t> &jpeg, std::vector<uint8_t> *gray) {
+  struct jpeg_decompress_struct cinfo;
+  struct jpeg_error_mgr jerr;
+  cinfo.err = jpeg_std_error(&jerr);
+  jpeg_create_decompress(&cinfo);
+  jpeg_mem_src(&cinfo, jpeg.data(), jpeg.size());
+  jpeg_read_header(&cinfo, TRUE);
+  cinfo.out_color_space = JCS_GRAYSCALE;
+  jpeg_start_decompress(&cinfo);
+  gray->resize(cinfo.output_width * cinfo.output_height);
+  while (cinfo.output_scanline < cinfo.output_height) {
+    JSAMPROW row = gray->data() + cinfo.output_scanline * cinfo.output_width;
+    jpeg_read_scanlines(&cinfo, &row, 1);
+  }
+  std::pair<int, int> size = {cinfo.output_width, cinfo.output_height};
+  jpeg_finish_decompress(&cinfo);
+  jpeg_destroy_decompress(&cinfo);
+  return size;
+}
+
+TEST_CASE("JpegEncoder publishes thumbnails from the worker") {
+  std::vector<Thumbnail> thumbnails;
+  JpegEncoder encoder("thumbnail", WIDTH / 4, HEIGHT / 4, [&](uint32_t frame_id, uint64_t timestamp_eof, const std::vector<uint8_t> &jpeg) {
+    thumbnails.push_back({frame_id, timestamp_eof, jpeg});
+  });
+
+  for (uint32_t frame_id : {100, 1300, 2500}) {
+    auto frame = synthetic_frame(frame_id);
+    REQUIRE(push(encoder, frame, frame_id));
+    // the frame is released as soon as the push returns
+    std::fill(frame.begin(), frame.end(), 0);
+    encoder.flush();
+  }
+
+  REQUIRE(encoder.published() == 3);
+  REQUIRE(encoder.dropped() == 0);
+  REQUIRE(thumbnails.size() == 3);
+  for (const auto &t : thumbnails) {
+    REQUIRE(t.timestamp_eof == t.frame_id * 50000000ULL);
+    std::vector<uint8_t> gray;
+    auto [w, h] = decode(t.jpeg, &gray);
+    REQUIRE(w == WIDTH / 4);
+    REQUIRE(h == HEIGHT / 4);
+
+    // the ramp survives the compression, thumbnail pixel pairs are sampled from the source
+    for (int x = 8; x < w - 8; x += 40) {
+      int src_x = ((x / 2) * 4 + 1) * 2 + x % 2;
+      int expected = (src_x * 200 / WIDTH + t.frame_id) & 0xff;
+      REQUIRE(std::abs(gray[(h / 2) * w + x] - expected) <= 6);
+    }
+  }
+}
+
+TEST_CASE("JpegEncoder drops thumbnails instead of blocking") {
+  std::promise<void> release;
+  std::shared_future<void> released = release.get_future().share();
+  std::atomic<int> published = 0;
+  JpegEncoder encoder("thumbnail", WIDTH / 4, HEIGHT / 4, [&](uint32_t, uint64_t, const std::vector<uint8_t> &) {
+    // a publisher stuck on the first thumbnail
+    released.wait();
+    published++;
+  });
+
+  auto frame = synthetic_frame(0);
+  auto start = std::chrono::steady_clock::now();
+  int queued = 0;
+  for (int i = 0; i < 10; i++) {
+    queued += push(encoder, frame, i);
+  }
+  auto elapsed = std::chrono::steady_clock::now() - start;
+
+  // one being compressed and one waiting, the rest dropped without waiting for the worker
+  REQUIRE(queued == THUMBNAIL_QUEUE_SIZE);
+  REQUIRE(encoder.dropped() == 10 - THUMBNAIL_QUEUE_SIZE);
+  REQUIRE(elapsed < std::chrono::seconds(1));
+
+  release.set_value();
+  encoder.flush();
+  REQUIRE(published == THUMBNAIL_QUEUE_SIZE);
+  REQUIRE(encoder.published() == THUMBNAIL_QUEUE_SIZE);
+
+  // room again once the worker caught up
+  REQUIRE(push(encoder, frame, 11));
+  encoder.flush();
+  REQUIRE(published == THUMBNAIL_QUEUE_SIZE + 1);
+}
@@ -0,0 +1,130 @@
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "catch2/catch.hpp"
+#include "common/util.h"
+#include "system/loggerd/video_writer.h"
+
+const auto RAW = cereal::EncodeIndex::Type::FULL_H_E_V_C;
+
+// every packet has its own bytes, so any reordering or loss shows in the file
+static std::vector<uint8_t> make_packet(int n, int size) {
+  std::vector<uint8_t> packet(size);
+  for (int i = 0; i < size; i++) {
+    packet[i] = (n * 31 + i) & 0xff;
+  }
+  return packet;
+}
+
+static void write_packets(VideoWriter &writer, std::vector<uint8_t> *expected, int first, int count, int size) {
+  for (int n = first; n < first + count; n++) {
+    auto packet = make_packet(n, size);
+    writer.write(packet.data(), packet.size(), n * 50000, n == 0, n % 20 == 0);
+    expected->insert(expected->end(), packet.begin(), packet.end());
+    // the packet is copied, the caller can reuse it right away
+    std::fill(packet.begin(), packet.end(), 0);
+  }
+}
+
+TEST_CASE("VideoWriter rotates mid-stream") {
+  const std::string route = "/tmp/test_video_writer_" + util::random_string(8);
+  const std::vector<std::string> segments = {route + "--0", route + "--1"};
+  for (auto &seg : segments) REQUIRE(util::create_directories(seg, 0775));
+
+  // the first segment ends with packets still queued, they are written before the file is closed
+  std::vector<uint8_t> expected[2];
+  auto writer = std::make_unique<VideoWriter>(segments[0].c_str(), "fcamera.hevc", false, 1928, 1208, 20, RAW);
+  write_packets(*writer, &expected[0], 0, 150, 20000);
+  REQUIRE(util::file_exists(segments[0] + "/fcamera.hevc.lock"));
+  writer.reset(new VideoWriter(segments[1].c_str(), "fcamera.hevc", false, 1928, 1208, 20, RAW));
+  write_packets(*writer, &expected[1], 150, 100, 20000);
+  writer->flush();
+
+  auto stats = writer->stats();
+  REQUIRE(stats.packets == 100);
+  REQUIRE(stats.bytes == 100 * 20000);
+  REQUIRE(stats.queue_depth == 0);
+  REQUIRE(stats.max_queue_depth <= VIDEO_WRITER_QUEUE_SIZE);
+  writer.reset();
+
+  for (int i = 0; i < 2; i++) {
+    std::string content = util::read_file(segments[i] + "/fcamera.hevc");
+    REQUIRE(content.size() == expected[i].size());
+    REQUIRE(memcmp(content.data(), expected[i].data(), content.size()) == 0);
+    REQUIRE(!util::file_exists(segments[i] + "/fcamera.hevc.lock"));
+  }
+  system(("rm -rf " + route + "--*").c_str());
+}
+
+TEST_CASE("VideoWriter preallocates without changing the file size") {
+  const std::string segment = "/tmp/test_video_writer_" + util::random_string(8);
+  REQUIRE(util::create_directories(segment, 0775));
+  const size_t preallocate = 8 << 20;
+
+  std::vector<uint8_t> expected;
+  {
+    VideoWriter writer(segment.c_str(), "ecamera.hevc", false, 1928, 1208, 20, RAW, preallocate);
+    write_packets(writer, &expected, 0, 10, 1000);
+  }
+
+  struct stat st = {};
+  REQUIRE(stat((segment + "/ecamera.hevc").c_str(), &st) == 0);
+  REQUIRE(st.st_size == expected.size());
+  // the reserved blocks past the end are freed on close
+  REQUIRE(st.st_blocks * 512 < expected.size() + 64 * 1024);
+  REQUIRE(util::read_file(segment + "/ecamera.hevc") == std::string(expected.begin(), expected.end()));
+  system(("rm -rf " + segment).c_str());
+}
+
+TEST_CASE("VideoWriter accounts for write stalls") {
+  const std::string segment = "/tmp/test_video_writer_" + util::random_string(8);
+  REQUIRE(util::create_directories(segment, 0775));
+  // a fifo nobody reads from yet is a disk that stopped keeping up
+  const std::string path = segment + "/dcamera.hevc";
+  REQUIRE(mkfifo(path.c_str(), 0664) == 0);
+  int fifo = open(path.c_str(), O_RDONLY | O_NONBLOCK);
+  REQUIRE(fifo >= 0);
+
+  // enough to fill the stdio buffer, the pipe and the queue
+  const int packet_size = 64 * 1024;
+  const int count = (VIDEO_WRITER_BUFFER_SIZE + (1 << 20)) / packet_size + VIDEO_WRITER_QUEUE_SIZE + 8;
+  std::vector<uint8_t> expected;
+  auto writer = std::make_unique<VideoWriter>(segment.c_str(), "dcamera.hevc", false, 1928, 1208, 20, RAW);
+  std::thread producer([&]() { write_packets(*writer, &expected, 0, count, packet_size); });
+
+  // the producer ends up waiting on a full queue
+  auto stats = writer->stats();
+  for (int i = 0; i < 500 && stats.max_queue_depth < VIDEO_WRITER_QUEUE_SIZE; i++) {
+    util::sleep_for(10);
+    stats = writer->stats();
+  }
+  util::sleep_for(100);
+  stats = writer->stats();
+  REQUIRE(stats.max_queue_depth == VIDEO_WRITER_QUEUE_SIZE);
+  REQUIRE(stats.queue_depth == VIDEO_WRITER_QUEUE_SIZE + 1);
+
+  // drain the fifo until the writer is closed
+  fcntl(fifo, F_SETFL, 0);
+  std::string content;
+  std::thread reader([&]() {
+    char buf[65536];
+    ssize_t n;
+    while ((n = read(fifo, buf, sizeof(buf))) > 0) content.append(buf, n);
+  });
+  producer.join();
+  stats = writer->stats();
+  writer.reset();
+  reader.join();
+  close(fifo);
+
+  REQUIRE(stats.stalls > 0);
+  REQUIRE(stats.stall_ms >= 100);
+  REQUIRE(content.size() == expected.size());
+  REQUIRE(memcmp(content.data(), expected.data(), content.size()) == 0);
+  system(("rm -rf " + segment).c_str());
+}
@@ -1,10 +1,16 @@
+#include <fcntl.h>
+
+#include <algorithm>
 #include <cassert>
+#include <chrono>
+#include <cinttypes>
 
 #include "system/loggerd/video_writer.h"
 #include "common/swaglog.h"
 #include "common/util.h"
 
-VideoWriter::VideoWriter(const char *path, const char *filename, bool remuxing, int width, int height, int fps, cereal::EncodeIndex::Type codec)
+VideoWriter::VideoWriter(const char *path, const char *filename, bool remuxing, int width, int height, int fps,
+                         cereal::EncodeIndex::Type codec, size_t preallocate_bytes)
   : remuxing(remuxing) {
   vid_path = util::string_format("%s/%s", path, filename);
   lock_path = util::string_format("%s/%s.lock", path, filename);
@@ -46,7 +52,19 @@ VideoWriter::VideoWriter(const char *path, const char *filename, bool remuxing,
   } else {
     this->of = util::safe_fopen(this->vid_path.c_str(), "wb");
     assert(this->of);
+    this->of_buffer = std::make_unique<char[]>(VIDEO_WRITER_BUFFER_SIZE);
+    setvbuf(this->of, this->of_buffer.get(), _IOFBF, VIDEO_WRITER_BUFFER_SIZE);
+#ifdef __linux__
+    if (preallocate_bytes > 0) {
+      // keep the size, a file closed early doesn't end in zeros
+      int err = HANDLE_EINTR(fallocate(fileno(this->of), FALLOC_FL_KEEP_SIZE, 0, preallocate_bytes));
+      if (err != 0) LOGW("%s: fallocate failed %d", this->vid_path.c_str(), errno);
+      this->preallocated = (err == 0);
+    }
+#endif
   }
+
+  writer_thread = std::thread(&VideoWriter::write_thread, this);
 }
 
 void VideoWriter::initialize_audio(int sample_rate) {
@@ -89,6 +107,94 @@ void VideoWriter::initialize_audio(int sample_rate) {
 }
 
 void VideoWriter::write(uint8_t *data, int len, long long timestamp, bool codecconfig, bool keyframe) {
+  Packet packet = {.audio = false, .data = take_buffer(), .timestamp = timestamp,
+                   .codecconfig = codecconfig, .keyframe = keyframe, .sample_rate = 0};
+  if (data) packet.data.assign(data, data + len);
+  push(std::move(packet));
+}
+
+void VideoWriter::write_audio(uint8_t *data, int len, long long timestamp, int sample_rate) {
+  if (!remuxing) return;
+  Packet packet = {.audio = true, .data = take_buffer(), .timestamp = timestamp,
+                   .codecconfig = false, .keyframe = false, .sample_rate = sample_rate};
+  packet.data.assign(data, data + len);
+  push(std::move(packet));
+}
+
+std::vector<uint8_t> VideoWriter::take_buffer() {
+  std::lock_guard lk(lock);
+  if (spare_buffers.empty()) return {};
+  std::vector<uint8_t> buf = std::move(spare_buffers.back());
+  spare_buffers.pop_back();
+  return buf;
+}
+
+void VideoWriter::push(Packet &&packet) {
+  std::unique_lock lk(lock);
+  if (queue.size() >= VIDEO_WRITER_QUEUE_SIZE) {
+    // blocking keeps the packets in order, the queue only fills up if the disk can't keep up
+    auto start = std::chrono::steady_clock::now();
+    space_cv.wait(lk, [this]() { return queue.size() < VIDEO_WRITER_QUEUE_SIZE; });
+    double waited = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    stats_.stalls++;
+    stats_.stall_ms += waited;
+    LOGW("%s: write stalled for %.1f ms, %" PRIu64 " stalls so far", vid_path.c_str(), waited, stats_.stalls);
+  }
+  queue.push_back(std::move(packet));
+  stats_.max_queue_depth = std::max(stats_.max_queue_depth, queue.size());
+  lk.unlock();
+  cv.notify_one();
+}
+
+void VideoWriter::write_thread() {
+  util::set_thread_name("video_writer");
+  while (true) {
+    Packet packet;
+    {
+      std::unique_lock lk(lock);
+      cv.wait(lk, [this]() { return exit || !queue.empty(); });
+      // queued packets are still written on exit
+      if (queue.empty()) return;
+      packet = std::move(queue.front());
+      queue.pop_front();
+      writing = true;
+    }
+    space_cv.notify_one();
+
+    uint8_t *data = packet.data.empty() ? nullptr : packet.data.data();
+    if (packet.audio) {
+      write_audio_packet(data, packet.data.size(), packet.timestamp, packet.sample_rate);
+    } else {
+      write_packet(data, packet.data.size(), packet.timestamp, packet.codecconfig, packet.keyframe);
+    }
+
+    {
+      std::lock_guard lk(lock);
+      stats_.packets++;
+      stats_.bytes += packet.data.size();
+      writing = false;
+      if (spare_buffers.size() < VIDEO_WRITER_QUEUE_SIZE) {
+        packet.data.clear();
+        spare_buffers.push_back(std::move(packet.data));
+      }
+    }
+    done_cv.notify_all();
+  }
+}
+
+void VideoWriter::flush() {
+  std::unique_lock lk(lock);
+  done_cv.wait(lk, [this]() { return queue.empty() && !writing; });
+}
+
+VideoWriter::Stats VideoWriter::stats() {
+  std::lock_guard lk(lock);
+  Stats stats = stats_;
+  stats.queue_depth = queue.size() + writing;
+  return stats;
+}
+
+void VideoWriter::write_packet(uint8_t *data, int len, long long timestamp, bool codecconfig, bool keyframe) {
   if (of && data) {
     size_t written = util::safe_fwrite(data, 1, len, of);
     if (written != len) {
@@ -135,8 +241,7 @@ void VideoWriter::write(uint8_t *data, int len, long long timestamp, bool codecc
   }
 }
 
-void VideoWriter::write_audio(uint8_t *data, int len, long long timestamp, int sample_rate) {
-  if (!remuxing) return;
+void VideoWriter::write_audio_packet(uint8_t *data, int len, long long timestamp, int sample_rate) {
   if (!audio_initialized) {
     initialize_audio(sample_rate);
     audio_initialized = true;
@@ -212,6 +317,17 @@ void VideoWriter::process_remaining_audio() {
 }
 
 VideoWriter::~VideoWriter() {
+  {
+    std::lock_guard lk(lock);
+    exit = true;
+  }
+  cv.notify_one();
+  writer_thread.join();
+
+  Stats s = stats();
+  LOGW("encoder_close %s packets:%" PRIu64 " bytes:%" PRIu64 " max queue:%zu stalls:%" PRIu64 " (%.1f ms)", this->vid_path.c_str(),
+       s.packets, s.bytes, s.max_queue_depth, s.stalls, s.stall_ms);
+
   if (this->remuxing) {
     if (this->audio_codec_ctx) {
       process_remaining_audio();
@@ -227,6 +343,13 @@ VideoWriter::~VideoWriter() {
     avformat_free_context(this->ofmt_ctx);
   } else {
     util::safe_fflush(this->of);
+    if (this->preallocated) {
+      // give back the space reserved past what was written
+      long size = ftell(this->of);
+      if (size < 0 || HANDLE_EINTR(ftruncate(fileno(this->of), size)) != 0) {
+        LOGW("%s: ftruncate failed %d", this->vid_path.c_str(), errno);
+      }
+    }
     fclose(this->of);
     this->of = nullptr;
   }
@@ -1,7 +1,12 @@
 #pragma once
 
-#include <string>
+#include <condition_variable>
 #include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
 
 extern "C" {
 #include <libavformat/avformat.h>
@@ -10,21 +15,60 @@ extern "C" {
 
 #include "cereal/messaging/messaging.h"
 
+// packets waiting for the write thread, writes block when it is full
+const int VIDEO_WRITER_QUEUE_SIZE = 64;
+// stdio buffer of raw outputs, packets go to disk in large writes
+const size_t VIDEO_WRITER_BUFFER_SIZE = 1 << 20;
+
+// Writes and remuxes encoded packets on its own thread. write and write_audio only copy the
+// packet into a bounded queue, the packets are written in the order they were queued.
 class VideoWriter {
 public:
-  VideoWriter(const char *path, const char *filename, bool remuxing, int width, int height, int fps, cereal::EncodeIndex::Type codec);
+  struct Stats {
+    size_t queue_depth;
+    size_t max_queue_depth;
+    uint64_t packets;
+    uint64_t bytes;
+    // writes that waited for room in the queue
+    uint64_t stalls;
+    double stall_ms;
+  };
+
+  // preallocate_bytes reserves space for a raw output up front, it doesn't change the file size
+  // and what isn't written is given back on close
+  VideoWriter(const char *path, const char *filename, bool remuxing, int width, int height, int fps,
+              cereal::EncodeIndex::Type codec, size_t preallocate_bytes = 0);
   void write(uint8_t *data, int len, long long timestamp, bool codecconfig, bool keyframe);
   void write_audio(uint8_t *data, int len, long long timestamp, int sample_rate);
+  // waits until every queued packet is written
+  void flush();
+  Stats stats();
 
+  // writes the queued packets and closes the file
   ~VideoWriter();
 
 private:
+  struct Packet {
+    bool audio;
+    std::vector<uint8_t> data;
+    long long timestamp;
+    bool codecconfig, keyframe;
+    int sample_rate;
+  };
+
+  std::vector<uint8_t> take_buffer();
+  void push(Packet &&packet);
+  void write_thread();
+  void write_packet(uint8_t *data, int len, long long timestamp, bool codecconfig, bool keyframe);
+  void write_audio_packet(uint8_t *data, int len, long long timestamp, int sample_rate);
   void initialize_audio(int sample_rate);
   void encode_and_write_audio_frame(AVFrame* frame);
   void process_remaining_audio();
 
   std::string vid_path, lock_path;
   FILE *of = nullptr;
+  std::unique_ptr<char[]> of_buffer;
+  bool preallocated = false;
 
   AVCodecContext *codec_ctx;
   AVFormatContext *ofmt_ctx;
@@ -39,4 +83,14 @@ private:
   std::deque<float> audio_buffer;
 
   bool remuxing;
+
+  std::mutex lock;
+  std::condition_variable cv, space_cv, done_cv;
+  std::deque<Packet> queue;
+  // buffers of written packets, reused for the next ones
+  std::vector<std::vector<uint8_t>> spare_buffers;
+  bool writing = false;
+  bool exit = false;
+  Stats stats_ = {};
+  std::thread writer_thread;
 };
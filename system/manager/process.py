@@ -1,7 +1,6 @@
 import importlib
 import os
 import signal
-import struct
 import time
 import subprocess
 from collections.abc import Callable, ValuesView
@@ -16,7 +15,7 @@ import openpilot.system.sentry as sentry
 from openpilot.common.basedir import BASEDIR
 from openpilot.common.params import Params
 from openpilot.common.swaglog import cloudlog
-from openpilot.common.watchdog import WATCHDOG_FN
+from openpilot.common.watchdog import read_watchdog, release_watchdog
 
 ENABLE_WATCHDOG = os.getenv("NO_WATCHDOG") is None
 
@@ -74,6 +73,8 @@ class ManagerProcess(ABC):
   last_watchdog_time = 0
   watchdog_max_dt: int | None = None
   watchdog_seen = False
+  # generation of a slot left over from an exited process with the same pid
+  watchdog_stale_generation: int | None = None
   shutting_down = False
 
   @abstractmethod
@@ -88,16 +89,13 @@ class ManagerProcess(ABC):
     self.stop(sig=signal.SIGKILL)
     self.start()
 
-  def check_watchdog(self, started: bool) -> None:
+  def check_watchdog(self, started: bool, watchdog: dict[int, tuple[int, int]]) -> None:
     if self.watchdog_max_dt is None or self.proc is None:
       return
 
-    try:
-      fn = WATCHDOG_FN + str(self.proc.pid)
-      with open(fn, "rb") as f:
-        self.last_watchdog_time = struct.unpack('Q', f.read())[0]
-    except Exception:
-      pass
+    generation, last_kick = watchdog.get(self.proc.pid, (None, 0))
+    if generation is not None and generation != self.watchdog_stale_generation:
+      self.last_watchdog_time = last_kick
 
     dt = time.monotonic() - self.last_watchdog_time / 1e9
 
@@ -135,6 +133,7 @@ class ManagerProcess(ABC):
     cloudlog.info(f"{self.name} is dead with {ret}")
 
     if self.proc.exitcode is not None:
+      release_watchdog(self.proc.pid)
       self.shutting_down = False
       self.proc = None
 
@@ -191,8 +190,11 @@ class NativeProcess(ManagerProcess):
     cwd = os.path.join(BASEDIR, self.cwd)
     cloudlog.info(f"starting process {self.name}")
     self.proc = Process(name=self.name, target=self.launcher, args=(self.cmdline, cwd, self.name))
+    # read before the start, the child may kick before start() returns
+    watchdog = read_watchdog()
     self.proc.start()
     self.watchdog_seen = False
+    self.watchdog_stale_generation = watchdog.get(self.proc.pid, (None, 0))[0]
     self.shutting_down = False
 
 
@@ -225,8 +227,11 @@ class PythonProcess(ManagerProcess):
 
     cloudlog.info(f"starting python {self.module}")
     self.proc = Process(name=name, target=self.launcher, args=(self.module, self.name))
+    # read before the start, the child may kick before start() returns
+    watchdog = read_watchdog()
     self.proc.start()
     self.watchdog_seen = False
+    self.watchdog_stale_generation = watchdog.get(self.proc.pid, (None, 0))[0]
     self.shutting_down = False
 
 
@@ -281,6 +286,7 @@ def ensure_running(procs: ValuesView[ManagerProcess], started: bool, params=None
   if not_run is None:
     not_run = []
 
+  watchdog = read_watchdog()
   running = []
   for p in procs:
     if p.enabled and p.name not in not_run and p.should_run(started, params, CP):
@@ -288,7 +294,7 @@ def ensure_running(procs: ValuesView[ManagerProcess], started: bool, params=None
     else:
       p.stop(block=False)
 
-    p.check_watchdog(started)
+    p.check_watchdog(started, watchdog)
 
   for p in running:
     p.start()
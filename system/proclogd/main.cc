@@ -1,6 +1,8 @@
 
 #include <sys/resource.h>
 
+#include <sstream>
+
 #include "common/ratekeeper.h"
 #include "common/util.h"
 #include "system/proclogd/proclog.h"
@@ -10,12 +12,28 @@ ExitHandler do_exit;
 int main(int argc, char **argv) {
   setpriority(PRIO_PROCESS, 0, -15);
 
+  // fds are kept open per process and per sampled thread
+  struct rlimit rl;
+  if (getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur < rl.rlim_max) {
+    rl.rlim_cur = rl.rlim_max;
+    setrlimit(RLIMIT_NOFILE, &rl);
+  }
+
   RateKeeper rk("proclogd", 0.5);
   PubMaster publisher({"procLog"});
+  ProcSampler sampler;
+
+  // comma separated process names to sample per-thread stats for
+  std::stringstream traced(util::getenv("PROCLOG_THREADS", "camerad,pandad,selfdrive.modeld.modeld,selfdrive.controls.controlsd,selfdrive.car.card"));
+  std::vector<std::string> traced_names;
+  for (std::string name; std::getline(traced, name, ',');) {
+    if (!name.empty()) traced_names.push_back(name);
+  }
+  sampler.setThreadSampling(traced_names);
 
   while (!do_exit) {
     MessageBuilder msg;
-    buildProcLogMessage(msg);
+    buildProcLogMessage(msg, sampler);
     publisher.send("procLog", msg);
 
     rk.keepTime();
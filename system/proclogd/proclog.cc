@@ -1,13 +1,19 @@
 #include "system/proclogd/proclog.h"
 
 #include <dirent.h>
+#include <fcntl.h>
+#include <sys/resource.h>
 
+#include <algorithm>
 #include <cassert>
+#include <cerrno>
+#include <cstring>
 #include <fstream>
 #include <iterator>
 #include <sstream>
 
 #include "common/swaglog.h"
+#include "common/timing.h"
 #include "common/util.h"
 
 namespace Parser {
@@ -138,18 +144,127 @@ std::vector<std::string> cmdline(std::istream &stream) {
   return ret;
 }
 
-const ProcCache &getProcExtraInfo(int pid, const std::string &name) {
-  static std::unordered_map<pid_t, ProcCache> proc_cache;
-  ProcCache &cache = proc_cache[pid];
-  if (cache.pid != pid || cache.name != name) {
-    cache.pid = pid;
-    cache.name = name;
-    std::string proc_path = "/proc/" + std::to_string(pid);
-    cache.exe = util::readlink(proc_path + "/exe");
-    std::ifstream stream(proc_path + "/cmdline");
-    cache.cmdline = cmdline(stream);
+// skip spaces, then parse a (possibly negative) decimal integer
+template <typename T>
+static inline bool scanInt(const char *&p, const char *end, T &out) {
+  while (p < end && *p == ' ') ++p;
+  bool neg = p < end && *p == '-';
+  if (neg) ++p;
+  const char *start = p;
+  unsigned long long v = 0;
+  while (p < end && *p >= '0' && *p <= '9') {
+    v = v * 10 + (*p++ - '0');
   }
-  return cache;
+  out = neg ? (T)(-(long long)v) : (T)v;
+  return p != start;
+}
+
+static inline bool skipField(const char *&p, const char *end) {
+  while (p < end && *p == ' ') ++p;
+  const char *start = p;
+  while (p < end && *p != ' ' && *p != '\n') ++p;
+  return p != start;
+}
+
+bool procStat(std::string_view stat, ProcStat &out) {
+  auto open_paren = stat.find('(');
+  auto close_paren = stat.rfind(')');
+  if (open_paren == std::string_view::npos || close_paren == std::string_view::npos || open_paren > close_paren) {
+    return false;
+  }
+
+  const char *p = stat.data();
+  const char *end = p + stat.size();
+  if (!scanInt(p, p + open_paren, out.pid)) return false;
+  out.name.assign(stat.data() + open_paren + 1, close_paren - open_paren - 1);
+
+  p = stat.data() + close_paren + 1;
+  while (p < end && *p == ' ') ++p;
+  if (p == end) return false;
+  out.state = *p++;
+
+  // only the fields up to the processor are required, newer kernels may append more
+  bool ok = true;
+  for (int field = StatPos::state + 1; ok && field <= StatPos::processor; ++field) {
+    switch (field) {
+      case StatPos::ppid: ok = scanInt(p, end, out.ppid); break;
+      case StatPos::utime: ok = scanInt(p, end, out.utime); break;
+      case StatPos::stime: ok = scanInt(p, end, out.stime); break;
+      case StatPos::cutime: ok = scanInt(p, end, out.cutime); break;
+      case StatPos::cstime: ok = scanInt(p, end, out.cstime); break;
+      case StatPos::priority: ok = scanInt(p, end, out.priority); break;
+      case StatPos::nice: ok = scanInt(p, end, out.nice); break;
+      case StatPos::num_threads: ok = scanInt(p, end, out.num_threads); break;
+      case StatPos::starttime: ok = scanInt(p, end, out.starttime); break;
+      case StatPos::vsize: ok = scanInt(p, end, out.vms); break;
+      case StatPos::rss: ok = scanInt(p, end, out.rss); break;
+      case StatPos::processor: ok = scanInt(p, end, out.processor); break;
+      default: ok = skipField(p, end); break;
+    }
+  }
+  return ok;
+}
+
+void cpuTimes(std::string_view stat, std::vector<CPUTime> &out) {
+  out.clear();
+  // skip the first line for cpu total
+  size_t pos = stat.find('\n');
+  while (pos != std::string_view::npos && stat.compare(pos + 1, 3, "cpu") == 0) {
+    const char *p = stat.data() + pos + 4;
+    const char *end = stat.data() + stat.size();
+    CPUTime t = {};
+    if (scanInt(p, end, t.id) && scanInt(p, end, t.utime) && scanInt(p, end, t.ntime) && scanInt(p, end, t.stime) &&
+        scanInt(p, end, t.itime) && scanInt(p, end, t.iowtime) && scanInt(p, end, t.irqtime) && scanInt(p, end, t.sirqtime)) {
+      out.push_back(t);
+    }
+    pos = stat.find('\n', pos + 1);
+  }
+}
+
+void memInfo(std::string_view meminfo, MemInfo &out) {
+  static const std::pair<std::string_view, uint64_t MemInfo::*> keys[] = {
+    {"MemTotal", &MemInfo::total}, {"MemFree", &MemInfo::free}, {"MemAvailable", &MemInfo::available},
+    {"Buffers", &MemInfo::buffers}, {"Cached", &MemInfo::cached}, {"Active", &MemInfo::active},
+    {"Inactive", &MemInfo::inactive}, {"Shmem", &MemInfo::shared},
+  };
+
+  out = {};
+  size_t pos = 0;
+  while (pos < meminfo.size()) {
+    size_t eol = std::min(meminfo.find('\n', pos), meminfo.size());
+    std::string_view line = meminfo.substr(pos, eol - pos);
+    size_t colon = line.find(':');
+    if (colon != std::string_view::npos) {
+      std::string_view key = line.substr(0, colon);
+      for (auto &[name, field] : keys) {
+        if (key == name) {
+          const char *p = line.data() + colon + 1;
+          uint64_t val = 0;
+          if (scanInt(p, line.data() + line.size(), val)) out.*field = val * 1024;
+          break;
+        }
+      }
+    }
+    pos = eol + 1;
+  }
+}
+
+bool schedStat(std::string_view schedstat, SchedStat &out) {
+  const char *p = schedstat.data();
+  const char *end = p + schedstat.size();
+  return scanInt(p, end, out.run_ns) && scanInt(p, end, out.wait_ns) && scanInt(p, end, out.timeslices);
+}
+
+bool ctxtSwitches(std::string_view status, CtxtSwitches &out) {
+  auto scanKey = [&status](std::string_view key, uint64_t &val) {
+    size_t pos = status.find(key);
+    if (pos == std::string_view::npos) return false;
+    const char *p = status.data() + pos + key.size();
+    while (p < status.data() + status.size() && *p == '\t') ++p;
+    return scanInt(p, status.data() + status.size(), val);
+  };
+  return scanKey("\nvoluntary_ctxt_switches:", out.voluntary) &&
+         scanKey("\nnonvoluntary_ctxt_switches:", out.involuntary);
 }
 
 }  // namespace Parser
@@ -157,10 +272,331 @@ const ProcCache &getProcExtraInfo(int pid, const std::string &name) {
 const double jiffy = sysconf(_SC_CLK_TCK);
 const size_t page_size = sysconf(_SC_PAGE_SIZE);
 
-void buildCPUTimes(cereal::ProcLog::Builder &builder) {
-  std::ifstream stream("/proc/stat");
-  std::vector<CPUTime> stats = Parser::cpuTimes(stream);
+// fds left for the rest of the process and for files read without a held fd
+const size_t fd_reserve = 64;
+
+static size_t fdBudget() {
+  struct rlimit rl = {};
+  if (getrlimit(RLIMIT_NOFILE, &rl) != 0) return 1024 - fd_reserve;
+  const size_t limit = std::min<rlim_t>(rl.rlim_cur, 1 << 20);
+  return limit > 2 * fd_reserve ? limit - fd_reserve : limit / 2;
+}
+
+ProcSampler::ProcSampler(const std::string &root) : root_(root), fd_budget_(fdBudget()) {
+  dir_ = opendir(root_.c_str());
+  assert(dir_);
+  stat_fd_ = open((root_ + "/stat").c_str(), O_RDONLY | O_CLOEXEC);
+  meminfo_fd_ = open((root_ + "/meminfo").c_str(), O_RDONLY | O_CLOEXEC);
+}
+
+ProcSampler::~ProcSampler() {
+  for (auto &[pid, e] : entries_) {
+    release(e);
+  }
+  if (stat_fd_ >= 0) close(stat_fd_);
+  if (meminfo_fd_ >= 0) close(meminfo_fd_);
+  closedir(dir_);
+}
+
+int ProcSampler::openHeld(const char *path, int flags) {
+  if (held_fds_ >= fd_budget_) {
+    errno = EMFILE;
+    return -1;
+  }
+
+  int fd = openat(dirfd(dir_), path, flags | O_CLOEXEC);
+  if (fd >= 0) {
+    ++held_fds_;
+  } else if (errno == EMFILE || errno == ENFILE) {
+    shrinkFdBudget();
+  }
+  return fd;
+}
+
+void ProcSampler::closeHeld(int &fd) {
+  if (fd >= 0) {
+    close(fd);
+    --held_fds_;
+  }
+  fd = -1;
+}
+
+void ProcSampler::shrinkFdBudget() {
+  const int err = errno;
+  fd_budget_ = std::min(fdBudget(), held_fds_ > fd_reserve ? held_fds_ - fd_reserve : 0);
+  LOGW("proclogd: %s with %zu fds held, keeping at most %zu", strerror(err), held_fds_, fd_budget_);
+
+  // the state of the processes is kept, their files are read by path until fds are back in the budget
+  for (auto &[pid, e] : entries_) {
+    if (held_fds_ <= fd_budget_) break;
+    for (auto &[tid, t] : e.threads) {
+      release(t);
+    }
+    if (e.task_dir) {
+      closedir(e.task_dir);
+      e.task_dir = nullptr;
+      --held_fds_;
+    }
+    closeHeld(e.fd);
+  }
+  errno = err;
+}
+
+void ProcSampler::release(ThreadEntry &t) {
+  closeHeld(t.stat_fd);
+  closeHeld(t.schedstat_fd);
+  closeHeld(t.status_fd);
+}
+
+void ProcSampler::releaseThreads(Entry &e) {
+  for (auto &[tid, t] : e.threads) {
+    release(t);
+  }
+  e.threads.clear();
+  if (e.task_dir) {
+    closedir(e.task_dir);
+    --held_fds_;
+  }
+  e.task_dir = nullptr;
+}
+
+void ProcSampler::release(Entry &e) {
+  releaseThreads(e);
+  closeHeld(e.fd);
+}
+
+void ProcSampler::setThreadSampling(const std::vector<std::string> &names, size_t max_threads) {
+  traced_names_ = names;
+  max_threads_ = max_threads;
+  for (auto &[pid, e] : entries_) {
+    e.traced = isTraced(e.stat.name);
+    if (!e.traced) releaseThreads(e);
+  }
+}
+
+bool ProcSampler::isTraced(const std::string &name) const {
+  // comm is truncated to 15 characters, e.g. "selfdrive.contr" for selfdrive.controls.controlsd
+  return std::any_of(traced_names_.begin(), traced_names_.end(), [&name](const std::string &n) {
+    return n == name || (name.size() == 15 && util::starts_with(n, name));
+  });
+}
+
+std::string_view ProcSampler::readAt(int fd) {
+  ssize_t n = fd >= 0 ? HANDLE_EINTR(pread(fd, buf_, sizeof(buf_), 0)) : -1;
+  return n > 0 ? std::string_view(buf_, n) : std::string_view();
+}
+
+std::string_view ProcSampler::readHeld(int &fd, const char *path) {
+  if (fd < 0 && (fd = openHeld(path)) < 0) {
+    // gone, or out of fds
+    if (errno != EMFILE && errno != ENFILE) return {};
+    ++read_by_path_;
+    int tmp_fd = openat(dirfd(dir_), path, O_RDONLY | O_CLOEXEC);
+    std::string_view content = readAt(tmp_fd);
+    if (tmp_fd >= 0) close(tmp_fd);
+    return content;
+  }
+  return readAt(fd);
+}
+
+void ProcSampler::loadExtraInfo(int pid, Entry &e) {
+  std::string proc_path = root_ + "/" + std::to_string(pid);
+  e.extra.pid = pid;
+  e.extra.name = e.stat.name;
+  e.extra.exe = util::readlink(proc_path + "/exe");
+  std::ifstream stream(proc_path + "/cmdline");
+  e.extra.cmdline = Parser::cmdline(stream);
+
+  e.traced = isTraced(e.stat.name);
+  if (!e.traced) releaseThreads(e);
+}
+
+bool ProcSampler::sample(int pid, Entry &e, std::string_view stat, double dt) {
+  const unsigned long prev_ticks = e.stat.utime + e.stat.stime;
+  const long prev_rss = e.stat.rss;
+  const unsigned long long prev_starttime = e.stat.starttime;
+
+  // an exited process keeps failing reads on its old fd, even if the pid got reused
+  if (!Parser::procStat(stat, e.stat) || e.stat.pid != pid) {
+    return false;
+  }
+
+  if (!e.sampled || e.stat.starttime != prev_starttime) {
+    e.cpu_usage = 0;
+    e.rss_delta = 0;
+  } else {
+    unsigned long ticks = (e.stat.utime + e.stat.stime) - prev_ticks;
+    e.cpu_usage = dt > 0 ? (ticks / jiffy) / dt * 100. : 0;
+    e.rss_delta = (int64_t)(e.stat.rss - prev_rss) * (int64_t)page_size;
+  }
+
+  // name changes after exec
+  if (!e.sampled || e.extra.name != e.stat.name || e.stat.starttime != prev_starttime) {
+    loadExtraInfo(pid, e);
+  }
+  e.sampled = true;
+  return true;
+}
+
+bool ProcSampler::sampleThread(int pid, int tid, ThreadEntry &t, double dt) {
+  const unsigned long prev_ticks = t.stat.utime + t.stat.stime;
+  const unsigned long long prev_starttime = t.stat.starttime;
+  const SchedStat prev_sched = t.sched;
+  const CtxtSwitches prev_ctxt = t.ctxt;
+
+  // relative to root_, task dirs can be closed when the fd budget shrinks
+  char path[64];
+  auto read = [&](int &fd, const char *file) {
+    if (fd < 0) snprintf(path, sizeof(path), "%d/task/%d/%s", pid, tid, file);
+    return readHeld(fd, path);
+  };
+  if (!Parser::procStat(read(t.stat_fd, "stat"), t.stat) || t.stat.pid != tid) {
+    return false;
+  }
+  // schedstat is missing on kernels without CONFIG_SCHEDSTATS
+  bool has_sched = Parser::schedStat(read(t.schedstat_fd, "schedstat"), t.sched);
+  if (!has_sched) t.sched = {};
+  if (!Parser::ctxtSwitches(read(t.status_fd, "status"), t.ctxt)) t.ctxt = {};
+
+  t.pid = pid;
+  if (!t.sampled || t.stat.starttime != prev_starttime || dt <= 0) {
+    t.cpu_usage = t.run_queue_wait = t.avg_run_queue_wait = 0;
+    t.voluntary_ctxt_switches = t.involuntary_ctxt_switches = 0;
+  } else {
+    if (has_sched) {
+      t.cpu_usage = (t.sched.run_ns - prev_sched.run_ns) * 1e-9 / dt * 100.;
+    } else {
+      t.cpu_usage = ((t.stat.utime + t.stat.stime - prev_ticks) / jiffy) / dt * 100.;
+    }
+    const uint64_t wait_ns = t.sched.wait_ns - prev_sched.wait_ns;
+    const uint64_t timeslices = t.sched.timeslices - prev_sched.timeslices;
+    t.run_queue_wait = wait_ns * 1e-9 / dt;
+    t.avg_run_queue_wait = timeslices > 0 ? wait_ns * 1e-9 / timeslices : 0;
+    t.voluntary_ctxt_switches = (t.ctxt.voluntary - prev_ctxt.voluntary) / dt;
+    t.involuntary_ctxt_switches = (t.ctxt.involuntary - prev_ctxt.involuntary) / dt;
+  }
+  t.sampled = true;
+  return true;
+}
+
+void ProcSampler::sampleThreads(int pid, Entry &e, double dt) {
+  char path[64];
+  snprintf(path, sizeof(path), "%d/task", pid);
+  DIR *task_dir = e.task_dir;
+  if (!task_dir) {
+    // past the fd budget the task dir is only open while listing it
+    int fd = openHeld(path, O_RDONLY | O_DIRECTORY);
+    const bool held = fd >= 0;
+    if (!held) fd = openat(dirfd(dir_), path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0 || !(task_dir = fdopendir(fd))) {
+      if (held) closeHeld(fd);
+      else if (fd >= 0) close(fd);
+      return;
+    }
+    if (held) e.task_dir = task_dir;
+  }
+
+  tids_.clear();
+  rewinddir(task_dir);
+  char *p_end;
+  struct dirent *de = NULL;
+  while ((de = readdir(task_dir))) {
+    int tid = strtol(de->d_name, &p_end, 10);
+    if (p_end == de->d_name || *p_end != '\0') continue;
+    tids_.push_back(tid);
+  }
+  if (task_dir != e.task_dir) closedir(task_dir);
+
+  // bound the cost of processes with many threads. The lowest tids are the main thread and
+  // the ones started with the process, so the selection stays the same while others come and go
+  const size_t num_threads = tids_.size();
+  const bool truncated = num_threads > max_threads_;
+  if (truncated) {
+    std::nth_element(tids_.begin(), tids_.begin() + max_threads_, tids_.end());
+    tids_.resize(max_threads_);
+    if (!e.threads_truncated) {
+      LOGW("proclogd: %s has %zu threads, sampling the %zu with the lowest tids", e.stat.name.c_str(), num_threads, max_threads_);
+    }
+  }
+  e.threads_truncated = truncated;
 
+  for (int tid : tids_) {
+    ThreadEntry &t = e.threads[tid];
+    if (sampleThread(pid, tid, t, dt)) {
+      t.generation = generation_;
+      threads_.push_back(&t);
+    }
+  }
+
+  for (auto it = e.threads.begin(); it != e.threads.end();) {
+    if (it->second.generation != generation_) {
+      release(it->second);
+      it = e.threads.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+void ProcSampler::update() {
+  const uint64_t now = nanos_since_boot();
+  const double dt = last_sample_ns_ > 0 ? (now - last_sample_ns_) * 1e-9 : 0;
+  last_sample_ns_ = now;
+  ++generation_;
+  read_by_path_ = 0;
+
+  procs_.clear();
+  threads_.clear();
+  rewinddir(dir_);
+  char path[64];
+  char *p_end;
+  struct dirent *de = NULL;
+  while ((de = readdir(dir_))) {
+    if (de->d_type != DT_DIR && de->d_type != DT_UNKNOWN) continue;
+    int pid = strtol(de->d_name, &p_end, 10);
+    if (p_end == de->d_name || *p_end != '\0') continue;
+
+    auto [it, inserted] = entries_.try_emplace(pid);
+    Entry &e = it->second;
+    for (int attempt = 0; attempt < 2; ++attempt) {
+      if (e.fd < 0) snprintf(path, sizeof(path), "%d/stat", pid);
+      if (sample(pid, e, readHeld(e.fd, path), dt)) {
+        e.generation = generation_;
+        break;
+      }
+      // stale fd of an exited process, reopen in case the pid was reused
+      release(e);
+      e = Entry{};
+    }
+    if (e.generation == generation_) {
+      procs_.push_back(&e);
+      if (e.traced) sampleThreads(pid, e, dt);
+    }
+  }
+
+  for (auto it = entries_.begin(); it != entries_.end();) {
+    if (it->second.generation != generation_) {
+      release(it->second);
+      it = entries_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+  std::sort(procs_.begin(), procs_.end(), [](auto a, auto b) { return a->stat.pid < b->stat.pid; });
+  std::sort(threads_.begin(), threads_.end(), [](auto a, auto b) {
+    return std::tie(a->pid, a->stat.pid) < std::tie(b->pid, b->stat.pid);
+  });
+
+  if ((read_by_path_ > 0) != reading_by_path_) {
+    reading_by_path_ = read_by_path_ > 0;
+    LOGW("proclogd: %zu files read without a held fd, %zu fds held", read_by_path_, held_fds_);
+  }
+
+  Parser::cpuTimes(readAt(stat_fd_), cpu_times_);
+  Parser::memInfo(readAt(meminfo_fd_), mem_info_);
+}
+
+void buildCPUTimes(cereal::ProcLog::Builder &builder, const std::vector<CPUTime> &stats) {
   auto log_cpu_times = builder.initCpuTimes(stats.size());
   for (int i = 0; i < stats.size(); ++i) {
     auto l = log_cpu_times[i];
@@ -176,36 +612,23 @@ void buildCPUTimes(cereal::ProcLog::Builder &builder) {
   }
 }
 
-void buildMemInfo(cereal::ProcLog::Builder &builder) {
-  std::ifstream stream("/proc/meminfo");
-  auto mem_info = Parser::memInfo(stream);
-
+void buildMemInfo(cereal::ProcLog::Builder &builder, const MemInfo &mem_info) {
   auto mem = builder.initMem();
-  mem.setTotal(mem_info["MemTotal:"]);
-  mem.setFree(mem_info["MemFree:"]);
-  mem.setAvailable(mem_info["MemAvailable:"]);
-  mem.setBuffers(mem_info["Buffers:"]);
-  mem.setCached(mem_info["Cached:"]);
-  mem.setActive(mem_info["Active:"]);
-  mem.setInactive(mem_info["Inactive:"]);
-  mem.setShared(mem_info["Shmem:"]);
+  mem.setTotal(mem_info.total);
+  mem.setFree(mem_info.free);
+  mem.setAvailable(mem_info.available);
+  mem.setBuffers(mem_info.buffers);
+  mem.setCached(mem_info.cached);
+  mem.setActive(mem_info.active);
+  mem.setInactive(mem_info.inactive);
+  mem.setShared(mem_info.shared);
 }
 
-void buildProcs(cereal::ProcLog::Builder &builder) {
-  auto pids = Parser::pids();
-  std::vector<ProcStat> proc_stats;
-  proc_stats.reserve(pids.size());
-  for (int pid : pids) {
-    std::string path = "/proc/" + std::to_string(pid) + "/stat";
-    if (auto stat = Parser::procStat(util::read_file(path))) {
-      proc_stats.push_back(*stat);
-    }
-  }
-
+void buildProcs(cereal::ProcLog::Builder &builder, const std::vector<const ProcSampler::Proc *> &proc_stats) {
   auto procs = builder.initProcs(proc_stats.size());
   for (size_t i = 0; i < proc_stats.size(); i++) {
     auto l = procs[i];
-    const ProcStat &r = proc_stats[i];
+    const ProcStat &r = proc_stats[i]->stat;
     l.setPid(r.pid);
     l.setState(r.state);
     l.setPpid(r.ppid);
@@ -221,8 +644,10 @@ void buildProcs(cereal::ProcLog::Builder &builder) {
     l.setMemRss((uint64_t)r.rss * page_size);
     l.setProcessor(r.processor);
     l.setName(r.name);
+    l.setCpuUsage(proc_stats[i]->cpu_usage);
+    l.setMemRssDelta(proc_stats[i]->rss_delta);
 
-    const ProcCache &extra_info = Parser::getProcExtraInfo(r.pid, r.name);
+    const ProcCache &extra_info = proc_stats[i]->extra;
     l.setExe(extra_info.exe);
     auto lcmdline = l.initCmdline(extra_info.cmdline.size());
     for (size_t j = 0; j < lcmdline.size(); j++) {
@@ -231,9 +656,31 @@ void buildProcs(cereal::ProcLog::Builder &builder) {
   }
 }
 
-void buildProcLogMessage(MessageBuilder &msg) {
+void buildThreads(cereal::ProcLog::Builder &builder, const std::vector<const ProcSampler::Thread *> &threads) {
+  auto lthreads = builder.initThreads(threads.size());
+  for (size_t i = 0; i < threads.size(); i++) {
+    auto l = lthreads[i];
+    const ProcSampler::Thread &t = *threads[i];
+    l.setPid(t.pid);
+    l.setTid(t.stat.pid);
+    l.setName(t.stat.name);
+    l.setState(t.stat.state);
+    l.setProcessor(t.stat.processor);
+    l.setPriority(t.stat.priority);
+    l.setCpuUsage(t.cpu_usage);
+    l.setRunQueueWait(t.run_queue_wait);
+    l.setAvgRunQueueWait(t.avg_run_queue_wait);
+    l.setVoluntaryCtxtSwitches(t.voluntary_ctxt_switches);
+    l.setInvoluntaryCtxtSwitches(t.involuntary_ctxt_switches);
+  }
+}
+
+void buildProcLogMessage(MessageBuilder &msg, ProcSampler &sampler) {
+  sampler.update();
+
   auto procLog = msg.initEvent().initProcLog();
-  buildProcs(procLog);
-  buildCPUTimes(procLog);
-  buildMemInfo(procLog);
+  buildProcs(procLog, sampler.procs());
+  buildCPUTimes(procLog, sampler.cpuTimes());
+  buildMemInfo(procLog, sampler.memInfo());
+  buildThreads(procLog, sampler.threads());
 }
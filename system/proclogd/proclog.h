@@ -1,5 +1,9 @@
+#include <dirent.h>
+#include <fcntl.h>
+
 #include <optional>
 #include <string>
+#include <string_view>
 #include <unordered_map>
 #include <vector>
 
@@ -11,6 +15,19 @@ struct CPUTime {
   unsigned long iowtime, irqtime, sirqtime;
 };
 
+struct MemInfo {
+  uint64_t total, free, available, buffers, cached;
+  uint64_t active, inactive, shared;
+};
+
+struct SchedStat {
+  uint64_t run_ns, wait_ns, timeslices;
+};
+
+struct CtxtSwitches {
+  uint64_t voluntary, involuntary;
+};
+
 struct ProcCache {
   int pid;
   std::string name, exe;
@@ -33,8 +50,106 @@ std::optional<ProcStat> procStat(std::string stat);
 std::vector<std::string> cmdline(std::istream &stream);
 std::vector<CPUTime> cpuTimes(std::istream &stream);
 std::unordered_map<std::string, uint64_t> memInfo(std::istream &stream);
-const ProcCache &getProcExtraInfo(int pid, const std::string &name);
+
+// in-place scanners used by ProcSampler, these don't allocate once the outputs are warmed up
+bool procStat(std::string_view stat, ProcStat &out);
+void cpuTimes(std::string_view stat, std::vector<CPUTime> &out);
+void memInfo(std::string_view meminfo, MemInfo &out);
+bool schedStat(std::string_view schedstat, SchedStat &out);
+bool ctxtSwitches(std::string_view status, CtxtSwitches &out);
 
 };  // namespace Parser
 
-void buildProcLogMessage(MessageBuilder &msg);
+// Samples processes under a /proc root. File descriptors are kept open
+// across samples, so steady state costs one pread per process and pid
+// churn is handled by only opening new and closing exited processes.
+// Threads of the processes passed to setThreadSampling are sampled too.
+// The fds held open stay within a budget below RLIMIT_NOFILE, files past
+// it are opened, read and closed every sample instead.
+class ProcSampler {
+public:
+  struct Proc {
+    ProcStat stat = {};
+    ProcCache extra = {};
+    float cpu_usage = 0;    // percent of one core since the previous sample
+    int64_t rss_delta = 0;  // change of resident memory in bytes since the previous sample
+  };
+
+  // rates are since the previous sample
+  struct Thread {
+    int pid = 0;
+    ProcStat stat = {};
+    SchedStat sched = {};
+    CtxtSwitches ctxt = {};
+    float cpu_usage = 0;                // percent of one core
+    float run_queue_wait = 0;           // seconds spent waiting on a run queue per second
+    float avg_run_queue_wait = 0;       // seconds waited per timeslice
+    float voluntary_ctxt_switches = 0;  // per second
+    float involuntary_ctxt_switches = 0;
+  };
+
+  explicit ProcSampler(const std::string &root = "/proc");
+  ~ProcSampler();
+  // sample the threads of processes with these names, at most max_threads per process,
+  // the ones with the lowest tids
+  void setThreadSampling(const std::vector<std::string> &names, size_t max_threads = 64);
+  void update();
+  inline const std::vector<const Proc *> &procs() const { return procs_; }
+  inline const std::vector<const Thread *> &threads() const { return threads_; }
+  inline const std::vector<CPUTime> &cpuTimes() const { return cpu_times_; }
+  inline const MemInfo &memInfo() const { return mem_info_; }
+
+private:
+  struct ThreadEntry : Thread {
+    int stat_fd = -1, schedstat_fd = -1, status_fd = -1;
+    bool sampled = false;
+    uint64_t generation = 0;
+  };
+  struct Entry : Proc {
+    int fd = -1;
+    bool sampled = false;
+    bool traced = false;
+    uint64_t generation = 0;
+    DIR *task_dir = nullptr;
+    bool threads_truncated = false;
+    std::unordered_map<int, ThreadEntry> threads;
+  };
+  bool sample(int pid, Entry &e, std::string_view stat, double dt);
+  bool sampleThread(int pid, int tid, ThreadEntry &t, double dt);
+  void sampleThreads(int pid, Entry &e, double dt);
+  void loadExtraInfo(int pid, Entry &e);
+  bool isTraced(const std::string &name) const;
+  std::string_view readAt(int fd);
+  // reads a file under root_, opening fd first if it isn't open. Past the fd
+  // budget the file is opened, read and closed again
+  std::string_view readHeld(int &fd, const char *path);
+  // opens a file under root_ to keep, -1 past the fd budget
+  int openHeld(const char *path, int flags = O_RDONLY);
+  void closeHeld(int &fd);
+  // after EMFILE or ENFILE, lowers the budget and closes held fds down to it
+  void shrinkFdBudget();
+  void release(ThreadEntry &t);
+  void release(Entry &e);
+  void releaseThreads(Entry &e);
+
+  const std::string root_;
+  DIR *dir_ = nullptr;
+  int stat_fd_ = -1, meminfo_fd_ = -1;
+  uint64_t generation_ = 0;
+  uint64_t last_sample_ns_ = 0;
+  std::unordered_map<int, Entry> entries_;
+  std::vector<const Proc *> procs_;
+  std::vector<const Thread *> threads_;
+  std::vector<std::string> traced_names_;
+  size_t max_threads_ = 0;
+  std::vector<int> tids_;
+  size_t held_fds_ = 0, fd_budget_ = 0;
+  // files read without a held fd in the last update
+  size_t read_by_path_ = 0;
+  bool reading_by_path_ = false;
+  std::vector<CPUTime> cpu_times_;
+  MemInfo mem_info_ = {};
+  char buf_[4096];
+};
+
+void buildProcLogMessage(MessageBuilder &msg, ProcSampler &sampler);
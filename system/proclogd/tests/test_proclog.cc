@@ -1,10 +1,63 @@
 #define CATCH_CONFIG_MAIN
+#define CATCH_CONFIG_ENABLE_BENCHMARKING
+#include <sys/resource.h>
+
 #include "catch2/catch.hpp"
 #include "common/util.h"
 #include "system/proclogd/proclog.h"
 
 const std::string allowed_states = "RSDTZtWXxKWPI";
 
+// a synthetic /proc tree in a temporary directory
+struct ProcFixture {
+  ProcFixture() {
+    char tmpl[] = "/tmp/proclog_fixture_XXXXXX";
+    root = mkdtemp(tmpl);
+    write("stat", "cpu  0 0 0 0 0 0 0 0 0 0\ncpu0 1 2 3 4 5 6 7 8 9 10\ncpu1 1 2 3 4 5 6 7 8 9 10\nintr 0 0 0\n");
+    write("meminfo", "MemTotal:    1024 kB\nMemFree:    2048 kB\nActive(anon):   1 kB\nActive:   512 kB\nShmem:   16 kB\n");
+  }
+  ~ProcFixture() { std::system(("rm -rf " + root).c_str()); }
+
+  void write(const std::string &path, const std::string &content) {
+    std::string fn = root + "/" + path;
+    REQUIRE(util::write_file(fn.c_str(), content.data(), content.size(), O_WRONLY | O_CREAT | O_TRUNC) == 0);
+  }
+  static std::string statString(int pid, const std::string &name, unsigned long utime, unsigned long stime, long rss, unsigned long long starttime) {
+    return util::string_format(
+      "%d (%s) S 1 %d %d 0 -1 4194368 0 0 0 0 %lu %lu 0 0 20 0 1 0 %llu 8192000 %ld 18446744073709551615 "
+      "1 1 0 0 0 0 0 0 0 0 0 0 17 3 0 0 0 0 0 0 0 0 0 0 0 0 0",
+      pid, name.c_str(), pid, pid, utime, stime, starttime, rss);
+  }
+  void setProc(int pid, const std::string &name, unsigned long utime, unsigned long stime, long rss, unsigned long long starttime = 100) {
+    util::create_directories(root + "/" + std::to_string(pid), 0775);
+    write(std::to_string(pid) + "/stat", statString(pid, name, utime, stime, rss, starttime));
+    write(std::to_string(pid) + "/cmdline", name + std::string("\0--flag\0", 8));
+  }
+  void setThread(int pid, int tid, const std::string &name, uint64_t run_ns, uint64_t wait_ns, uint64_t timeslices,
+                 uint64_t voluntary, uint64_t involuntary) {
+    std::string task = std::to_string(pid) + "/task/" + std::to_string(tid);
+    util::create_directories(root + "/" + task, 0775);
+    write(task + "/stat", statString(tid, name, run_ns / 10000000, 0, 0, 100));
+    write(task + "/schedstat", util::string_format("%lu %lu %lu\n", run_ns, wait_ns, timeslices));
+    write(task + "/status", util::string_format("Name:\t%s\nvoluntary_ctxt_switches:\t%lu\nnonvoluntary_ctxt_switches:\t%lu\n",
+                                                name.c_str(), voluntary, involuntary));
+  }
+  void removeProc(int pid) {
+    // reads on an open stat file of an exited process fail
+    write(std::to_string(pid) + "/stat", "");
+    std::system(("rm -rf " + root + "/" + std::to_string(pid)).c_str());
+  }
+
+  std::string root;
+};
+
+const ProcSampler::Proc *findProc(const ProcSampler &sampler, int pid) {
+  for (auto p : sampler.procs()) {
+    if (p->stat.pid == pid) return p;
+  }
+  return nullptr;
+}
+
 TEST_CASE("Parser::procStat") {
   SECTION("from string") {
     const std::string stat_str =
@@ -29,6 +82,27 @@ TEST_CASE("Parser::procStat") {
     REQUIRE(stat->vms == 830029824);
     REQUIRE(stat->rss == 62214);
     REQUIRE(stat->processor == 2);
+
+    ProcStat scanned = {};
+    REQUIRE(Parser::procStat(std::string_view(stat_str), scanned));
+    REQUIRE(scanned.pid == stat->pid);
+    REQUIRE(scanned.name == stat->name);
+    REQUIRE(scanned.state == stat->state);
+    REQUIRE(scanned.ppid == stat->ppid);
+    REQUIRE(scanned.utime == stat->utime);
+    REQUIRE(scanned.stime == stat->stime);
+    REQUIRE(scanned.priority == stat->priority);
+    REQUIRE(scanned.num_threads == stat->num_threads);
+    REQUIRE(scanned.starttime == stat->starttime);
+    REQUIRE(scanned.vms == stat->vms);
+    REQUIRE(scanned.rss == stat->rss);
+    REQUIRE(scanned.processor == stat->processor);
+  }
+  SECTION("malformed") {
+    ProcStat scanned = {};
+    REQUIRE_FALSE(Parser::procStat(std::string_view(""), scanned));
+    REQUIRE_FALSE(Parser::procStat(std::string_view("1 (init"), scanned));
+    REQUIRE_FALSE(Parser::procStat(std::string_view("1 (init) S 0 1 1 0"), scanned));
   }
   SECTION("all processes") {
     std::vector<int> pids = Parser::pids();
@@ -36,9 +110,17 @@ TEST_CASE("Parser::procStat") {
     for (int pid : pids) {
       std::string stat_path = "/proc/" + std::to_string(pid) + "/stat";
       INFO(stat_path);
-      if (auto stat = Parser::procStat(util::read_file(stat_path))) {
+      std::string stat_str = util::read_file(stat_path);
+      if (auto stat = Parser::procStat(stat_str)) {
         REQUIRE(stat->pid == pid);
         REQUIRE(allowed_states.find(stat->state) != std::string::npos);
+
+        ProcStat scanned = {};
+        REQUIRE(Parser::procStat(std::string_view(stat_str), scanned));
+        REQUIRE(scanned.pid == stat->pid);
+        REQUIRE(scanned.name == stat->name);
+        REQUIRE(scanned.starttime == stat->starttime);
+        REQUIRE(scanned.processor == stat->processor);
       } else {
         REQUIRE(util::file_exists(stat_path) == false);
       }
@@ -65,6 +147,15 @@ TEST_CASE("Parser::cpuTimes") {
       REQUIRE(stats[i].irqtime == 6);
       REQUIRE(stats[i].sirqtime == 7);
     }
+
+    std::vector<CPUTime> scanned;
+    Parser::cpuTimes(std::string_view(stat), scanned);
+    REQUIRE(scanned.size() == 2);
+    for (int i = 0; i < scanned.size(); ++i) {
+      REQUIRE(scanned[i].id == i);
+      REQUIRE(scanned[i].utime == 1);
+      REQUIRE(scanned[i].sirqtime == 7);
+    }
   }
   SECTION("all cpus") {
     std::istringstream stream(util::read_file("/proc/stat"));
@@ -82,6 +173,12 @@ TEST_CASE("Parser::memInfo") {
     auto meminfo = Parser::memInfo(stream);
     REQUIRE(meminfo["MemTotal:"] == 1024 * 1024);
     REQUIRE(meminfo["MemFree:"] == 2048 * 1024);
+
+    MemInfo scanned = {};
+    Parser::memInfo("MemTotal:    1024 kb\nActive(anon):    1 kb\nActive:    2048 kb\n", scanned);
+    REQUIRE(scanned.total == 1024 * 1024);
+    REQUIRE(scanned.active == 2048 * 1024);
+    REQUIRE(scanned.free == 0);
   }
   SECTION("from /proc/meminfo") {
     std::string require_keys[] = {"MemTotal:", "MemFree:", "MemAvailable:", "Buffers:", "Cached:", "Active:", "Inactive:", "Shmem:"};
@@ -109,9 +206,249 @@ TEST_CASE("Parser::cmdline") {
   test_cmdline(std::string("a\0b\0c\0\0\0", 9), {"a", "b", "c"});
 }
 
+TEST_CASE("ProcSampler") {
+  ProcFixture fixture;
+  fixture.setProc(1, "init", 10, 10, 100);
+  fixture.setProc(20, "camerad", 100, 50, 1000);
+
+  ProcSampler sampler(fixture.root);
+  sampler.update();
+  REQUIRE(sampler.procs().size() == 2);
+  REQUIRE(sampler.cpuTimes().size() == 2);
+  REQUIRE(sampler.memInfo().total == 1024 * 1024);
+  REQUIRE(sampler.memInfo().active == 512 * 1024);
+  REQUIRE(sampler.memInfo().shared == 16 * 1024);
+
+  auto camerad = findProc(sampler, 20);
+  REQUIRE(camerad);
+  REQUIRE(camerad->stat.name == "camerad");
+  REQUIRE(camerad->cpu_usage == 0);
+  REQUIRE(camerad->rss_delta == 0);
+  REQUIRE(camerad->extra.cmdline == std::vector<std::string>{"camerad", "--flag"});
+
+  SECTION("deltas") {
+    util::sleep_for(10);
+    fixture.setProc(20, "camerad", 200, 50, 900);
+    sampler.update();
+    camerad = findProc(sampler, 20);
+    REQUIRE(camerad->cpu_usage > 0);
+    REQUIRE(camerad->rss_delta == -100 * sysconf(_SC_PAGE_SIZE));
+    REQUIRE(findProc(sampler, 1)->cpu_usage == 0);
+  }
+  SECTION("pid churn") {
+    fixture.removeProc(1);
+    fixture.setProc(30, "modeld", 0, 0, 10);
+    sampler.update();
+    REQUIRE(sampler.procs().size() == 2);
+    REQUIRE(findProc(sampler, 1) == nullptr);
+    REQUIRE(findProc(sampler, 30)->stat.name == "modeld");
+    REQUIRE(sampler.procs()[0]->stat.pid < sampler.procs()[1]->stat.pid);
+  }
+  SECTION("pid reuse") {
+    fixture.removeProc(20);
+    fixture.setProc(20, "pandad", 500, 500, 2000, 200);
+    sampler.update();
+    camerad = findProc(sampler, 20);
+    REQUIRE(camerad->stat.name == "pandad");
+    REQUIRE(camerad->extra.name == "pandad");
+    REQUIRE(camerad->cpu_usage == 0);
+    REQUIRE(camerad->rss_delta == 0);
+  }
+}
+
+TEST_CASE("Parser::schedStat") {
+  SchedStat sched = {};
+  REQUIRE(Parser::schedStat("2795880541 48375836 9862\n", sched));
+  REQUIRE(sched.run_ns == 2795880541);
+  REQUIRE(sched.wait_ns == 48375836);
+  REQUIRE(sched.timeslices == 9862);
+  REQUIRE_FALSE(Parser::schedStat("", sched));
+
+  SECTION("from /proc/self/schedstat") {
+    if (util::file_exists("/proc/self/schedstat")) {
+      REQUIRE(Parser::schedStat(util::read_file("/proc/self/schedstat"), sched));
+      REQUIRE(sched.run_ns > 0);
+    }
+  }
+}
+
+TEST_CASE("Parser::ctxtSwitches") {
+  CtxtSwitches ctxt = {};
+  REQUIRE(Parser::ctxtSwitches("Name:\tcat\nvoluntary_ctxt_switches:\t12\nnonvoluntary_ctxt_switches:\t3\n", ctxt));
+  REQUIRE(ctxt.voluntary == 12);
+  REQUIRE(ctxt.involuntary == 3);
+  REQUIRE_FALSE(Parser::ctxtSwitches("Name:\tcat\n", ctxt));
+  REQUIRE(Parser::ctxtSwitches(util::read_file("/proc/self/status"), ctxt));
+}
+
+TEST_CASE("ProcSampler threads") {
+  ProcFixture fixture;
+  fixture.setProc(20, "camerad", 0, 0, 0);
+  fixture.setThread(20, 20, "camerad", 0, 0, 0, 0, 0);
+  fixture.setThread(20, 21, "camera_thread", 1000000, 500000, 10, 5, 1);
+  fixture.setProc(30, "selfdrive.contr", 0, 0, 0);
+  fixture.setThread(30, 30, "selfdrive.contr", 0, 0, 0, 0, 0);
+  fixture.setProc(40, "loggerd", 0, 0, 0);
+  fixture.setThread(40, 40, "loggerd", 0, 0, 0, 0, 0);
+
+  ProcSampler sampler(fixture.root);
+  sampler.setThreadSampling({"camerad", "selfdrive.controls.controlsd"});
+  sampler.update();
+
+  // loggerd isn't traced
+  auto &threads = sampler.threads();
+  REQUIRE(threads.size() == 3);
+  REQUIRE(threads[0]->pid == 20);
+  REQUIRE(threads[0]->stat.pid == 20);
+  REQUIRE(threads[1]->stat.pid == 21);
+  REQUIRE(threads[1]->stat.name == "camera_thread");
+  REQUIRE(threads[1]->cpu_usage == 0);
+  REQUIRE(threads[2]->pid == 30);
+
+  SECTION("rates") {
+    util::sleep_for(10);
+    fixture.setThread(20, 21, "camera_thread", 5000000, 900000, 20, 15, 6);
+    sampler.update();
+    const ProcSampler::Thread *t = threads[1];
+    REQUIRE(t->stat.pid == 21);
+    REQUIRE(t->cpu_usage > 0);
+    REQUIRE(t->run_queue_wait > 0);
+    REQUIRE(t->avg_run_queue_wait == Approx(400000 * 1e-9 / 10));
+    REQUIRE(t->voluntary_ctxt_switches > 0);
+    REQUIRE(t->involuntary_ctxt_switches > 0);
+    REQUIRE(threads[0]->cpu_usage == 0);
+  }
+  SECTION("thread churn") {
+    fixture.write("20/task/21/stat", "");
+    std::system(("rm -rf " + fixture.root + "/20/task/21").c_str());
+    fixture.setThread(20, 22, "new_thread", 0, 0, 0, 0, 0);
+    sampler.update();
+    REQUIRE(threads.size() == 3);
+    REQUIRE(threads[1]->stat.pid == 22);
+  }
+  SECTION("bounded threads per process") {
+    for (int tid = 100; tid < 200; ++tid) {
+      fixture.setThread(20, tid, "worker", 0, 0, 0, 0, 0);
+    }
+    sampler.setThreadSampling({"camerad"}, 8);
+    sampler.update();
+    auto tids = [&]() {
+      std::vector<int> v;
+      for (auto t : threads) {
+        REQUIRE(t->pid == 20);
+        v.push_back(t->stat.pid);
+      }
+      return v;
+    };
+    REQUIRE(tids() == std::vector<int>{20, 21, 100, 101, 102, 103, 104, 105});
+
+    // the lowest tids, regardless of the order they're listed or started in
+    fixture.write("20/task/101/stat", "");
+    std::system(("rm -rf " + fixture.root + "/20/task/101").c_str());
+    fixture.setThread(20, 50, "late_worker", 0, 0, 0, 0, 0);
+    sampler.update();
+    REQUIRE(tids() == std::vector<int>{20, 21, 50, 100, 102, 103, 104, 105});
+  }
+}
+
+// lowers RLIMIT_NOFILE, the old limit is restored when it goes out of scope
+struct FdLimit {
+  FdLimit() { getrlimit(RLIMIT_NOFILE, &saved); }
+  ~FdLimit() { setrlimit(RLIMIT_NOFILE, &saved); }
+  void set(rlim_t soft) {
+    struct rlimit rl = saved;
+    rl.rlim_cur = soft;
+    REQUIRE(setrlimit(RLIMIT_NOFILE, &rl) == 0);
+  }
+  struct rlimit saved = {};
+};
+
+TEST_CASE("ProcSampler fd limit") {
+  ProcFixture fixture;
+  int num_procs = 150;
+  for (int pid = 1; pid <= num_procs; ++pid) {
+    fixture.setProc(pid, "proc" + std::to_string(pid), pid, pid, pid);
+  }
+  for (int tid = 1000; tid < 1020; ++tid) {
+    fixture.setThread(1, tid, "worker", 0, 0, 0, 0, 0);
+  }
+  auto require_all = [&](const ProcSampler &sampler) {
+    REQUIRE(sampler.procs().size() == num_procs);
+    for (int pid = 1; pid <= num_procs; ++pid) {
+      INFO("pid " << pid);
+      REQUIRE(findProc(sampler, pid));
+    }
+    REQUIRE(sampler.threads().size() == 20);
+  };
+  FdLimit limit;
+
+  SECTION("limited at start") {
+    limit.set(128);
+    ProcSampler sampler(fixture.root);
+    sampler.setThreadSampling({"proc1"});
+    sampler.update();
+    require_all(sampler);
+    util::sleep_for(10);
+    fixture.setProc(num_procs, "proc", 2 * num_procs, num_procs, num_procs);
+    sampler.update();
+    require_all(sampler);
+    REQUIRE(findProc(sampler, num_procs)->cpu_usage > 0);
+  }
+  SECTION("lowered while sampling") {
+    ProcSampler sampler(fixture.root);
+    sampler.setThreadSampling({"proc1"});
+    sampler.update();
+    require_all(sampler);
+
+    // more fds are held than the new limit allows, the new processes fail to open
+    for (; num_procs < 200; ++num_procs) {
+      fixture.setProc(num_procs + 1, "proc" + std::to_string(num_procs + 1), 0, 0, 0);
+    }
+    limit.set(128);
+    sampler.update();
+    require_all(sampler);
+    sampler.update();
+    require_all(sampler);
+  }
+}
+
+TEST_CASE("ProcSampler benchmark", "[.][benchmark]") {
+  ProcFixture fixture;
+  const int num_procs = 500;
+  for (int pid = 1; pid <= num_procs; ++pid) {
+    fixture.setProc(pid, "proc" + std::to_string(pid), pid, pid, pid);
+  }
+
+  BENCHMARK("read_file + istringstream parser") {
+    size_t n = 0;
+    for (int pid = 1; pid <= num_procs; ++pid) {
+      n += Parser::procStat(util::read_file(fixture.root + "/" + std::to_string(pid) + "/stat")).has_value();
+    }
+    return n;
+  };
+
+  ProcSampler sampler(fixture.root);
+  sampler.update();
+  BENCHMARK("ProcSampler::update") {
+    sampler.update();
+    return sampler.procs().size();
+  };
+
+  for (int tid = 1000; tid < 1100; ++tid) {
+    fixture.setThread(1, tid, "worker", 0, 0, 0, 0, 0);
+  }
+  sampler.setThreadSampling({"proc1"}, 100);
+  sampler.update();
+  BENCHMARK("ProcSampler::update with 100 traced threads") {
+    sampler.update();
+    return sampler.threads().size();
+  };
+}
+
 TEST_CASE("buildProcLoggerMessage") {
   MessageBuilder msg;
-  buildProcLogMessage(msg);
+  ProcSampler sampler;
+  buildProcLogMessage(msg, sampler);
 
   kj::Array<capnp::word> buf = capnp::messageToFlatArray(msg);
   capnp::FlatArrayMessageReader reader(buf);
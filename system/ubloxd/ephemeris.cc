@@ -0,0 +1,301 @@
+#include "system/ubloxd/ephemeris.h"
+
+#include <cmath>
+#include <cstring>
+
+namespace ublox {
+
+uint32_t get_bits(const uint8_t *data, int offset, int bits) {
+  uint64_t v = 0;
+  for (int i = offset / 8; i < (offset + bits + 7) / 8; i++) {
+    v = (v << 8) | data[i];
+  }
+  int trailing = (8 - (offset + bits) % 8) % 8;
+  return (v >> trailing) & ((uint64_t(1) << bits) - 1);
+}
+
+int32_t get_bits_signed(const uint8_t *data, int offset, int bits) {
+  int64_t v = get_bits(data, offset, bits);
+  return ((v >> (bits - 1)) & 1) ? v - (int64_t(1) << bits) : v;
+}
+
+int32_t get_bits_sign_magnitude(const uint8_t *data, int offset, int bits) {
+  int32_t v = get_bits(data, offset + 1, bits - 1);
+  return get_bits(data, offset, 1) ? -v : v;
+}
+
+static uint32_t gps_parity(uint32_t data, uint32_t prev_word) {
+  // d1-d24 covered by D25-D30, d1 is the MSB
+  static const uint32_t masks[6] = {0xec7cd2, 0x763e69, 0xbb1f34, 0x5d8f9a, 0xaec7cd, 0x2dea27};
+  // D29* (bit 1) or D30* (bit 0) of the previous word
+  static const int prev_bit[6] = {1, 0, 1, 0, 0, 1};
+
+  uint32_t parity = 0;
+  for (int i = 0; i < 6; i++) {
+    uint32_t bit = (__builtin_popcount(data & masks[i]) + (prev_word >> prev_bit[i])) & 1;
+    parity = (parity << 1) | bit;
+  }
+  return parity;
+}
+
+bool gps_word_parity(uint32_t word, uint32_t prev_word, uint32_t &data) {
+  const uint32_t parity = word & 0x3f;
+  data = (word >> 6) & 0xffffff;
+  if (gps_parity(data, prev_word) == parity) {
+    return true;
+  }
+  // data bits as transmitted, inverted when D30* is set
+  if ((prev_word & 1) && gps_parity(data ^ 0xffffff, prev_word) == parity) {
+    data ^= 0xffffff;
+    return true;
+  }
+  return false;
+}
+
+// b1-b85 of the string are stored from bit 84 (b1) down to bit 0 (b85, the idle chip)
+static inline int glonass_bit(const uint8_t *string, int i) {
+  int offset = 85 - i;
+  return (string[offset / 8] >> (7 - offset % 8)) & 1;
+}
+
+bool glonass_string_hamming(uint8_t string[16]) {
+  // positions of the data bits b9-b85 in the Hamming code, skipping powers of two
+  static const auto positions = [] {
+    std::array<uint8_t, 86> p = {};
+    int pos = 2;
+    for (int i = 9; i <= 85; i++) {
+      do { pos++; } while ((pos & (pos - 1)) == 0);
+      p[i] = pos;
+    }
+    return p;
+  }();
+
+  int syndrome = 0;
+  int checks = 0;
+  int overall = 0;
+  for (int i = 9; i <= 85; i++) {
+    if (glonass_bit(string, i)) {
+      syndrome ^= positions[i];
+      overall ^= 1;
+    }
+  }
+  // check bits b1-b7 (β1-β7) and b8 (βΣ)
+  for (int k = 1; k <= 7; k++) {
+    int c = glonass_bit(string, k) ^ ((syndrome >> (k - 1)) & 1);
+    checks |= c << (k - 1);
+    overall ^= glonass_bit(string, k);
+  }
+  overall ^= glonass_bit(string, 8);
+
+  if (checks == 0 && overall == 0) {
+    return true;
+  }
+  if (overall == 0 || checks == 0) {
+    // more than one error
+    return false;
+  }
+  if ((checks & (checks - 1)) == 0) {
+    // single error in a check bit
+    return true;
+  }
+  for (int i = 9; i <= 85; i++) {
+    if (positions[i] == checks) {
+      int offset = 85 - i;
+      string[offset / 8] ^= 0x80 >> (offset % 8);
+      return true;
+    }
+  }
+  return false;
+}
+
+bool GpsEphemerisAssembler::add(uint8_t sv_id, const uint32_t *words, size_t num_words, double t, GpsEphemeris &eph) {
+  if (sv_id < 1 || sv_id > MAX_SV || num_words != SUBFRAME_WORDS) {
+    return false;
+  }
+
+  // 10 words of 24 data bits and 6 parity bits
+  uint8_t data[30];
+  uint32_t prev_word = 0;
+  for (size_t i = 0; i < SUBFRAME_WORDS; i++) {
+    uint32_t d;
+    if (!gps_word_parity(words[i], prev_word, d)) {
+      parity_errors++;
+      return false;
+    }
+    data[i * 3 + 0] = d >> 16;
+    data[i * 3 + 1] = d >> 8;
+    data[i * 3 + 2] = d >> 0;
+    prev_word = words[i];
+  }
+
+  int subframe_id = get_bits(data, 43, 3);
+  if (data[0] != 0x8b || subframe_id > 3 || subframe_id < 1) {
+    // don't parse almanac subframes
+    return false;
+  }
+
+  Slot &slot = slots[sv_id - 1];
+  for (int i = 0; i < 3; i++) {
+    if ((slot.received & (1 << i)) && t - slot.times[i] > MAX_AGE) {
+      slot.received &= ~(1 << i);
+      expired++;
+    }
+  }
+  memcpy(slot.subframes[subframe_id - 1], data, sizeof(data));
+  slot.times[subframe_id - 1] = t;
+  slot.received |= 1 << (subframe_id - 1);
+
+  // publish if subframes 1-3 have been collected
+  if (slot.received != 0b111) {
+    return false;
+  }
+  slot.received = 0;
+
+  for (int i = 0; i < 3; i++) {
+    eph.tow_count[i] = get_bits(slot.subframes[i], 24, 17);
+  }
+
+  const uint8_t *sf1 = slot.subframes[0];
+  eph.week_no = get_bits(sf1, 48, 10);
+  eph.sv_health = get_bits(sf1, 64, 6);
+  eph.t_gd = get_bits_signed(sf1, 160, 8);
+  eph.iodc_lsb = get_bits(sf1, 168, 8);
+  eph.t_oc = get_bits(sf1, 176, 16);
+  eph.af_2 = get_bits_signed(sf1, 192, 8);
+  eph.af_1 = get_bits_signed(sf1, 200, 16);
+  eph.af_0 = get_bits_signed(sf1, 216, 22);
+
+  const uint8_t *sf2 = slot.subframes[1];
+  eph.iode_2 = get_bits(sf2, 48, 8);
+  eph.c_rs = get_bits_signed(sf2, 56, 16);
+  eph.delta_n = get_bits_signed(sf2, 72, 16);
+  eph.m_0 = get_bits_signed(sf2, 88, 32);
+  eph.c_uc = get_bits_signed(sf2, 120, 16);
+  eph.e = get_bits_signed(sf2, 136, 32);
+  eph.c_us = get_bits_signed(sf2, 168, 16);
+  eph.sqrt_a = get_bits(sf2, 184, 32);
+  eph.t_oe = get_bits(sf2, 216, 16);
+
+  const uint8_t *sf3 = slot.subframes[2];
+  eph.c_ic = get_bits_signed(sf3, 48, 16);
+  eph.omega_0 = get_bits_signed(sf3, 64, 32);
+  eph.c_is = get_bits_signed(sf3, 96, 16);
+  eph.i_0 = get_bits_signed(sf3, 112, 32);
+  eph.c_rc = get_bits_signed(sf3, 144, 16);
+  eph.omega = get_bits_signed(sf3, 160, 32);
+  eph.omega_dot = get_bits_signed(sf3, 192, 24);
+  eph.iode_3 = get_bits(sf3, 216, 8);
+  eph.idot = get_bits_signed(sf3, 224, 14);
+
+  // data set cutover, reject ephemeris
+  return eph.iodc_lsb == eph.iode_2 && eph.iodc_lsb == eph.iode_3;
+}
+
+bool GlonassEphemerisAssembler::add(uint8_t sv_id, uint8_t freq_id, const uint32_t *words, size_t num_words, double t, GlonassEphemeris &eph) {
+  if (freq_id >= MAX_FREQ || num_words != STRING_WORDS) {
+    return false;
+  }
+
+  uint8_t string[16];
+  for (size_t i = 0; i < STRING_WORDS; i++) {
+    for (int j = 0; j < 4; j++) {
+      string[i * 4 + j] = words[i] >> 8 * (3 - j);
+    }
+  }
+  if (!glonass_string_hamming(string)) {
+    parity_errors++;
+    return false;
+  }
+
+  int string_number = get_bits(string, 1, 4);
+  if (string_number < 1 || string_number > 5 || get_bits(string, 0, 1)) {
+    // don't parse non immediate data, idle_chip == 0
+    return false;
+  }
+  uint16_t superframe = get_bits(string, 96, 16);
+
+  Slot &slot = slots[freq_id];
+  for (int i = 0; i < 5; i++) {
+    if ((slot.received & (1 << i)) && t - slot.times[i] > MAX_AGE) {
+      slot.received &= ~(1 << i);
+      expired++;
+    }
+  }
+
+  // Check if new string either has same superframe_id or log transmission times make sense
+  bool superframe_unknown = false;
+  bool needs_clear = false;
+  for (int i = 1; i <= 5; i++) {
+    if (!(slot.received & (1 << (i - 1))))
+      continue;
+    if (slot.superframes[i - 1] == 0 || superframe == 0) {
+      superframe_unknown = true;
+    } else if (slot.superframes[i - 1] != superframe) {
+      needs_clear = true;
+    }
+    // Check if string times add up to being from the same frame
+    // If superframe is known this is redundant
+    // Strings are sent 2s apart and frames are 30s apart
+    if (superframe_unknown &&
+        std::abs((slot.times[i - 1] - 2.0 * i) - (t - 2.0 * string_number)) > 10)
+      needs_clear = true;
+  }
+  if (needs_clear) {
+    slot.received = 0;
+  }
+  memcpy(slot.strings[string_number - 1], string, sizeof(string));
+  slot.times[string_number - 1] = t;
+  slot.superframes[string_number - 1] = superframe;
+  slot.received |= 1 << (string_number - 1);
+
+  if (sv_id == 255) {
+    // data can be decoded before identifying the SV number, in this case 255
+    // is returned, which means "unknown"  (ublox p32)
+    return false;
+  }
+
+  // publish if strings 1-5 have been collected
+  if (slot.received != 0b11111) {
+    return false;
+  }
+  slot.received = 0;
+
+  const uint8_t *s1 = slot.strings[0];
+  eph.p1 = get_bits(s1, 7, 2);
+  eph.t_k = get_bits(s1, 9, 12);
+  eph.x_vel = get_bits_sign_magnitude(s1, 21, 24);
+  eph.x_accel = get_bits_sign_magnitude(s1, 45, 5);
+  eph.x = get_bits_sign_magnitude(s1, 50, 27);
+
+  const uint8_t *s2 = slot.strings[1];
+  eph.b_n = get_bits(s2, 5, 3);
+  eph.p2 = get_bits(s2, 8, 1);
+  eph.t_b = get_bits(s2, 9, 7);
+  eph.y_vel = get_bits_sign_magnitude(s2, 21, 24);
+  eph.y_accel = get_bits_sign_magnitude(s2, 45, 5);
+  eph.y = get_bits_sign_magnitude(s2, 50, 27);
+
+  const uint8_t *s3 = slot.strings[2];
+  eph.p3 = get_bits(s3, 5, 1);
+  eph.gamma_n = get_bits_sign_magnitude(s3, 6, 11);
+  eph.l_n = get_bits(s3, 20, 1);
+  eph.z_vel = get_bits_sign_magnitude(s3, 21, 24);
+  eph.z_accel = get_bits_sign_magnitude(s3, 45, 5);
+  eph.z = get_bits_sign_magnitude(s3, 50, 27);
+
+  const uint8_t *s4 = slot.strings[3];
+  eph.tau_n = get_bits_sign_magnitude(s4, 5, 22);
+  eph.delta_tau_n = get_bits_sign_magnitude(s4, 27, 5);
+  eph.e_n = get_bits(s4, 32, 5);
+  eph.p4 = get_bits(s4, 51, 1);
+  eph.f_t = get_bits(s4, 52, 4);
+  eph.n_t = get_bits(s4, 59, 11);
+  eph.n = get_bits(s4, 70, 5);
+  eph.m = get_bits(s4, 75, 2);
+
+  const uint8_t *s5 = slot.strings[4];
+  eph.n_4 = get_bits(s5, 49, 5);
+  return true;
+}
+
+}  // namespace ublox
@@ -0,0 +1,135 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+// Assembles GPS subframes and GLONASS strings from RXM-SFRBX into ephemerides.
+// Every satellite has a fixed slot, parts that fail parity are dropped and
+// parts older than MAX_AGE are expired so they never mix with a later frame.
+namespace ublox {
+  // big endian bit fields of navigation data
+  uint32_t get_bits(const uint8_t *data, int offset, int bits);
+  int32_t get_bits_signed(const uint8_t *data, int offset, int bits);
+  // sign bit followed by the magnitude, as used by GLONASS
+  int32_t get_bits_sign_magnitude(const uint8_t *data, int offset, int bits);
+
+  // Checks the D25-D30 parity of a 30 bit GPS word (IS-GPS-200 20.3.5.2), prev_word is
+  // the previous word of the subframe or 0 for the TLM. The data bits are accepted both
+  // with and without the D30* inversion, data is set to the source data bits.
+  bool gps_word_parity(uint32_t word, uint32_t prev_word, uint32_t &data);
+  // Checks the Hamming code of a GLONASS string (ICD 4.7), corrects a single bit error in place.
+  bool glonass_string_hamming(uint8_t string[16]);
+
+  // ephemeris parameters of GPS subframes 1-3, as transmitted
+  struct GpsEphemeris {
+    uint32_t tow_count[3];
+    // subframe 1
+    uint16_t week_no;
+    uint8_t sv_health;
+    int8_t t_gd;
+    uint8_t iodc_lsb;
+    uint16_t t_oc;
+    int8_t af_2;
+    int16_t af_1;
+    int32_t af_0;
+    // subframe 2
+    uint8_t iode_2;
+    int16_t c_rs;
+    int16_t delta_n;
+    int32_t m_0;
+    int16_t c_uc;
+    int32_t e;
+    int16_t c_us;
+    uint32_t sqrt_a;
+    uint16_t t_oe;
+    // subframe 3
+    int16_t c_ic;
+    int32_t omega_0;
+    int16_t c_is;
+    int32_t i_0;
+    int16_t c_rc;
+    int32_t omega;
+    int32_t omega_dot;
+    uint8_t iode_3;
+    int32_t idot;
+  };
+
+  // immediate data of GLONASS strings 1-5, as transmitted
+  struct GlonassEphemeris {
+    // string 1
+    uint8_t p1;
+    uint16_t t_k;
+    int32_t x_vel, x_accel, x;
+    // string 2
+    uint8_t b_n;
+    uint8_t p2;
+    uint8_t t_b;
+    int32_t y_vel, y_accel, y;
+    // string 3
+    uint8_t p3;
+    int32_t gamma_n;
+    uint8_t l_n;
+    int32_t z_vel, z_accel, z;
+    // string 4
+    int32_t tau_n;
+    int32_t delta_tau_n;
+    uint8_t e_n;
+    uint8_t p4;
+    uint8_t f_t;
+    uint16_t n_t;
+    uint8_t n;
+    uint8_t m;
+    // string 5
+    uint8_t n_4;
+  };
+
+  class GpsEphemerisAssembler {
+  public:
+    static constexpr int MAX_SV = 32;
+    static constexpr double MAX_AGE = 60.0;
+    static constexpr size_t SUBFRAME_WORDS = 10;
+
+    // Adds a subframe received at time t [s]. Returns true and fills eph when subframes 1-3
+    // of the satellite are complete and belong to the same issue of data.
+    bool add(uint8_t sv_id, const uint32_t *words, size_t num_words, double t, GpsEphemeris &eph);
+    void reset() { slots = {}; }
+
+    uint64_t parity_errors = 0;
+    uint64_t expired = 0;
+
+  private:
+    struct Slot {
+      uint8_t subframes[3][30];
+      double times[3];
+      uint8_t received;  // bit per subframe
+    };
+    std::array<Slot, MAX_SV> slots = {};
+  };
+
+  class GlonassEphemerisAssembler {
+  public:
+    // slots are keyed by frequency channel, no 2 satellites of the same
+    // frequency can be in view at the same time
+    static constexpr int MAX_FREQ = 14;
+    static constexpr double MAX_AGE = 60.0;
+    static constexpr size_t STRING_WORDS = 4;
+
+    // Adds a string received at time t [s]. Returns true and fills eph when
+    // strings 1-5 of the same frame are complete.
+    bool add(uint8_t sv_id, uint8_t freq_id, const uint32_t *words, size_t num_words, double t, GlonassEphemeris &eph);
+    void reset() { slots = {}; }
+
+    uint64_t parity_errors = 0;
+    uint64_t expired = 0;
+
+  private:
+    struct Slot {
+      uint8_t strings[5][16];
+      double times[5];
+      uint16_t superframes[5];
+      uint8_t received;  // bit per string
+    };
+    std::array<Slot, MAX_FREQ> slots = {};
+  };
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// encoders for GPS subframes and GLONASS strings as reported by RXM-SFRBX
+
+// big endian bit field writer for navigation data
+inline void set_bits(std::string &data, int offset, int bits, uint64_t value) {
+  for (int i = 0; i < bits; i++) {
+    int bit = offset + i;
+    uint8_t mask = 0x80 >> (bit % 8);
+    if ((value >> (bits - 1 - i)) & 1) {
+      data[bit / 8] |= mask;
+    } else {
+      data[bit / 8] &= ~mask;
+    }
+  }
+}
+
+inline int get_bit(const std::string &data, int bit) {
+  return ((uint8_t)data[bit / 8] >> (7 - bit % 8)) & 1;
+}
+
+// 24 data bits followed by D25-D30, IS-GPS-200 table 20-XIV
+inline uint32_t gps_word(uint32_t data, uint32_t prev_word) {
+  static const std::vector<int> equations[6] = {
+    {1, 2, 3, 5, 6, 10, 11, 12, 13, 14, 17, 18, 20, 23},
+    {2, 3, 4, 6, 7, 11, 12, 13, 14, 15, 18, 19, 21, 24},
+    {1, 3, 4, 5, 7, 8, 12, 13, 14, 15, 16, 19, 20, 22},
+    {2, 4, 5, 6, 8, 9, 13, 14, 15, 16, 17, 20, 21, 23},
+    {1, 3, 5, 6, 7, 9, 10, 14, 15, 16, 17, 18, 21, 22, 24},
+    {3, 5, 6, 8, 9, 10, 11, 13, 15, 19, 22, 23, 24},
+  };
+  const int d29 = (prev_word >> 1) & 1, d30 = prev_word & 1;
+  const int prev[6] = {d29, d30, d29, d30, d30, d29};
+
+  uint32_t word = data << 6;
+  for (int k = 0; k < 6; k++) {
+    int parity = prev[k];
+    for (int d : equations[k]) parity ^= (data >> (24 - d)) & 1;
+    word |= parity << (5 - k);
+  }
+  return word;
+}
+
+// GPS subframe of 30 data bytes as 10 words with parity
+inline std::vector<uint32_t> gps_words(const std::string &data) {
+  std::vector<uint32_t> words;
+  uint32_t prev_word = 0;
+  for (int i = 0; i < 10; i++) {
+    uint32_t d = ((uint8_t)data[i * 3] << 16) | ((uint8_t)data[i * 3 + 1] << 8) | (uint8_t)data[i * 3 + 2];
+    words.push_back(gps_word(d, prev_word));
+    prev_word = words.back();
+  }
+  return words;
+}
+
+// Sets the Hamming code of a 16 byte GLONASS string. The string bits b85-b1 are
+// stored from bit 0 on, the data bits b9-b85 take the Hamming code positions that
+// aren't powers of two and β1-β7 cover the positions with the respective bit set.
+inline void glonass_set_hamming(std::string &data) {
+  int position = 2;
+  int beta[8] = {};
+  for (int i = 9; i <= 85; i++) {
+    do { position++; } while ((position & (position - 1)) == 0);
+    if (!get_bit(data, 85 - i)) continue;
+    for (int k = 1; k <= 7; k++) {
+      if (position & (1 << (k - 1))) beta[k - 1] ^= 1;
+    }
+    beta[7] ^= 1;
+  }
+  for (int k = 1; k <= 7; k++) {
+    set_bits(data, 85 - k, 1, beta[k - 1]);
+    beta[7] ^= beta[k - 1];
+  }
+  set_bits(data, 85 - 8, 1, beta[7]);
+}
+
+// GLONASS string of 16 bytes as 4 words
+inline std::vector<uint32_t> glonass_words(const std::string &data) {
+  std::vector<uint32_t> words;
+  for (int i = 0; i < 4; i++) {
+    words.push_back(((uint8_t)data[i * 4] << 24) | ((uint8_t)data[i * 4 + 1] << 16) |
+                    ((uint8_t)data[i * 4 + 2] << 8) | (uint8_t)data[i * 4 + 3]);
+  }
+  return words;
+}
@@ -0,0 +1,328 @@
+#define CATCH_CONFIG_ENABLE_BENCHMARKING
+#include "catch2/catch.hpp"
+
+#include <cstring>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "system/ubloxd/ephemeris.h"
+#include "system/ubloxd/generated/glonass.h"
+#include "system/ubloxd/generated/gps.h"
+#include "system/ubloxd/tests/nav_data.h"
+
+typedef std::vector<std::pair<int, int64_t>> string_data; // <bit length, value>
+
+static std::mt19937_64 eph_rng(42);
+
+static std::pair<int, int64_t> field(int bits) {
+  return {bits, (int64_t)(eph_rng() & ((1ULL << bits) - 1))};
+}
+
+static std::string gps_subframe_data(int subframe_id, uint8_t iode) {
+  std::string data(30, '\0');
+  for (int i = 0; i < 240; i += 8) set_bits(data, i, 8, eph_rng());
+  data[0] = 0x8b;
+  set_bits(data, 24 + 19, 3, subframe_id);
+  if (subframe_id == 1) data[21] = iode;  // iodc lsb
+  if (subframe_id == 2) data[6] = iode;
+  if (subframe_id == 3) data[27] = iode;
+  return data;
+}
+
+static string_data glonass_fields(int string_number) {
+  string_data data;
+  data.push_back({1, 0}); // idle chip
+  data.push_back({4, string_number}); // string number
+  if (string_number == 1) {
+    for (int bits : {2, 2, 12, 1, 23, 1, 4, 1, 26}) data.push_back(field(bits));
+  } else if (string_number == 2) {
+    for (int bits : {3, 1, 7, 5, 1, 23, 1, 4, 1, 26}) data.push_back(field(bits));
+  } else if (string_number == 3) {
+    for (int bits : {1, 1, 10, 1, 2, 1, 1, 23, 1, 4, 1, 26}) data.push_back(field(bits));
+  } else if (string_number == 4) {
+    for (int bits : {1, 21, 1, 4, 5, 14, 1, 4, 3, 11, 5, 2}) data.push_back(field(bits));
+  } else {
+    for (int bits : {11, 32, 1, 5, 22, 1}) data.push_back(field(bits));
+  }
+  return data;
+}
+
+static std::string glonass_string_data(const string_data &fields, uint16_t superframe) {
+  std::string data(16, '\0');
+  int offset = 0;
+  for (auto &[bits, value] : fields) {
+    set_bits(data, offset, bits, value);
+    offset += bits;
+  }
+  REQUIRE(offset == 77);
+  set_bits(data, 96, 16, superframe);
+  glonass_set_hamming(data);
+  return data;
+}
+
+TEST_CASE("gps ephemeris matches kaitai") {
+  for (int n = 0; n < 100; n++) {
+    ublox::GpsEphemerisAssembler assembler;
+    ublox::GpsEphemeris eph;
+    uint8_t iode = eph_rng();
+    std::string subframes[3];
+    for (int i = 0; i < 3; i++) {
+      subframes[i] = gps_subframe_data(i + 1, iode);
+      auto words = gps_words(subframes[i]);
+      REQUIRE(assembler.add(5, words.data(), words.size(), i * 6.0, eph) == (i == 2));
+    }
+    REQUIRE(assembler.parity_errors == 0);
+
+    kaitai::kstream stream1(subframes[0]);
+    gps_t subframe1(&stream1);
+    auto sf1 = static_cast<gps_t::subframe_1_t *>(subframe1.body());
+    REQUIRE(eph.tow_count[0] == subframe1.how()->tow_count());
+    REQUIRE(eph.week_no == sf1->week_no());
+    REQUIRE(eph.sv_health == sf1->sv_health());
+    REQUIRE(eph.t_gd == sf1->t_gd());
+    REQUIRE(eph.iodc_lsb == sf1->iodc_lsb());
+    REQUIRE(eph.t_oc == sf1->t_oc());
+    REQUIRE(eph.af_2 == sf1->af_2());
+    REQUIRE(eph.af_1 == sf1->af_1());
+    REQUIRE(eph.af_0 == sf1->af_0());
+
+    kaitai::kstream stream2(subframes[1]);
+    gps_t subframe2(&stream2);
+    auto sf2 = static_cast<gps_t::subframe_2_t *>(subframe2.body());
+    REQUIRE(eph.tow_count[1] == subframe2.how()->tow_count());
+    REQUIRE(eph.iode_2 == sf2->iode());
+    REQUIRE(eph.c_rs == sf2->c_rs());
+    REQUIRE(eph.delta_n == sf2->delta_n());
+    REQUIRE(eph.m_0 == sf2->m_0());
+    REQUIRE(eph.c_uc == sf2->c_uc());
+    REQUIRE(eph.e == sf2->e());
+    REQUIRE(eph.c_us == sf2->c_us());
+    REQUIRE(eph.sqrt_a == sf2->sqrt_a());
+    REQUIRE(eph.t_oe == sf2->t_oe());
+
+    kaitai::kstream stream3(subframes[2]);
+    gps_t subframe3(&stream3);
+    auto sf3 = static_cast<gps_t::subframe_3_t *>(subframe3.body());
+    REQUIRE(eph.tow_count[2] == subframe3.how()->tow_count());
+    REQUIRE(eph.c_ic == sf3->c_ic());
+    REQUIRE(eph.omega_0 == sf3->omega_0());
+    REQUIRE(eph.c_is == sf3->c_is());
+    REQUIRE(eph.i_0 == sf3->i_0());
+    REQUIRE(eph.c_rc == sf3->c_rc());
+    REQUIRE(eph.omega == sf3->omega());
+    REQUIRE(eph.omega_dot == sf3->omega_dot());
+    REQUIRE(eph.iode_3 == sf3->iode());
+    REQUIRE(eph.idot == sf3->idot());
+  }
+}
+
+TEST_CASE("gps parity") {
+  ublox::GpsEphemerisAssembler assembler;
+  ublox::GpsEphemeris eph;
+  std::vector<std::vector<uint32_t>> subframes;
+  for (int i = 1; i <= 3; i++) subframes.push_back(gps_words(gps_subframe_data(i, 7)));
+
+  SECTION("single bit errors are rejected") {
+    for (int bit = 0; bit < 30; bit++) {
+      auto words = subframes[0];
+      words[eph_rng() % 10] ^= 1 << bit;
+      REQUIRE_FALSE(assembler.add(1, words.data(), words.size(), 0, eph));
+    }
+    REQUIRE(assembler.parity_errors == 30);
+  }
+
+  SECTION("data bits as transmitted") {
+    for (auto &words : subframes) {
+      for (int i = 1; i < 10; i++) {
+        if (words[i - 1] & 1) words[i] ^= 0xffffff << 6;
+      }
+    }
+    REQUIRE_FALSE(assembler.add(1, subframes[0].data(), 10, 0, eph));
+    REQUIRE_FALSE(assembler.add(1, subframes[1].data(), 10, 0, eph));
+    REQUIRE(assembler.add(1, subframes[2].data(), 10, 0, eph));
+    REQUIRE(eph.iode_3 == 7);
+    REQUIRE(assembler.parity_errors == 0);
+  }
+}
+
+TEST_CASE("gps subframes expire") {
+  ublox::GpsEphemerisAssembler assembler;
+  ublox::GpsEphemeris eph;
+  std::vector<std::vector<uint32_t>> subframes;
+  for (int i = 1; i <= 3; i++) subframes.push_back(gps_words(gps_subframe_data(i, 7)));
+
+  REQUIRE_FALSE(assembler.add(32, subframes[0].data(), 10, 0, eph));
+  REQUIRE_FALSE(assembler.add(32, subframes[1].data(), 10, 6, eph));
+  REQUIRE_FALSE(assembler.add(32, subframes[2].data(), 10, 100, eph));
+  REQUIRE(assembler.expired == 2);
+
+  REQUIRE_FALSE(assembler.add(32, subframes[0].data(), 10, 130, eph));
+  REQUIRE(assembler.add(32, subframes[1].data(), 10, 136, eph));
+
+  // out of range satellites and truncated subframes
+  REQUIRE_FALSE(assembler.add(0, subframes[0].data(), 10, 140, eph));
+  REQUIRE_FALSE(assembler.add(33, subframes[0].data(), 10, 140, eph));
+  REQUIRE_FALSE(assembler.add(32, subframes[0].data(), 9, 140, eph));
+}
+
+TEST_CASE("gps issue of data cutover") {
+  ublox::GpsEphemerisAssembler assembler;
+  ublox::GpsEphemeris eph;
+  for (int i = 1; i <= 3; i++) {
+    auto words = gps_words(gps_subframe_data(i, i == 3 ? 8 : 7));
+    REQUIRE_FALSE(assembler.add(1, words.data(), words.size(), 0, eph));
+  }
+}
+
+TEST_CASE("glonass ephemeris matches kaitai") {
+  for (int n = 0; n < 100; n++) {
+    ublox::GlonassEphemerisAssembler assembler;
+    ublox::GlonassEphemeris eph;
+    uint16_t superframe = 1 + eph_rng() % 0xfffe;
+    string_data fields[5];
+    std::string strings[5];
+    for (int i = 0; i < 5; i++) {
+      fields[i] = glonass_fields(i + 1);
+      strings[i] = glonass_string_data(fields[i], superframe);
+      auto words = glonass_words(strings[i]);
+      REQUIRE(assembler.add(3, 8, words.data(), words.size(), i * 2.0, eph) == (i == 4));
+    }
+    REQUIRE(assembler.parity_errors == 0);
+
+    kaitai::kstream stream1(strings[0]);
+    glonass_t str1(&stream1);
+    auto s1 = static_cast<glonass_t::string_1_t *>(str1.data());
+    REQUIRE(eph.p1 == s1->p1());
+    REQUIRE(eph.t_k == s1->t_k());
+    REQUIRE(eph.t_k == fields[0][4].second);
+    REQUIRE(eph.x_vel == s1->x_vel());
+    REQUIRE(eph.x_accel == s1->x_accel());
+    REQUIRE(eph.x == s1->x());
+    REQUIRE(eph.x == fields[0][10].second * (fields[0][9].second ? -1 : 1));
+
+    kaitai::kstream stream2(strings[1]);
+    glonass_t str2(&stream2);
+    auto s2 = static_cast<glonass_t::string_2_t *>(str2.data());
+    REQUIRE(eph.b_n == s2->b_n());
+    REQUIRE(eph.p2 == s2->p2());
+    REQUIRE(eph.t_b == s2->t_b());
+    REQUIRE(eph.y_vel == s2->y_vel());
+    REQUIRE(eph.y_accel == s2->y_accel());
+    REQUIRE(eph.y == s2->y());
+
+    kaitai::kstream stream3(strings[2]);
+    glonass_t str3(&stream3);
+    auto s3 = static_cast<glonass_t::string_3_t *>(str3.data());
+    REQUIRE(eph.p3 == s3->p3());
+    REQUIRE(eph.gamma_n == s3->gamma_n());
+    REQUIRE(eph.gamma_n == fields[2][4].second * (fields[2][3].second ? -1 : 1));
+    REQUIRE(eph.l_n == s3->l_n());
+    REQUIRE(eph.z_vel == s3->z_vel());
+    REQUIRE(eph.z_accel == s3->z_accel());
+    REQUIRE(eph.z == s3->z());
+
+    kaitai::kstream stream4(strings[3]);
+    glonass_t str4(&stream4);
+    auto s4 = static_cast<glonass_t::string_4_t *>(str4.data());
+    REQUIRE(eph.tau_n == s4->tau_n());
+    REQUIRE(eph.delta_tau_n == s4->delta_tau_n());
+    REQUIRE(eph.e_n == s4->e_n());
+    REQUIRE(eph.p4 == s4->p4());
+    REQUIRE(eph.f_t == s4->f_t());
+    REQUIRE(eph.n_t == s4->n_t());
+    REQUIRE(eph.n == s4->n());
+    REQUIRE(eph.m == s4->m());
+
+    kaitai::kstream stream5(strings[4]);
+    glonass_t str5(&stream5);
+    auto s5 = static_cast<glonass_t::string_5_t *>(str5.data());
+    REQUIRE(eph.n_4 == s5->n_4());
+  }
+}
+
+TEST_CASE("glonass hamming code") {
+  std::string string = glonass_string_data(glonass_fields(4), 12);
+  uint8_t data[16];
+
+  memcpy(data, string.data(), 16);
+  REQUIRE(ublox::glonass_string_hamming(data));
+  REQUIRE(memcmp(data, string.data(), 16) == 0);
+
+  // b1-b85 are at bits 84-0
+  for (int bit = 0; bit < 85; bit++) {
+    memcpy(data, string.data(), 16);
+    data[bit / 8] ^= 0x80 >> (bit % 8);
+    if (bit == 85 - 8) {
+      // the overall check bit alone is an error
+      REQUIRE_FALSE(ublox::glonass_string_hamming(data));
+      continue;
+    }
+    REQUIRE(ublox::glonass_string_hamming(data));
+    if (bit < 85 - 8) {
+      // data bits are corrected
+      REQUIRE(memcmp(data, string.data(), 16) == 0);
+    }
+  }
+
+  for (int bit = 0; bit < 84; bit++) {
+    memcpy(data, string.data(), 16);
+    data[bit / 8] ^= 0x80 >> (bit % 8);
+    data[(bit + 1) / 8] ^= 0x80 >> ((bit + 1) % 8);
+    REQUIRE_FALSE(ublox::glonass_string_hamming(data));
+  }
+}
+
+TEST_CASE("glonass strings expire") {
+  ublox::GlonassEphemerisAssembler assembler;
+  ublox::GlonassEphemeris eph;
+  std::vector<std::vector<uint32_t>> strings;
+  for (int i = 1; i <= 5; i++) strings.push_back(glonass_words(glonass_string_data(glonass_fields(i), 0)));
+
+  SECTION("old strings") {
+    for (int i = 0; i < 4; i++) {
+      REQUIRE_FALSE(assembler.add(3, 13, strings[i].data(), 4, i * 2.0, eph));
+    }
+    REQUIRE_FALSE(assembler.add(3, 13, strings[4].data(), 4, 68, eph));
+    REQUIRE(assembler.expired == 4);
+  }
+
+  SECTION("unknown satellite") {
+    for (int i = 0; i < 5; i++) {
+      REQUIRE_FALSE(assembler.add(255, 13, strings[i].data(), 4, i * 2.0, eph));
+    }
+    REQUIRE(assembler.add(3, 13, strings[4].data(), 4, 8, eph));
+  }
+
+  SECTION("out of range frequency") {
+    REQUIRE_FALSE(assembler.add(3, 14, strings[0].data(), 4, 0, eph));
+  }
+}
+
+TEST_CASE("ephemeris decode", "[.][benchmark]") {
+  std::string gps[3];
+  std::vector<uint32_t> gps_subframes[3];
+  for (int i = 0; i < 3; i++) {
+    gps[i] = gps_subframe_data(i + 1, 1);
+    gps_subframes[i] = gps_words(gps[i]);
+  }
+
+  BENCHMARK("kaitai") {
+    int64_t sum = 0;
+    for (auto &subframe : gps) {
+      kaitai::kstream stream(subframe);
+      gps_t s(&stream);
+      sum += s.how()->tow_count();
+    }
+    return sum;
+  };
+  BENCHMARK("assembler") {
+    ublox::GpsEphemerisAssembler assembler;
+    ublox::GpsEphemeris eph;
+    for (auto &words : gps_subframes) {
+      assembler.add(1, words.data(), words.size(), 0, eph);
+    }
+    return eph.tow_count[0];
+  };
+}
@@ -0,0 +1,399 @@
+#define CATCH_CONFIG_MAIN
+#define CATCH_CONFIG_ENABLE_BENCHMARKING
+#include "catch2/catch.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "common/util.h"
+#include "system/ubloxd/tests/nav_data.h"
+#include "system/ubloxd/ublox_msg.h"
+
+static std::mt19937 rng(1337);
+
+static std::string random_bytes(size_t size) {
+  std::uniform_int_distribution<int> dist(0, 255);
+  std::string s(size, '\0');
+  for (auto &c : s) c = dist(rng);
+  return s;
+}
+
+template <typename T>
+static T random_struct() {
+  T v;
+  std::string bytes = random_bytes(sizeof(T));
+  memcpy(&v, bytes.data(), sizeof(T));
+  return v;
+}
+
+template <typename T>
+static std::string as_bytes(const T &v) {
+  return std::string((const char *)&v, sizeof(T));
+}
+
+static std::string ubx_frame(uint16_t msg_type, const std::string &payload) {
+  std::string msg = "\xb5\x62"s;
+  msg.push_back(msg_type >> 8);
+  msg.push_back(msg_type & 0xff);
+  uint16_t size = payload.size();
+  msg.append((const char *)&size, sizeof(size));
+  return ublox::ubx_add_checksum(msg + payload);
+}
+
+std::string nav_pvt() {
+  auto pvt = random_struct<ublox::ubx_nav_pvt_t>();
+  pvt.year = 2024;
+  pvt.month = 1 + rng() % 12;
+  pvt.day = 1 + rng() % 28;
+  pvt.hour = rng() % 24;
+  pvt.min = rng() % 60;
+  pvt.sec = rng() % 60;
+  return ubx_frame(0x0107, as_bytes(pvt));
+}
+
+std::string rxm_rawx(int num_meas) {
+  std::uniform_real_distribution<double> range(2e7, 3e7);
+  auto rawx = random_struct<ublox::ubx_rxm_rawx_t>();
+  rawx.rcv_tow = range(rng) * 1e-3;
+  rawx.num_meas = num_meas;
+  std::string payload = as_bytes(rawx);
+  for (int i = 0; i < num_meas; i++) {
+    auto meas = random_struct<ublox::ubx_rxm_rawx_meas_t>();
+    meas.pr_mes = range(rng);
+    meas.cp_mes = range(rng) * 5;
+    meas.do_mes = range(rng) * 1e-4;
+    payload += as_bytes(meas);
+  }
+  return ubx_frame(0x0215, payload);
+}
+
+std::string nav_sat(int num_svs) {
+  auto sat = random_struct<ublox::ubx_nav_sat_t>();
+  sat.num_svs = num_svs;
+  std::string payload = as_bytes(sat);
+  for (int i = 0; i < num_svs; i++) {
+    payload += as_bytes(random_struct<ublox::ubx_nav_sat_sv_t>());
+  }
+  return ubx_frame(0x0135, payload);
+}
+
+std::string rxm_sfrbx(uint8_t gnss_id, uint8_t sv_id, uint8_t freq_id, const std::vector<uint32_t> &words) {
+  ublox::ubx_rxm_sfrbx_t sfrbx = {.gnss_id = gnss_id, .sv_id = sv_id, .freq_id = freq_id, .num_words = (uint8_t)words.size()};
+  std::string payload = as_bytes(sfrbx);
+  payload.append((const char *)words.data(), words.size() * sizeof(uint32_t));
+  return ubx_frame(0x0213, payload);
+}
+
+// GPS subframe as 10 words of 24 data bits and parity
+std::vector<uint32_t> gps_subframe(int subframe_id, uint8_t iode) {
+  std::string data = random_bytes(30);
+  data[0] = 0x8b;
+  set_bits(data, 24 + 19, 3, subframe_id);
+  if (subframe_id == 1) data[21] = iode;  // iodc lsb
+  if (subframe_id == 2) data[6] = iode;
+  if (subframe_id == 3) data[27] = iode;
+  return gps_words(data);
+}
+
+// GLONASS string as 4 words, with an unknown superframe number
+std::vector<uint32_t> glonass_string(int string_number) {
+  std::string data = random_bytes(16);
+  set_bits(data, 0, 1, 0);  // idle chip
+  set_bits(data, 1, 4, string_number);
+  set_bits(data, 96, 16, 0);
+  glonass_set_hamming(data);
+  return glonass_words(data);
+}
+
+std::string mon_hw() {
+  return ubx_frame(0x0a09, random_bytes(60));
+}
+
+// raw event bytes with logMonoTime, the only field that differs between runs, cleared in place
+std::string without_mono_time(kj::ArrayPtr<const capnp::byte> bytes) {
+  std::string event((const char *)bytes.begin(), bytes.size());
+  if (event.empty()) return event;
+
+  // a single segment: the segment table, then the root pointer to the Event struct
+  uint32_t segment_count_minus_one;
+  uint64_t root;
+  REQUIRE(event.size() >= 16);
+  memcpy(&segment_count_minus_one, event.data(), sizeof(segment_count_minus_one));
+  memcpy(&root, event.data() + 8, sizeof(root));
+  REQUIRE(segment_count_minus_one == 0);
+  REQUIRE((root & 3) == 0);
+
+  // logMonoTime is the first word of the struct's data section
+  const size_t offset = 16 + 8 * ((int32_t)(root & 0xffffffff) >> 2);
+  REQUIRE(event.size() >= offset + 8);
+  memset(&event[offset], 0, 8);
+  return event;
+}
+
+// the kaitai decoders ubloxd used before the packed views, as the reference for the in place decoders
+kj::Array<capnp::word> kaitai_nav_pvt(ubx_t::nav_pvt_t *msg) {
+  MessageBuilder msg_builder;
+  auto gpsLoc = msg_builder.initEvent().initGpsLocationExternal();
+  gpsLoc.setSource(cereal::GpsLocationData::SensorSource::UBLOX);
+  gpsLoc.setFlags(msg->flags());
+  gpsLoc.setHasFix((msg->flags() % 2) == 1);
+  gpsLoc.setLatitude(msg->lat() * 1e-07);
+  gpsLoc.setLongitude(msg->lon() * 1e-07);
+  gpsLoc.setAltitude(msg->height() * 1e-03);
+  gpsLoc.setSpeed(msg->g_speed() * 1e-03);
+  gpsLoc.setBearingDeg(msg->head_mot() * 1e-5);
+  gpsLoc.setHorizontalAccuracy(msg->h_acc() * 1e-03);
+  gpsLoc.setSatelliteCount(msg->num_sv());
+  std::tm timeinfo = std::tm();
+  timeinfo.tm_year = msg->year() - 1900;
+  timeinfo.tm_mon = msg->month() - 1;
+  timeinfo.tm_mday = msg->day();
+  timeinfo.tm_hour = msg->hour();
+  timeinfo.tm_min = msg->min();
+  timeinfo.tm_sec = msg->sec();
+
+  std::time_t utc_tt = timegm(&timeinfo);
+  gpsLoc.setUnixTimestampMillis(utc_tt * 1e+03 + msg->nano() * 1e-06);
+  float f[] = { msg->vel_n() * 1e-03f, msg->vel_e() * 1e-03f, msg->vel_d() * 1e-03f };
+  gpsLoc.setVNED(f);
+  gpsLoc.setVerticalAccuracy(msg->v_acc() * 1e-03);
+  gpsLoc.setSpeedAccuracy(msg->s_acc() * 1e-03);
+  gpsLoc.setBearingAccuracyDeg(msg->head_acc() * 1e-05);
+  return capnp::messageToFlatArray(msg_builder);
+}
+
+kj::Array<capnp::word> kaitai_rxm_rawx(ubx_t::rxm_rawx_t *msg) {
+  MessageBuilder msg_builder;
+  auto mr = msg_builder.initEvent().initUbloxGnss().initMeasurementReport();
+  mr.setRcvTow(msg->rcv_tow());
+  mr.setGpsWeek(msg->week());
+  mr.setLeapSeconds(msg->leap_s());
+
+  auto mb = mr.initMeasurements(msg->num_meas());
+  auto measurements = *msg->meas();
+  for (int i = 0; i < msg->num_meas(); i++) {
+    mb[i].setSvId(measurements[i]->sv_id());
+    mb[i].setPseudorange(measurements[i]->pr_mes());
+    mb[i].setCarrierCycles(measurements[i]->cp_mes());
+    mb[i].setDoppler(measurements[i]->do_mes());
+    mb[i].setGnssId(measurements[i]->gnss_id());
+    mb[i].setGlonassFrequencyIndex(measurements[i]->freq_id());
+    mb[i].setLocktime(measurements[i]->lock_time());
+    mb[i].setCno(measurements[i]->cno());
+    mb[i].setPseudorangeStdev(0.01 * (pow(2, (measurements[i]->pr_stdev() & 15))));
+    mb[i].setCarrierPhaseStdev(0.004 * (measurements[i]->cp_stdev() & 15));
+    mb[i].setDopplerStdev(0.002 * (pow(2, (measurements[i]->do_stdev() & 15))));
+
+    auto ts = mb[i].initTrackingStatus();
+    auto trk_stat = measurements[i]->trk_stat();
+    ts.setPseudorangeValid(trk_stat & 1);
+    ts.setCarrierPhaseValid(trk_stat & 2);
+    ts.setHalfCycleValid(trk_stat & 4);
+    ts.setHalfCycleSubtracted(trk_stat & 8);
+  }
+
+  mr.setNumMeas(msg->num_meas());
+  auto rs = mr.initReceiverStatus();
+  rs.setLeapSecValid(msg->rec_stat() & 1);
+  rs.setClkReset(msg->rec_stat() & 4);
+  return capnp::messageToFlatArray(msg_builder);
+}
+
+kj::Array<capnp::word> kaitai_nav_sat(ubx_t::nav_sat_t *msg) {
+  MessageBuilder msg_builder;
+  auto sr = msg_builder.initEvent().initUbloxGnss().initSatReport();
+  sr.setITow(msg->itow());
+
+  auto svs = sr.initSvs(msg->num_svs());
+  auto svs_data = *msg->svs();
+  for (int i = 0; i < msg->num_svs(); i++) {
+    svs[i].setSvId(svs_data[i]->sv_id());
+    svs[i].setGnssId(svs_data[i]->gnss_id());
+    svs[i].setFlagsBitfield(svs_data[i]->flags());
+    svs[i].setCno(svs_data[i]->cno());
+    svs[i].setElevationDeg(svs_data[i]->elev());
+    svs[i].setAzimuthDeg(svs_data[i]->azim());
+    svs[i].setPseudorangeResidual(svs_data[i]->pr_res() * 0.1);
+  }
+  return capnp::messageToFlatArray(msg_builder);
+}
+
+using Decoded = std::vector<std::pair<std::string, std::string>>;
+
+// decodes complete messages with kaitai, subframes go to the same ephemeris assembly as in ubloxd
+struct KaitaiReference {
+  Decoded decode(const std::vector<std::string> &frames) {
+    Decoded msgs;
+    for (const std::string &frame : frames) {
+      kaitai::kstream stream(frame);
+      ubx_t ubx_message(&stream);
+      auto body = ubx_message.body();
+
+      kj::Array<capnp::word> words;
+      const char *service = "ubloxGnss";
+      switch (ubx_message.msg_type()) {
+      case 0x0107:
+        service = "gpsLocationExternal";
+        words = kaitai_nav_pvt(static_cast<ubx_t::nav_pvt_t *>(body));
+        break;
+      case 0x0215:
+        words = kaitai_rxm_rawx(static_cast<ubx_t::rxm_rawx_t *>(body));
+        break;
+      case 0x0135:
+        words = kaitai_nav_sat(static_cast<ubx_t::nav_sat_t *>(body));
+        break;
+      case 0x0213: {
+        auto sfrbx = static_cast<ubx_t::rxm_sfrbx_t *>(body);
+        ublox::ubx_rxm_sfrbx_t header = {.gnss_id = (uint8_t)sfrbx->gnss_id(), .sv_id = sfrbx->sv_id(),
+                                         .freq_id = sfrbx->freq_id(), .num_words = (uint8_t)sfrbx->body()->size()};
+        std::string payload = as_bytes(header);
+        payload.append((const char *)sfrbx->body()->data(), sfrbx->body()->size() * sizeof(uint32_t));
+        words = ephemeris.gen_rxm_sfrbx(*(const ublox::ubx_rxm_sfrbx_t *)payload.data());
+        break;
+      }
+      case 0x0a09:
+        words = ephemeris.gen_mon_hw(static_cast<ubx_t::mon_hw_t *>(body));
+        break;
+      case 0x0a0b:
+        words = ephemeris.gen_mon_hw2(static_cast<ubx_t::mon_hw2_t *>(body));
+        break;
+      default:
+        break;
+      }
+      msgs.emplace_back(service, without_mono_time(words.asBytes()));
+    }
+    return msgs;
+  }
+
+  UbloxMsgParser ephemeris;
+};
+
+// messages of a stream fed in chunks of chunk_size, and the frames they were decoded from
+Decoded parse_stream(const std::string &stream, size_t chunk_size, std::vector<std::string> *frames = nullptr) {
+  Decoded msgs;
+  UbloxMsgParser parser;
+  for (size_t offset = 0; offset < stream.size(); offset += chunk_size) {
+    const uint8_t *data = (const uint8_t *)stream.data() + offset;
+    const size_t len = std::min(chunk_size, stream.size() - offset);
+    size_t bytes_consumed = 0;
+    while (bytes_consumed < len) {
+      size_t bytes_consumed_this_time = 0U;
+      if (parser.add_data(0, data + bytes_consumed, (uint32_t)(len - bytes_consumed), bytes_consumed_this_time)) {
+        if (frames) frames->push_back(parser.data());
+        auto [service, bytes] = parser.gen_msg();
+        msgs.emplace_back(service, without_mono_time(bytes));
+        parser.reset();
+      }
+      bytes_consumed += bytes_consumed_this_time;
+    }
+  }
+  return msgs;
+}
+
+void require_matches_kaitai(const std::string &stream) {
+  std::vector<std::string> frames;
+  const Decoded first = parse_stream(stream, stream.size(), &frames);
+  const Decoded expected = KaitaiReference().decode(frames);
+  REQUIRE(first.size() == expected.size());
+
+  for (size_t chunk_size : {stream.size(), (size_t)4096, (size_t)7, (size_t)1}) {
+    INFO("chunk size " << chunk_size);
+    auto msgs = chunk_size == stream.size() ? first : parse_stream(stream, chunk_size);
+    REQUIRE(msgs.size() == expected.size());
+    for (size_t i = 0; i < msgs.size(); i++) {
+      INFO("msg " << i << ", type " << std::hex << ((uint8_t)frames[i][2] << 8 | (uint8_t)frames[i][3]));
+      REQUIRE(msgs[i].first == expected[i].first);
+      REQUIRE(msgs[i].second == expected[i].second);
+    }
+  }
+}
+
+std::string synthetic_stream(int num_epochs) {
+  std::string stream;
+  for (int i = 0; i < num_epochs; i++) {
+    stream += nav_pvt();
+    stream += rxm_rawx(1 + rng() % 40);
+    stream += nav_sat(rng() % 60);
+    if (i % 10 == 0) stream += mon_hw();
+  }
+  return stream;
+}
+
+TEST_CASE("in place decoders match kaitai") {
+  std::string stream = synthetic_stream(50);
+  stream += rxm_rawx(0);
+  stream += nav_sat(0);
+
+  // complete ephemerides
+  for (int sf = 1; sf <= 3; sf++) {
+    stream += rxm_sfrbx(0, 12, 0, gps_subframe(sf, 42));
+  }
+  for (int n = 1; n <= 5; n++) {
+    stream += rxm_sfrbx(6, 3, 8, glonass_string(n));
+  }
+
+  auto msgs = parse_stream(stream, stream.size());
+  REQUIRE(msgs.size() == 50 * 3 + 5 + 2 + 8);
+  REQUIRE(msgs[msgs.size() - 6].second.size() > 0);  // GPS ephemeris
+  REQUIRE(msgs.back().second.size() > 0);  // GLONASS ephemeris
+  require_matches_kaitai(stream);
+}
+
+TEST_CASE("fixtures match kaitai") {
+  // receiver output at 10Hz, NAV-PVT, RXM-RAWX and NAV-SAT with MON-HW, MON-HW2 and ACK-ACK every second
+  const std::string path = std::string(__FILE__).substr(0, std::string(__FILE__).rfind('/')) + "/fixtures/m8_10hz.ubx";
+  const std::string stream = util::read_file(path);
+  INFO(path);
+  REQUIRE(stream.size() > 0);
+
+  auto msgs = parse_stream(stream, stream.size());
+  REQUIRE(msgs.size() == 12 * 3 + 2 * 3);
+  REQUIRE(msgs[0].first == "gpsLocationExternal");
+  // only the acks aren't decoded
+  REQUIRE(std::count_if(msgs.begin(), msgs.end(), [](auto &msg) { return msg.second.empty(); }) == 2);
+  require_matches_kaitai(stream);
+}
+
+TEST_CASE("framing drops garbage and corrupted messages") {
+  std::string good = nav_pvt();
+  std::string corrupted = nav_pvt();
+  corrupted[20] ^= 0xff;
+
+  std::string stream = "\x01\x02\xb5\x03"s + good + corrupted + "\xb5\x62\x01"s + good;
+  const Decoded expected = KaitaiReference().decode({good, good});
+  for (size_t chunk_size : {stream.size(), (size_t)33, (size_t)1}) {
+    INFO("chunk size " << chunk_size);
+    auto msgs = parse_stream(stream, chunk_size);
+    REQUIRE(msgs.size() == 2);
+    REQUIRE(msgs[0].first == "gpsLocationExternal");
+    REQUIRE(msgs == expected);
+  }
+}
+
+TEST_CASE("truncated messages are dropped") {
+  std::string pvt = nav_pvt();
+  std::string truncated = ubx_frame(0x0107, pvt.substr(ublox::UBLOX_HEADER_SIZE, 40));
+  std::string rawx = rxm_rawx(10);
+  rawx = ubx_frame(0x0215, rawx.substr(ublox::UBLOX_HEADER_SIZE, 16 + 5 * 32));
+
+  auto msgs = parse_stream(truncated + rawx + pvt, 4096);
+  REQUIRE(msgs.size() == 3);
+  REQUIRE(msgs[0].second.empty());
+  REQUIRE(msgs[1].second.empty());
+  REQUIRE(msgs[2].second.size() > 0);
+}
+
+TEST_CASE("ubloxd throughput", "[.][benchmark]") {
+  const std::string stream = synthetic_stream(1000);
+  std::vector<std::string> frames;
+  parse_stream(stream, stream.size(), &frames);
+
+  // ubloxRaw messages are at most a few KB
+  BENCHMARK("kaitai") { return KaitaiReference().decode(frames).size(); };
+  BENCHMARK("in place") { return parse_stream(stream, 4096).size(); };
+}
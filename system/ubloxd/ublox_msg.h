@@ -4,14 +4,14 @@
 #include <cstdint>
 #include <ctime>
 #include <memory>
+#include <vector>
 #include <string>
 #include <unordered_map>
 #include <utility>
 
 #include "cereal/messaging/messaging.h"
 #include "common/util.h"
-#include "system/ubloxd/generated/gps.h"
-#include "system/ubloxd/generated/glonass.h"
+#include "system/ubloxd/ephemeris.h"
 #include "system/ubloxd/generated/ubx.h"
 
 using namespace std::string_literals;
@@ -48,6 +48,106 @@ namespace ublox {
     uint32_t tAccNs;
   } __attribute__((packed));
 
+  // views of the high rate message payloads with the layouts in ubx.ksy, decoded in place
+  struct ubx_nav_pvt_t {
+    uint32_t i_tow;
+    uint16_t year;
+    uint8_t month;
+    uint8_t day;
+    uint8_t hour;
+    uint8_t min;
+    uint8_t sec;
+    uint8_t valid;
+    uint32_t t_acc;
+    int32_t nano;
+    uint8_t fix_type;
+    uint8_t flags;
+    uint8_t flags2;
+    uint8_t num_sv;
+    int32_t lon;
+    int32_t lat;
+    int32_t height;
+    int32_t h_msl;
+    uint32_t h_acc;
+    uint32_t v_acc;
+    int32_t vel_n;
+    int32_t vel_e;
+    int32_t vel_d;
+    int32_t g_speed;
+    int32_t head_mot;
+    int32_t s_acc;
+    uint32_t head_acc;
+    uint16_t p_dop;
+    uint8_t flags3;
+    uint8_t reserved1[5];
+    int32_t head_veh;
+    int16_t mag_dec;
+    uint16_t mag_acc;
+  } __attribute__((packed));
+  static_assert(sizeof(ubx_nav_pvt_t) == 92);
+
+  struct ubx_rxm_rawx_meas_t {
+    double pr_mes;
+    double cp_mes;
+    float do_mes;
+    uint8_t gnss_id;
+    uint8_t sv_id;
+    uint8_t reserved2;
+    uint8_t freq_id;
+    uint16_t lock_time;
+    uint8_t cno;
+    uint8_t pr_stdev;
+    uint8_t cp_stdev;
+    uint8_t do_stdev;
+    uint8_t trk_stat;
+    uint8_t reserved3;
+  } __attribute__((packed));
+  static_assert(sizeof(ubx_rxm_rawx_meas_t) == 32);
+
+  struct ubx_rxm_rawx_t {
+    double rcv_tow;
+    uint16_t week;
+    int8_t leap_s;
+    uint8_t num_meas;
+    uint8_t rec_stat;
+    uint8_t reserved1[3];
+    ubx_rxm_rawx_meas_t meas[];
+  } __attribute__((packed));
+  static_assert(sizeof(ubx_rxm_rawx_t) == 16);
+
+  struct ubx_nav_sat_sv_t {
+    uint8_t gnss_id;
+    uint8_t sv_id;
+    uint8_t cno;
+    int8_t elev;
+    int16_t azim;
+    int16_t pr_res;
+    uint32_t flags;
+  } __attribute__((packed));
+  static_assert(sizeof(ubx_nav_sat_sv_t) == 12);
+
+  struct ubx_nav_sat_t {
+    uint32_t itow;
+    uint8_t version;
+    uint8_t num_svs;
+    uint8_t reserved[2];
+    ubx_nav_sat_sv_t svs[];
+  } __attribute__((packed));
+  static_assert(sizeof(ubx_nav_sat_t) == 8);
+
+  struct ubx_rxm_sfrbx_t {
+    uint8_t gnss_id;
+    uint8_t sv_id;
+    uint8_t reserved1;
+    uint8_t freq_id;
+    uint8_t num_words;
+    uint8_t reserved2;
+    uint8_t version;
+    uint8_t reserved3;
+    uint32_t words[];
+  } __attribute__((packed));
+  static_assert(sizeof(ubx_rxm_sfrbx_t) == 8);
+
   inline std::string ubx_add_checksum(const std::string &msg) {
     assert(msg.size() > 2);
 
@@ -92,40 +192,56 @@ namespace ublox {
 
 class UbloxMsgParser {
   public:
+    UbloxMsgParser();
+    // A complete message is framed in place when it's fully contained in incoming_data,
+    // and only reassembled in the parse buffer when it's split across calls.
     bool add_data(float log_time, const uint8_t *incoming_data, uint32_t incoming_data_len, size_t &bytes_consumed);
-    inline void reset() {bytes_in_parse_buf = 0;}
+    inline void reset() {bytes_in_parse_buf = 0; msg_buf = nullptr; msg_size = 0;}
     inline int needed_bytes();
-    inline std::string data() {return std::string((const char*)msg_parse_buf, bytes_in_parse_buf);}
+    inline std::string data() {return std::string((const char*)msg_buf, msg_size);}
 
-    std::pair<std::string, kj::Array<capnp::word>> gen_msg();
-    kj::Array<capnp::word> gen_nav_pvt(ubx_t::nav_pvt_t *msg);
-    kj::Array<capnp::word> gen_rxm_sfrbx(ubx_t::rxm_sfrbx_t *msg);
-    kj::Array<capnp::word> gen_rxm_rawx(ubx_t::rxm_rawx_t *msg);
+    // The returned bytes are valid until the next call. The high rate messages are
+    // decoded from packed views into a reused arena, the hardware status with kaitai.
+    std::pair<const char *, kj::ArrayPtr<const capnp::byte>> gen_msg();
     kj::Array<capnp::word> gen_mon_hw(ubx_t::mon_hw_t *msg);
     kj::Array<capnp::word> gen_mon_hw2(ubx_t::mon_hw2_t *msg);
-    kj::Array<capnp::word> gen_nav_sat(ubx_t::nav_sat_t *msg);
+
+    void gen_nav_pvt(const ublox::ubx_nav_pvt_t &msg, MessageBuilder &msg_builder);
+    void gen_rxm_rawx(const ublox::ubx_rxm_rawx_t &msg, MessageBuilder &msg_builder);
+    void gen_nav_sat(const ublox::ubx_nav_sat_t &msg, MessageBuilder &msg_builder);
+    kj::Array<capnp::word> gen_rxm_sfrbx(const ublox::ubx_rxm_sfrbx_t &msg);
 
   private:
     inline bool valid_cheksum();
     inline bool valid();
     inline bool valid_so_far();
+    bool frame_in_place(const uint8_t *incoming_data, uint32_t incoming_data_len, size_t &bytes_consumed);
+    kj::ArrayPtr<const capnp::byte> serialize(MessageBuilder &msg_builder);
 
-    kj::Array<capnp::word> parse_gps_ephemeris(ubx_t::rxm_sfrbx_t *msg);
-    kj::Array<capnp::word> parse_glonass_ephemeris(ubx_t::rxm_sfrbx_t *msg);
+    kj::Array<capnp::word> parse_gps_ephemeris(uint8_t sv_id, kj::ArrayPtr<const uint32_t> words);
+    kj::Array<capnp::word> parse_glonass_ephemeris(uint8_t sv_id, uint8_t freq_id, kj::ArrayPtr<const uint32_t> words);
 
-    std::unordered_map<int, std::unordered_map<int, std::string>> gps_subframes;
+    ublox::GpsEphemerisAssembler gps_assembler;
+    ublox::GlonassEphemerisAssembler glonass_assembler;
 
     float last_log_time = 0.0;
     size_t bytes_in_parse_buf = 0;
     uint8_t msg_parse_buf[ublox::UBLOX_HEADER_SIZE + ublox::UBLOX_MAX_MSG_SIZE];
 
+    // the current message, either in the caller's buffer or in msg_parse_buf
+    const uint8_t *msg_buf = nullptr;
+    size_t msg_size = 0;
+
+    // first segment for the message builders, large enough for a full RAWX or NAV-SAT
+    static const size_t ARENA_WORDS = 4096;
+    kj::Array<capnp::word> arena;
+    std::vector<capnp::byte> out_buf;
+    // output of the decoders that build their own message
+    kj::Array<capnp::word> out_words;
+
     // user range accuracy in meters
     const std::unordered_map<uint8_t, float> glonass_URA_lookup =
       {{ 0,  1}, { 1,   2}, { 2, 2.5}, { 3,   4}, { 4,  5}, {5, 7},
        { 6, 10}, { 7,  12}, { 8,  14}, { 9,  16}, {10, 32},
        {11, 64}, {12, 128}, {13, 256}, {14, 512}, {15, 1024}};
-
-    std::unordered_map<int, std::unordered_map<int, std::string>> glonass_strings;
-    std::unordered_map<int, std::unordered_map<int, long>> glonass_string_times;
-    std::unordered_map<int, std::unordered_map<int, int>> glonass_string_superframes;
 };
@@ -249,6 +249,7 @@ std::tuple<int, int, bool> BinaryView::getSelection(QModelIndex index) {
 void BinaryViewModel::refresh() {
   beginResetModel();
   bit_flip_tracker = {};
+  bit_flip_index.clear();
   items.clear();
   if (auto dbc_msg = dbc()->msg(msg_id)) {
     row_count = dbc_msg->size;
@@ -340,35 +341,21 @@ void BinaryViewModel::updateState() {
   }
 }
 
-const std::vector<std::array<uint32_t, 8>> &BinaryViewModel::getBitFlipChanges(size_t msg_size) {
+const BitFlipCounts &BinaryViewModel::getBitFlipChanges(size_t msg_size) {
   // Return cached results if time range and data are unchanged
+  const auto &events = can->events(msg_id);
   auto time_range = can->timeRange();
-  if (bit_flip_tracker.time_range == time_range && !bit_flip_tracker.flip_counts.empty())
+  if (bit_flip_tracker.time_range == time_range && bit_flip_tracker.event_count == events.size() &&
+      !bit_flip_tracker.flip_counts.empty())
     return bit_flip_tracker.flip_counts;
 
   bit_flip_tracker.time_range = time_range;
-  bit_flip_tracker.flip_counts.assign(msg_size, std::array<uint32_t, 8>{});
+  bit_flip_tracker.event_count = events.size();
 
-  // Iterate over events within the specified time range and calculate bit flips
+  // Index the new events, then any time range is answered without walking its events
+  bit_flip_index.update(events);
   auto [first, last] = can->eventsInRange(msg_id, time_range);
-  if (std::distance(first, last) <= 1) return bit_flip_tracker.flip_counts;
-
-  std::vector<uint8_t> prev_values((*first)->dat, (*first)->dat + (*first)->size);
-  for (auto it = std::next(first); it != last; ++it) {
-    const CanEvent *event = *it;
-    int size = std::min<int>(msg_size, event->size);
-    for (int i = 0; i < size; ++i) {
-      const uint8_t diff = event->dat[i] ^ prev_values[i];
-      if (!diff) continue;
-
-      auto &bit_flips = bit_flip_tracker.flip_counts[i];
-      for (int bit = 0; bit < 8; ++bit) {
-        if (diff & (1u << bit)) ++bit_flips[7 - bit];
-      }
-      prev_values[i] = event->dat[i];
-    }
-  }
-
+  bit_flip_index.query(first - events.begin(), last - events.begin(), msg_size, bit_flip_tracker.flip_counts);
   return bit_flip_tracker.flip_counts;
 }
 
@@ -10,6 +10,7 @@
 
 #include "tools/cabana/dbc/dbcmanager.h"
 #include "tools/cabana/streams/abstractstream.h"
+#include "tools/cabana/utils/bitflipindex.h"
 
 class BinaryItemDelegate : public QStyledItemDelegate {
 public:
@@ -39,12 +40,14 @@ public:
   Qt::ItemFlags flags(const QModelIndex &index) const override {
     return (index.column() == column_count - 1) ? Qt::ItemIsEnabled : Qt::ItemIsEnabled | Qt::ItemIsSelectable;
   }
-  const std::vector<std::array<uint32_t, 8>> &getBitFlipChanges(size_t msg_size);
+  const BitFlipCounts &getBitFlipChanges(size_t msg_size);
 
   struct BitFlipTracker {
     std::optional<std::pair<double, double>> time_range;
-    std::vector<std::array<uint32_t, 8>> flip_counts;
+    size_t event_count = 0;
+    BitFlipCounts flip_counts;
   } bit_flip_tracker;
+  BitFlipIndex bit_flip_index;
 
   struct Item {
     QColor bg_color = QColor(102, 86, 169, 255);
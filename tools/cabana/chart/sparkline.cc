@@ -1,100 +1,230 @@
 #include "tools/cabana/chart/sparkline.h"
 
 #include <algorithm>
-#include <limits>
+#include <cmath>
 #include <QPainter>
 
-void Sparkline::update(const cabana::Signal *sig, CanEventIter first, CanEventIter last, int range, QSize size) {
-  if (first == last || size.isEmpty()) {
-    pixmap = QPixmap();
+void updateSparklines(const std::vector<std::pair<const cabana::Signal *, Sparkline *>> &lines,
+                      CanEventIter first, CanEventIter last, int range, int width) {
+  if (first == last || width <= 0) {
+    for (auto &[_, sparkline] : lines) sparkline->reset();
     return;
   }
 
+  const uint64_t start_time = (*first)->mono_time;
+  const uint64_t bucket_width = std::max<uint64_t>(1, range * 1e9 / std::max(width - 1, 1));
+
+  // continue from the last decoded event if it is still in range, otherwise start over
+  struct Line {
+    size_t from;
+    const cabana::Signal *sig;
+    Sparkline *sparkline;
+  };
+  std::vector<Line> todo;
+  todo.reserve(lines.size());
+  for (auto &[sig, sparkline] : lines) {
+    size_t from = 0;
+    if (sparkline->last_event_ && sparkline->window_start_ <= start_time) {
+      auto it = std::lower_bound(first, last, sparkline->last_event_->mono_time, CompareCanEvent());
+      while (it != last && *it != sparkline->last_event_ && (*it)->mono_time == sparkline->last_event_->mono_time) ++it;
+      if (it != last && *it == sparkline->last_event_) {
+        from = std::distance(first, it) + 1;
+      } else {
+        sparkline->reset();
+      }
+    } else {
+      sparkline->reset();
+    }
+    sparkline->setBucketWidth(bucket_width);
+    sparkline->dropBefore(start_time);
+    sparkline->window_start_ = start_time;
+    sparkline->last_event_ = *std::prev(last);
+    todo.push_back({from, sig, sparkline});
+  }
+
+  // one pass over the events, a sparkline joins once the pass reaches its first new event
+  std::sort(todo.begin(), todo.end(), [](auto &l, auto &r) { return l.from < r.from; });
+  const size_t count = std::distance(first, last);
+  size_t active = 0;
+  double value = 0;
+  for (size_t i = todo.empty() ? count : todo[0].from; i < count; ++i) {
+    while (active < todo.size() && todo[active].from <= i) ++active;
+    const CanEvent *e = *(first + i);
+    for (size_t j = 0; j < active; ++j) {
+      if (todo[j].sig->getValue(e->dat, e->size, &value)) {
+        todo[j].sparkline->append(e->mono_time, value);
+      }
+    }
+  }
+
+  for (auto &line : todo) line.sparkline->updateStats();
+}
+
+void Sparkline::reset() {
   points_.clear();
-  min_val = std::numeric_limits<double>::max();
-  max_val = std::numeric_limits<double>::lowest();
-  points_.reserve(std::distance(first, last));
-
-  uint64_t start_time = (*first)->mono_time;
-  double value = 0.0;
-  for (auto it = first; it != last; ++it) {
-    if (sig->getValue((*it)->dat, (*it)->size, &value)) {
-      min_val = std::min(min_val, value);
-      max_val = std::max(max_val, value);
-      points_.emplace_back(((*it)->mono_time - start_time) / 1e9, value);
+  buckets_.clear();
+  min_queue_.clear();
+  max_queue_.clear();
+  front_index_ = 0;
+  last_event_ = nullptr;
+  freq_ = min_val = max_val = 0;
+  dirty_ = true;
+}
+
+void Sparkline::append(uint64_t mono_time, double value) {
+  const uint64_t index = front_index_ + points_.size();
+  points_.push_back({mono_time, value});
+  while (!min_queue_.empty() && points_[min_queue_.back() - front_index_].value >= value) min_queue_.pop_back();
+  min_queue_.push_back(index);
+  while (!max_queue_.empty() && points_[max_queue_.back() - front_index_].value <= value) max_queue_.pop_back();
+  max_queue_.push_back(index);
+  addToBuckets(points_.back());
+  dirty_ = true;
+}
+
+void Sparkline::dropBefore(uint64_t mono_time) {
+  bool dropped = false;
+  while (!points_.empty() && points_.front().mono_time < mono_time) {
+    if (min_queue_.front() == front_index_) min_queue_.pop_front();
+    if (max_queue_.front() == front_index_) max_queue_.pop_front();
+    points_.pop_front();
+    ++front_index_;
+    dropped = true;
+  }
+  if (!dropped) return;
+
+  while (!buckets_.empty() && buckets_.front().last.mono_time < mono_time) buckets_.pop_front();
+  if (!buckets_.empty() && buckets_.front().first.mono_time < mono_time) {
+    // the bucket lost its first points, take it again from the ones left
+    const uint64_t id = points_.front().mono_time / bucket_width_;
+    Bucket b = {points_.front(), points_.front(), points_.front(), points_.front()};
+    for (auto it = std::next(points_.begin()); it != points_.end() && it->mono_time / bucket_width_ == id; ++it) {
+      if (it->value < b.min.value) b.min = *it;
+      if (it->value > b.max.value) b.max = *it;
+      b.last = *it;
     }
+    buckets_.front() = b;
   }
+  dirty_ = true;
+}
 
+void Sparkline::setBucketWidth(uint64_t width) {
+  if (width == bucket_width_) return;
+
+  bucket_width_ = width;
+  buckets_.clear();
+  for (const auto &p : points_) addToBuckets(p);
+  dirty_ = true;
+}
+
+void Sparkline::addToBuckets(const Point &p) {
+  if (buckets_.empty() || buckets_.back().first.mono_time / bucket_width_ != p.mono_time / bucket_width_) {
+    buckets_.push_back({p, p, p, p});
+    return;
+  }
+  auto &b = buckets_.back();
+  if (p.value < b.min.value) b.min = p;
+  if (p.value > b.max.value) b.max = p;
+  b.last = p;
+}
+
+void Sparkline::updateStats() {
   if (points_.empty()) {
+    freq_ = min_val = max_val = 0;
+    return;
+  }
+  min_val = points_[min_queue_.front() - front_index_].value;
+  max_val = points_[max_queue_.front() - front_index_].value;
+  freq_ = points_.size() / std::max((points_.back().mono_time - points_.front().mono_time) / 1e9, 1.0);
+}
+
+void Sparkline::render(const QColor &color, int range, QSize size) {
+  if (points_.empty() || size.isEmpty()) {
     pixmap = QPixmap();
     return;
   }
+  if (!dirty_ && !pixmap.isNull() && color == rendered_color_ && range == rendered_range_ && size == rendered_size_) {
+    return;
+  }
+  dirty_ = false;
+  rendered_color_ = color;
+  rendered_range_ = range;
+  rendered_size_ = size;
+  renderPoints(range, size);
 
-  freq_ = points_.size() / std::max(points_.back().x() - points_.front().x(), 1.0);
-  render(sig->color, range, size);
+  // Render to pixmap
+  qreal dpr = qApp->devicePixelRatio();
+  const QSize pixmap_size = size * dpr;
+  if (pixmap.size() != pixmap_size) {
+    pixmap = QPixmap(pixmap_size);
+  }
+  pixmap.setDevicePixelRatio(dpr);
+  pixmap.fill(Qt::transparent);
+  QPainter painter(&pixmap);
+  painter.setRenderHint(QPainter::Antialiasing, render_points_.size() <= 500);
+  painter.setPen(color);
+  painter.drawPolyline(render_points_.data(), render_points_.size());
+
+  painter.setPen(QPen(color, 3));
+  if (draw_individual_points_) {
+    painter.drawPoints(render_points_.data(), render_points_.size());
+  } else {
+    painter.drawPoint(render_points_.back());
+  }
 }
 
-void Sparkline::render(const QColor &color, int range, QSize size) {
+const std::vector<QPointF> &Sparkline::renderPoints(int range, QSize size) {
+  render_points_.clear();
+  if (points_.empty() || size.isEmpty()) return render_points_;
+
   // Adjust for flat lines
-  bool is_flat_line = min_val == max_val;
+  double min = min_val, max = max_val;
+  bool is_flat_line = min == max;
   if (is_flat_line) {
-    min_val -= 1.0;
-    max_val += 1.0;
+    min -= 1.0;
+    max += 1.0;
   }
 
   // Calculate scaling
   const double xscale = (size.width() - 1) / (double)range;
-  const double yscale = (size.height() - 3) / (max_val - min_val);
-  bool draw_individual_points = (points_.back().x() * xscale / points_.size()) > 8.0;
+  const double yscale = (size.height() - 3) / (max - min);
+  auto to_point = [&](const Point &p) { return QPointF((p.mono_time - window_start_) / 1e9 * xscale, 1.0 + (max - p.value) * yscale); };
+  draw_individual_points_ = (to_point(points_.back()).x() / points_.size()) > 8.0;
 
   // Transform or downsample points
-  render_points_.reserve(points_.size());
-  render_points_.clear();
-  if (draw_individual_points) {
+  if (draw_individual_points_) {
+    render_points_.reserve(points_.size());
     for (const auto &p : points_) {
-      render_points_.emplace_back(p.x() * xscale, 1.0 + (max_val - p.y()) * yscale);
+      render_points_.push_back(to_point(p));
     }
   } else if (is_flat_line) {
     double y = size.height() / 2.0;
     render_points_.emplace_back(0.0, y);
-    render_points_.emplace_back(points_.back().x() * xscale, y);
+    render_points_.emplace_back(to_point(points_.back()).x(), y);
   } else {
-    double prev_y = points_.front().y();
-    render_points_.emplace_back(points_.front().x() * xscale, 1.0 + (max_val - prev_y) * yscale);
+    // the first, min, max and last value of each bucket, flat runs are reduced to their ends
+    const Point *prev = nullptr;
     bool in_flat = false;
-
-    for (size_t i = 1; i < points_.size(); ++i) {
-      const auto &p = points_[i];
-      double y = p.y();
-      if (std::abs(y - prev_y) < 1e-6) {
+    auto add = [&](const Point &p) {
+      if (prev && std::abs(p.value - prev->value) < 1e-6) {
         in_flat = true;
       } else {
-        if (in_flat) render_points_.emplace_back(points_[i - 1].x() * xscale, 1.0 + (max_val - prev_y) * yscale);
-        render_points_.emplace_back(p.x() * xscale, 1.0 + (max_val - y) * yscale);
+        if (in_flat) render_points_.push_back(to_point(*prev));
+        render_points_.push_back(to_point(p));
         in_flat = false;
       }
-      prev_y = y;
+      prev = &p;
+    };
+    for (const auto &b : buckets_) {
+      add(b.first);
+      const Point *lo = &b.min, *hi = &b.max;
+      if (hi->mono_time < lo->mono_time) std::swap(lo, hi);
+      for (const Point *p : {lo, hi}) {
+        if (p->mono_time != b.first.mono_time && p->mono_time != b.last.mono_time) add(*p);
+      }
+      if (b.last.mono_time != b.first.mono_time) add(b.last);
     }
-    if (in_flat) render_points_.emplace_back(points_.back().x() * xscale, 1.0 + (max_val - prev_y) * yscale);
-  }
-
-  // Render to pixmap
-  qreal dpr = qApp->devicePixelRatio();
-  const QSize pixmap_size = size * dpr;
-  if (pixmap.size() != pixmap_size) {
-    pixmap = QPixmap(pixmap_size);
-  }
-  pixmap.setDevicePixelRatio(dpr);
-  pixmap.fill(Qt::transparent);
-  QPainter painter(&pixmap);
-  painter.setRenderHint(QPainter::Antialiasing, render_points_.size() <= 500);
-  painter.setPen(color);
-  painter.drawPolyline(render_points_.data(), render_points_.size());
-
-  painter.setPen(QPen(color, 3));
-  if (draw_individual_points) {
-    painter.drawPoints(render_points_.data(), render_points_.size());
-  } else {
-    painter.drawPoint(render_points_.back());
+    if (in_flat) render_points_.push_back(to_point(*prev));
   }
+  return render_points_;
 }
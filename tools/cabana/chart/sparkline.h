@@ -1,16 +1,26 @@
 #pragma once
 
+#include <QColor>
 #include <QPixmap>
 #include <QPointF>
+#include <deque>
+#include <utility>
 #include <vector>
 
 #include "tools/cabana/dbc/dbc.h"
 #include "tools/cabana/streams/abstractstream.h"
 
+// The values of a signal over the sparkline range, kept up to date as the range slides.
+// Min and max come from monotonic queues, the pixels from min/max buckets of a fixed time width,
+// so neither is recomputed over the whole range on every update.
 class Sparkline {
 public:
-  void update(const cabana::Signal *sig, CanEventIter first, CanEventIter last, int range, QSize size);
+  void render(const QColor &color, int range, QSize size);
+  // the polyline render() draws for the range and size, in pixels
+  const std::vector<QPointF> &renderPoints(int range, QSize size);
+  void reset();
   inline double freq() const { return freq_; }
+  inline size_t size() const { return points_.size(); }
   bool isEmpty() const { return pixmap.isNull(); }
 
   QPixmap pixmap;
@@ -18,9 +28,42 @@ public:
   double max_val = 0;
 
 private:
-  void render(const QColor &color, int range, QSize size);
+  struct Point {
+    uint64_t mono_time;
+    double value;
+  };
+  struct Bucket {
+    Point first, min, max, last;
+  };
 
-  std::vector<QPointF> points_;
-  std::vector<QPointF> render_points_;
+  void append(uint64_t mono_time, double value);
+  void dropBefore(uint64_t mono_time);
+  void setBucketWidth(uint64_t width);
+  void addToBuckets(const Point &p);
+  void updateStats();
+
+  std::deque<Point> points_;
+  std::deque<Bucket> buckets_;
+  // indexes of points_ offset by front_index_, the values increase in min_queue_ and decrease in max_queue_
+  std::deque<uint64_t> min_queue_, max_queue_;
+  uint64_t front_index_ = 0;
+  uint64_t bucket_width_ = 0;
+  uint64_t window_start_ = 0;
+  const CanEvent *last_event_ = nullptr;
   double freq_ = 0;
+
+  bool dirty_ = true;
+  QColor rendered_color_;
+  int rendered_range_ = 0;
+  QSize rendered_size_;
+  std::vector<QPointF> render_points_;
+  bool draw_individual_points_ = false;
+
+  friend void updateSparklines(const std::vector<std::pair<const cabana::Signal *, Sparkline *>> &lines,
+                               CanEventIter first, CanEventIter last, int range, int width);
 };
+
+// Brings the sparklines of a message to the events in [first, last). The events each sparkline
+// has not seen yet are decoded for all signals in one pass, older values are dropped.
+void updateSparklines(const std::vector<std::pair<const cabana::Signal *, Sparkline *>> &lines,
+                      CanEventIter first, CanEventIter last, int range, int width);
@@ -5,10 +5,21 @@
 #include <QFileDialog>
 #include <QPainter>
 #include <QVBoxLayout>
+#include <QtConcurrent>
 
 #include "tools/cabana/commands.h"
 #include "tools/cabana/utils/export.h"
 
+HistoryLogModel::HistoryLogModel(QObject *parent) : QAbstractTableModel(parent) {
+  QObject::connect(&filter_watcher, &QFutureWatcher<bool>::finished, [this]() {
+    if (filter_watcher.result()) updateState(true);
+  });
+}
+
+HistoryLogModel::~HistoryLogModel() {
+  cancelFilter();
+}
+
 QVariant HistoryLogModel::data(const QModelIndex &index, int role) const {
   const auto &m = messages[index.row()];
   const int col = index.column();
@@ -68,12 +79,29 @@ void HistoryLogModel::setHexMode(bool hex) {
 }
 
 void HistoryLogModel::setFilter(int sig_idx, const QString &value, std::function<bool(double, double)> cmp) {
+  cancelFilter();
   filter_sig_idx = sig_idx;
   filter_value = value.toDouble();
   filter_cmp = value.isEmpty() ? nullptr : cmp;
+  if (filter_cmp) {
+    startFilter();
+  }
   updateState(true);
 }
 
+void HistoryLogModel::startFilter() {
+  cancelFilter();
+  filter = std::make_unique<LogFilter>(can->events(msg_id), *sigs[filter_sig_idx], filter_value, filter_cmp);
+  abort_filter = false;
+  filter_watcher.setFuture(QtConcurrent::run([this]() { return filter->run(&abort_filter); }));
+}
+
+void HistoryLogModel::cancelFilter() {
+  abort_filter = true;
+  filter_watcher.waitForFinished();
+  filter.reset();
+}
+
 void HistoryLogModel::updateState(bool clear) {
   if (clear && !messages.empty()) {
     beginRemoveRows({}, 0, messages.size() - 1);
@@ -96,23 +124,47 @@ void HistoryLogModel::fetchMore(const QModelIndex &parent) {
 
 void HistoryLogModel::fetchData(std::deque<Message>::iterator insert_pos, uint64_t from_time, uint64_t min_time) {
   const auto &events = can->events(msg_id);
-  auto first = std::upper_bound(events.rbegin(), events.rend(), from_time, [](uint64_t ts, auto e) {
-    return ts > e->mono_time;
-  });
+  if (filter_cmp) {
+    // wait for the matches, and index again if the events changed other than by new ones
+    if (!filter || isFiltering()) return;
+    if (!filter->follows(events)) {
+      startFilter();
+      return;
+    }
+  }
 
   std::vector<HistoryLogModel::Message> msgs;
   std::vector<double> values(sigs.size());
   msgs.reserve(batch_size);
-  for (; first != events.rend() && (*first)->mono_time > min_time; ++first) {
-    const CanEvent *e = *first;
+  // returns true when the batch is full
+  auto add = [&](const CanEvent *e) {
+    bool matched = true;
     for (int i = 0; i < sigs.size(); ++i) {
-      sigs[i]->getValue(e->dat, e->size, &values[i]);
+      bool valid = sigs[i]->getValue(e->dat, e->size, &values[i]);
+      if (filter_cmp && i == filter_sig_idx) matched = valid && filter_cmp(values[i], filter_value);
     }
-    if (!filter_cmp || filter_cmp(values[filter_sig_idx], filter_value)) {
-       msgs.emplace_back(Message{e->mono_time, values, {e->dat, e->dat + e->size}});
-      if (msgs.size() >= batch_size && min_time == 0) {
-        break;
-      }
+    if (matched) {
+      msgs.emplace_back(Message{e->mono_time, values, {e->dat, e->dat + e->size}});
+    }
+    return matched && msgs.size() >= batch_size && min_time == 0;
+  };
+
+  auto first = std::upper_bound(events.rbegin(), events.rend(), from_time, [](uint64_t ts, auto e) {
+    return ts > e->mono_time;
+  });
+  // the events after the indexed ones are checked here, the older ones come from the matches
+  const size_t indexed = filter_cmp ? filter->size() : 0;
+  bool full = false;
+  for (; first != events.rend() && (size_t)std::distance(first, events.rend()) > indexed && (*first)->mono_time > min_time; ++first) {
+    if ((full = add(*first))) break;
+  }
+  if (filter_cmp && !full) {
+    const auto &matches = filter->matches();
+    auto it = std::lower_bound(matches.begin(), matches.end(), from_time, [&](uint32_t i, uint64_t ts) {
+      return events[i]->mono_time < ts;
+    });
+    while (it != matches.begin() && events[*std::prev(it)]->mono_time > min_time) {
+      if (add(events[*--it])) break;
     }
   }
 
@@ -177,6 +229,10 @@ LogsWidget::LogsWidget(QWidget *parent) : QFrame(parent) {
   filter_layout->addWidget(comp_box = new QComboBox(this));
   filter_layout->addWidget(value_edit = new QLineEdit(this));
   h->addWidget(filters_widget);
+  h->addWidget(filter_progress = new QProgressBar(this));
+  filter_progress->setRange(0, 100);
+  filter_progress->setMaximumWidth(150);
+  filter_progress->setVisible(false);
   h->addStretch(0);
   export_btn = new ToolButton("filetype-csv", tr("Export to CSV file..."));
   h->addWidget(export_btn, 0, Qt::AlignRight);
@@ -211,6 +267,8 @@ LogsWidget::LogsWidget(QWidget *parent) : QFrame(parent) {
   QObject::connect(UndoStack::instance(), &QUndoStack::indexChanged, model, &HistoryLogModel::reset);
   QObject::connect(model, &HistoryLogModel::modelReset, this, &LogsWidget::modelReset);
   QObject::connect(model, &HistoryLogModel::rowsInserted, [this]() { export_btn->setEnabled(true); });
+  QObject::connect(&filter_progress_timer, &QTimer::timeout, this, &LogsWidget::updateFilterProgress);
+  filter_progress_timer.setInterval(100);
 }
 
 void LogsWidget::modelReset() {
@@ -235,6 +293,14 @@ void LogsWidget::filterChanged() {
     case 3: cmp = std::less<double>{}; break;
   }
   model->setFilter(signals_cb->currentIndex(), value_edit->text(), cmp);
+  updateFilterProgress();
+  if (model->isFiltering()) filter_progress_timer.start();
+}
+
+void LogsWidget::updateFilterProgress() {
+  filter_progress->setVisible(model->isFiltering());
+  filter_progress->setValue(model->filterProgress() * 100);
+  if (!model->isFiltering()) filter_progress_timer.stop();
 }
 
 void LogsWidget::exportToCSV() {
@@ -1,15 +1,21 @@
 #pragma once
 
+#include <atomic>
 #include <deque>
+#include <memory>
 #include <vector>
 
 #include <QComboBox>
+#include <QFutureWatcher>
 #include <QHeaderView>
 #include <QLineEdit>
+#include <QProgressBar>
 #include <QTableView>
+#include <QTimer>
 
 #include "tools/cabana/dbc/dbcmanager.h"
 #include "tools/cabana/streams/abstractstream.h"
+#include "tools/cabana/utils/logfilter.h"
 
 class HeaderView : public QHeaderView {
 public:
@@ -22,7 +28,8 @@ class HistoryLogModel : public QAbstractTableModel {
   Q_OBJECT
 
 public:
-  HistoryLogModel(QObject *parent) : QAbstractTableModel(parent) {}
+  HistoryLogModel(QObject *parent);
+  ~HistoryLogModel();
   void setMessage(const MessageId &message_id);
   void updateState(bool clear = false);
   void setFilter(int sig_idx, const QString &value, std::function<bool(double, double)> cmp);
@@ -35,6 +42,8 @@ public:
   inline bool isHexMode() const { return sigs.empty() || hex_mode; }
   void reset();
   void setHexMode(bool hex_mode);
+  inline bool isFiltering() const { return filter_watcher.isRunning(); }
+  inline float filterProgress() const { return filter ? filter->progress() : 1.0f; }
 
   struct Message {
     uint64_t mono_time = 0;
@@ -44,6 +53,8 @@ public:
   };
 
   void fetchData(std::deque<Message>::iterator insert_pos, uint64_t from_time, uint64_t min_time);
+  void startFilter();
+  void cancelFilter();
 
   MessageId msg_id;
   CanData hex_colors;
@@ -51,6 +62,10 @@ public:
   int filter_sig_idx = -1;
   double filter_value = 0;
   std::function<bool(double, double)> filter_cmp = nullptr;
+  // the matches of filter_cmp, built in the background
+  std::unique_ptr<LogFilter> filter;
+  QFutureWatcher<bool> filter_watcher;
+  std::atomic<bool> abort_filter = false;
   std::deque<Message> messages;
   std::vector<cabana::Signal *> sigs;
   bool hex_mode = false;
@@ -69,12 +84,15 @@ private slots:
   void filterChanged();
   void exportToCSV();
   void modelReset();
+  void updateFilterProgress();
 
 private:
   QTableView *logs;
   HistoryLogModel *model;
   QComboBox *signals_cb, *comp_box, *display_type_cb;
   QLineEdit *value_edit;
+  QProgressBar *filter_progress;
+  QTimer filter_progress_timer;
   QWidget *filters_widget;
   ToolButton *export_btn;
   MessageBytesDelegate *delegate;
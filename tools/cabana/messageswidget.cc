@@ -1,6 +1,7 @@
 #include "tools/cabana/messageswidget.h"
 
 #include <limits>
+#include <numeric>
 #include <utility>
 
 #include <QCheckBox>
@@ -45,15 +46,24 @@ MessagesWidget::MessagesWidget(QWidget *parent) : menu(new QMenu(this)), QWidget
   QObject::connect(can, &AbstractStream::msgsReceived, model, &MessageListModel::msgsReceived);
   QObject::connect(dbc(), &DBCManager::DBCFileChanged, model, &MessageListModel::dbcModified);
   QObject::connect(UndoStack::instance(), &QUndoStack::indexChanged, model, &MessageListModel::dbcModified);
-  QObject::connect(model, &MessageListModel::modelReset, [this]() {
+  // the model changes rows in place, the selection follows unless the selected row is removed
+  auto rows_changed = [this]() {
     if (current_msg_id) {
-      selectMessage(*current_msg_id);
+      auto current = view->currentIndex();
+      if (!current.isValid() || model->items_[current.row()].id != *current_msg_id) {
+        view->selectionModel()->clearCurrentIndex();
+        selectMessage(*current_msg_id);
+      }
     }
     view->updateBytesSectionSize();
     updateTitle();
-  });
+  };
+  QObject::connect(model, &MessageListModel::modelReset, rows_changed);
+  QObject::connect(model, &MessageListModel::rowsInserted, rows_changed);
+  QObject::connect(model, &MessageListModel::rowsRemoved, rows_changed);
+  QObject::connect(model, &MessageListModel::layoutChanged, rows_changed);
   QObject::connect(view->selectionModel(), &QItemSelectionModel::currentChanged, [=](const QModelIndex &current, const QModelIndex &previous) {
-    if (current.isValid() && current.row() < model->items_.size()) {
+    if (!model->removingRows() && current.isValid() && current.row() < model->items_.size()) {
       const auto &id = model->items_[current.row()].id;
       if (!current_msg_id || id != *current_msg_id) {
         current_msg_id = id;
@@ -213,6 +223,7 @@ QVariant MessageListModel::data(const QModelIndex &index, int role) const {
 
 void MessageListModel::setFilterStrings(const QMap<int, QString> &filters) {
   filters_ = filters;
+  ++filter_generation_;
   filterAndSort();
 }
 
@@ -226,10 +237,17 @@ void MessageListModel::dbcModified() {
   for (const auto &[_, m] : dbc()->getMessages(-1)) {
     dbc_messages_.insert(MessageId{.source = INVALID_SOURCE, .address = m.address});
   }
+  // names and nodes may have changed
+  ++filter_generation_;
   filterAndSort();
 }
 
-void MessageListModel::sortItems(std::vector<MessageListModel::Item> &items) {
+MessageListModel::Item MessageListModel::makeItem(const MessageId &id) const {
+  auto msg = dbc()->msg(id);
+  return {.id = id, .name = msg ? msg->name : UNTITLED, .node = msg ? msg->transmitter : QString()};
+}
+
+bool MessageListModel::lessThan(const Item &l, const Item &r) const {
   auto compare = [this](const auto &l, const auto &r) {
     switch (sort_column) {
       case Column::NAME: return std::tie(l.name, l.id) < std::tie(r.name, r.id);
@@ -241,11 +259,7 @@ void MessageListModel::sortItems(std::vector<MessageListModel::Item> &items) {
       default: return false; // Default case to suppress compiler warning
     }
   };
-
-  if (sort_order == Qt::DescendingOrder)
-    std::stable_sort(items.rbegin(), items.rend(), compare);
-  else
-    std::stable_sort(items.begin(), items.end(), compare);
+  return sort_order == Qt::AscendingOrder ? compare(l, r) : compare(r, l);
 }
 
 static bool parseRange(const QString &filter, uint32_t value, int base = 10) {
@@ -263,13 +277,29 @@ static bool parseRange(const QString &filter, uint32_t value, int base = 10) {
   return ok && value >= min && value <= max;
 }
 
+static bool isDynamicColumn(int column) {
+  return column == MessageListModel::Column::FREQ || column == MessageListModel::Column::COUNT ||
+         column == MessageListModel::Column::DATA;
+}
+
 bool MessageListModel::match(const MessageListModel::Item &item) {
   if (filters_.isEmpty())
     return true;
 
+  // the filters on the message data change all the time, the others only with the filter generation
+  auto &cached = filter_cache_[item.id];
+  if (cached.generation != filter_generation_) {
+    cached = {.generation = filter_generation_, .matched = matchColumns(item, false)};
+  }
+  return cached.matched && matchColumns(item, true);
+}
+
+bool MessageListModel::matchColumns(const MessageListModel::Item &item, bool dynamic) const {
   bool match = true;
   const auto &data = can->lastMessage(item.id);
   for (auto it = filters_.cbegin(); it != filters_.cend() && match; ++it) {
+    if (isDynamicColumn(it.key()) != dynamic) continue;
+
     const QString &txt = it.value();
     switch (it.key()) {
       case Column::NAME: {
@@ -310,8 +340,10 @@ bool MessageListModel::filterAndSort() {
   std::vector<MessageId> all_messages;
   all_messages.reserve(can->lastMessages().size() + dbc_messages_.size());
   auto dbc_msgs = dbc_messages_;
+  known_messages_.clear();
   for (const auto &[id, m] : can->lastMessages()) {
     all_messages.push_back(id);
+    known_messages_.insert(id);
     dbc_msgs.erase(MessageId{.source = INVALID_SOURCE, .address = id.address});
   }
   all_messages.insert(all_messages.end(), dbc_msgs.begin(), dbc_msgs.end());
@@ -321,34 +353,177 @@ bool MessageListModel::filterAndSort() {
   items.reserve(all_messages.size());
   for (const auto &id : all_messages) {
     if (show_inactive_messages || can->isMessageActive(id)) {
-      auto msg = dbc()->msg(id);
-      Item item = {.id = id,
-                  .name = msg ? msg->name : UNTITLED,
-                  .node = msg ? msg->transmitter : QString()};
+      Item item = makeItem(id);
       if (match(item))
-        items.emplace_back(item);
+        items.emplace_back(std::move(item));
     }
   }
-  sortItems(items);
+  std::sort(items.begin(), items.end(), [this](const auto &l, const auto &r) { return lessThan(l, r); });
+  return setItems(std::move(items));
+}
 
-  if (items_ != items) {
-    beginResetModel();
-    items_ = std::move(items);
-    endResetModel();
-    return true;
+bool MessageListModel::setItems(std::vector<Item> &&items) {
+  if (items_ == items) return false;
+
+  std::unordered_map<MessageId, int> new_rows;
+  for (int i = 0; i < items.size(); ++i) {
+    new_rows[items[i].id] = i;
+  }
+
+  // remove the rows that are gone, in runs from the bottom
+  for (int last = (int)items_.size() - 1; last >= 0;) {
+    if (new_rows.count(items_[last].id)) {
+      --last;
+      continue;
+    }
+    int first = last;
+    while (first > 0 && !new_rows.count(items_[first - 1].id)) --first;
+    removeItems(first, last);
+    last = first - 1;
+  }
+
+  // move the rows left to their new order, the selection follows them
+  auto new_order = [&](const Item &l, const Item &r) { return new_rows[l.id] < new_rows[r.id]; };
+  if (!std::is_sorted(items_.begin(), items_.end(), new_order)) {
+    emit layoutAboutToBeChanged();
+    std::vector<int> order(items_.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&](int l, int r) { return new_order(items_[l], items_[r]); });
+    std::vector<int> moved_to(items_.size());
+    std::vector<Item> sorted;
+    sorted.reserve(items_.size());
+    for (int i = 0; i < order.size(); ++i) {
+      moved_to[order[i]] = i;
+      sorted.push_back(std::move(items_[order[i]]));
+    }
+    items_ = std::move(sorted);
+
+    QModelIndexList from = persistentIndexList(), to;
+    for (const auto &idx : from) {
+      to.append(index(moved_to[idx.row()], idx.column()));
+    }
+    changePersistentIndexList(from, to);
+    emit layoutChanged();
+  }
+
+  // insert the new rows in runs, the rows left are already in place
+  std::unordered_set<MessageId> present;
+  for (const auto &item : items_) present.insert(item.id);
+  for (int i = 0; i < items.size();) {
+    if (present.count(items[i].id)) {
+      if (!(items_[i] == items[i])) {
+        items_[i] = items[i];
+        emit dataChanged(index(i, Column::NAME), index(i, Column::NODE));
+      }
+      ++i;
+      continue;
+    }
+    int last = i;
+    while (last + 1 < items.size() && !present.count(items[last + 1].id)) ++last;
+    beginInsertRows({}, i, last);
+    items_.insert(items_.begin() + i, items.begin() + i, items.begin() + last + 1);
+    endInsertRows();
+    i = last + 1;
+  }
+  updateRows();
+  return true;
+}
+
+void MessageListModel::removeItems(int first, int last) {
+  removing_rows_ = true;
+  beginRemoveRows({}, first, last);
+  items_.erase(items_.begin() + first, items_.begin() + last + 1);
+  endRemoveRows();
+  removing_rows_ = false;
+}
+
+void MessageListModel::insertNewMessages(const std::set<MessageId> &new_msgs) {
+  std::vector<MessageId> added;
+  for (const auto &id : new_msgs) {
+    if (!known_messages_.count(id)) added.push_back(id);
+  }
+  // a row at a time only pays off for a few new messages
+  if (added.size() > 64) {
+    filterAndSort();
+    return;
+  }
+
+  auto row_of = [this](const Item &item) {
+    return std::distance(items_.begin(), std::lower_bound(items_.begin(), items_.end(), item, [this](const auto &l, const auto &r) {
+      return lessThan(l, r);
+    }));
+  };
+  for (const auto &id : added) {
+    known_messages_.insert(id);
+    // the message takes the place of its DBC message
+    Item dbc_item = makeItem({.source = INVALID_SOURCE, .address = id.address});
+    if (int row = row_of(dbc_item); row < items_.size() && items_[row].id == dbc_item.id) {
+      removeItems(row, row);
+    }
+
+    Item item = makeItem(id);
+    if ((show_inactive_messages || can->isMessageActive(id)) && match(item)) {
+      int row = row_of(item);
+      beginInsertRows({}, row, row);
+      items_.insert(items_.begin() + row, std::move(item));
+      endInsertRows();
+    }
+  }
+  updateRows();
+}
+
+void MessageListModel::updateRows() {
+  rows_.clear();
+  for (int i = 0; i < items_.size(); ++i) {
+    rows_[items_[i].id] = i;
+  }
+}
+
+void MessageListModel::updateActiveRows() {
+  int first = std::numeric_limits<int>::max(), last = -1;
+  for (int i = 0; i < items_.size(); ++i) {
+    const bool active = can->isMessageActive(items_[i].id);
+    auto [it, inserted] = active_.try_emplace(items_[i].id, active);
+    if (!inserted && it->second != active) {
+      it->second = active;
+      first = std::min(first, i);
+      last = i;
+    }
+  }
+  if (last >= 0) {
+    emit dataChanged(index(first, 0), index(last, columnCount() - 1));
   }
-  return false;
 }
 
 void MessageListModel::msgsReceived(const std::set<MessageId> *new_msgs, bool has_new_ids) {
-  if (has_new_ids || ((filters_.count(Column::FREQ) || filters_.count(Column::COUNT) || filters_.count(Column::DATA)) &&
-                      ++sort_threshold_ == settings.fps)) {
+  const bool dynamic_sort = sort_column == Column::FREQ || sort_column == Column::COUNT;
+  if (has_new_ids && new_msgs && !dynamic_sort) {
+    insertNewMessages(*new_msgs);
+  } else if (has_new_ids || ((filters_.count(Column::FREQ) || filters_.count(Column::COUNT) || filters_.count(Column::DATA)) &&
+                             ++sort_threshold_ == settings.fps)) {
     sort_threshold_ = 0;
-    if (filterAndSort()) return;
+    filterAndSort();
   }
 
-  // Update viewport
-  emit dataChanged(index(0, 0), index(rowCount() - 1, columnCount() - 1));
+  // Update the rows of the received messages
+  if (!new_msgs) {
+    if (rowCount() > 0) emit dataChanged(index(0, 0), index(rowCount() - 1, columnCount() - 1));
+  } else {
+    int first = std::numeric_limits<int>::max(), last = -1;
+    for (const auto &id : *new_msgs) {
+      if (auto it = rows_.find(id); it != rows_.end()) {
+        first = std::min(first, it->second);
+        last = std::max(last, it->second);
+      }
+    }
+    if (last >= 0) emit dataChanged(index(first, Column::FREQ), index(last, Column::DATA));
+  }
+
+  // messages that stopped are drawn grayed out
+  if (++active_threshold_ >= settings.fps) {
+    active_threshold_ = 0;
+    updateActiveRows();
+  }
 }
 
 void MessageListModel::sort(int column, Qt::SortOrder order) {
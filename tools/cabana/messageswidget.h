@@ -3,6 +3,8 @@
 #include <algorithm>
 #include <optional>
 #include <set>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 #include <QAbstractTableModel>
@@ -40,6 +42,8 @@ public:
   void msgsReceived(const std::set<MessageId> *new_msgs, bool has_new_ids);
   bool filterAndSort();
   void dbcModified();
+  // the view moves the current index to a neighbor while its row is removed
+  inline bool removingRows() const { return removing_rows_; }
 
   struct Item {
     MessageId id;
@@ -53,14 +57,35 @@ public:
   bool show_inactive_messages = true;
 
 private:
-  void sortItems(std::vector<MessageListModel::Item> &items);
+  Item makeItem(const MessageId &id) const;
+  bool lessThan(const Item &l, const Item &r) const;
   bool match(const MessageListModel::Item &id);
+  bool matchColumns(const MessageListModel::Item &item, bool dynamic) const;
+  void insertNewMessages(const std::set<MessageId> &new_msgs);
+  bool setItems(std::vector<Item> &&items);
+  void removeItems(int first, int last);
+  void updateRows();
+  void updateActiveRows();
+
+  struct FilterResult {
+    uint32_t generation = 0;
+    bool matched = false;
+  };
 
   QMap<int, QString> filters_;
+  // bumped when the result of the name, bus, address or node filters may change
+  uint32_t filter_generation_ = 1;
+  std::unordered_map<MessageId, FilterResult> filter_cache_;
   std::set<MessageId> dbc_messages_;
+  // CAN messages added to the list, shown or not
+  std::unordered_set<MessageId> known_messages_;
+  std::unordered_map<MessageId, int> rows_;
+  std::unordered_map<MessageId, bool> active_;
   int sort_column = 0;
   Qt::SortOrder sort_order = Qt::AscendingOrder;
   int sort_threshold_ = 0;
+  int active_threshold_ = 0;
+  bool removing_rows_ = false;
 };
 
 class MessageView : public QTreeView {
@@ -590,8 +590,11 @@ void SignalView::handleSignalAdded(MessageId id, const cabana::Signal *sig) {
 }
 
 void SignalView::handleSignalUpdated(const cabana::Signal *sig) {
-  if (int row = model->signalRow(sig); row != -1)
+  if (int row = model->signalRow(sig); row != -1) {
+    // the decoded values are stale, a multiplexor change affects the other signals too
+    for (auto item : model->root->children) item->sparkline.reset();
     updateState();
+  }
 }
 
 std::pair<QModelIndex, QModelIndex> SignalView::visibleSignalRange() {
@@ -635,13 +638,13 @@ void SignalView::updateState(const std::set<MessageId> *msgs) {
                delegate->button_size.height() - style()->pixelMetric(QStyle::PM_FocusFrameVMargin) * 2);
 
     auto [first, last] = can->eventsInRange(model->msg_id, std::make_pair(last_msg.ts -settings.sparkline_range, last_msg.ts));
-    QFutureSynchronizer<void> synchronizer;
+    std::vector<std::pair<const cabana::Signal *, Sparkline *>> sparklines;
     for (int i = first_visible.row(); i <= last_visible.row(); ++i) {
       auto item = model->getItem(model->index(i, 1));
-      synchronizer.addFuture(QtConcurrent::run(
-          &item->sparkline, &Sparkline::update, item->sig, first, last, settings.sparkline_range, size));
+      sparklines.push_back({item->sig, &item->sparkline});
     }
-    synchronizer.waitForFinished();
+    updateSparklines(sparklines, first, last, settings.sparkline_range, size.width());
+    QtConcurrent::blockingMap(sparklines, [&](auto &s) { s.second->render(s.first->color, settings.sparkline_range, size); });
   }
 
   for (int i = 0; i < model->rowCount(); ++i) {
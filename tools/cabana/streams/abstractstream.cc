@@ -6,6 +6,7 @@
 #include <QApplication>
 #include "common/timing.h"
 #include "tools/cabana/settings.h"
+#include "tools/cabana/utils/bitflipindex.h"
 
 static const int EVENT_NEXT_BUFFER_SIZE = 6 * 1024 * 1024;  // 6MB
 
@@ -305,13 +306,7 @@ void CanData::compute(const MessageId &msg_id, const uint8_t *can_data, const in
         }
 
         // Track bit level changes
-        auto &row_bit_flips = bit_flip_counts[i];
-        const uint8_t diff = (cur ^ last);
-        for (int bit = 0; bit < 8; bit++) {
-          if (diff & (1u << bit)) {
-            ++row_bit_flips[7 - bit];
-          }
-        }
+        addBitFlips(bit_flip_counts[i], cur ^ last);
 
         last_change.ts = ts;
         last_change.delta = delta;
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include "tools/cabana/streams/abstractstream.h"
+
+// owns the synthetic events of a test, laid out like a stream's with the payload after the header
+class CanEventStorage {
+public:
+  const CanEvent *add(const MessageId &id, uint64_t mono_time, const std::vector<uint8_t> &dat) {
+    auto &buf = bufs.emplace_back(new uint8_t[sizeof(CanEvent) + dat.size()]);
+    CanEvent *e = (CanEvent *)buf.get();
+    e->src = id.source;
+    e->address = id.address;
+    e->mono_time = mono_time;
+    e->size = dat.size();
+    memcpy(e->dat, dat.data(), dat.size());
+    return e;
+  }
+
+private:
+  std::vector<std::unique_ptr<uint8_t[]>> bufs;
+};
@@ -0,0 +1,179 @@
+#include <map>
+#include <random>
+#include <vector>
+
+#include "catch2/catch.hpp"
+#include "tools/cabana/tests/can_events.h"
+#include "tools/cabana/utils/bitcorrelation.h"
+
+struct SyntheticRoute {
+  CanEventStorage storage;
+  MessageEventsMap events;
+
+  void add(const MessageId &id, uint64_t mono_time, const std::vector<uint8_t> &dat) {
+    events[id].push_back(storage.add(id, mono_time, dat));
+  }
+};
+
+const MessageId SOURCE = {.source = 0, .address = 0x100};
+
+// a source with a 2-bit state, a copy on another bus, an inverted copy that lags by two
+// frames, and noise. the messages run at different rates.
+static SyntheticRoute synthetic_route() {
+  std::mt19937 gen(7);
+  SyntheticRoute route;
+  std::vector<int> states;
+  int state = 0;
+  for (int i = 0; i < 2000; ++i) {
+    if (gen() % 20 == 0) state = gen() % 4;
+    states.push_back(state);
+    const uint64_t t = 1000 + i * 10000000ULL;
+    route.add(SOURCE, t, {(uint8_t)(state << 6), (uint8_t)gen()});
+    if (i % 2 == 0) {
+      route.add({.source = 1, .address = 0x200}, t + 100, {(uint8_t)gen(), (uint8_t)((state & 1) << 3), 0xff});
+    }
+    const int lagged = i >= 2 ? states[i - 2] : 0;
+    route.add({.source = 2, .address = 0x300}, t + 200, {(uint8_t)((lagged & 2) ? 0 : 1)});
+    if (gen() % 3 == 0) {
+      route.add({.source = 1, .address = 0x400}, t + gen() % 10000000, std::vector<uint8_t>(8 + gen() % 2, (uint8_t)gen()));
+    }
+  }
+  // events of a message are in time order
+  for (auto &[_, events] : route.events) {
+    std::stable_sort(events.begin(), events.end(), [](auto l, auto r) { return l->mono_time < r->mono_time; });
+  }
+  return route;
+}
+
+static bool bit_at(const CanEvent *e, int pos) {
+  return pos / 8 < e->size && ((e->dat[pos / 8] >> (7 - pos % 8)) & 1);
+}
+
+// every target event looks up the last source event and compares bit by bit
+static std::vector<BitCorrelation> brute_force(const MessageEventsMap &events, const std::vector<int> &source_bits,
+                                               int max_lag, uint32_t min_samples) {
+  const auto &source_events = events.at(SOURCE);
+  std::vector<BitCorrelation> results;
+  for (const auto &[id, target_events] : events) {
+    // held source event per target event, -1 before the first one
+    std::vector<int> held;
+    for (const CanEvent *e : target_events) {
+      int h = -1;
+      for (int j = 0; j < source_events.size() && source_events[j]->mono_time <= e->mono_time; ++j) h = j;
+      held.push_back(h);
+    }
+    const int m = target_events.size();
+    int max_size = 0;
+    for (auto e : target_events) max_size = std::max<int>(max_size, e->size);
+
+    for (int s = 0; s < source_bits.size(); ++s) {
+      for (int pos = 0; pos < max_size * 8; ++pos) {
+        if (id == SOURCE && pos == source_bits[s]) continue;
+
+        auto agreement_at = [&](int lag, uint32_t *samples) {
+          uint32_t n = 0, equal = 0;
+          for (int k = 0; k < m; ++k) {
+            if (k - lag < 0 || k - lag >= m || held[k - lag] < 0) continue;
+            ++n;
+            equal += bit_at(target_events[k], pos) == bit_at(source_events[held[k - lag]], source_bits[s]);
+          }
+          *samples = n;
+          return n ? equal / (float)n : 0.5f;
+        };
+
+        uint32_t n = 0, n_target = 0, n_source = 0, n_both = 0;
+        for (int k = 0; k < m; ++k) {
+          if (held[k] < 0) continue;
+          bool t = bit_at(target_events[k], pos), src = bit_at(source_events[held[k]], source_bits[s]);
+          ++n;
+          n_target += t;
+          n_source += src;
+          n_both += t && src;
+        }
+        if (n < min_samples || n_target == 0 || n_target == n) continue;
+
+        BitCorrelation c = {.source = {SOURCE, source_bits[s]}, .target = {id, pos}, .samples = n};
+        c.agreement = agreement_at(0, &n);
+        c.best_lag = 0;
+        c.lagged_agreement = c.agreement;
+        for (int lag = 1; lag <= max_lag; ++lag) {
+          for (int l : {lag, -lag}) {
+            uint32_t lag_n;
+            float a = agreement_at(l, &lag_n);
+            if (lag_n > 0 && std::abs(a - 0.5f) > std::abs(c.lagged_agreement - 0.5f)) {
+              c.best_lag = l;
+              c.lagged_agreement = a;
+            }
+          }
+        }
+        c.mutual_information = mutual_information(n, n_target, n_source, n_both);
+        results.push_back(c);
+      }
+    }
+  }
+  return results;
+}
+
+TEST_CASE("BitCorrelator matches a brute force search") {
+  SyntheticRoute route = synthetic_route();
+  const std::vector<int> source_bits = {0, 1, 12};  // the state and a noisy bit of byte 1
+  BitCorrelator::Options options;
+  options.max_lag = 3;
+  options.min_samples = 50;
+  options.threads = GENERATE(1, 4);
+
+  BitCorrelator correlator(route.events, SOURCE, source_bits, options);
+  auto results = correlator.run();
+  REQUIRE(correlator.progress() == 1.0f);
+
+  auto expected = brute_force(route.events, source_bits, options.max_lag, options.min_samples);
+  REQUIRE(results.size() == expected.size());
+  std::map<std::tuple<int, MessageId, int>, BitCorrelation> by_bit;
+  for (auto &c : expected) by_bit[{c.source.pos, c.target.id, c.target.pos}] = c;
+  for (auto &c : results) {
+    auto it = by_bit.find({c.source.pos, c.target.id, c.target.pos});
+    REQUIRE(it != by_bit.end());
+    INFO("source bit " << c.source.pos << " target " << c.target.id.address << ":" << c.target.pos);
+    REQUIRE(c.samples == it->second.samples);
+    REQUIRE(c.agreement == Approx(it->second.agreement));
+    REQUIRE(c.best_lag == it->second.best_lag);
+    REQUIRE(c.lagged_agreement == Approx(it->second.lagged_agreement));
+    REQUIRE(c.mutual_information == Approx(it->second.mutual_information).margin(1e-6));
+  }
+
+  // sorted by mutual information
+  for (int i = 1; i < results.size(); ++i) {
+    REQUIRE(results[i - 1].mutual_information >= results[i].mutual_information);
+  }
+
+  // the copy of the low state bit and the lagged inverted copy of the high one come first
+  auto find = [&](int source_pos, uint32_t address, int pos) {
+    return *std::find_if(results.begin(), results.end(), [&](auto &c) {
+      return c.source.pos == source_pos && c.target.id.address == address && c.target.pos == pos;
+    });
+  };
+  auto copy = find(1, 0x200, 12);
+  REQUIRE(copy.agreement == 1.0f);
+  REQUIRE(copy.best_lag == 0);
+  REQUIRE(copy.mutual_information > 0.9f);
+  auto inverted = find(0, 0x300, 7);
+  REQUIRE(inverted.best_lag == 2);
+  REQUIRE(inverted.lagged_agreement == Approx(0.0f).margin(0.002));
+  REQUIRE(inverted.agreement < 0.2f);
+}
+
+TEST_CASE("BitCorrelator filters and cancels") {
+  SyntheticRoute route = synthetic_route();
+  BitCorrelator::Options options;
+  options.buses = {1};
+  options.max_results = 5;
+
+  BitCorrelator correlator(route.events, SOURCE, {0, 1}, options);
+  auto results = correlator.run();
+  REQUIRE(results.size() == 5);
+  for (auto &c : results) REQUIRE(c.target.id.source == 1);
+
+  std::atomic<bool> abort = true;
+  REQUIRE(BitCorrelator(route.events, SOURCE, {0}, {}).run(&abort).empty());
+  REQUIRE(BitCorrelator(route.events, {.source = 5, .address = 1}, {0}, {}).run().empty());
+}
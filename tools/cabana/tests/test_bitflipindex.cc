@@ -0,0 +1,142 @@
+#define CATCH_CONFIG_ENABLE_BENCHMARKING
+
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "catch2/catch.hpp"
+#include "tools/cabana/tests/can_events.h"
+#include "tools/cabana/utils/bitflipindex.h"
+
+struct Events {
+  CanEventStorage storage;
+  std::vector<const CanEvent *> events;
+
+  void add(uint64_t mono_time, const std::vector<uint8_t> &dat) {
+    events.push_back(storage.add({.source = 0, .address = 0x123}, mono_time, dat));
+  }
+};
+
+// a message with a counter, a slowly changing signal, a noisy one and constant bytes
+static Events random_events(size_t count, int size, uint32_t seed) {
+  std::mt19937 gen(seed);
+  Events e;
+  std::vector<uint8_t> dat(size);
+  for (size_t i = 0; i < count; ++i) {
+    dat[0] = i & 0xff;
+    if (gen() % 16 == 0) dat[1] += 1;
+    for (int j = 2; j < size; j += 3) dat[j] = gen();
+    e.add(i * 10000000ULL, dat);
+  }
+  return e;
+}
+
+// the per event walk BinaryViewModel::getBitFlipChanges used to do
+static BitFlipCounts walk_events(CanEventIter first, CanEventIter last, size_t msg_size) {
+  BitFlipCounts counts(msg_size);
+  if (std::distance(first, last) <= 1) return counts;
+
+  std::vector<uint8_t> prev_values((*first)->dat, (*first)->dat + (*first)->size);
+  for (auto it = std::next(first); it != last; ++it) {
+    const CanEvent *event = *it;
+    int size = std::min<int>(msg_size, event->size);
+    for (int i = 0; i < size; ++i) {
+      const uint8_t diff = event->dat[i] ^ prev_values[i];
+      if (!diff) continue;
+      for (int bit = 0; bit < 8; ++bit) {
+        if (diff & (1u << bit)) ++counts[i][7 - bit];
+      }
+      prev_values[i] = event->dat[i];
+    }
+  }
+  return counts;
+}
+
+TEST_CASE("BitFlipIndex matches walking the events") {
+  const int size = GENERATE(1, 8, 24, 64);
+  Events e = random_events(5000, size, size);
+  BitFlipIndex index;
+  index.update(e.events);
+  REQUIRE(index.size() == e.events.size());
+
+  std::mt19937 gen(42);
+  BitFlipCounts counts;
+  for (int i = 0; i < 500; ++i) {
+    size_t first = gen() % (e.events.size() + 1);
+    size_t last = first + gen() % (e.events.size() - first + 1);
+    if (i < 4) {
+      // the whole stream, one block, block boundaries
+      const std::pair<size_t, size_t> ranges[] = {{0, e.events.size()}, {0, BitFlipIndex::BLOCK_SIZE},
+                                                  {BitFlipIndex::BLOCK_SIZE, 3 * BitFlipIndex::BLOCK_SIZE + 1}, {10, 11}};
+      std::tie(first, last) = ranges[i];
+    }
+    INFO("size " << size << " range " << first << "-" << last);
+    index.query(first, last, size, counts);
+    REQUIRE(counts == walk_events(e.events.begin() + first, e.events.begin() + last, size));
+  }
+
+  // fewer rows than the payload has, and more
+  index.query(0, e.events.size(), size / 2, counts);
+  REQUIRE(counts == walk_events(e.events.begin(), e.events.end(), size / 2));
+  index.query(0, e.events.size(), size + 8, counts);
+  auto expected = walk_events(e.events.begin(), e.events.end(), size);
+  expected.resize(size + 8);
+  REQUIRE(counts == expected);
+}
+
+TEST_CASE("BitFlipIndex follows new events") {
+  Events all = random_events(3000, 8, 1);
+  Events e;
+  BitFlipIndex index;
+  BitFlipCounts counts;
+
+  // live streaming, events arrive in small batches
+  for (size_t n = 0; n < all.events.size();) {
+    n = std::min(all.events.size(), n + 1 + n % 97);
+    e.events.assign(all.events.begin(), all.events.begin() + n);
+    index.update(e.events);
+    REQUIRE(index.size() == n);
+    index.query(n / 3, n, 8, counts);
+    REQUIRE(counts == walk_events(e.events.begin() + n / 3, e.events.end(), 8));
+  }
+
+  // events merged in front of the indexed ones
+  Events earlier = random_events(100, 8, 2);
+  e.events.insert(e.events.begin(), earlier.events.begin(), earlier.events.end());
+  index.update(e.events);
+  index.query(0, e.events.size(), 8, counts);
+  REQUIRE(counts == walk_events(e.events.begin(), e.events.end(), 8));
+
+  // a longer message needs a wider payload
+  e.add(e.events.back()->mono_time + 1, std::vector<uint8_t>(16, 0xff));
+  index.update(e.events);
+  index.query(e.events.size() - 2, e.events.size(), 16, counts);
+  REQUIRE(counts[15] == std::array<uint32_t, 8>{1, 1, 1, 1, 1, 1, 1, 1});
+
+  index.update({});
+  REQUIRE(index.size() == 0);
+  index.query(0, 10, 8, counts);
+  REQUIRE(counts == BitFlipCounts(8));
+}
+
+TEST_CASE("BitFlipIndex benchmark", "[.][benchmark]") {
+  // a busy 100Hz message over an hour
+  Events e = random_events(100 * 3600, 8, 3);
+  BitFlipIndex index;
+  index.update(e.events);
+  BitFlipCounts counts;
+
+  size_t first = e.events.size() / 4, last = e.events.size() * 3 / 4;
+  BENCHMARK("walk events") {
+    return walk_events(e.events.begin() + first, e.events.begin() + last, 8);
+  };
+  BENCHMARK("index query") {
+    index.query(first++, last, 8, counts);
+    return counts;
+  };
+  BENCHMARK("index build") {
+    BitFlipIndex fresh;
+    fresh.update(e.events);
+    return fresh.size();
+  };
+}
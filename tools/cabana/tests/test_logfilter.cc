@@ -0,0 +1,140 @@
+#define CATCH_CONFIG_ENABLE_BENCHMARKING
+
+#include <algorithm>
+#include <functional>
+#include <random>
+#include <vector>
+
+#include "catch2/catch.hpp"
+#include "tools/cabana/tests/can_events.h"
+#include "tools/cabana/utils/logfilter.h"
+
+struct FilterEvents {
+  CanEventStorage storage;
+  std::vector<const CanEvent *> events;
+
+  void add(uint64_t mono_time, const std::vector<uint8_t> &dat) {
+    events.push_back(storage.add({.source = 0, .address = 0x123}, mono_time, dat));
+  }
+};
+
+static cabana::Signal make_signal(int start_bit, int size, double factor) {
+  cabana::Signal sig;
+  sig.name = "sig";
+  sig.start_bit = start_bit;
+  sig.size = size;
+  sig.is_little_endian = true;
+  sig.is_signed = false;
+  sig.factor = factor;
+  sig.update();
+  return sig;
+}
+
+// a counter, a rare value and a multiplexor with its signal
+static FilterEvents filter_events(size_t count) {
+  std::mt19937 gen(11);
+  FilterEvents e;
+  for (size_t i = 0; i < count; ++i) {
+    e.add(i * 10000000ULL, {(uint8_t)i, (uint8_t)(gen() % 5000 == 0 ? 200 : gen() % 100), (uint8_t)(gen() % 3), (uint8_t)gen()});
+  }
+  return e;
+}
+
+// the filtering of HistoryLogModel::fetchData, newest event first
+static std::vector<uint32_t> scan(const std::vector<const CanEvent *> &events, const cabana::Signal &sig, double value,
+                                  std::function<bool(double, double)> cmp) {
+  std::vector<uint32_t> matches;
+  double v = 0;
+  for (int i = events.size() - 1; i >= 0; --i) {
+    if (sig.getValue(events[i]->dat, events[i]->size, &v) && cmp(v, value)) matches.push_back(i);
+  }
+  std::reverse(matches.begin(), matches.end());
+  return matches;
+}
+
+TEST_CASE("LogFilter matches scanning the events") {
+  FilterEvents e = filter_events(200000);
+  const int threads = GENERATE(1, 4);
+  cabana::Signal counter = make_signal(0, 8, 1.0), rare = make_signal(8, 8, 0.5);
+  const std::pair<const cabana::Signal *, double> filters[] = {{&counter, 10}, {&rare, 100}, {&rare, 0}};
+  // the comparisons of LogsWidget::filterChanged
+  const std::vector<std::function<bool(double, double)>> cmps = {std::greater<double>{}, std::equal_to<double>{},
+                                                                 [](double l, double r) { return l != r; }, std::less<double>{}};
+  for (auto [sig, value] : filters) {
+    for (auto &cmp : cmps) {
+      LogFilter filter(e.events, *sig, value, cmp, threads);
+      REQUIRE(filter.run());
+      REQUIRE(filter.progress() == 1.0f);
+      REQUIRE(filter.size() == e.events.size());
+      REQUIRE(filter.matches() == scan(e.events, *sig, value, cmp));
+    }
+  }
+
+  // the rare value
+  LogFilter filter(e.events, rare, 99, std::greater<double>{}, threads);
+  filter.run();
+  REQUIRE(!filter.matches().empty());
+  REQUIRE(filter.matches().size() < 100);
+}
+
+TEST_CASE("LogFilter multiplexed signals, new events and cancellation") {
+  FilterEvents e = filter_events(50000);
+  cabana::Signal mux = make_signal(16, 8, 1.0), muxed = make_signal(24, 8, 1.0);
+  mux.type = cabana::Signal::Type::Multiplexor;
+  muxed.type = cabana::Signal::Type::Multiplexed;
+  muxed.multiplexor = &mux;
+  muxed.multiplex_value = 1;
+
+  LogFilter filter(e.events, muxed, 0, std::greater_equal<double>{});
+  muxed.multiplex_value = 2;  // edits after the start don't change the result
+  REQUIRE(filter.run());
+  for (uint32_t i : filter.matches()) REQUIRE(e.events[i]->dat[2] == 1);
+  muxed.multiplex_value = 1;
+  REQUIRE(filter.matches() == scan(e.events, muxed, 0, std::greater_equal<double>{}));
+
+  // appended events are still covered, events merged in front are not
+  REQUIRE(filter.follows(e.events));
+  e.add(e.events.back()->mono_time + 1, {1, 2, 3, 4});
+  REQUIRE(filter.follows(e.events));
+  FilterEvents earlier = filter_events(10);
+  e.events.insert(e.events.begin(), earlier.events.begin(), earlier.events.end());
+  REQUIRE(!filter.follows(e.events));
+
+  std::atomic<bool> abort = true;
+  LogFilter aborted(e.events, muxed, 0, std::greater_equal<double>{});
+  REQUIRE(!aborted.run(&abort));
+  REQUIRE(aborted.matches().empty());
+
+  LogFilter empty({}, muxed, 0, std::greater_equal<double>{});
+  REQUIRE(empty.run());
+  REQUIRE(empty.matches().empty());
+}
+
+TEST_CASE("LogFilter benchmark", "[.][benchmark]") {
+  // a 100Hz message over three hours, a page of the history log is 50 rows
+  FilterEvents e = filter_events(100 * 3600 * 3);
+  cabana::Signal rare = make_signal(8, 8, 0.5);
+  LogFilter index(e.events, rare, 99, std::greater<double>{});
+  index.run();
+
+  BENCHMARK("scan for a page") {
+    std::vector<uint32_t> page;
+    double v = 0;
+    for (int i = e.events.size() - 1; i >= 0 && page.size() < 50; --i) {
+      if (rare.getValue(e.events[i]->dat, e.events[i]->size, &v) && v > 99) page.push_back(i);
+    }
+    return page.size();
+  };
+  BENCHMARK("page from the matches") {
+    const auto &matches = index.matches();
+    auto it = std::lower_bound(matches.begin(), matches.end(), e.events.back()->mono_time, [&](uint32_t i, uint64_t ts) {
+      return e.events[i]->mono_time < ts;
+    });
+    return std::vector<uint32_t>(it - std::min<size_t>(50, it - matches.begin()), it).size();
+  };
+  BENCHMARK("build the matches") {
+    LogFilter filter(e.events, rare, 99, std::greater<double>{});
+    filter.run();
+    return filter.matches().size();
+  };
+}
@@ -0,0 +1,163 @@
+#define CATCH_CONFIG_ENABLE_BENCHMARKING
+
+#include <algorithm>
+#include <random>
+#include <set>
+#include <tuple>
+#include <vector>
+
+#include <QCoreApplication>
+#include <QPersistentModelIndex>
+
+#include "catch2/catch.hpp"
+#include "tools/cabana/messageswidget.h"
+
+// a stream the test feeds by hand
+class TestStream : public AbstractStream {
+public:
+  TestStream(QObject *parent) : AbstractStream(parent) {}
+  QString routeName() const override { return "test"; }
+  void start() override {}
+
+  void receive(const std::vector<MessageId> &ids) {
+    sec += 0.01;
+    for (const auto &id : ids) {
+      const uint8_t dat[8] = {(uint8_t)id.address, (uint8_t)(id.address >> 8), id.source, (uint8_t)(sec * 100)};
+      updateEvent(id, sec, dat, sizeof(dat));
+    }
+    emit privateUpdateLastMsgsSignal();
+    QCoreApplication::processEvents();
+  }
+
+  double sec = 0;
+};
+
+struct ModelSignals {
+  int resets = 0, inserts = 0, removes = 0, layouts = 0;
+  std::vector<std::pair<int, int>> changed_rows;
+
+  ModelSignals(MessageListModel *model) {
+    QObject::connect(model, &MessageListModel::modelReset, [this]() { ++resets; });
+    QObject::connect(model, &MessageListModel::rowsInserted, [this]() { ++inserts; });
+    QObject::connect(model, &MessageListModel::rowsRemoved, [this]() { ++removes; });
+    QObject::connect(model, &MessageListModel::layoutChanged, [this]() { ++layouts; });
+    QObject::connect(model, &MessageListModel::dataChanged, [this](const QModelIndex &top_left, const QModelIndex &bottom_right) {
+      changed_rows.push_back({top_left.row(), bottom_right.row()});
+    });
+  }
+};
+
+static std::vector<MessageId> ids_of(const MessageListModel &model) {
+  std::vector<MessageId> ids;
+  for (const auto &item : model.items_) ids.push_back(item.id);
+  return ids;
+}
+
+// the same list built from scratch
+static std::vector<MessageId> rebuilt(const QMap<int, QString> &filters, int column, Qt::SortOrder order) {
+  QObject parent;
+  MessageListModel model(&parent);
+  model.setFilterStrings(filters);
+  model.sort(column, order);
+  return ids_of(model);
+}
+
+TEST_CASE("MessageListModel updates rows in place") {
+  QObject parent;
+  can = new TestStream(&parent);
+  TestStream *stream = (TestStream *)can;
+  MessageListModel model(&parent);
+  QObject::connect(can, &AbstractStream::msgsReceived, &model, &MessageListModel::msgsReceived);
+  ModelSignals sig(&model);
+
+  // thousands of IDs on three buses, a few new ones at a time
+  std::mt19937 gen(3);
+  std::vector<MessageId> all_ids;
+  for (uint8_t bus : {0, 1, 2}) {
+    for (uint32_t address = 0; address < 1500; ++address) all_ids.push_back({.source = bus, .address = address * 7});
+  }
+  std::shuffle(all_ids.begin(), all_ids.end(), gen);
+
+  const auto [column, order] = GENERATE(std::pair{MessageListModel::Column::ADDRESS, Qt::AscendingOrder},
+                                        std::pair{MessageListModel::Column::NAME, Qt::DescendingOrder},
+                                        std::pair{MessageListModel::Column::COUNT, Qt::DescendingOrder});
+  model.sort(column, order);
+
+  for (size_t received = 0; received < all_ids.size();) {
+    // the new messages and some of the known ones
+    size_t count = std::min(all_ids.size() - received, received < 1000 ? 200 : 1 + gen() % 20);
+    std::vector<MessageId> batch(all_ids.begin() + received, all_ids.begin() + received + count);
+    for (int i = 0; received > 0 && i < 50; ++i) batch.push_back(all_ids[gen() % received]);
+    received += count;
+    stream->receive(batch);
+    REQUIRE(ids_of(model) == rebuilt({}, column, order));
+  }
+  REQUIRE(sig.resets == 0);
+
+  if (column == MessageListModel::Column::ADDRESS) {
+    std::vector<MessageId> expected = all_ids;
+    std::sort(expected.begin(), expected.end(), [](auto &l, auto &r) { return std::tie(l.address, l.source) < std::tie(r.address, r.source); });
+    REQUIRE(ids_of(model) == expected);
+  }
+
+  // updates of known messages only repaint their rows
+  const int row = model.rowCount() / 2;
+  const MessageId id = model.items_[row].id;
+  int inserts = sig.inserts, layouts = sig.layouts;
+  if (column != MessageListModel::Column::COUNT) {
+    sig.changed_rows.clear();
+    stream->receive({id});
+    REQUIRE(!sig.changed_rows.empty());
+    REQUIRE(sig.changed_rows[0] == std::pair{row, row});
+    REQUIRE(sig.inserts == inserts);
+    REQUIRE(sig.layouts == layouts);
+  }
+
+  // filters remove and insert rows, the selection follows its message
+  QPersistentModelIndex selected = model.index(row, 0);
+  const QMap<int, QString> filters = {{MessageListModel::Column::SOURCE, "1-2"}};
+  model.setFilterStrings(filters);
+  REQUIRE(ids_of(model) == rebuilt(filters, column, order));
+  if (id.source >= 1) {
+    REQUIRE(selected.isValid());
+    REQUIRE(model.items_[selected.row()].id == id);
+  }
+  model.setFilterStrings({});
+  REQUIRE(ids_of(model) == rebuilt({}, column, order));
+
+  // a sort is a layout change, not a reset
+  model.sort(MessageListModel::Column::SOURCE, Qt::DescendingOrder);
+  REQUIRE(ids_of(model) == rebuilt({}, MessageListModel::Column::SOURCE, Qt::DescendingOrder));
+  if (selected.isValid()) REQUIRE(model.items_[selected.row()].id == id);
+  REQUIRE(sig.resets == 0);
+
+  can = nullptr;
+}
+
+TEST_CASE("MessageListModel benchmark", "[.][benchmark]") {
+  QObject parent;
+  can = new TestStream(&parent);
+  TestStream *stream = (TestStream *)can;
+  MessageListModel model(&parent);
+
+  std::vector<MessageId> ids;
+  for (uint8_t bus : {0, 1, 2, 3}) {
+    for (uint32_t address = 0; address < 2000; ++address) ids.push_back({.source = bus, .address = address});
+  }
+  stream->receive(ids);
+  model.sort(MessageListModel::Column::NAME, Qt::AscendingOrder);
+
+  uint32_t address = 0x10000;
+  BENCHMARK("a new message, rebuild the list") {
+    stream->receive({{.source = 0, .address = address++}});
+    return model.filterAndSort();
+  };
+  BENCHMARK("a new message, incremental") {
+    const MessageId id = {.source = 0, .address = address++};
+    stream->receive({id});
+    const std::set<MessageId> new_msgs = {id};
+    model.msgsReceived(&new_msgs, true);
+    return model.rowCount();
+  };
+  can = nullptr;
+}
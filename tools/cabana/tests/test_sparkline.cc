@@ -0,0 +1,192 @@
+#define CATCH_CONFIG_ENABLE_BENCHMARKING
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "catch2/catch.hpp"
+#include "tools/cabana/chart/sparkline.h"
+#include "tools/cabana/tests/can_events.h"
+
+// a 64 byte message with a multiplexor, a multiplexed signal and 62 byte sized signals
+struct Message {
+  std::vector<std::unique_ptr<cabana::Signal>> sigs;
+  CanEventStorage storage;
+  std::vector<const CanEvent *> events;
+
+  Message() {
+    for (int i = 0; i < 64; ++i) {
+      auto &sig = sigs.emplace_back(new cabana::Signal);
+      sig->name = QString("sig_%1").arg(i);
+      sig->start_bit = i * 8;
+      sig->size = 8;
+      sig->is_little_endian = true;
+      sig->is_signed = i % 3 == 0;
+      sig->factor = i % 2 ? 0.5 : 1.0;
+      sig->update();
+    }
+    sigs[0]->type = cabana::Signal::Type::Multiplexor;
+    sigs[1]->type = cabana::Signal::Type::Multiplexed;
+    sigs[1]->multiplexor = sigs[0].get();
+    sigs[1]->multiplex_value = 1;
+  }
+
+  void add(size_t count, std::mt19937 &gen) {
+    std::vector<uint8_t> dat(64);
+    for (size_t i = 0; i < count; ++i) {
+      uint64_t mono_time = events.empty() ? 0 : events.back()->mono_time + 10000000ULL;
+      dat[0] = gen() % 2;
+      for (int j = 1; j < dat.size(); ++j) {
+        if (gen() % (j + 1) == 0) dat[j] = gen();
+      }
+      events.push_back(storage.add({.source = 0, .address = 0x123}, mono_time, dat));
+    }
+  }
+
+  std::pair<CanEventIter, CanEventIter> range(int seconds) const {
+    uint64_t last_time = events.back()->mono_time;
+    uint64_t start = last_time > seconds * 1e9 ? last_time - seconds * 1e9 : 0;
+    return {std::lower_bound(events.begin(), events.end(), start, CompareCanEvent()), events.end()};
+  }
+};
+
+struct Decoded {
+  size_t count = 0;
+  double min_val = std::numeric_limits<double>::max();
+  double max_val = std::numeric_limits<double>::lowest();
+  double freq = 0;
+};
+
+// what every sparkline did on its own before the batched update
+static Decoded decode_window(const cabana::Signal *sig, CanEventIter first, CanEventIter last) {
+  Decoded d;
+  uint64_t first_time = 0, last_time = 0;
+  double value = 0;
+  for (auto it = first; it != last; ++it) {
+    if (sig->getValue((*it)->dat, (*it)->size, &value)) {
+      if (d.count++ == 0) first_time = (*it)->mono_time;
+      last_time = (*it)->mono_time;
+      d.min_val = std::min(d.min_val, value);
+      d.max_val = std::max(d.max_val, value);
+    }
+  }
+  if (d.count == 0) return {};
+  d.freq = d.count / std::max((last_time - first_time) / 1e9, 1.0);
+  return d;
+}
+
+TEST_CASE("updateSparklines matches decoding the whole range") {
+  std::mt19937 gen(5);
+  Message msg;
+  std::vector<Sparkline> sparklines(msg.sigs.size());
+  auto lines = [&](int first_sig, int last_sig) {
+    std::vector<std::pair<const cabana::Signal *, Sparkline *>> v;
+    for (int i = first_sig; i < last_sig; ++i) v.push_back({msg.sigs[i].get(), &sparklines[i]});
+    return v;
+  };
+  auto check = [&](int first_sig, int last_sig, int seconds) {
+    auto [first, last] = msg.range(seconds);
+    for (int i = first_sig; i < last_sig; ++i) {
+      INFO("signal " << i << " events " << msg.events.size() << " range " << seconds);
+      Decoded expected = decode_window(msg.sigs[i].get(), first, last);
+      REQUIRE(sparklines[i].size() == expected.count);
+      if (expected.count == 0) continue;
+      REQUIRE(sparklines[i].min_val == expected.min_val);
+      REQUIRE(sparklines[i].max_val == expected.max_val);
+      REQUIRE(sparklines[i].freq() == Approx(expected.freq));
+    }
+  };
+
+  // live streaming with the visible rows scrolling
+  for (int step = 0; step < 300; ++step) {
+    msg.add(1 + gen() % 40, gen);
+    int first_sig = (step / 20) % 32, last_sig = first_sig + 32;
+    auto [first, last] = msg.range(15);
+    updateSparklines(lines(first_sig, last_sig), first, last, 15, 200);
+    check(first_sig, last_sig, 15);
+  }
+
+  // a longer range, a narrower column and an edited signal
+  for (auto [seconds, width] : {std::pair{60, 200}, {60, 50}, {5, 50}}) {
+    auto [first, last] = msg.range(seconds);
+    updateSparklines(lines(0, 64), first, last, seconds, width);
+    check(0, 64, seconds);
+  }
+  msg.sigs[10]->factor = 2.0;
+  sparklines[10].reset();
+  auto [first, last] = msg.range(5);
+  updateSparklines(lines(0, 64), first, last, 5, 50);
+  check(0, 64, 5);
+
+  updateSparklines(lines(0, 64), msg.events.end(), msg.events.end(), 5, 50);
+  REQUIRE(sparklines[10].size() == 0);
+}
+
+TEST_CASE("Sparkline buckets match bucketing the window from scratch") {
+  std::mt19937 gen(9);
+  Message msg;
+  msg.add(100 * 20, gen);
+  // the multiplexed signal and a few that change often
+  std::vector<Sparkline> sparklines(6);
+  std::vector<std::pair<const cabana::Signal *, Sparkline *>> lines;
+  for (int i = 0; i < sparklines.size(); ++i) lines.push_back({msg.sigs[i + 1].get(), &sparklines[i]});
+
+  auto check = [&](int range, int width) {
+    auto [first, last] = msg.range(range);
+    updateSparklines(lines, first, last, range, width);
+    for (int i = 0; i < sparklines.size(); ++i) {
+      INFO("signal " << i + 1 << " events " << msg.events.size() << " range " << range << " width " << width);
+      Sparkline fresh;
+      updateSparklines({{lines[i].first, &fresh}}, first, last, range, width);
+      const QSize size(width, 40);
+      const std::vector<QPointF> expected = fresh.renderPoints(range, size);
+      const std::vector<QPointF> &points = sparklines[i].renderPoints(range, size);
+      // downsampled, not one point per value
+      REQUIRE(points.size() < sparklines[i].size());
+      REQUIRE(points.size() == expected.size());
+      for (int j = 0; j < points.size(); ++j) {
+        REQUIRE(points[j].x() == expected[j].x());
+        REQUIRE(points[j].y() == expected[j].y());
+      }
+    }
+  };
+
+  // sliding, the front buckets lose points
+  for (int step = 0; step < 100; ++step) {
+    msg.add(1 + gen() % 30, gen);
+    check(15, 200);
+  }
+  // a narrower column, then shorter and longer ranges rebucket the window
+  for (auto [range, width] : {std::pair{15, 120}, {5, 120}, {20, 120}, {20, 300}}) {
+    check(range, width);
+    msg.add(1 + gen() % 30, gen);
+    check(range, width);
+  }
+}
+
+TEST_CASE("Sparkline benchmark", "[.][benchmark]") {
+  std::mt19937 gen(6);
+  Message msg;
+  msg.add(100 * 15, gen);
+  std::vector<Sparkline> sparklines(msg.sigs.size());
+  std::vector<std::pair<const cabana::Signal *, Sparkline *>> lines;
+  for (int i = 0; i < msg.sigs.size(); ++i) lines.push_back({msg.sigs[i].get(), &sparklines[i]});
+
+  // one refresh of a 100Hz message with a 15 second range
+  BENCHMARK("decode each signal") {
+    msg.add(1, gen);
+    auto [first, last] = msg.range(15);
+    double sum = 0;
+    for (auto &sig : msg.sigs) sum += decode_window(sig.get(), first, last).max_val;
+    return sum;
+  };
+  BENCHMARK("batched update") {
+    msg.add(1, gen);
+    auto [first, last] = msg.range(15);
+    updateSparklines(lines, first, last, 15, 200);
+    return sparklines[2].max_val;
+  };
+}
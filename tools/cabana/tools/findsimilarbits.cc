@@ -1,6 +1,6 @@
 #include "tools/cabana/tools/findsimilarbits.h"
 
-#include <algorithm>
+#include <climits>
 
 #include <QGridLayout>
 #include <QHeaderView>
@@ -8,11 +8,12 @@
 #include <QIntValidator>
 #include <QLabel>
 #include <QPushButton>
-#include <QRadioButton>
+#include <QtConcurrent>
 
-#include "tools/cabana/dbc/dbcmanager.h"
 #include "tools/cabana/streams/abstractstream.h"
 
+const int MAX_RESULTS = 1000;
+
 FindSimilarBitsDlg::FindSimilarBitsDlg(QWidget *parent) : QDialog(parent, Qt::WindowFlags() | Qt::Window) {
   setWindowTitle(tr("Find similar bits"));
   setAttribute(Qt::WA_DeleteOnClose);
@@ -22,6 +23,7 @@ FindSimilarBitsDlg::FindSimilarBitsDlg(QWidget *parent) : QDialog(parent, Qt::Wi
   QHBoxLayout *src_layout = new QHBoxLayout();
   src_bus_combo = new QComboBox(this);
   find_bus_combo = new QComboBox(this);
+  find_bus_combo->addItem(tr("All"), -1);
   for (auto cb : {src_bus_combo, find_bus_combo}) {
     for (uint8_t bus : can->sources) {
       cb->addItem(QString::number(bus), bus);
@@ -36,6 +38,8 @@ FindSimilarBitsDlg::FindSimilarBitsDlg(QWidget *parent) : QDialog(parent, Qt::Wi
   msg_cb->model()->sort(0);
   msg_cb->setCurrentIndex(0);
 
+  signal_cb = new QComboBox(this);
+
   byte_idx_sb = new QSpinBox(this);
   byte_idx_sb->setFixedWidth(50);
   byte_idx_sb->setRange(0, 63);
@@ -47,6 +51,7 @@ FindSimilarBitsDlg::FindSimilarBitsDlg(QWidget *parent) : QDialog(parent, Qt::Wi
   src_layout->addWidget(new QLabel(tr("Bus")));
   src_layout->addWidget(src_bus_combo);
   src_layout->addWidget(msg_cb);
+  src_layout->addWidget(signal_cb);
   src_layout->addWidget(new QLabel(tr("Byte Index")));
   src_layout->addWidget(byte_idx_sb);
   src_layout->addWidget(new QLabel(tr("Bit Index")));
@@ -56,12 +61,8 @@ FindSimilarBitsDlg::FindSimilarBitsDlg(QWidget *parent) : QDialog(parent, Qt::Wi
   QHBoxLayout *find_layout = new QHBoxLayout();
   find_layout->addWidget(new QLabel(tr("Bus")));
   find_layout->addWidget(find_bus_combo);
-  find_layout->addWidget(new QLabel(tr("Equal")));
-  equal_combo = new QComboBox(this);
-  equal_combo->addItems({"Yes", "No"});
-  find_layout->addWidget(equal_combo);
   min_msgs = new QLineEdit(this);
-  min_msgs->setValidator(new QIntValidator(this));
+  min_msgs->setValidator(new QIntValidator(0, INT_MAX, this));
   min_msgs->setText("100");
   find_layout->addWidget(new QLabel(tr("Min msg count")));
   find_layout->addWidget(min_msgs);
@@ -76,6 +77,11 @@ FindSimilarBitsDlg::FindSimilarBitsDlg(QWidget *parent) : QDialog(parent, Qt::Wi
   grid_layout->addLayout(find_layout, 1, 1);
   main_layout->addLayout(grid_layout);
 
+  progress_bar = new QProgressBar(this);
+  progress_bar->setRange(0, 100);
+  progress_bar->setVisible(false);
+  main_layout->addWidget(progress_bar);
+
   table = new QTableWidget(this);
   table->setSelectionBehavior(QAbstractItemView::SelectRows);
   table->setSelectionMode(QAbstractItemView::SingleSelection);
@@ -83,78 +89,119 @@ FindSimilarBitsDlg::FindSimilarBitsDlg(QWidget *parent) : QDialog(parent, Qt::Wi
   table->horizontalHeader()->setStretchLastSection(true);
   main_layout->addWidget(table);
 
-  setMinimumSize({700, 500});
-  QObject::connect(search_btn, &QPushButton::clicked, this, &FindSimilarBitsDlg::find);
+  updateSignals();
+  setMinimumSize({800, 500});
+  progress_timer.setInterval(100);
+  QObject::connect(&progress_timer, &QTimer::timeout, [this]() {
+    if (correlator) progress_bar->setValue(correlator->progress() * 100);
+  });
+  QObject::connect(&watcher, &QFutureWatcher<std::vector<BitCorrelation>>::finished, this, &FindSimilarBitsDlg::searchFinished);
+  QObject::connect(src_bus_combo, qOverload<int>(&QComboBox::currentIndexChanged), this, &FindSimilarBitsDlg::updateSignals);
+  QObject::connect(msg_cb, qOverload<int>(&QComboBox::currentIndexChanged), this, &FindSimilarBitsDlg::updateSignals);
+  QObject::connect(signal_cb, qOverload<int>(&QComboBox::currentIndexChanged), [this](int index) {
+    byte_idx_sb->setEnabled(index == 0);
+    bit_idx_sb->setEnabled(index == 0);
+  });
+  QObject::connect(search_btn, &QPushButton::clicked, [this]() { watcher.isRunning() ? cancel() : find(); });
   QObject::connect(table, &QTableWidget::doubleClicked, [this](const QModelIndex &index) {
     if (index.isValid()) {
-      MessageId msg_id = {.source = (uint8_t)find_bus_combo->currentData().toUInt(), .address = table->item(index.row(), 0)->text().toUInt(0, 16)};
+      MessageId msg_id = {.source = (uint8_t)table->item(index.row(), 1)->text().toUInt(), .address = table->item(index.row(), 2)->text().toUInt(0, 16)};
       emit openMessage(msg_id);
     }
   });
 }
 
-void FindSimilarBitsDlg::find() {
-  search_btn->setEnabled(false);
-  table->clear();
-  uint32_t selected_address = msg_cb->currentData().toUInt();
-  auto msg_mismatched = calcBits(src_bus_combo->currentText().toUInt(), selected_address, byte_idx_sb->value(), bit_idx_sb->value(),
-                                 find_bus_combo->currentText().toUInt(), equal_combo->currentIndex() == 0, min_msgs->text().toInt());
-  table->setRowCount(msg_mismatched.size());
-  table->setColumnCount(6);
-  table->setHorizontalHeaderLabels({"address", "byte idx", "bit idx", "mismatches", "total msgs", "% mismatched"});
-  for (int i = 0; i < msg_mismatched.size(); ++i) {
-    auto &m = msg_mismatched[i];
-    table->setItem(i, 0, new QTableWidgetItem(QString("%1").arg(m.address, 1, 16)));
-    table->setItem(i, 1, new QTableWidgetItem(QString::number(m.byte_idx)));
-    table->setItem(i, 2, new QTableWidgetItem(QString::number(m.bit_idx)));
-    table->setItem(i, 3, new QTableWidgetItem(QString::number(m.mismatches)));
-    table->setItem(i, 4, new QTableWidgetItem(QString::number(m.total)));
-    table->setItem(i, 5, new QTableWidgetItem(QString::number(m.perc, 'f', 2)));
-  }
-  search_btn->setEnabled(true);
+FindSimilarBitsDlg::~FindSimilarBitsDlg() {
+  abort_search = true;
+  watcher.waitForFinished();
 }
 
-QList<FindSimilarBitsDlg::mismatched_struct> FindSimilarBitsDlg::calcBits(uint8_t bus, uint32_t selected_address, int byte_idx,
-                                                                          int bit_idx, uint8_t find_bus, bool equal, int min_msgs_cnt) {
-  QHash<uint32_t, QVector<uint32_t>> mismatches;
-  QHash<uint32_t, uint32_t> msg_count;
-  const auto &events = can->allEvents();
-  int bit_to_find = -1;
-  for (const CanEvent *e : events) {
-    if (e->src == bus) {
-      if (e->address == selected_address && e->size > byte_idx) {
-        bit_to_find = ((e->dat[byte_idx] >> (7 - bit_idx)) & 1) != 0;
-      }
-    }
-    if (e->src == find_bus) {
-      ++msg_count[e->address];
-      if (bit_to_find == -1) continue;
-
-      auto &mismatched = mismatches[e->address];
-      if (mismatched.size() < e->size * 8) {
-        mismatched.resize(e->size * 8);
-      }
-      for (int i = 0; i < e->size; ++i) {
-        for (int j = 0; j < 8; ++j) {
-          int bit = ((e->dat[i] >> (7 - j)) & 1) != 0;
-          mismatched[i * 8 + j] += equal ? (bit != bit_to_find) : (bit == bit_to_find);
-        }
-      }
+void FindSimilarBitsDlg::updateSignals() {
+  signal_cb->clear();
+  signal_cb->addItem(tr("(bit)"));
+  MessageId id = {.source = (uint8_t)src_bus_combo->currentData().toUInt(), .address = msg_cb->currentData().toUInt()};
+  if (auto m = dbc()->msg(id)) {
+    for (auto sig : m->getSignals()) {
+      signal_cb->addItem(sig->name);
     }
   }
+}
 
-  QList<mismatched_struct> result;
-  result.reserve(mismatches.size());
-  for (auto it = mismatches.begin(); it != mismatches.end(); ++it) {
-    if (auto cnt = msg_count[it.key()]; cnt > min_msgs_cnt) {
-      auto &mismatched = it.value();
-      for (int i = 0; i < mismatched.size(); ++i) {
-        if (float perc = (mismatched[i] / (double)cnt) * 100; perc < 50) {
-          result.push_back({it.key(), (uint32_t)i / 8, (uint32_t)i % 8, mismatched[i], cnt, perc});
-        }
-      }
+std::vector<int> FindSimilarBitsDlg::sourceBits() const {
+  MessageId id = {.source = (uint8_t)src_bus_combo->currentData().toUInt(), .address = msg_cb->currentData().toUInt()};
+  auto m = dbc()->msg(id);
+  if (signal_cb->currentIndex() <= 0 || !m || signal_cb->currentIndex() > m->getSignals().size()) {
+    return {byte_idx_sb->value() * 8 + bit_idx_sb->value()};
+  }
+
+  // every bit of the signal, in the column order of the binary view
+  auto sig = m->getSignals()[signal_cb->currentIndex() - 1];
+  std::vector<int> bits;
+  for (int j = 0; j < sig->size; ++j) {
+    bits.push_back(sig->is_little_endian ? flipBitPos(sig->start_bit + j) : flipBitPos(sig->start_bit) + j);
+  }
+  return bits;
+}
+
+void FindSimilarBitsDlg::find() {
+  table->clear();
+  table->setRowCount(0);
+
+  BitCorrelator::Options options;
+  int find_bus = find_bus_combo->currentData().toInt();
+  if (find_bus >= 0) options.buses = {(uint8_t)find_bus};
+  options.min_samples = min_msgs->text().toUInt();
+  options.max_results = MAX_RESULTS;
+
+  // a copy of the event pointers, the stream keeps adding messages while the search runs
+  events.clear();
+  for (const auto &[id, e] : can->eventsMap()) {
+    if (options.buses.empty() || options.buses.count(id.source) || id.source == src_bus_combo->currentData().toUInt()) {
+      events[id] = e;
     }
   }
-  std::sort(result.begin(), result.end(), [](auto &l, auto &r) { return l.perc < r.perc; });
-  return result;
+
+  MessageId source_id = {.source = (uint8_t)src_bus_combo->currentData().toUInt(), .address = msg_cb->currentData().toUInt()};
+  correlator = std::make_unique<BitCorrelator>(events, source_id, sourceBits(), options);
+  abort_search = false;
+  watcher.setFuture(QtConcurrent::run([this]() { return correlator->run(&abort_search); }));
+
+  search_btn->setText(tr("&Cancel"));
+  progress_bar->setValue(0);
+  progress_bar->setVisible(true);
+  progress_timer.start();
+}
+
+void FindSimilarBitsDlg::cancel() {
+  abort_search = true;
+  search_btn->setEnabled(false);
+}
+
+void FindSimilarBitsDlg::searchFinished() {
+  progress_timer.stop();
+  progress_bar->setVisible(false);
+  search_btn->setText(tr("&Find"));
+  search_btn->setEnabled(true);
+
+  const auto results = watcher.result();
+  correlator.reset();
+  events.clear();
+
+  table->setRowCount(results.size());
+  table->setColumnCount(10);
+  table->setHorizontalHeaderLabels({"source bit", "bus", "address", "byte idx", "bit idx", "total msgs",
+                                    "% equal", "best lag", "% equal at lag", "mutual information"});
+  for (int i = 0; i < results.size(); ++i) {
+    auto &c = results[i];
+    table->setItem(i, 0, new QTableWidgetItem(QString("%1:%2").arg(c.source.pos / 8).arg(c.source.pos % 8)));
+    table->setItem(i, 1, new QTableWidgetItem(QString::number(c.target.id.source)));
+    table->setItem(i, 2, new QTableWidgetItem(QString::number(c.target.id.address, 16)));
+    table->setItem(i, 3, new QTableWidgetItem(QString::number(c.target.pos / 8)));
+    table->setItem(i, 4, new QTableWidgetItem(QString::number(c.target.pos % 8)));
+    table->setItem(i, 5, new QTableWidgetItem(QString::number(c.samples)));
+    table->setItem(i, 6, new QTableWidgetItem(QString::number(c.agreement * 100, 'f', 2)));
+    table->setItem(i, 7, new QTableWidgetItem(QString::number(c.best_lag)));
+    table->setItem(i, 8, new QTableWidgetItem(QString::number(c.lagged_agreement * 100, 'f', 2)));
+    table->setItem(i, 9, new QTableWidgetItem(QString::number(c.mutual_information, 'f', 4)));
+  }
 }
@@ -1,34 +1,49 @@
 #pragma once
 
+#include <atomic>
+#include <memory>
+#include <vector>
+
 #include <QComboBox>
 #include <QDialog>
+#include <QFutureWatcher>
 #include <QLineEdit>
+#include <QProgressBar>
 #include <QSpinBox>
 #include <QTableWidget>
+#include <QTimer>
 
 #include "tools/cabana/dbc/dbcmanager.h"
+#include "tools/cabana/utils/bitcorrelation.h"
 
 class FindSimilarBitsDlg : public QDialog {
   Q_OBJECT
 
 public:
   FindSimilarBitsDlg(QWidget *parent);
+  ~FindSimilarBitsDlg();
 
 signals:
   void openMessage(const MessageId &msg_id);
 
 private:
-  struct mismatched_struct {
-    uint32_t address, byte_idx, bit_idx, mismatches, total;
-    float perc;
-  };
-  QList<mismatched_struct> calcBits(uint8_t bus, uint32_t selected_address, int byte_idx, int bit_idx, uint8_t find_bus,
-                                    bool equal, int min_msgs_cnt);
+  void updateSignals();
+  std::vector<int> sourceBits() const;
   void find();
+  void cancel();
+  void searchFinished();
 
   QTableWidget *table;
-  QComboBox *src_bus_combo, *find_bus_combo, *msg_cb, *equal_combo;
+  QComboBox *src_bus_combo, *find_bus_combo, *msg_cb, *signal_cb;
   QSpinBox *byte_idx_sb, *bit_idx_sb;
   QPushButton *search_btn;
   QLineEdit *min_msgs;
+  QProgressBar *progress_bar;
+  QTimer progress_timer;
+
+  // the events are copied when a search starts, the correlator runs on a worker thread
+  MessageEventsMap events;
+  std::unique_ptr<BitCorrelator> correlator;
+  QFutureWatcher<std::vector<BitCorrelation>> watcher;
+  std::atomic<bool> abort_search = false;
 };
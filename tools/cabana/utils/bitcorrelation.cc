@@ -0,0 +1,230 @@
+#include "tools/cabana/utils/bitcorrelation.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <mutex>
+#include <thread>
+#include <tuple>
+
+namespace {
+
+using Plane = std::vector<uint64_t>;
+
+inline bool get_bit(const CanEvent *e, int pos) {
+  return pos / 8 < e->size && ((e->dat[pos / 8] >> (7 - pos % 8)) & 1);
+}
+
+// moves bit k of the plane to k + shift, the bits past the end are dropped
+void shift_plane(const Plane &in, int shift, size_t bits, Plane &out) {
+  const int words = in.size();
+  const int word_shift = std::abs(shift) / 64, bit_shift = std::abs(shift) % 64;
+  out.assign(words, 0);
+  for (int i = 0; i < words; ++i) {
+    if (shift >= 0) {
+      const int src = i - word_shift;
+      if (src >= 0) out[i] |= in[src] << bit_shift;
+      if (bit_shift && src - 1 >= 0) out[i] |= in[src - 1] >> (64 - bit_shift);
+    } else {
+      const int src = i + word_shift;
+      if (src < words) out[i] |= in[src] >> bit_shift;
+      if (bit_shift && src + 1 < words) out[i] |= in[src + 1] << (64 - bit_shift);
+    }
+  }
+  if (bits % 64) out[words - 1] &= (1ULL << (bits % 64)) - 1;
+}
+
+inline uint32_t popcount(const Plane &a) {
+  uint32_t n = 0;
+  for (uint64_t w : a) n += __builtin_popcountll(w);
+  return n;
+}
+
+inline uint32_t popcount_and(const Plane &a, const Plane &b) {
+  uint32_t n = 0;
+  for (size_t i = 0; i < a.size(); ++i) n += __builtin_popcountll(a[i] & b[i]);
+  return n;
+}
+
+inline uint32_t popcount_xor_and(const Plane &a, const Plane &b, const Plane &mask) {
+  uint32_t n = 0;
+  for (size_t i = 0; i < a.size(); ++i) n += __builtin_popcountll((a[i] ^ b[i]) & mask[i]);
+  return n;
+}
+
+}  // namespace
+
+float mutual_information(uint32_t n, uint32_t n_target, uint32_t n_source, uint32_t n_both) {
+  if (n == 0) return 0;
+  const double counts[2][2] = {
+    {(double)n - n_target - n_source + n_both, (double)n_source - n_both},
+    {(double)n_target - n_both, (double)n_both},
+  };
+  const double p_target[2] = {(double)(n - n_target) / n, (double)n_target / n};
+  const double p_source[2] = {(double)(n - n_source) / n, (double)n_source / n};
+  double mi = 0;
+  for (int t = 0; t < 2; ++t) {
+    for (int s = 0; s < 2; ++s) {
+      if (counts[t][s] > 0) {
+        const double p = counts[t][s] / n;
+        mi += p * std::log2(p / (p_target[t] * p_source[s]));
+      }
+    }
+  }
+  return std::max(0.0, mi);
+}
+
+BitCorrelator::BitCorrelator(const MessageEventsMap &events, const MessageId &source_id, const std::vector<int> &source_bits,
+                             const Options &options)
+    : events_map(events), source_id(source_id), source_bits(source_bits), options(options) {
+  assert(source_bits.size() <= 64);
+  if (auto it = events_map.find(source_id); it != events_map.end()) {
+    source_samples.reserve(it->second.size());
+    for (const CanEvent *e : it->second) {
+      uint64_t bits = 0;
+      for (int s = 0; s < source_bits.size(); ++s) {
+        bits |= (uint64_t)get_bit(e, source_bits[s]) << s;
+      }
+      source_samples.push_back({e->mono_time, bits});
+    }
+  }
+  for (const auto &m : events_map) {
+    if (!m.second.empty() && (options.buses.empty() || options.buses.count(m.first.source))) {
+      messages.push_back(&m);
+    }
+  }
+}
+
+std::vector<BitCorrelation> BitCorrelator::run(std::atomic<bool> *abort) {
+  done_messages = 0;
+
+  std::vector<BitCorrelation> results;
+  if (source_samples.empty()) return results;
+
+  std::mutex lock;
+  std::atomic<size_t> next = 0;
+  auto worker = [&]() {
+    std::vector<BitCorrelation> local;
+    for (size_t i; (i = next++) < messages.size() && !(abort && *abort);) {
+      correlate(messages[i]->first, messages[i]->second, local);
+      ++done_messages;
+    }
+    std::lock_guard lk(lock);
+    results.insert(results.end(), local.begin(), local.end());
+  };
+
+  int threads = options.threads > 0 ? options.threads : std::max(1u, std::thread::hardware_concurrency());
+  std::vector<std::thread> pool;
+  for (int i = 1; i < threads; ++i) pool.emplace_back(worker);
+  worker();
+  for (auto &t : pool) t.join();
+
+  if (abort && *abort) return {};
+
+  auto key = [](const BitCorrelation &c) {
+    return std::make_tuple(-c.mutual_information, -std::abs(c.agreement - 0.5f), c.source.pos, c.target.id, c.target.pos);
+  };
+  std::sort(results.begin(), results.end(), [&](auto &l, auto &r) { return key(l) < key(r); });
+  if (options.max_results > 0 && results.size() > options.max_results) {
+    results.resize(options.max_results);
+  }
+  return results;
+}
+
+void BitCorrelator::correlate(const MessageId &id, const std::vector<const CanEvent *> &events, std::vector<BitCorrelation> &results) const {
+  const size_t m = events.size();
+  const int words = (m + 63) / 64;
+
+  // hold the source bits at every target event
+  std::vector<Plane> source_planes(source_bits.size(), Plane(words, 0));
+  Plane valid(words, 0);
+  int max_size = 0;
+  size_t held = 0;
+  for (size_t k = 0; k < m; ++k) {
+    const CanEvent *e = events[k];
+    max_size = std::max<int>(max_size, e->size);
+    while (held < source_samples.size() && source_samples[held].mono_time <= e->mono_time) ++held;
+    if (held == 0) continue;
+
+    const uint64_t mask = 1ULL << (k % 64);
+    valid[k / 64] |= mask;
+    for (uint64_t bits = source_samples[held - 1].bits; bits; bits &= bits - 1) {
+      source_planes[__builtin_ctzll(bits)][k / 64] |= mask;
+    }
+  }
+  const uint32_t n = popcount(valid);
+  if (n == 0 || n < options.min_samples) return;
+
+  // one plane per bit of the message
+  std::vector<Plane> target_planes(max_size * 8, Plane(words, 0));
+  for (size_t k = 0; k < m; ++k) {
+    const CanEvent *e = events[k];
+    const uint64_t mask = 1ULL << (k % 64);
+    for (int i = 0; i < e->size; ++i) {
+      for (uint8_t v = e->dat[i]; v; v &= v - 1) {
+        target_planes[i * 8 + 7 - __builtin_ctz(v)][k / 64] |= mask;
+      }
+    }
+  }
+
+  // bits that never change in the samples can't follow the source
+  std::vector<int> target_bits;
+  std::vector<uint32_t> target_counts(target_planes.size());
+  for (int pos = 0; pos < target_planes.size(); ++pos) {
+    target_counts[pos] = popcount_and(target_planes[pos], valid);
+    if (target_counts[pos] > 0 && target_counts[pos] < n) target_bits.push_back(pos);
+  }
+  if (target_bits.empty()) return;
+
+  // lags in the order they are preferred on a tie: 1, -1, 2, -2...
+  std::vector<int> lags;
+  for (int lag = 1; lag <= options.max_lag; ++lag) {
+    lags.push_back(lag);
+    lags.push_back(-lag);
+  }
+  std::vector<Plane> lagged_source(lags.size()), lagged_valid(lags.size());
+  std::vector<uint32_t> lagged_n(lags.size());
+  for (int l = 0; l < lags.size(); ++l) {
+    shift_plane(valid, lags[l], m, lagged_valid[l]);
+    lagged_n[l] = popcount(lagged_valid[l]);
+  }
+
+  for (int s = 0; s < source_bits.size(); ++s) {
+    const Plane &source = source_planes[s];
+    const uint32_t n_source = popcount(source);
+    for (int l = 0; l < lags.size(); ++l) {
+      shift_plane(source, lags[l], m, lagged_source[l]);
+    }
+
+    for (int pos : target_bits) {
+      if (id == source_id && pos == source_bits[s]) continue;
+
+      const Plane &target = target_planes[pos];
+      const uint32_t n_both = popcount_and(target, source);
+      const uint32_t mismatches = target_counts[pos] + n_source - 2 * n_both;
+      const float agreement = (n - mismatches) / (float)n;
+
+      int best_lag = 0;
+      float lagged_agreement = agreement;
+      for (int l = 0; l < lags.size(); ++l) {
+        if (lagged_n[l] == 0) continue;
+        const uint32_t lagged_mismatches = popcount_xor_and(target, lagged_source[l], lagged_valid[l]);
+        const float a = (lagged_n[l] - lagged_mismatches) / (float)lagged_n[l];
+        if (std::abs(a - 0.5f) > std::abs(lagged_agreement - 0.5f)) {
+          best_lag = lags[l];
+          lagged_agreement = a;
+        }
+      }
+
+      results.push_back({
+        .source = {source_id, source_bits[s]},
+        .target = {id, pos},
+        .samples = n,
+        .agreement = agreement,
+        .best_lag = best_lag,
+        .lagged_agreement = lagged_agreement,
+        .mutual_information = mutual_information(n, target_counts[pos], n_source, n_both),
+      });
+    }
+  }
+}
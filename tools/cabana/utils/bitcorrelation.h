@@ -0,0 +1,69 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <set>
+#include <vector>
+
+#include "tools/cabana/streams/abstractstream.h"
+
+// A bit of a message, byte * 8 + column. Columns go from the msb to the lsb like in the binary view.
+struct MessageBit {
+  MessageId id;
+  int pos;
+};
+
+struct BitCorrelation {
+  MessageBit source;
+  MessageBit target;
+  // target events after the first source event
+  uint32_t samples;
+  // fraction of the samples where the target bit equals the last value of the source bit
+  float agreement;
+  // the lag in target events with the agreement farthest from chance, positive when the target follows the source
+  int best_lag;
+  float lagged_agreement;
+  // in bits, the same for equal and inverted bits
+  float mutual_information;
+};
+
+// Correlates source bits with every bit of every message. The source bit is sampled and held at
+// the time of each target event. Each message is turned into packed bit planes, one bit per event,
+// so every comparison is an xor and a popcount over 64 events at a time. Messages are split
+// between worker threads.
+class BitCorrelator {
+public:
+  struct Options {
+    // all buses when empty
+    std::set<uint8_t> buses;
+    int max_lag = 3;
+    uint32_t min_samples = 100;
+    // the best results by mutual information, all when 0
+    size_t max_results = 0;
+    int threads = 0;
+  };
+
+  BitCorrelator(const MessageEventsMap &events, const MessageId &source_id, const std::vector<int> &source_bits, const Options &options);
+  std::vector<BitCorrelation> run(std::atomic<bool> *abort = nullptr);
+  // fraction of the messages done
+  float progress() const { return messages.empty() ? 0 : done_messages / (float)messages.size(); }
+
+private:
+  struct SourceSample {
+    uint64_t mono_time;
+    uint64_t bits;  // one per source bit
+  };
+
+  void correlate(const MessageId &id, const std::vector<const CanEvent *> &events, std::vector<BitCorrelation> &results) const;
+
+  const MessageEventsMap &events_map;
+  MessageId source_id;
+  std::vector<int> source_bits;
+  Options options;
+  std::vector<SourceSample> source_samples;
+  // the messages to search, fixed before run() so progress() can read them from another thread
+  std::vector<const std::pair<const MessageId, std::vector<const CanEvent *>> *> messages;
+  std::atomic<size_t> done_messages = 0;
+};
+
+float mutual_information(uint32_t n, uint32_t n_target, uint32_t n_source, uint32_t n_both);
@@ -0,0 +1,136 @@
+#include "tools/cabana/utils/bitflipindex.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "tools/cabana/streams/abstractstream.h"
+
+// bit planes of the per bit counters, enough to add up 127 flips before they are flushed
+constexpr int PLANES = 7;
+constexpr int MAX_PLANE_COUNT = (1 << PLANES) - 1;
+
+namespace {
+
+// adds the counter in the bit planes of a payload word to the per bit sums
+void flush_planes(uint64_t planes[PLANES], int word, int64_t sign, std::vector<int64_t> &sums) {
+  for (int p = 0; p < PLANES; ++p) {
+    uint8_t bytes[8];
+    memcpy(bytes, &planes[p], sizeof(bytes));
+    for (int j = 0; j < 8; ++j) {
+      for (uint8_t v = bytes[j]; v; v &= v - 1) {
+        sums[(word * 8 + j) * 8 + 7 - __builtin_ctz(v)] += sign << p;
+      }
+    }
+    planes[p] = 0;
+  }
+}
+
+int payload_words(const std::vector<const CanEvent *> &events, size_t from) {
+  int max_size = 1;
+  for (size_t i = from; i < events.size(); ++i) {
+    max_size = std::max<int>(max_size, events[i]->size);
+  }
+  return (max_size + 7) / 8;
+}
+
+}  // namespace
+
+void BitFlipIndex::clear() {
+  words = 0;
+  event_count = 0;
+  first_event = last_event = nullptr;
+  payloads.clear();
+  checkpoints.clear();
+}
+
+void BitFlipIndex::update(const std::vector<const CanEvent *> &events) {
+  if (events.empty()) {
+    clear();
+    return;
+  }
+
+  const bool appended = event_count > 0 && events.size() >= event_count &&
+                        events.front() == first_event && events[event_count - 1] == last_event;
+  if (!appended || payload_words(events, event_count) > words) {
+    rebuild(events, payload_words(events, 0));
+  } else if (events.size() > event_count) {
+    append(events, event_count);
+  }
+  first_event = events.front();
+  last_event = events.back();
+  event_count = events.size();
+}
+
+void BitFlipIndex::rebuild(const std::vector<const CanEvent *> &events, int payload_words) {
+  words = payload_words;
+  payloads.clear();
+  checkpoints.assign(words * 64, 0);
+  append(events, 0);
+}
+
+void BitFlipIndex::append(const std::vector<const CanEvent *> &events, size_t from) {
+  payloads.resize(events.size() * words, 0);
+  for (size_t k = from; k < events.size(); ++k) {
+    memcpy(&payloads[k * words], events[k]->dat, events[k]->size);
+  }
+
+  // close the blocks that are complete now
+  const size_t bits = words * 64;
+  std::vector<int64_t> sums(bits);
+  for (size_t block = checkpoints.size() / bits; block * BLOCK_SIZE < events.size(); ++block) {
+    std::fill(sums.begin(), sums.end(), 0);
+    accumulate((block - 1) * BLOCK_SIZE, block * BLOCK_SIZE, 1, sums);
+    checkpoints.resize((block + 1) * bits);
+    const uint32_t *prev = &checkpoints[(block - 1) * bits];
+    uint32_t *cp = &checkpoints[block * bits];
+    for (size_t i = 0; i < bits; ++i) cp[i] = prev[i] + sums[i];
+  }
+}
+
+void BitFlipIndex::accumulate(size_t first, size_t last, int64_t sign, std::vector<int64_t> &sums) const {
+  for (int w = 0; w < words; ++w) {
+    // a carry-save adder over all 64 bits of the word at once
+    uint64_t planes[PLANES] = {};
+    int pending = 0;
+    for (size_t k = first + 1; k <= last; ++k) {
+      uint64_t carry = payloads[k * words + w] ^ payloads[(k - 1) * words + w];
+      for (int p = 0; p < PLANES && carry; ++p) {
+        const uint64_t next = planes[p] & carry;
+        planes[p] ^= carry;
+        carry = next;
+      }
+      if (++pending == MAX_PLANE_COUNT) {
+        flush_planes(planes, w, sign, sums);
+        pending = 0;
+      }
+    }
+    if (pending) flush_planes(planes, w, sign, sums);
+  }
+}
+
+void BitFlipIndex::query(size_t first, size_t last, size_t msg_size, BitFlipCounts &counts) const {
+  counts.assign(msg_size, std::array<uint32_t, 8>{});
+  last = std::min(last, event_count);
+  if (first + 1 >= last) return;
+
+  // flips of (first, last - 1] = flips of (0, last - 1] - flips of (0, first]
+  const size_t bits = words * 64;
+  std::vector<int64_t> sums(bits);
+  const size_t end_block = (last - 1) / BLOCK_SIZE, begin_block = first / BLOCK_SIZE;
+  if (end_block == begin_block) {
+    accumulate(first, last - 1, 1, sums);
+  } else {
+    const uint32_t *end_cp = &checkpoints[end_block * bits];
+    const uint32_t *begin_cp = &checkpoints[begin_block * bits];
+    for (size_t i = 0; i < bits; ++i) sums[i] = (int64_t)end_cp[i] - begin_cp[i];
+    accumulate(end_block * BLOCK_SIZE, last - 1, 1, sums);
+    accumulate(begin_block * BLOCK_SIZE, first, -1, sums);
+  }
+
+  const size_t rows = std::min<size_t>(msg_size, words * 8);
+  for (size_t i = 0; i < rows; ++i) {
+    for (int j = 0; j < 8; ++j) {
+      counts[i][j] = sums[i * 8 + j];
+    }
+  }
+}
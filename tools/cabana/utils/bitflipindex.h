@@ -0,0 +1,48 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+struct CanEvent;
+
+using BitFlipCounts = std::vector<std::array<uint32_t, 8>>;
+
+// counts the flipped bits of a byte, the columns go from the msb to the lsb like in the binary view
+inline void addBitFlips(std::array<uint32_t, 8> &row, uint8_t diff) {
+  while (diff) {
+    ++row[7 - __builtin_ctz(diff)];
+    diff &= diff - 1;
+  }
+}
+
+// Per bit flip counts of a message, for any range of its events.
+// The payloads are copied into one array of 64-bit words, the flips are the xor of consecutive
+// payloads summed in bit planes. Cumulative counts are kept every BLOCK_SIZE events, so a range
+// costs two lookups and at most two partial blocks, however many events it spans.
+class BitFlipIndex {
+public:
+  static constexpr int BLOCK_SIZE = 64;
+
+  // indexes the events added since the last update, or all of them if earlier events changed
+  void update(const std::vector<const CanEvent *> &events);
+  // flips between consecutive events in [first, last) for the first msg_size bytes
+  void query(size_t first, size_t last, size_t msg_size, BitFlipCounts &counts) const;
+  void clear();
+  size_t size() const { return event_count; }
+
+private:
+  void rebuild(const std::vector<const CanEvent *> &events, int words);
+  void append(const std::vector<const CanEvent *> &events, size_t from);
+  // adds the flips of events (first, last] to sums, one per bit of the payload
+  void accumulate(size_t first, size_t last, int64_t sign, std::vector<int64_t> &sums) const;
+
+  int words = 0;  // 64-bit words per payload
+  size_t event_count = 0;
+  const CanEvent *first_event = nullptr;
+  const CanEvent *last_event = nullptr;
+  std::vector<uint64_t> payloads;
+  // flips of events (0, k * BLOCK_SIZE], words * 64 counts per block
+  std::vector<uint32_t> checkpoints;
+};
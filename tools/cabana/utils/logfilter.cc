@@ -0,0 +1,58 @@
+#include "tools/cabana/utils/logfilter.h"
+
+#include <algorithm>
+#include <thread>
+
+LogFilter::LogFilter(const std::vector<const CanEvent *> &events, const cabana::Signal &sig, double value,
+                     std::function<bool(double, double)> cmp, int threads)
+    : events(events), sig(sig), value(value), cmp(cmp), threads(threads) {
+  // the signals may change while the filter runs
+  if (sig.multiplexor) {
+    multiplexor = *sig.multiplexor;
+    this->sig.multiplexor = &multiplexor;
+  }
+  event_count = events.size();
+  if (!events.empty()) {
+    first_event = events.front();
+    last_event = events.back();
+  }
+  chunk_count = (event_count + CHUNK_SIZE - 1) / CHUNK_SIZE;
+}
+
+bool LogFilter::run(std::atomic<bool> *abort) {
+  std::vector<std::vector<uint32_t>> chunk_matches(chunk_count);
+  std::atomic<size_t> next = 0;
+  auto worker = [&]() {
+    double v = 0;
+    for (size_t c; (c = next++) < chunk_count && !(abort && *abort);) {
+      const size_t end = std::min(event_count, (c + 1) * CHUNK_SIZE);
+      for (size_t i = c * CHUNK_SIZE; i < end; ++i) {
+        const CanEvent *e = events[i];
+        // a multiplexed signal only matches the events it is in
+        if (sig.getValue(e->dat, e->size, &v) && cmp(v, value)) chunk_matches[c].push_back(i);
+      }
+      ++done_chunks;
+    }
+  };
+
+  int n = threads > 0 ? threads : std::max(1u, std::thread::hardware_concurrency());
+  n = std::min<int>(n, chunk_count);
+  std::vector<std::thread> pool;
+  for (int i = 1; i < n; ++i) pool.emplace_back(worker);
+  worker();
+  for (auto &t : pool) t.join();
+  if (abort && *abort) return false;
+
+  size_t total = 0;
+  for (auto &m : chunk_matches) total += m.size();
+  matches_.reserve(total);
+  for (auto &m : chunk_matches) matches_.insert(matches_.end(), m.begin(), m.end());
+  events = {};
+  return true;
+}
+
+bool LogFilter::follows(const std::vector<const CanEvent *> &message_events) const {
+  if (event_count == 0) return true;
+  return message_events.size() >= event_count && message_events.front() == first_event &&
+         message_events[event_count - 1] == last_event;
+}
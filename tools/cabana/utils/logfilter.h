@@ -0,0 +1,43 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "tools/cabana/dbc/dbc.h"
+#include "tools/cabana/streams/abstractstream.h"
+
+// Finds the events of a message where a signal passes the history log filter. The events are
+// split into chunks that worker threads decode and compare, the result is the sorted list of
+// matching event indexes, so paging through the matches doesn't decode anything again.
+class LogFilter {
+public:
+  static constexpr size_t CHUNK_SIZE = 16 * 1024;
+
+  LogFilter(const std::vector<const CanEvent *> &events, const cabana::Signal &sig, double value,
+            std::function<bool(double, double)> cmp, int threads = 0);
+  // returns false if aborted
+  bool run(std::atomic<bool> *abort = nullptr);
+  // fraction of the events done
+  float progress() const { return chunk_count ? done_chunks / (float)chunk_count : 1.0f; }
+  // the indexed events are still the first events of the message
+  bool follows(const std::vector<const CanEvent *> &message_events) const;
+  // indexes of the matching events, in ascending order
+  const std::vector<uint32_t> &matches() const { return matches_; }
+  size_t size() const { return event_count; }
+
+private:
+  std::vector<const CanEvent *> events;
+  cabana::Signal sig, multiplexor;
+  double value;
+  std::function<bool(double, double)> cmp;
+  int threads;
+
+  size_t event_count;
+  const CanEvent *first_event = nullptr;
+  const CanEvent *last_event = nullptr;
+  size_t chunk_count;
+  std::atomic<size_t> done_chunks = 0;
+  std::vector<uint32_t> matches_;
+};
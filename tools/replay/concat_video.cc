@@ -0,0 +1,102 @@
+#include <getopt.h>
+
+#include <csignal>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "tools/replay/route.h"
+#include "tools/replay/util.h"
+#include "tools/replay/video_concat.h"
+
+const std::string helpText =
+R"(Usage: concat_video [options] [route] [output]
+Stitches the camera files of a route into one video without re-encoding.
+The container is picked from the extension of the output, e.g. .mkv or .mp4
+Options:
+  -c, --camera       road, driver, wide or qcam. Default is road
+  -d, --data_dir     Local directory with routes
+  -j, --jobs         Segments demuxed in parallel
+      --no-index     Don't write the keyframe index next to the output
+  -h, --help         Show this help message
+)";
+
+struct CameraFiles {
+  std::string SegmentFile::*file;
+  cereal::Event::Which encode_idx;
+  // every EncodeIndex of the camera is in the qlog, see cereal/services.py
+  bool in_qlog;
+};
+
+const std::map<std::string, CameraFiles> cameras = {
+  {"road", {&SegmentFile::road_cam, cereal::Event::ROAD_ENCODE_IDX, true}},
+  {"driver", {&SegmentFile::driver_cam, cereal::Event::DRIVER_ENCODE_IDX, true}},
+  {"wide", {&SegmentFile::wide_road_cam, cereal::Event::WIDE_ROAD_ENCODE_IDX, true}},
+  {"qcam", {&SegmentFile::qcamera, cereal::Event::Q_ROAD_ENCODE_IDX, false}},
+};
+
+std::atomic<bool> do_exit = false;
+
+int main(int argc, char *argv[]) {
+  const struct option cli_options[] = {
+      {"camera", required_argument, nullptr, 'c'},
+      {"data_dir", required_argument, nullptr, 'd'},
+      {"jobs", required_argument, nullptr, 'j'},
+      {"no-index", no_argument, nullptr, 0},
+      {"help", no_argument, nullptr, 'h'},
+      {nullptr, 0, nullptr, 0},  // Terminating entry
+  };
+
+  std::string camera = "road", data_dir;
+  int jobs = 0;
+  bool write_index = true;
+  int opt, option_index = 0;
+  while ((opt = getopt_long(argc, argv, "c:d:j:h", cli_options, &option_index)) != -1) {
+    switch (opt) {
+      case 'c': camera = optarg; break;
+      case 'd': data_dir = optarg; break;
+      case 'j': jobs = std::atoi(optarg); break;
+      case 0: write_index = false; break;
+      case 'h': std::cout << helpText; return 0;
+      default: return 1;
+    }
+  }
+  if (argc - optind != 2 || cameras.count(camera) == 0) {
+    std::cerr << helpText;
+    return 1;
+  }
+  const std::string route_name = argv[optind], output = argv[optind + 1];
+  const CameraFiles &cam = cameras.at(camera);
+
+  Route route(route_name, data_dir);
+  if (!route.load()) {
+    std::cerr << "failed to load route " << route_name << "\n";
+    return 1;
+  }
+
+  std::vector<ConcatSegment> segments;
+  for (const auto &[n, files] : route.segments()) {
+    if ((files.*cam.file).empty()) {
+      rWarning("segment %d has no %s video", n, camera.c_str());
+      continue;
+    }
+    // the qlog is much smaller, but qRoadEncodeIdx is only logged in the rlog
+    const std::string &log = cam.in_qlog && !files.qlog.empty() ? files.qlog : files.rlog;
+    segments.push_back({.seg_num = n, .video = files.*cam.file, .log = log});
+  }
+
+  std::signal(SIGINT, [](int) { do_exit = true; });
+  VideoConcat concat(cam.encode_idx, jobs);
+  if (!concat.concat(segments, output, &do_exit)) {
+    std::cerr << "failed to write " << output << "\n";
+    return 1;
+  }
+  std::cout << "wrote " << concat.frameCount() << " frames from " << segments.size() << " segments to " << output << "\n";
+
+  if (write_index && !concat.writeKeyframeIndex(output + ".keyframes.csv")) {
+    std::cerr << "failed to write the keyframe index\n";
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,171 @@
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "catch2/catch.hpp"
+#include "common/util.h"
+#include "tools/replay/video_concat.h"
+
+const int WIDTH = 160, HEIGHT = 96;
+const int SEGMENT_FRAMES = 30, GOP = 5;
+
+// luma of a synthetic frame, survives the encoding within a few levels
+static int frame_luma(int frame) { return 40 + (frame % 60) * 3; }
+
+// writes the packets one after another like VideoWriter does for the raw camera streams
+static void encode_segment(const std::string &file, int first_frame) {
+  const AVCodec *codec = avcodec_find_encoder(AV_CODEC_ID_MPEG4);
+  REQUIRE(codec);
+  AVCodecContext *ctx = avcodec_alloc_context3(codec);
+  ctx->width = WIDTH;
+  ctx->height = HEIGHT;
+  ctx->pix_fmt = AV_PIX_FMT_YUV420P;
+  ctx->time_base = {1, 20};
+  ctx->gop_size = GOP;
+  ctx->max_b_frames = 0;
+  ctx->bit_rate = 2000000;
+  REQUIRE(avcodec_open2(ctx, codec, nullptr) == 0);
+
+  AVFrame *frame = av_frame_alloc();
+  frame->format = ctx->pix_fmt;
+  frame->width = WIDTH;
+  frame->height = HEIGHT;
+  REQUIRE(av_frame_get_buffer(frame, 0) == 0);
+  AVPacket *pkt = av_packet_alloc();
+  FILE *f = fopen(file.c_str(), "wb");
+  REQUIRE(f);
+
+  auto write_packets = [&]() {
+    while (avcodec_receive_packet(ctx, pkt) == 0) {
+      fwrite(pkt->data, 1, pkt->size, f);
+      av_packet_unref(pkt);
+    }
+  };
+  for (int i = 0; i < SEGMENT_FRAMES; ++i) {
+    REQUIRE(av_frame_make_writable(frame) == 0);
+    for (int y = 0; y < HEIGHT; ++y) memset(frame->data[0] + y * frame->linesize[0], frame_luma(first_frame + i), WIDTH);
+    for (int y = 0; y < HEIGHT / 2; ++y) {
+      memset(frame->data[1] + y * frame->linesize[1], 128, WIDTH / 2);
+      memset(frame->data[2] + y * frame->linesize[2], 128, WIDTH / 2);
+    }
+    frame->pts = i;
+    REQUIRE(avcodec_send_frame(ctx, frame) == 0);
+    write_packets();
+  }
+  avcodec_send_frame(ctx, nullptr);
+  write_packets();
+
+  fclose(f);
+  av_packet_free(&pkt);
+  av_frame_free(&frame);
+  avcodec_free_context(&ctx);
+}
+
+struct OutputFrame {
+  int64_t pts_us;
+  bool keyframe;
+  int luma;
+};
+
+// demuxes and decodes the output
+static std::vector<OutputFrame> read_output(const std::string &file) {
+  std::vector<OutputFrame> frames;
+  AVFormatContext *input_ctx = nullptr;
+  REQUIRE(avformat_open_input(&input_ctx, file.c_str(), nullptr, nullptr) == 0);
+  REQUIRE(avformat_find_stream_info(input_ctx, nullptr) >= 0);
+  REQUIRE(input_ctx->nb_streams == 1);
+  AVStream *stream = input_ctx->streams[0];
+
+  const AVCodec *codec = avcodec_find_decoder(stream->codecpar->codec_id);
+  AVCodecContext *ctx = avcodec_alloc_context3(codec);
+  avcodec_parameters_to_context(ctx, stream->codecpar);
+  REQUIRE(avcodec_open2(ctx, codec, nullptr) == 0);
+
+  AVPacket *pkt = av_packet_alloc();
+  AVFrame *frame = av_frame_alloc();
+  int decoded = 0;
+  auto receive_frames = [&]() {
+    while (avcodec_receive_frame(ctx, frame) == 0) {
+      frames[decoded++].luma = frame->data[0][(HEIGHT / 2) * frame->linesize[0] + WIDTH / 2];
+    }
+  };
+  while (av_read_frame(input_ctx, pkt) == 0) {
+    frames.push_back({av_rescale_q(pkt->pts, stream->time_base, {1, 1000000}), (pkt->flags & AV_PKT_FLAG_KEY) != 0, -1});
+    REQUIRE(avcodec_send_packet(ctx, pkt) == 0);
+    av_packet_unref(pkt);
+    receive_frames();
+  }
+  avcodec_send_packet(ctx, nullptr);
+  receive_frames();
+  REQUIRE(decoded == frames.size());
+
+  av_frame_free(&frame);
+  av_packet_free(&pkt);
+  avcodec_free_context(&ctx);
+  avformat_close_input(&input_ctx);
+  return frames;
+}
+
+TEST_CASE("VideoConcat remuxes segments") {
+  const std::string dir = "/tmp/test_video_concat_" + util::random_string(8);
+  REQUIRE(util::create_directories(dir, 0775));
+
+  // three segments, the second one starts after a gap of a second. the last one has no index
+  const uint64_t start_ns = 1234567890000ULL;
+  std::vector<ConcatSegment> segments;
+  std::vector<int64_t> expected_pts;
+  for (int n = 0; n < 3; ++n) {
+    ConcatSegment seg = {.seg_num = n, .video = util::string_format("%s/%d.m4v", dir.c_str(), n)};
+    encode_segment(seg.video, n * SEGMENT_FRAMES);
+    for (int i = 0; i < SEGMENT_FRAMES; ++i) {
+      int64_t pts_us = ((n * SEGMENT_FRAMES + i) * 50 + (n > 0 ? 1000 : 0)) * 1000;
+      if (n < 2) seg.timestamps.push_back(start_ns + pts_us * 1000);
+      expected_pts.push_back(pts_us);
+    }
+    segments.push_back(seg);
+  }
+
+  const std::string output = dir + "/concat.mkv";
+  VideoConcat concat(cereal::Event::ROAD_ENCODE_IDX, 2);
+  REQUIRE(concat.concat(segments, output));
+  REQUIRE(concat.frameCount() == 3 * SEGMENT_FRAMES);
+
+  auto frames = read_output(output);
+  REQUIRE(frames.size() == 3 * SEGMENT_FRAMES);
+  for (int i = 0; i < frames.size(); ++i) {
+    INFO("frame " << i);
+    // rebased to the first frame, the frames without an index follow at the camera rate
+    REQUIRE(frames[i].pts_us == expected_pts[i]);
+    REQUIRE(frames[i].keyframe == (i % GOP == 0));
+    // in order and not re-encoded
+    REQUIRE(std::abs(frames[i].luma - frame_luma(i)) <= 2);
+  }
+
+  const auto &keyframes = concat.keyframes();
+  REQUIRE(keyframes.size() == 3 * SEGMENT_FRAMES / GOP);
+  for (int k = 0; k < keyframes.size(); ++k) {
+    REQUIRE(keyframes[k].frame == k * GOP);
+    REQUIRE(keyframes[k].seg_num == k * GOP / SEGMENT_FRAMES);
+    REQUIRE(keyframes[k].segment_id == (k * GOP) % SEGMENT_FRAMES);
+    REQUIRE(keyframes[k].pts_us == expected_pts[k * GOP]);
+  }
+  REQUIRE(concat.writeKeyframeIndex(output + ".keyframes.csv"));
+  auto index = util::read_file(output + ".keyframes.csv");
+  REQUIRE(util::starts_with(index, "frame,segment,segment_id,pts_us\n0,0,0,0\n5,0,5,250000\n"));
+
+  system(("rm -rf " + dir).c_str());
+}
+
+TEST_CASE("VideoConcat skips unreadable segments") {
+  const std::string dir = "/tmp/test_video_concat_" + util::random_string(8);
+  REQUIRE(util::create_directories(dir, 0775));
+  const std::string video = dir + "/0.m4v";
+  encode_segment(video, 0);
+
+  VideoConcat concat(cereal::Event::ROAD_ENCODE_IDX);
+  REQUIRE(concat.concat({{.seg_num = 0, .video = video}, {.seg_num = 1, .video = dir + "/missing.m4v"}}, dir + "/concat.mkv"));
+  REQUIRE(concat.frameCount() == SEGMENT_FRAMES);
+  REQUIRE_FALSE(concat.concat({{.seg_num = 1, .video = dir + "/missing.m4v"}}, dir + "/empty.mkv"));
+
+  system(("rm -rf " + dir).c_str());
+}
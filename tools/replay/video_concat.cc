@@ -0,0 +1,258 @@
+#include "tools/replay/video_concat.h"
+
+#include <algorithm>
+#include <deque>
+#include <fstream>
+#include <future>
+#include <thread>
+#include <utility>
+
+#include "common/util.h"
+#include "tools/replay/filereader.h"
+#include "tools/replay/logreader.h"
+#include "tools/replay/util.h"
+
+// frame rate of the cameras, used for frames without an EncodeIndex
+const int FALLBACK_FPS = 20;
+// segments demuxed ahead of the muxer by default
+const int MAX_DEFAULT_THREADS = 4;
+
+const AVRational MICROSECONDS = {1, 1000000};
+
+VideoConcat::DemuxedSegment::DemuxedSegment(DemuxedSegment &&other)
+    : ok(other.ok), codecpar(other.codecpar), time_base(other.time_base),
+      packets(std::move(other.packets)), timestamps(std::move(other.timestamps)) {
+  other.codecpar = nullptr;
+  other.packets.clear();
+}
+
+VideoConcat::DemuxedSegment::~DemuxedSegment() {
+  for (auto pkt : packets) av_packet_free(&pkt);
+  if (codecpar) avcodec_parameters_free(&codecpar);
+}
+
+VideoConcat::VideoConcat(cereal::Event::Which encode_idx_type, int threads) : encode_idx_type(encode_idx_type) {
+  if (threads <= 0) {
+    threads = std::clamp((int)std::thread::hardware_concurrency(), 1, MAX_DEFAULT_THREADS);
+  }
+  this->threads = threads;
+  av_log_set_level(AV_LOG_QUIET);
+}
+
+bool VideoConcat::concat(const std::vector<ConcatSegment> &segments, const std::string &output, std::atomic<bool> *abort) {
+  keyframes_.clear();
+  frame_count_ = 0;
+  base_timestamp = 0;
+  next_pts_us = 0;
+  last_pts_us = -1;
+
+  // demux ahead in parallel, mux in segment order as each one is ready
+  std::deque<std::future<DemuxedSegment>> pending;
+  size_t next = 0;
+  auto fill = [&]() {
+    while (next < segments.size() && pending.size() < (size_t)threads && !(abort && *abort)) {
+      pending.push_back(std::async(std::launch::async, &VideoConcat::demux, this, std::cref(segments[next]), abort));
+      ++next;
+    }
+  };
+
+  bool success = true;
+  for (size_t i = 0; i < segments.size() && !(abort && *abort); ++i) {
+    fill();
+    if (pending.empty()) break;
+    DemuxedSegment demuxed = pending.front().get();
+    pending.pop_front();
+
+    if (!demuxed.ok) {
+      rWarning("skipping segment %d, failed to read %s", segments[i].seg_num, segments[i].video.c_str());
+      continue;
+    }
+    if (!ofmt_ctx && !openOutput(output, demuxed)) {
+      success = false;
+      break;
+    }
+    if (!mux(segments[i], demuxed)) {
+      success = false;
+      break;
+    }
+    rInfo("segment %d: %zu frames", segments[i].seg_num, demuxed.packets.size());
+  }
+  // finish the demuxers still running before the segments go away
+  for (auto &f : pending) f.wait();
+
+  if (!ofmt_ctx) {
+    if (success) rError("no video to write");
+    return false;
+  }
+  int err = av_write_trailer(ofmt_ctx);
+  if (err != 0) {
+    rError("av_write_trailer failed %d", err);
+    success = false;
+  }
+  if (!(ofmt_ctx->oformat->flags & AVFMT_NOFILE)) avio_closep(&ofmt_ctx->pb);
+  avformat_free_context(ofmt_ctx);
+  avcodec_parameters_free(&out_codecpar);
+  ofmt_ctx = nullptr;
+  out_stream = nullptr;
+  return success && !(abort && *abort);
+}
+
+VideoConcat::DemuxedSegment VideoConcat::demux(const ConcatSegment &segment, std::atomic<bool> *abort) {
+  DemuxedSegment demuxed;
+  demuxed.timestamps = segment.timestamps;
+  if (demuxed.timestamps.empty() && !segment.log.empty()) {
+    demuxed.timestamps = readTimestamps(segment.log, abort);
+  }
+
+  std::string file = segment.video;
+  if (file.find("https://") == 0) {
+    file = cacheFilePath(segment.video);
+    if (!util::file_exists(file) && FileReader(true).read(segment.video, abort).empty()) {
+      return demuxed;
+    }
+  }
+
+  AVFormatContext *input_ctx = nullptr;
+  if (avformat_open_input(&input_ctx, file.c_str(), nullptr, nullptr) != 0) {
+    return demuxed;
+  }
+  int stream_idx = -1;
+  if (avformat_find_stream_info(input_ctx, nullptr) >= 0) {
+    stream_idx = av_find_best_stream(input_ctx, AVMEDIA_TYPE_VIDEO, -1, -1, nullptr, 0);
+  }
+  if (stream_idx >= 0) {
+    AVStream *stream = input_ctx->streams[stream_idx];
+    demuxed.codecpar = avcodec_parameters_alloc();
+    avcodec_parameters_copy(demuxed.codecpar, stream->codecpar);
+    demuxed.time_base = stream->time_base;
+
+    // the packets are kept as they are, in file order
+    demuxed.packets.reserve(60 * FALLBACK_FPS);
+    AVPacket *pkt = av_packet_alloc();
+    while (!(abort && *abort) && av_read_frame(input_ctx, pkt) == 0) {
+      if (pkt->stream_index == stream_idx) {
+        demuxed.packets.push_back(pkt);
+        pkt = av_packet_alloc();
+      } else {
+        av_packet_unref(pkt);
+      }
+    }
+    av_packet_free(&pkt);
+    demuxed.ok = !demuxed.packets.empty();
+  }
+  avformat_close_input(&input_ctx);
+  return demuxed;
+}
+
+std::vector<uint64_t> VideoConcat::readTimestamps(const std::string &log, std::atomic<bool> *abort) {
+  auto event_schema = capnp::Schema::from<cereal::Event>().asStruct();
+  std::vector<bool> filters(event_schema.getUnionFields().size(), false);
+  filters[encode_idx_type] = true;
+
+  std::vector<uint64_t> timestamps;
+  LogReader reader(filters);
+  if (!reader.load(log, abort, true)) return timestamps;
+
+  for (const Event &e : reader.events) {
+    // the log reader adds each full video index again as a frame event
+    if (e.which != encode_idx_type || e.eidx_segnum != -1) continue;
+    capnp::FlatArrayMessageReader msg(e.data);
+    auto event = msg.getRoot<cereal::Event>();
+    auto idx = capnp::AnyStruct::Reader(event).getPointerSection()[0].getAs<cereal::EncodeIndex>();
+    uint32_t segment_id = idx.getSegmentId();
+    if (segment_id >= timestamps.size()) timestamps.resize(segment_id + 1, 0);
+    timestamps[segment_id] = idx.getTimestampEof();
+  }
+  return timestamps;
+}
+
+bool VideoConcat::openOutput(const std::string &output, const DemuxedSegment &first) {
+  avformat_alloc_output_context2(&ofmt_ctx, nullptr, nullptr, output.c_str());
+  if (!ofmt_ctx) {
+    rError("unknown output format for %s", output.c_str());
+    return false;
+  }
+
+  out_stream = avformat_new_stream(ofmt_ctx, nullptr);
+  out_codecpar = avcodec_parameters_alloc();
+  avcodec_parameters_copy(out_codecpar, first.codecpar);
+  avcodec_parameters_copy(out_stream->codecpar, first.codecpar);
+  // the tag of the input container may not exist in the output one
+  out_stream->codecpar->codec_tag = 0;
+  out_stream->time_base = MICROSECONDS;
+
+  if (!(ofmt_ctx->oformat->flags & AVFMT_NOFILE) && avio_open(&ofmt_ctx->pb, output.c_str(), AVIO_FLAG_WRITE) < 0) {
+    rError("failed to open %s", output.c_str());
+  } else if (avformat_write_header(ofmt_ctx, nullptr) < 0) {
+    rError("failed to write header of %s", output.c_str());
+    if (!(ofmt_ctx->oformat->flags & AVFMT_NOFILE)) avio_closep(&ofmt_ctx->pb);
+  } else {
+    return true;
+  }
+  avformat_free_context(ofmt_ctx);
+  avcodec_parameters_free(&out_codecpar);
+  ofmt_ctx = nullptr;
+  return false;
+}
+
+bool VideoConcat::mux(const ConcatSegment &segment, DemuxedSegment &demuxed) {
+  const AVCodecParameters *par = demuxed.codecpar;
+  if (par->codec_id != out_codecpar->codec_id || par->width != out_codecpar->width || par->height != out_codecpar->height) {
+    rWarning("skipping segment %d, its video can't be remuxed with the first one", segment.seg_num);
+    return true;
+  }
+  if (!demuxed.timestamps.empty() && demuxed.timestamps.size() != demuxed.packets.size()) {
+    rWarning("segment %d: %zu frames but %zu indexed", segment.seg_num, demuxed.packets.size(), demuxed.timestamps.size());
+  }
+
+  const int64_t frame_us = 1000000 / FALLBACK_FPS;
+  int out_of_order = 0;
+  for (int i = 0; i < demuxed.packets.size(); ++i) {
+    AVPacket *pkt = demuxed.packets[i];
+
+    // rebase the EncodeIndex timestamps, frames without one follow the previous frame
+    int64_t pts_us = next_pts_us;
+    if (i < demuxed.timestamps.size() && demuxed.timestamps[i] != 0) {
+      if (base_timestamp == 0) {
+        base_timestamp = demuxed.timestamps[i] - next_pts_us * 1000;
+      }
+      pts_us = ((int64_t)demuxed.timestamps[i] - (int64_t)base_timestamp) / 1000;
+    }
+    if (pts_us <= last_pts_us) {
+      pts_us = last_pts_us + 1;
+      ++out_of_order;
+    }
+    last_pts_us = pts_us;
+    next_pts_us = pts_us + frame_us;
+
+    if (pkt->flags & AV_PKT_FLAG_KEY) {
+      keyframes_.push_back({.frame = frame_count_, .seg_num = segment.seg_num, .segment_id = i, .pts_us = pts_us});
+    }
+
+    pkt->stream_index = out_stream->index;
+    pkt->pts = pkt->dts = av_rescale_q(pts_us, MICROSECONDS, out_stream->time_base);
+    pkt->duration = av_rescale_q(frame_us, MICROSECONDS, out_stream->time_base);
+    pkt->pos = -1;
+    int err = av_interleaved_write_frame(ofmt_ctx, pkt);
+    if (err < 0) {
+      rError("segment %d: failed to write frame %d, error %d", segment.seg_num, i, err);
+      return false;
+    }
+    ++frame_count_;
+  }
+
+  if (out_of_order > 0) {
+    rWarning("segment %d: moved %d frames with timestamps out of order", segment.seg_num, out_of_order);
+  }
+  return true;
+}
+
+bool VideoConcat::writeKeyframeIndex(const std::string &file) const {
+  std::ofstream fs(file, std::ios::out | std::ios::trunc);
+  if (!fs) return false;
+  fs << "frame,segment,segment_id,pts_us\n";
+  for (const auto &k : keyframes_) {
+    fs << k.frame << "," << k.seg_num << "," << k.segment_id << "," << k.pts_us << "\n";
+  }
+  return fs.good();
+}
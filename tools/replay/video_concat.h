@@ -0,0 +1,73 @@
+#pragma once
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include "cereal/gen/cpp/log.capnp.h"
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+}
+
+struct ConcatSegment {
+  int seg_num;
+  std::string video;
+  // log with the EncodeIndex of the video, used when no timestamps are given
+  std::string log;
+  // timestampEof of every frame in the file, in presentation order
+  std::vector<uint64_t> timestamps;
+};
+
+struct KeyframeIndexEntry {
+  int frame;
+  int seg_num;
+  int segment_id;
+  int64_t pts_us;
+};
+
+// Stitches the per-segment camera files of a route into one seekable file. Packets are remuxed as
+// they are, timestamps are rebased to the first frame of the route. Segments are demuxed in
+// parallel and muxed in order, only a few of them are held in memory at a time.
+class VideoConcat {
+public:
+  VideoConcat(cereal::Event::Which encode_idx_type, int threads = 0);
+  // the output container is picked from the file extension
+  bool concat(const std::vector<ConcatSegment> &segments, const std::string &output, std::atomic<bool> *abort = nullptr);
+  bool writeKeyframeIndex(const std::string &file) const;
+
+  const std::vector<KeyframeIndexEntry> &keyframes() const { return keyframes_; }
+  int frameCount() const { return frame_count_; }
+
+private:
+  struct DemuxedSegment {
+    DemuxedSegment() = default;
+    DemuxedSegment(DemuxedSegment &&other);
+    ~DemuxedSegment();
+
+    bool ok = false;
+    AVCodecParameters *codecpar = nullptr;
+    AVRational time_base = {1, 1000000};
+    AVRational frame_rate = {20, 1};
+    std::vector<AVPacket *> packets;
+    std::vector<uint64_t> timestamps;
+  };
+
+  DemuxedSegment demux(const ConcatSegment &segment, std::atomic<bool> *abort);
+  std::vector<uint64_t> readTimestamps(const std::string &log, std::atomic<bool> *abort);
+  bool openOutput(const std::string &output, const DemuxedSegment &first);
+  bool mux(const ConcatSegment &segment, DemuxedSegment &demuxed);
+
+  cereal::Event::Which encode_idx_type;
+  int threads;
+
+  AVFormatContext *ofmt_ctx = nullptr;
+  AVStream *out_stream = nullptr;
+  AVCodecParameters *out_codecpar = nullptr;
+  uint64_t base_timestamp = 0;
+  int64_t next_pts_us = 0;
+  int64_t last_pts_us = -1;
+  int frame_count_ = 0;
+  std::vector<KeyframeIndexEntry> keyframes_;
+};